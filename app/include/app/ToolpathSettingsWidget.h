@@ -73,6 +73,7 @@ private:
     QComboBox* m_cutDirection{nullptr};
     QDoubleSpinBox* m_leaveStock{nullptr};
     QCheckBox* m_useHeightField{nullptr};
+    QCheckBox* m_cutterAwareRaster{nullptr};
     QPushButton* m_generateButton{nullptr};
     QCheckBox* m_strategyOverrideCheck{nullptr};
     QTableWidget* m_strategyTable{nullptr};
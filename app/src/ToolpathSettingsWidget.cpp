@@ -125,6 +125,11 @@ ToolpathSettingsWidget::ToolpathSettingsWidget(QWidget* parent)
     m_useHeightField->setToolTip(tr("Build a sampled height field when OpenCL acceleration is unavailable."));
     form->addRow(tr("HeightField"), m_useHeightField);
 
+    m_cutterAwareRaster = new QCheckBox(tr("Drop full cutter footprint"), this);
+    m_cutterAwareRaster->setToolTip(
+        tr("Raster passes rest the whole flat or ball cutter on the height field instead of the point under its centre."));
+    form->addRow(tr("Cutter-Aware Raster"), m_cutterAwareRaster);
+
     m_enableRamp = new QCheckBox(tr("Ramp entries"), this);
     m_enableRamp->setToolTip(tr("When enabled, replace plunges with linear ramps using the angle below."));
     form->addRow(tr("Ramp Entry"), m_enableRamp);
@@ -253,6 +258,11 @@ ToolpathSettingsWidget::ToolpathSettingsWidget(QWidget* parent)
         validateInputs();
     });
 
+    connect(m_cutterAwareRaster, &QCheckBox::toggled, this, [this](bool) {
+        syncParamsFromWidgets();
+        validateInputs();
+    });
+
     connect(m_enableRamp, &QCheckBox::toggled, this, [this](bool checked) {
         if (m_rampAngle)
         {
@@ -306,6 +316,7 @@ ToolpathSettingsWidget::ToolpathSettingsWidget(QWidget* parent)
     m_paramsMm.spindle = 12'000.0;
     m_paramsMm.rasterAngleDeg = 0.0;
     m_paramsMm.useHeightField = true;
+    m_paramsMm.cutterAwareRaster = false;
     m_paramsMm.cutterType = tp::UserParams::CutterType::FlatEndmill;
     m_paramsMm.enableRamp = true;
     m_paramsMm.rampAngleDeg = 3.0;
@@ -614,6 +625,7 @@ void ToolpathSettingsWidget::syncWidgetsFromParams()
     QSignalBlocker blocker13(m_leadIn);
     QSignalBlocker blocker14(m_leadOut);
     QSignalBlocker blocker15(m_cutDirection);
+    QSignalBlocker blocker16(m_cutterAwareRaster);
 
     m_toolDiameter->setValue(displayFromMm(m_paramsMm.toolDiameter));
     m_stepOver->setValue(displayFromMm(m_paramsMm.stepOver));
@@ -629,6 +641,10 @@ void ToolpathSettingsWidget::syncWidgetsFromParams()
     {
         m_useHeightField->setChecked(m_paramsMm.useHeightField);
     }
+    if (m_cutterAwareRaster)
+    {
+        m_cutterAwareRaster->setChecked(m_paramsMm.cutterAwareRaster);
+    }
     if (m_enableRamp)
     {
         m_enableRamp->setChecked(m_paramsMm.enableRamp);
@@ -684,6 +700,10 @@ void ToolpathSettingsWidget::syncParamsFromWidgets()
     {
         m_paramsMm.useHeightField = m_useHeightField->isChecked();
     }
+    if (m_cutterAwareRaster)
+    {
+        m_paramsMm.cutterAwareRaster = m_cutterAwareRaster->isChecked();
+    }
     if (m_enableRamp)
     {
         m_paramsMm.enableRamp = m_enableRamp->isChecked();
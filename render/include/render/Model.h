@@ -6,6 +6,7 @@
 #include <QtCore/QString>
 #include <QtGui/QVector3D>
 
+#include <memory>
 #include <vector>
 
 #ifdef Index
@@ -37,6 +38,10 @@ public:
     [[nodiscard]] const std::vector<Index>& indices() const;
     [[nodiscard]] bool isValid() const;
 
+    // Identifies the current mesh data for caches keyed on a model. Copies share it, setMeshData()
+    // replaces it, and it expires once the last model holding it is destroyed.
+    [[nodiscard]] std::weak_ptr<const void> meshToken() const;
+
     [[nodiscard]] common::Bounds bounds() const;
 
     [[nodiscard]] QByteArray toObjFormat() const;
@@ -45,6 +50,7 @@ private:
     QString m_name;
     std::vector<Vertex> m_vertices;
     std::vector<Index> m_indices;
+    std::shared_ptr<const int> m_meshToken{std::make_shared<const int>(0)};
 };
 
 } // namespace render
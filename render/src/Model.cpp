@@ -23,6 +23,7 @@ void Model::setMeshData(std::vector<Vertex> vertices, std::vector<Model::Index>
 {
     m_vertices = std::move(vertices);
     m_indices = std::move(indices);
+    m_meshToken = std::make_shared<const int>(0);
 }
 
 const std::vector<Vertex>& Model::vertices() const
@@ -40,6 +41,11 @@ bool Model::isValid() const
     return !m_vertices.empty() && !m_indices.empty();
 }
 
+std::weak_ptr<const void> Model::meshToken() const
+{
+    return m_meshToken;
+}
+
 common::Bounds Model::bounds() const
 {
     common::Bounds result;
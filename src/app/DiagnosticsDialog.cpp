@@ -2,6 +2,8 @@
 
 #if WITH_EMBEDDED_TESTS
 
+#include "tp/ToolpathGenerator.h"
+
 #include <QAbstractItemView>
 #include <QBoxLayout>
 #include <QBrush>
@@ -45,6 +47,23 @@ QString joinTags(const QStringList& tags)
     return tags.join(", ");
 }
 
+QString formatCacheStats(const tp::HeightFieldCacheStats& stats)
+{
+    constexpr double kMiB = 1024.0 * 1024.0;
+    return QObject::tr("Height field cache: %1 entries, %2 / %3 MiB; %4 hits, %5 misses "
+                       "(%6 built, %7 downsampled, %8 from disk), %9 evicted, %10 invalidated")
+        .arg(static_cast<qulonglong>(stats.entries))
+        .arg(QString::number(static_cast<double>(stats.bytes) / kMiB, 'f', 1))
+        .arg(QString::number(static_cast<double>(stats.capacityBytes) / kMiB, 'f', 1))
+        .arg(static_cast<qulonglong>(stats.hits))
+        .arg(static_cast<qulonglong>(stats.misses))
+        .arg(static_cast<qulonglong>(stats.builds))
+        .arg(static_cast<qulonglong>(stats.downsampled))
+        .arg(static_cast<qulonglong>(stats.diskHits))
+        .arg(static_cast<qulonglong>(stats.evictions))
+        .arg(static_cast<qulonglong>(stats.invalidations));
+}
+
 tests_core::RunOptions toOptions(tests_core::RunMode mode)
 {
     tests_core::RunOptions options;
@@ -84,6 +103,11 @@ DiagnosticsDialog::DiagnosticsDialog(QWidget* parent)
     m_summaryLabel = new QLabel(tr("No diagnostics run."), this);
     rootLayout->addWidget(m_summaryLabel);
 
+    m_cacheLabel = new QLabel(this);
+    m_cacheLabel->setWordWrap(true);
+    rootLayout->addWidget(m_cacheLabel);
+    refreshCacheStats();
+
     auto* bottomRow = new QHBoxLayout();
     m_openLogsButton = new QPushButton(tr("Open Build Logs"), this);
     m_exportReportButton = new QPushButton(tr("Open Diagnostics Report"), this);
@@ -115,9 +139,15 @@ void DiagnosticsDialog::runTests(tests_core::RunMode mode)
     const tests_core::RunSummary summary = tests_core::runTests(toOptions(mode));
     m_lastSummary = summary;
     displaySummary(m_lastSummary);
+    refreshCacheStats();
     updateRunButtons(false);
 }
 
+void DiagnosticsDialog::refreshCacheStats()
+{
+    m_cacheLabel->setText(formatCacheStats(tp::ToolpathGenerator::heightFieldCacheStats()));
+}
+
 void DiagnosticsDialog::displaySummary(const tests_core::RunSummary& summary)
 {
     m_resultsView->clear();
@@ -212,6 +242,7 @@ QString DiagnosticsDialog::buildReportMarkdown(const tests_core::RunSummary& sum
     lines << tr("- Tests executed: %1").arg(summary.executed);
     lines << tr("- Tests failed: %1").arg(summary.failed);
     lines << tr("- Total duration: %1 ms").arg(QString::number(summary.durationMs, 'f', 2));
+    lines << tr("- %1").arg(formatCacheStats(tp::ToolpathGenerator::heightFieldCacheStats()));
     lines << QStringLiteral("");
     lines << QStringLiteral("## Results");
 
@@ -31,6 +31,7 @@ private:
     void displaySummary(const tests_core::RunSummary& summary);
     QString buildReportMarkdown(const tests_core::RunSummary& summary) const;
     void updateRunButtons(bool running);
+    void refreshCacheStats();
 
     QPushButton* m_runFastButton{nullptr};
     QPushButton* m_runAllButton{nullptr};
@@ -38,6 +39,7 @@ private:
     QPushButton* m_exportReportButton{nullptr};
     QTreeWidget* m_resultsView{nullptr};
     QLabel* m_summaryLabel{nullptr};
+    QLabel* m_cacheLabel{nullptr};
     tests_core::RunSummary m_lastSummary;
 };
 
@@ -16,12 +16,14 @@
 #    include "ai/OnnxAI.h"
 #endif
 #include "io/ImportWorker.h"
+#include "tp/CycleTime.h"
 #include "tp/GenerateWorker.h"
 #include "tp/GCodeExporter.h"
 #include "tp/FanucPost.h"
 #include "tp/GRBLPost.h"
 #include "tp/HeidenhainPost.h"
 #include "tp/MarlinPost.h"
+#include "tp/heightfield/HeightFieldDiskCache.h"
 #include "render/Model.h"
 #include "render/ModelViewerWidget.h"
 #include "render/SimulationController.h"
@@ -298,6 +300,18 @@ void setRuntimeForceCpu(ai::IPathAI* ai, bool forceCpu)
 #endif
 }
 
+// Per-segment playback times under the machine's acceleration and corner limits.
+std::vector<double> simulationSegmentTimes(const std::shared_ptr<tp::Toolpath>& toolpath)
+{
+    std::vector<double> segmentTimes;
+    if (toolpath)
+    {
+        tp::CycleTimeEstimator estimator(toolpath->machine);
+        estimator.estimate(*toolpath, &segmentTimes);
+    }
+    return segmentTimes;
+}
+
 } // namespace
 
 MainWindow::MainWindow(QWidget* parent)
@@ -1523,6 +1537,9 @@ void MainWindow::createMachineMenu(QMenu* machineMenu)
         machine.rapidFeed_mm_min = 9'000.0;
         machine.maxFeed_mm_min = 3'000.0;
         machine.maxSpindleRPM = 24'000.0;
+        machine.maxAccel_mm_s2 = 500.0;
+        machine.maxJerk_mm_s3 = 0.0;
+        machine.junctionDeviation_mm = 0.01;
         machine.clearanceZ_mm = 5.0;
         machine.safeZ_mm = 15.0;
         applyMachinePreset(machine);
@@ -1535,6 +1552,9 @@ void MainWindow::createMachineMenu(QMenu* machineMenu)
         machine.rapidFeed_mm_min = 6'000.0;
         machine.maxFeed_mm_min = 2'500.0;
         machine.maxSpindleRPM = 18'000.0;
+        machine.maxAccel_mm_s2 = 300.0;
+        machine.maxJerk_mm_s3 = 0.0;
+        machine.junctionDeviation_mm = 0.02;
         machine.clearanceZ_mm = 6.0;
         machine.safeZ_mm = 20.0;
         applyMachinePreset(machine);
@@ -2224,6 +2244,17 @@ void MainWindow::startGenerateWorker(const tp::UserParams& settings)
 
     connect(m_generateProgress, &QProgressDialog::canceled, m_generateWorker, &tp::GenerateWorker::requestCancel);
     connect(m_generateWorker, &tp::GenerateWorker::progress, m_generateProgress, &QProgressDialog::setValue);
+    // Earlier passes are shown while later ones are still being generated.
+    connect(m_generateWorker,
+            &tp::GenerateWorker::passReady,
+            this,
+            [this](std::shared_ptr<tp::Toolpath> partial) {
+                if (m_viewer && partial)
+                {
+                    m_viewer->setToolpath(std::move(partial));
+                    m_showingPartialToolpath = true;
+                }
+            });
     connect(m_generateWorker,
             &tp::GenerateWorker::banner,
             this,
@@ -2235,6 +2266,7 @@ void MainWindow::startGenerateWorker(const tp::UserParams& settings)
             });
 
     m_generateTimer.start();
+    m_showingPartialToolpath = false;
     logMessage(tr("Toolpath generation started."));
 
     m_generateProgress->show();
@@ -2251,6 +2283,7 @@ void MainWindow::startGenerateWorker(const tp::UserParams& settings)
                 }
 
                 cleanupGeneration();
+                m_showingPartialToolpath = false;
 
                 if (!toolpath || toolpath->passes.empty())
                 {
@@ -2304,7 +2337,7 @@ void MainWindow::startGenerateWorker(const tp::UserParams& settings)
                 if (m_simulation)
                 {
                     m_simulation->setToolDiameter(m_lastUserParams.toolDiameter);
-                    m_simulation->setToolpath(m_currentToolpath);
+                    m_simulation->setToolpath(m_currentToolpath, simulationSegmentTimes(m_currentToolpath));
                     onSimulationStateChanged(m_simulation->state());
                     onSimulationProgressChanged(m_simulation->progress());
                 }
@@ -2326,11 +2359,16 @@ void MainWindow::startGenerateWorker(const tp::UserParams& settings)
                     logWarning(message);
                 }
                 displayToolpathMessage(message);
+                if (m_viewer && m_showingPartialToolpath)
+                {
+                    m_viewer->setToolpath(m_currentToolpath);
+                }
+                m_showingPartialToolpath = false;
                 if (m_simulation)
                 {
                     if (m_currentToolpath && !m_currentToolpath->empty())
                     {
-                        m_simulation->setToolpath(m_currentToolpath);
+                        m_simulation->setToolpath(m_currentToolpath, simulationSegmentTimes(m_currentToolpath));
                     }
                     else
                     {
@@ -2904,6 +2942,37 @@ void MainWindow::loadSettings()
     m_aiModelPath = settings.value(QStringLiteral("ai/modelPath"), m_aiModelPath).toString();
     m_forceCpuInference = settings.value(QStringLiteral("ai/forceCpu"), m_forceCpuInference).toBool();
 
+    // Height field budgets: in memory for this session, and on disk in the user cache directory so
+    // fields survive restarts. A zero disk budget disables the disk cache.
+    const qint64 heightFieldMemoryMiB =
+        settings
+            .value(QStringLiteral("cache/heightFieldMemoryMiB"),
+                   static_cast<qlonglong>(tp::ToolpathGenerator::heightFieldCacheStats().capacityBytes >> 20))
+            .toLongLong();
+    tp::ToolpathGenerator::setHeightFieldCacheCapacity(static_cast<std::size_t>(std::max<qint64>(0, heightFieldMemoryMiB))
+                                                       << 20);
+    // Quantized fields take 2 bytes per sample instead of 9; 0 keeps full precision.
+    const int heightFieldQuantumUm = settings.value(QStringLiteral("cache/heightFieldQuantumUm"), 0).toInt();
+    tp::ToolpathGenerator::setHeightFieldQuantum(std::max(0, heightFieldQuantumUm) * 0.001);
+    tp::ToolpathGenerator::setHeightFieldTiling(settings.value(QStringLiteral("cache/heightFieldTiled"), false).toBool());
+    tp::ToolpathGenerator::setHeightFieldLazyBuild(settings.value(QStringLiteral("cache/heightFieldLazy"), false).toBool());
+    const qint64 heightFieldDiskMiB =
+        settings
+            .value(QStringLiteral("cache/heightFieldDiskMiB"),
+                   static_cast<qlonglong>(tp::heightfield::HeightFieldDiskCache::kDefaultMaxBytes >> 20))
+            .toLongLong();
+    const QString cacheRoot = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheRoot.isEmpty() && heightFieldDiskMiB > 0)
+    {
+        tp::heightfield::HeightFieldDiskCache::instance().configure(
+            std::filesystem::path(QDir(cacheRoot).filePath(QStringLiteral("heightfields")).toStdU16String()),
+            static_cast<std::uint64_t>(heightFieldDiskMiB) << 20);
+    }
+    else
+    {
+        tp::heightfield::HeightFieldDiskCache::instance().configure({});
+    }
+
     tp::UserParams params = m_toolpathSettings->currentParameters();
     params.toolDiameter = settings.value(QStringLiteral("params/toolDiameter"), params.toolDiameter).toDouble();
     params.stepOver = settings.value(QStringLiteral("params/stepOver"), params.stepOver).toDouble();
@@ -2912,6 +2981,32 @@ void MainWindow::loadSettings()
     params.spindle = settings.value(QStringLiteral("params/spindle"), params.spindle).toDouble();
     params.rasterAngleDeg = settings.value(QStringLiteral("params/rasterAngle"), params.rasterAngleDeg).toDouble();
     params.useHeightField = settings.value(QStringLiteral("params/useHeightField"), params.useHeightField).toBool();
+    params.cutterAwareRaster =
+        settings.value(QStringLiteral("params/cutterAwareRaster"), params.cutterAwareRaster).toBool();
+    params.adaptiveHeightField =
+        settings.value(QStringLiteral("params/adaptiveHeightField"), params.adaptiveHeightField).toBool();
+    params.adaptiveHeightFieldTolerance_mm = settings
+                                                 .value(QStringLiteral("params/adaptiveHeightFieldTolerance"),
+                                                        params.adaptiveHeightFieldTolerance_mm)
+                                                 .toDouble();
+    params.prefetchHeightFieldTiles =
+        settings.value(QStringLiteral("params/prefetchHeightFieldTiles"), params.prefetchHeightFieldTiles).toBool();
+    params.rasterChordTolerance_mm =
+        settings.value(QStringLiteral("params/rasterChordTolerance"), params.rasterChordTolerance_mm).toDouble();
+    params.waterlineArcTolerance_mm =
+        settings.value(QStringLiteral("params/waterlineArcTolerance"), params.waterlineArcTolerance_mm).toDouble();
+    params.concurrentPasses =
+        settings.value(QStringLiteral("params/concurrentPasses"), params.concurrentPasses).toInt();
+    params.passOrderingSteps = static_cast<std::size_t>(
+        settings
+            .value(QStringLiteral("params/passOrderingSteps"), static_cast<qulonglong>(params.passOrderingSteps))
+            .toULongLong());
+    params.passOrderingBudget_ms =
+        settings.value(QStringLiteral("params/passOrderingTimeCap"), params.passOrderingBudget_ms).toDouble();
+    params.reverseOpenPolylines =
+        settings.value(QStringLiteral("params/reverseOpenPolylines"), params.reverseOpenPolylines).toBool();
+    params.linking = static_cast<tp::UserParams::Linking>(
+        settings.value(QStringLiteral("params/linking"), static_cast<int>(params.linking)).toInt());
     params.enableRamp = settings.value(QStringLiteral("params/enableRamp"), params.enableRamp).toBool();
     params.rampAngleDeg = settings.value(QStringLiteral("params/rampAngle"), params.rampAngleDeg).toDouble();
     params.enableHelical = settings.value(QStringLiteral("params/enableHelical"), params.enableHelical).toBool();
@@ -2963,6 +3058,10 @@ void MainWindow::loadSettings()
     m_machine.rapidFeed_mm_min = settings.value(QStringLiteral("machine/rapidFeed"), m_machine.rapidFeed_mm_min).toDouble();
     m_machine.maxFeed_mm_min = settings.value(QStringLiteral("machine/maxFeed"), m_machine.maxFeed_mm_min).toDouble();
     m_machine.maxSpindleRPM = settings.value(QStringLiteral("machine/maxSpindle"), m_machine.maxSpindleRPM).toDouble();
+    m_machine.maxAccel_mm_s2 = settings.value(QStringLiteral("machine/maxAccel"), m_machine.maxAccel_mm_s2).toDouble();
+    m_machine.maxJerk_mm_s3 = settings.value(QStringLiteral("machine/maxJerk"), m_machine.maxJerk_mm_s3).toDouble();
+    m_machine.junctionDeviation_mm =
+        settings.value(QStringLiteral("machine/junctionDeviation"), m_machine.junctionDeviation_mm).toDouble();
     m_machine.clearanceZ_mm = settings.value(QStringLiteral("machine/clearanceZ"), m_machine.clearanceZ_mm).toDouble();
     m_machine.safeZ_mm = settings.value(QStringLiteral("machine/safeZ"), m_machine.safeZ_mm).toDouble();
     m_machine.ensureValid();
@@ -3017,6 +3116,18 @@ void MainWindow::saveSettings() const
         settings.setValue(QStringLiteral("params/spindle"), params.spindle);
         settings.setValue(QStringLiteral("params/rasterAngle"), params.rasterAngleDeg);
         settings.setValue(QStringLiteral("params/useHeightField"), params.useHeightField);
+        settings.setValue(QStringLiteral("params/cutterAwareRaster"), params.cutterAwareRaster);
+        settings.setValue(QStringLiteral("params/adaptiveHeightField"), params.adaptiveHeightField);
+        settings.setValue(QStringLiteral("params/adaptiveHeightFieldTolerance"),
+                          params.adaptiveHeightFieldTolerance_mm);
+        settings.setValue(QStringLiteral("params/prefetchHeightFieldTiles"), params.prefetchHeightFieldTiles);
+        settings.setValue(QStringLiteral("params/rasterChordTolerance"), params.rasterChordTolerance_mm);
+        settings.setValue(QStringLiteral("params/waterlineArcTolerance"), params.waterlineArcTolerance_mm);
+        settings.setValue(QStringLiteral("params/concurrentPasses"), params.concurrentPasses);
+        settings.setValue(QStringLiteral("params/passOrderingSteps"), static_cast<qulonglong>(params.passOrderingSteps));
+        settings.setValue(QStringLiteral("params/passOrderingTimeCap"), params.passOrderingBudget_ms);
+        settings.setValue(QStringLiteral("params/reverseOpenPolylines"), params.reverseOpenPolylines);
+        settings.setValue(QStringLiteral("params/linking"), static_cast<int>(params.linking));
         settings.setValue(QStringLiteral("params/cutterType"), static_cast<int>(params.cutterType));
         settings.setValue(QStringLiteral("params/enableRamp"), params.enableRamp);
         settings.setValue(QStringLiteral("params/rampAngle"), params.rampAngleDeg);
@@ -3046,6 +3157,9 @@ void MainWindow::saveSettings() const
     settings.setValue(QStringLiteral("machine/rapidFeed"), m_machine.rapidFeed_mm_min);
     settings.setValue(QStringLiteral("machine/maxFeed"), m_machine.maxFeed_mm_min);
     settings.setValue(QStringLiteral("machine/maxSpindle"), m_machine.maxSpindleRPM);
+    settings.setValue(QStringLiteral("machine/maxAccel"), m_machine.maxAccel_mm_s2);
+    settings.setValue(QStringLiteral("machine/maxJerk"), m_machine.maxJerk_mm_s3);
+    settings.setValue(QStringLiteral("machine/junctionDeviation"), m_machine.junctionDeviation_mm);
     settings.setValue(QStringLiteral("machine/clearanceZ"), m_machine.clearanceZ_mm);
     settings.setValue(QStringLiteral("machine/safeZ"), m_machine.safeZ_mm);
 
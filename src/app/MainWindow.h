@@ -295,6 +295,8 @@ private:
     QProgressDialog* m_generateProgress{nullptr};
     QElapsedTimer m_importTimer;
     QElapsedTimer m_generateTimer;
+    // The viewer shows the passes of a generation still in progress instead of m_currentToolpath.
+    bool m_showingPartialToolpath{false};
     std::unique_ptr<ai::IPathAI> m_activeAiPrototype;
     bool m_forceCpuInference{false};
     std::unique_ptr<render::SimulationController> m_simulation;
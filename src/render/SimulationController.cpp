@@ -27,10 +27,11 @@ SimulationController::SimulationController(QObject* parent)
     connect(&m_timer, &QTimer::timeout, this, &SimulationController::onTick);
 }
 
-void SimulationController::setToolpath(std::shared_ptr<tp::Toolpath> toolpath)
+void SimulationController::setToolpath(std::shared_ptr<tp::Toolpath> toolpath, std::vector<double> segmentTimes)
 {
     stop();
     m_toolpath = std::move(toolpath);
+    m_segmentTimes = std::move(segmentTimes);
     rebuildSegments();
 }
 
@@ -171,7 +172,17 @@ void SimulationController::rebuildSegments()
     m_cutSpeed = cutFeed;
     m_rapidSpeed = rapidFeed;
 
+    // Given segment times follow the machine's acceleration and corner limits, so playback slows down where
+    // the machine would; a list that does not match the toolpath is ignored.
+    std::size_t segmentCount = 0;
+    for (const tp::Polyline& poly : m_toolpath->passes)
+    {
+        segmentCount += (poly.pts.size() < 2) ? 0 : poly.pts.size() - 1;
+    }
+    const bool timed = m_segmentTimes.size() == segmentCount;
+
     double cumulative = 0.0;
+    std::size_t segmentIndex = 0;
     for (const tp::Polyline& poly : m_toolpath->passes)
     {
         if (poly.pts.size() < 2)
@@ -183,19 +194,19 @@ void SimulationController::rebuildSegments()
         {
             const tp::Vertex& prev = poly.pts[i - 1];
             const tp::Vertex& curr = poly.pts[i];
+            const std::size_t index = segmentIndex++;
 
             QVector3D start(prev.p.x, prev.p.y, prev.p.z);
             QVector3D end(curr.p.x, curr.p.y, curr.p.z);
             const double length = distanceBetween(start, end);
-            if (length <= std::numeric_limits<double>::epsilon())
+            const bool rapid = poly.motion == tp::MotionType::Rapid;
+            const double speed = rapid ? m_rapidSpeed : m_cutSpeed;
+            const double duration = timed ? m_segmentTimes[index] : std::max(length / speed, 0.0);
+            if (length <= std::numeric_limits<double>::epsilon() || duration <= 0.0)
             {
                 continue;
             }
 
-            const bool rapid = poly.motion != tp::MotionType::Cut;
-            const double speed = rapid ? m_rapidSpeed : m_cutSpeed;
-            const double duration = std::max(length / speed, 0.0);
-
             Segment segment;
             segment.start = start;
             segment.end = end;
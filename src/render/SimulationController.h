@@ -28,7 +28,9 @@ public:
 
     explicit SimulationController(QObject* parent = nullptr);
 
-    void setToolpath(std::shared_ptr<tp::Toolpath> toolpath);
+    // segmentTimes holds the seconds for every segment of the toolpath's polylines in order, as
+    // tp::CycleTimeEstimator reports them; without them each segment runs at its constant feed.
+    void setToolpath(std::shared_ptr<tp::Toolpath> toolpath, std::vector<double> segmentTimes = {});
     void setToolDiameter(double diameterMm);
 
     void play();
@@ -81,6 +83,7 @@ private:
     double m_toolDiameter{6.0};
     double m_cutSpeed{20.0};  // mm/s
     double m_rapidSpeed{120.0}; // mm/s
+    std::vector<double> m_segmentTimes;
 
     std::size_t m_currentSegment{0};
 
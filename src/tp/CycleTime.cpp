@@ -0,0 +1,294 @@
+#include "tp/CycleTime.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace tp
+{
+
+namespace
+{
+
+constexpr double kMinSpeed_mm_s = 1.0;
+constexpr double kDefaultRapid_mm_min = 9'000.0;
+constexpr double kMinLength_mm = 1e-9;
+// Direction changes closer to straight than this blend at full speed; closer to a reversal they stop.
+constexpr double kStraightCosine = 0.999999;
+constexpr int kPeakIterations = 16;
+constexpr double kPeakTolerance = 1e-7;
+
+} // namespace
+
+CycleTimeEstimator::CycleTimeEstimator(const Machine& machine)
+    : m_accel(std::max(machine.maxAccel_mm_s2, 0.0))
+    , m_jerk(std::max(machine.maxJerk_mm_s3, 0.0))
+    , m_junctionDeviation(std::max(machine.junctionDeviation_mm, 0.0))
+{
+    m_jerkSpeedChange = (m_jerk > 0.0) ? m_accel * m_accel / m_jerk : 0.0;
+    m_inverseJerk = (m_jerk > 0.0) ? 1.0 / m_jerk : 0.0;
+}
+
+CycleTimeEstimate CycleTimeEstimator::estimate(const std::vector<Polyline>& polylines,
+                                               double feed_mm_min,
+                                               double rapidFeed_mm_min,
+                                               std::vector<double>* segmentTimes)
+{
+    const double cutSpeed = std::max(kMinSpeed_mm_s, feed_mm_min / 60.0);
+    const double rapidRate = (rapidFeed_mm_min > 0.0) ? rapidFeed_mm_min : kDefaultRapid_mm_min;
+    const double rapidSpeed = std::max(kMinSpeed_mm_s, rapidRate / 60.0);
+
+    // Collect the moves with the speed each corner allows. Zero-length segments keep their output slot.
+    m_moves.clear();
+    m_segmentLengths.clear();
+    std::size_t output = 0;
+    glm::dvec3 lastDirection(0.0);
+    for (const Polyline& poly : polylines)
+    {
+        if (poly.pts.size() < 2)
+        {
+            continue;
+        }
+        const double speed = (poly.motion == MotionType::Rapid) ? rapidSpeed : cutSpeed;
+        for (std::size_t i = 1; i < poly.pts.size(); ++i)
+        {
+            const glm::dvec3 delta = glm::dvec3(poly.pts[i].p) - glm::dvec3(poly.pts[i - 1].p);
+            const double length = glm::length(delta);
+            if (segmentTimes)
+            {
+                m_segmentLengths.push_back(length);
+            }
+            if (length <= kMinLength_mm)
+            {
+                ++output;
+                continue;
+            }
+            const glm::dvec3 direction = delta / length;
+            double corner = 0.0;
+            if (!m_moves.empty())
+            {
+                Move& last = m_moves.back();
+                corner = junctionSpeed(lastDirection, direction);
+                if (last.motion == poly.motion && last.speed == speed && corner >= speed)
+                {
+                    last.length += length;
+                    last.lastOutput = output++;
+                    lastDirection = direction;
+                    continue;
+                }
+                corner = std::min({corner, speed, last.speed});
+            }
+            Move move;
+            move.length = length;
+            move.speed = speed;
+            move.entry = corner;
+            move.firstOutput = output;
+            move.lastOutput = output++;
+            move.motion = poly.motion;
+            m_moves.push_back(move);
+            lastDirection = direction;
+        }
+    }
+
+    CycleTimeEstimate result;
+    result.segments = output;
+    if (segmentTimes)
+    {
+        segmentTimes->assign(output, 0.0);
+    }
+
+    const auto record = [&](const Move& move, double time) {
+        result.total_s += time;
+        switch (move.motion)
+        {
+        case MotionType::Cut:
+            result.cut_s += time;
+            break;
+        case MotionType::Link:
+            result.link_s += time;
+            break;
+        case MotionType::Rapid:
+            result.rapid_s += time;
+            break;
+        }
+        if (segmentTimes)
+        {
+            for (std::size_t i = move.firstOutput; i <= move.lastOutput; ++i)
+            {
+                (*segmentTimes)[i] = (m_segmentLengths[i] > kMinLength_mm) ? time * m_segmentLengths[i] / move.length
+                                                                           : 0.0;
+            }
+        }
+    };
+
+    // Without an acceleration limit every move runs at its feed throughout.
+    if (m_accel <= 0.0)
+    {
+        for (const Move& move : m_moves)
+        {
+            record(move, move.length / move.speed);
+        }
+        return result;
+    }
+
+    // Backward pass: every move has to be able to slow down to the entry speed of the next one.
+    double exit = 0.0;
+    for (auto it = m_moves.rbegin(); it != m_moves.rend(); ++it)
+    {
+        if (it->entry > exit && changeDistance(exit, it->entry) > it->length)
+        {
+            it->entry = reachableSpeed(exit, it->length);
+        }
+        exit = it->entry;
+    }
+
+    // Forward pass: speed up only as far as each move allows, then time the resulting profile.
+    double entry = 0.0;
+    for (std::size_t i = 0; i < m_moves.size(); ++i)
+    {
+        const Move& move = m_moves[i];
+        double moveExit = (i + 1 < m_moves.size()) ? m_moves[i + 1].entry : 0.0;
+        if (moveExit > entry && changeDistance(entry, moveExit) > move.length)
+        {
+            moveExit = reachableSpeed(entry, move.length);
+        }
+        record(move, moveTime(entry, moveExit, move.speed, move.length));
+        entry = moveExit;
+    }
+    return result;
+}
+
+CycleTimeEstimate CycleTimeEstimator::estimate(const Toolpath& toolpath, std::vector<double>* segmentTimes)
+{
+    const double rapidFeed = (toolpath.machine.rapidFeed_mm_min > 0.0) ? toolpath.machine.rapidFeed_mm_min
+                                                                        : toolpath.rapidFeed;
+    return estimate(toolpath.passes, toolpath.feed, rapidFeed, segmentTimes);
+}
+
+// Junction deviation as in GRBL: the fastest speed at which the corner, rounded by the allowed deviation,
+// can be taken at full acceleration.
+double CycleTimeEstimator::junctionSpeed(const glm::dvec3& before, const glm::dvec3& after) const
+{
+    const double cosine = -glm::dot(before, after);
+    if (cosine > kStraightCosine)
+    {
+        return 0.0;
+    }
+    if (cosine < -kStraightCosine)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    const double sinHalf = std::sqrt(0.5 * (1.0 - cosine));
+    return std::sqrt(m_accel * m_junctionDeviation * sinHalf / (1.0 - sinHalf));
+}
+
+// Highest speed reached from `from` over `length` at full acceleration and jerk.
+double CycleTimeEstimator::reachableSpeed(double from, double length) const
+{
+    if (m_jerk <= 0.0)
+    {
+        return std::sqrt(from * from + 2.0 * m_accel * length);
+    }
+
+    const double k = m_jerkSpeedChange;
+    if (changeDistance(from, from + k) < length)
+    {
+        // Full acceleration is reached: (v^2 - from^2) / 2a + (from + v) a / 2j = length.
+        return 0.5 * (-k + std::sqrt(k * k + 4.0 * (2.0 * m_accel * length + from * from - k * from)));
+    }
+
+    // Jerk limited throughout: with s = sqrt(v - from), s^3 + 2 from s = length sqrt(j). Newton's method
+    // from an upper bound converges from above on this convex cubic.
+    const double p = 2.0 * from;
+    const double q = length * std::sqrt(m_jerk);
+    double s = std::cbrt(q);
+    if (p > 0.0)
+    {
+        s = std::min(s, q / p);
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        s -= (s * s * s + p * s - q) / (3.0 * s * s + p);
+    }
+    return from + s * s;
+}
+
+double CycleTimeEstimator::changeTime(double deltaSpeed) const
+{
+    if (m_jerk <= 0.0)
+    {
+        return deltaSpeed / m_accel;
+    }
+    if (deltaSpeed >= m_jerkSpeedChange)
+    {
+        return deltaSpeed / m_accel + m_accel / m_jerk;
+    }
+    return 2.0 * std::sqrt(deltaSpeed * m_inverseJerk);
+}
+
+// The S-curve is symmetric, so the average speed over a change is the mean of its end speeds.
+double CycleTimeEstimator::changeDistance(double from, double to) const
+{
+    return 0.5 * (from + to) * changeTime(std::abs(to - from));
+}
+
+double CycleTimeEstimator::moveTime(double entry, double exit, double speed, double length) const
+{
+    const double accelerate = changeDistance(entry, speed);
+    const double decelerate = changeDistance(exit, speed);
+    if (accelerate + decelerate <= length)
+    {
+        return changeTime(speed - entry) + changeTime(speed - exit) + (length - accelerate - decelerate) / speed;
+    }
+
+    // The move is too short to reach its feed; find the peak whose speed-up and slow-down fill it.
+    const double fast = std::max(entry, exit);
+    double peak = std::min(speed, std::sqrt(m_accel * length + 0.5 * (entry * entry + exit * exit)));
+    if (m_jerk > 0.0)
+    {
+        // The trapezoid's peak bounds the S-curve's from above; bracketed Newton steps from there find the
+        // peak to within a relative distance error of kPeakTolerance.
+        double low = fast;
+        double high = peak;
+        const auto side = [&](double from, double& time, double& slope) {
+            const double delta = peak - from;
+            if (delta >= m_jerkSpeedChange)
+            {
+                time = delta / m_accel + m_accel / m_jerk;
+                slope = 0.5 * time + 0.5 * (from + peak) / m_accel;
+                return 0.5 * (from + peak) * time;
+            }
+            const double root = std::sqrt(std::max(delta, kMinLength_mm) * m_inverseJerk);
+            time = 2.0 * root;
+            slope = root + 0.5 * (from + peak) * m_inverseJerk / root;
+            return (from + peak) * root;
+        };
+        for (int i = 0; i < kPeakIterations; ++i)
+        {
+            double entryTime = 0.0;
+            double exitTime = 0.0;
+            double entrySlope = 0.0;
+            double exitSlope = 0.0;
+            const double excess = side(entry, entryTime, entrySlope) + side(exit, exitTime, exitSlope) - length;
+            if (std::abs(excess) <= kPeakTolerance * length)
+            {
+                return entryTime + exitTime;
+            }
+            (excess > 0.0 ? high : low) = peak;
+            const double next = peak - excess / (entrySlope + exitSlope);
+            peak = (next > low && next < high) ? next : 0.5 * (low + high);
+        }
+    }
+    peak = std::max(peak, fast);
+    return changeTime(peak - entry) + changeTime(peak - exit);
+}
+
+CycleTimeEstimate estimateCycleTime(const Toolpath& toolpath)
+{
+    CycleTimeEstimator estimator(toolpath.machine);
+    return estimator.estimate(toolpath);
+}
+
+} // namespace tp
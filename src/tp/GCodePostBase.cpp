@@ -380,7 +380,7 @@ void GCodePostBase::emitLinearMove(std::ostringstream& out,
                                    common::UnitSystem units,
                                    double /*feedUnits*/) const
 {
-    const char* code = (motion == MotionType::Cut) ? "G1" : "G0";
+    const char* code = (motion == MotionType::Rapid) ? "G0" : "G1";
     out << code
         << " X" << formatNumber(toUnits(point.x, units))
         << " Y" << formatNumber(toUnits(point.y, units))
@@ -436,8 +436,9 @@ void GCodePostBase::emitPolyline(std::ostringstream& out,
         return;
     }
 
+    // Links between cuts stay near the material, so they run at feed like the cuts; only cuts are arc fitted.
     const bool isCut = (poly.motion == MotionType::Cut);
-    if (isCut)
+    if (poly.motion != MotionType::Rapid)
     {
         emitFeedCommand(out, feedUnits);
     }
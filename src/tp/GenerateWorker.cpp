@@ -47,14 +47,29 @@ void GenerateWorker::run()
         emit progress(value);
     };
 
+    Toolpath partial;
+    auto sink = [this, &partial](const ToolpathChunk& chunk) {
+        if (chunk.passIndex + 1 >= chunk.passCount)
+        {
+            return;
+        }
+        if (partial.passes.empty())
+        {
+            partial = *chunk.settings;
+        }
+        partial.passes.insert(partial.passes.end(), chunk.polylines.begin(), chunk.polylines.end());
+        emit passReady(std::make_shared<Toolpath>(partial));
+    };
+
     std::string bannerMessage;
-    Toolpath result = m_generator.generate(*m_model,
-                                           m_params,
-                                           *m_ai,
-                                           m_cancelled,
-                                           progressCallback,
-                                           &decision,
-                                           &bannerMessage);
+    Toolpath result = m_generator.generateStreaming(*m_model,
+                                                    m_params,
+                                                    *m_ai,
+                                                    m_cancelled,
+                                                    sink,
+                                                    progressCallback,
+                                                    &decision,
+                                                    &bannerMessage);
 
     if (m_cancelled.load(std::memory_order_relaxed))
     {
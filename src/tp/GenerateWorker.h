@@ -36,6 +36,8 @@ public:
 
     Q_SIGNALS:
     void progress(int value);
+    // Everything generated so far, emitted after each pass except the last; finished() delivers that one.
+    void passReady(std::shared_ptr<tp::Toolpath> partial);
     void finished(std::shared_ptr<tp::Toolpath> toolpath, ai::StrategyDecision decision);
     void error(const QString& message);
     void banner(const QString& message);
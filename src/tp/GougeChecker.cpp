@@ -93,6 +93,37 @@ double pointTriangleDistanceSquared(const glm::dvec3& point,
     return glm::dot(diff, diff);
 }
 
+// Highest Z along the edge from a to b where its XY projection lies within the disc; -inf when the edge
+// misses the disc.
+double edgeMaxUnderDisc(const glm::dvec3& a, const glm::dvec3& b, double x, double y, double radius)
+{
+    const double dx = b.x - a.x;
+    const double dy = b.y - a.y;
+    const double ox = a.x - x;
+    const double oy = a.y - y;
+    const double along = dx * dx + dy * dy;
+    const double outside = ox * ox + oy * oy - radius * radius;
+    if (along <= kEpsilon * kEpsilon)
+    {
+        return (outside <= 0.0) ? std::max(a.z, b.z) : -std::numeric_limits<double>::infinity();
+    }
+
+    const double half = dx * ox + dy * oy;
+    const double discriminant = half * half - along * outside;
+    if (discriminant < 0.0)
+    {
+        return -std::numeric_limits<double>::infinity();
+    }
+    const double root = std::sqrt(discriminant);
+    const double enter = std::max((-half - root) / along, 0.0);
+    const double leave = std::min((-half + root) / along, 1.0);
+    if (enter > leave)
+    {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return a.z + (b.z - a.z) * ((b.z > a.z) ? leave : enter);
+}
+
 } // namespace
 
 namespace tp
@@ -101,10 +132,9 @@ namespace tp
 GougeChecker::GougeChecker(const render::Model& model)
     : m_grid(model, 0.0)
 {
-    m_candidateScratch.reserve(128);
 }
 
-GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point) const
+GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point, QueryContext& context) const
 {
     ClosestHit result;
     if (m_grid.empty())
@@ -114,9 +144,10 @@ GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point) const
 
     glm::dvec3 query(static_cast<double>(point.x), static_cast<double>(point.y), static_cast<double>(point.z));
 
+    std::vector<std::uint32_t>& candidates = context.candidates;
     auto gatherWithRadius = [&](int radius) {
-        m_grid.gatherCandidatesXY(query.x, query.y, radius, m_candidateScratch);
-        return !m_candidateScratch.empty();
+        m_grid.gatherCandidatesXY(query.x, query.y, radius, context);
+        return !candidates.empty();
     };
 
     if (!gatherWithRadius(1))
@@ -131,22 +162,23 @@ GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point) const
     glm::dvec3 bestPoint{0.0};
     bool found = false;
 
-    for (std::uint32_t index : m_candidateScratch)
+    for (std::uint32_t index : candidates)
     {
         if (index >= m_grid.triangleCount())
         {
             continue;
         }
-        const TriangleGrid::Triangle& tri = m_grid.triangle(index);
+        const TriangleGrid::Corners& tri = m_grid.corners(index);
 
-        const double verticalComponent = std::abs(tri.normal.z);
+        const double verticalComponent = std::abs(static_cast<double>(tri.normalZ));
         if (verticalComponent <= 0.1)
         {
             continue;
         }
 
         glm::dvec3 candidatePoint{0.0};
-        const double dist2 = pointTriangleDistanceSquared(query, tri.v0, tri.v1, tri.v2, candidatePoint);
+        const double dist2 = pointTriangleDistanceSquared(
+            query, glm::dvec3(tri.v0), glm::dvec3(tri.v1), glm::dvec3(tri.v2), candidatePoint);
         if (candidatePoint.z > query.z + 1e-4)
         {
             continue;
@@ -161,7 +193,7 @@ GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point) const
 
     if (!found)
     {
-        m_candidateScratch.clear();
+        candidates.clear();
         return result;
     }
 
@@ -169,13 +201,19 @@ GougeChecker::ClosestHit GougeChecker::closestPoint(const Vec3& point) const
     result.distance = std::sqrt(bestDist2);
     result.closestPoint =
         Vec3(static_cast<float>(bestPoint.x), static_cast<float>(bestPoint.y), static_cast<float>(bestPoint.z));
-    m_candidateScratch.clear();
+    candidates.clear();
     return result;
 }
 
 std::optional<double> GougeChecker::surfaceHeightAt(const Vec3& sample) const
 {
-    const ClosestHit hit = closestPoint(sample);
+    thread_local QueryContext context;
+    return surfaceHeightAt(sample, context);
+}
+
+std::optional<double> GougeChecker::surfaceHeightAt(const Vec3& sample, QueryContext& context) const
+{
+    const ClosestHit hit = closestPoint(sample, context);
     if (!hit.hit)
     {
         return std::nullopt;
@@ -183,6 +221,86 @@ std::optional<double> GougeChecker::surfaceHeightAt(const Vec3& sample) const
     return static_cast<double>(hit.closestPoint.z);
 }
 
+std::optional<double> GougeChecker::maxHeightUnderDisc(double x,
+                                                     double y,
+                                                     double radius,
+                                                     QueryContext& context) const
+{
+    if (m_grid.empty())
+    {
+        return std::nullopt;
+    }
+
+    radius = std::max(radius, 0.0);
+    m_grid.gatherCandidatesAABB(x - radius, y - radius, x + radius, y + radius, context);
+
+    double best = -std::numeric_limits<double>::infinity();
+    for (std::uint32_t index : context.candidates)
+    {
+        const TriangleGrid::CullRecord& cull = m_grid.cull(index);
+        if (static_cast<double>(cull.maxX) < x - radius || static_cast<double>(cull.minX) > x + radius
+            || static_cast<double>(cull.maxY) < y - radius || static_cast<double>(cull.minY) > y + radius)
+        {
+            continue;
+        }
+        const double dx = static_cast<double>(cull.centroidX) - x;
+        const double dy = static_cast<double>(cull.centroidY) - y;
+        const double reach = std::sqrt(static_cast<double>(cull.boundingRadiusSq)) + radius;
+        if (dx * dx + dy * dy > reach * reach)
+        {
+            continue;
+        }
+
+        // The plane's highest value over the disc, capped at the top corner, cheaply skips triangles that
+        // cannot raise the result.
+        const TriangleGrid::SurfaceRecord& surface = m_grid.surface(index);
+        const double slopeX = static_cast<double>(surface.slopeX);
+        const double slopeY = static_cast<double>(surface.slopeY);
+        const double slope = std::sqrt(slopeX * slopeX + slopeY * slopeY);
+        double bound = static_cast<double>(cull.maxZ);
+        if (surface.valid)
+        {
+            const double planeAtCentre = static_cast<double>(surface.originZ)
+                                         + slopeX * (x - static_cast<double>(surface.originX))
+                                         + slopeY * (y - static_cast<double>(surface.originY));
+            bound = std::min(bound, planeAtCentre + radius * slope);
+        }
+        if (bound <= best)
+        {
+            continue;
+        }
+
+        // The bound counts a triangle only partly under the disc, like a steep wall beside the tool, with
+        // its top. Its highest point under the disc lies on an edge or, on a sloped plane, at the uphill
+        // point of the disc's rim.
+        const TriangleGrid::Corners& corners = m_grid.corners(index);
+        const glm::dvec3 a(corners.v0);
+        const glm::dvec3 b(corners.v1);
+        const glm::dvec3 c(corners.v2);
+        double exact = std::max({edgeMaxUnderDisc(a, b, x, y, radius),
+                                 edgeMaxUnderDisc(b, c, x, y, radius),
+                                 edgeMaxUnderDisc(c, a, x, y, radius)});
+        if (surface.valid)
+        {
+            const double rimX = (slope > 0.0) ? x + radius * slopeX / slope : x;
+            const double rimY = (slope > 0.0) ? y + radius * slopeY / slope : y;
+            double rimZ = 0.0;
+            if (m_grid.surfaceHeightAt(index, rimX, rimY, kEpsilon, kEpsilon, rimZ))
+            {
+                exact = std::max(exact, rimZ);
+            }
+        }
+        best = std::max(best, exact);
+    }
+    context.candidates.clear();
+
+    if (!std::isfinite(best))
+    {
+        return std::nullopt;
+    }
+    return best;
+}
+
 double GougeChecker::minClearanceAlong(const std::vector<Vec3>& path, const GougeParams& params) const
 {
     if (path.size() < 2 || m_grid.empty())
@@ -193,6 +311,7 @@ double GougeChecker::minClearanceAlong(const std::vector<Vec3>& path, const Goug
     const double sampleSpacing = std::max(0.5, params.toolRadius * 0.5);
     double minClearance = std::numeric_limits<double>::infinity();
     bool sawSample = false;
+    thread_local QueryContext context;
 
     for (std::size_t i = 0; i + 1 < path.size(); ++i)
     {
@@ -205,7 +324,7 @@ double GougeChecker::minClearanceAlong(const std::vector<Vec3>& path, const Goug
         {
             const double t = static_cast<double>(s) / static_cast<double>(samples);
             const Vec3 sample = start + static_cast<float>(t) * (end - start);
-            const ClosestHit hit = closestPoint(sample);
+            const ClosestHit hit = closestPoint(sample, context);
             if (!hit.hit)
             {
                 continue;
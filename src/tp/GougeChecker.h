@@ -29,11 +29,21 @@ class GougeChecker
 {
 public:
     using Vec3 = glm::vec3;
+    using QueryContext = TriangleGrid::QueryContext;
 
     explicit GougeChecker(const render::Model& model);
 
     [[nodiscard]] double minClearanceAlong(const std::vector<Vec3>& path, const GougeParams& params) const;
     [[nodiscard]] std::optional<double> surfaceHeightAt(const Vec3& sample) const;
+    // Reentrant variant for hot loops and worker threads; keep one context per thread.
+    [[nodiscard]] std::optional<double> surfaceHeightAt(const Vec3& sample, QueryContext& context) const;
+    // Highest model point under the disc of the given radius around (x, y); nullopt when no triangle
+    // reaches the disc. Exact for each triangle, so walls just touching the disc's rim count with their
+    // height there rather than their top.
+    [[nodiscard]] std::optional<double> maxHeightUnderDisc(double x,
+                                                           double y,
+                                                           double radius,
+                                                           QueryContext& context) const;
 
     struct AdjustResult
     {
@@ -55,10 +65,9 @@ private:
         Vec3 closestPoint{0.0f};
     };
 
-    [[nodiscard]] ClosestHit closestPoint(const Vec3& point) const;
+    [[nodiscard]] ClosestHit closestPoint(const Vec3& point, QueryContext& context) const;
 
     TriangleGrid m_grid;
-    mutable std::vector<std::uint32_t> m_candidateScratch;
 };
 
 } // namespace tp
@@ -70,7 +70,7 @@ void HeidenhainPost::emitLinearMove(std::ostringstream& out,
         << " X" << formatNumber(toUnits(point.x, units))
         << " Y" << formatNumber(toUnits(point.y, units))
         << " Z" << formatNumber(toUnits(point.z, units));
-    if (motion == MotionType::Cut)
+    if (motion != MotionType::Rapid)
     {
         out << " F" << formatNumber(feedUnits);
     }
@@ -16,6 +16,9 @@ void Machine::ensureValid()
     rapidFeed_mm_min = std::max(rapidFeed_mm_min, kMinFeed);
     maxFeed_mm_min = std::max(maxFeed_mm_min, kMinFeed);
     maxSpindleRPM = std::max(maxSpindleRPM, kMinSpindle);
+    maxAccel_mm_s2 = std::max(maxAccel_mm_s2, 0.0);
+    maxJerk_mm_s3 = std::max(maxJerk_mm_s3, 0.0);
+    junctionDeviation_mm = std::max(junctionDeviation_mm, 0.0);
     clearanceZ_mm = std::max(clearanceZ_mm, 0.0);
     safeZ_mm = std::max(safeZ_mm, clearanceZ_mm);
 }
@@ -11,6 +11,12 @@ struct Machine
     double rapidFeed_mm_min{3'000.0};
     double maxFeed_mm_min{2'000.0};
     double maxSpindleRPM{12'000.0};
+    // Path acceleration and jerk the controller plans with. A jerk of 0 plans trapezoidal speed changes
+    // and an acceleration of 0 leaves acceleration out of cycle-time estimates.
+    double maxAccel_mm_s2{500.0};
+    double maxJerk_mm_s3{10'000.0};
+    // How far a corner may be rounded off when it is taken without stopping (GRBL's junction deviation).
+    double junctionDeviation_mm{0.01};
     double clearanceZ_mm{5.0};
     double safeZ_mm{15.0};
 
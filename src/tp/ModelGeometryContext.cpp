@@ -0,0 +1,96 @@
+#include "tp/ModelGeometryContext.h"
+
+#include "render/Model.h"
+#include "tp/GougeChecker.h"
+#include "tp/heightfield/UniformGrid.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace tp
+{
+
+namespace
+{
+
+struct Registry
+{
+    struct Entry
+    {
+        std::weak_ptr<const void> meshToken;
+        std::shared_ptr<ModelGeometryContext> context;
+    };
+
+    std::mutex mutex;
+    std::vector<Entry> entries;
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+ModelGeometryContext::~ModelGeometryContext() = default;
+
+std::shared_ptr<ModelGeometryContext> ModelGeometryContext::forModel(const render::Model& model)
+{
+    const std::weak_ptr<const void> meshToken = model.meshToken();
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::erase_if(reg.entries, [](const Registry::Entry& entry) { return entry.meshToken.expired(); });
+    for (const Registry::Entry& entry : reg.entries)
+    {
+        if (!entry.meshToken.owner_before(meshToken) && !meshToken.owner_before(entry.meshToken))
+        {
+            return entry.context;
+        }
+    }
+    auto context = std::make_shared<ModelGeometryContext>();
+    reg.entries.push_back({meshToken, context});
+    return context;
+}
+
+const waterline::ZSlicer& ModelGeometryContext::slicer(const render::Model& model)
+{
+    std::call_once(m_slicerOnce, [&] { m_slicer = std::make_unique<const waterline::ZSlicer>(model, 1e-4); });
+    return *m_slicer;
+}
+
+const GougeChecker& ModelGeometryContext::gougeChecker(const render::Model& model)
+{
+    std::call_once(m_gougeOnce, [&] { m_gougeChecker = std::make_unique<const GougeChecker>(model); });
+    return *m_gougeChecker;
+}
+
+std::shared_ptr<const heightfield::UniformGrid> ModelGeometryContext::uniformGrid(const render::Model& model,
+                                                                                  double cellSizeMm)
+{
+    // Built under the lock: concurrent passes asking for the same grid wait for one build. Dense height
+    // field builds are already deduplicated upstream, so there is little to gain from finer locking.
+    std::lock_guard<std::mutex> lock(m_gridMutex);
+    for (GridEntry& entry : m_grids)
+    {
+        if (std::abs(entry.cellSize - cellSizeMm) < 1e-9)
+        {
+            entry.lastUse = ++m_clock;
+            return entry.grid;
+        }
+    }
+
+    if (m_grids.size() >= kMaxUniformGrids)
+    {
+        m_grids.erase(std::min_element(m_grids.begin(), m_grids.end(), [](const GridEntry& a, const GridEntry& b) {
+            return a.lastUse < b.lastUse;
+        }));
+    }
+    auto grid = std::make_shared<const heightfield::UniformGrid>(model, cellSizeMm);
+    m_grids.push_back({cellSizeMm, grid, ++m_clock});
+    return grid;
+}
+
+} // namespace tp
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace render
+{
+class Model;
+}
+
+namespace tp
+{
+
+class GougeChecker;
+
+namespace heightfield
+{
+class UniformGrid;
+}
+
+namespace waterline
+{
+class ZSlicer;
+}
+
+// Mesh acceleration structures for one model, each built on first use and then shared by every pass,
+// every regeneration and every thread. Contexts are keyed on Model::meshToken(): copies of a model share
+// one context and setMeshData() starts a new one. Removal is lazy: the registry lets go of contexts whose
+// mesh is gone the next time forModel() is called, and a context is freed once no caller holds it either.
+// The accessors build from the model they are given, which must carry the mesh the context belongs to.
+class ModelGeometryContext
+{
+public:
+    // Grids for at most this many cell sizes are kept; the least recently used one is dropped first.
+    static constexpr std::size_t kMaxUniformGrids = 4;
+
+    ModelGeometryContext() = default;
+    ModelGeometryContext(const ModelGeometryContext&) = delete;
+    ModelGeometryContext& operator=(const ModelGeometryContext&) = delete;
+    ~ModelGeometryContext();
+
+    // Shared context for the model's current mesh, created on first request.
+    [[nodiscard]] static std::shared_ptr<ModelGeometryContext> forModel(const render::Model& model);
+
+    [[nodiscard]] const waterline::ZSlicer& slicer(const render::Model& model);
+    [[nodiscard]] const GougeChecker& gougeChecker(const render::Model& model);
+    [[nodiscard]] std::shared_ptr<const heightfield::UniformGrid> uniformGrid(const render::Model& model,
+                                                                              double cellSizeMm);
+
+private:
+    struct GridEntry
+    {
+        double cellSize{0.0};
+        std::shared_ptr<const heightfield::UniformGrid> grid;
+        std::uint64_t lastUse{0};
+    };
+
+    std::once_flag m_slicerOnce;
+    std::unique_ptr<const waterline::ZSlicer> m_slicer;
+    std::once_flag m_gougeOnce;
+    std::unique_ptr<const GougeChecker> m_gougeChecker;
+    std::mutex m_gridMutex;
+    std::vector<GridEntry> m_grids;
+    std::uint64_t m_clock{0};
+};
+
+} // namespace tp
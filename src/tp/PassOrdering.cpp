@@ -0,0 +1,809 @@
+#include "tp/PassOrdering.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace tp
+{
+
+namespace
+{
+
+constexpr std::size_t kCandidateCount = 6;
+// The precedence guard is skipped, and with it the improvement stage, when nearby polylines at different
+// depths are this dense; checking moves against that many constraints costs more than it saves.
+constexpr std::size_t kMaxConflictsPerPolyline = 64;
+constexpr double kMinImprovement_mm = 1e-6;
+
+double horizontalDistance(const glm::dvec3& a, const glm::dvec3& b)
+{
+    const double dx = a.x - b.x;
+    const double dy = a.y - b.y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// Uniform XY grid over a fixed point set. Points can be removed; nearest() then only sees the rest.
+class PointGrid
+{
+public:
+    explicit PointGrid(const std::vector<glm::dvec3>& points)
+        : m_points(points)
+        , m_slot(points.size(), 0)
+    {
+        double minX = std::numeric_limits<double>::max();
+        double minY = std::numeric_limits<double>::max();
+        double maxX = std::numeric_limits<double>::lowest();
+        double maxY = std::numeric_limits<double>::lowest();
+        for (const glm::dvec3& p : points)
+        {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+        const double width = std::max(maxX - minX, 0.0);
+        const double height = std::max(maxY - minY, 0.0);
+        const double count = static_cast<double>(std::max<std::size_t>(points.size(), 1));
+        // About one point per cell, with the cell count bounded along each axis.
+        m_cellSize = std::max({std::sqrt(width * height / count),
+                               std::max(width, height) / count,
+                               width / 4095.0,
+                               height / 4095.0,
+                               1e-6});
+        m_minX = minX;
+        m_minY = minY;
+        m_columns = static_cast<long long>(width / m_cellSize) + 1;
+        m_rows = static_cast<long long>(height / m_cellSize) + 1;
+        m_cells.resize(static_cast<std::size_t>(m_columns * m_rows));
+        for (std::size_t i = 0; i < points.size(); ++i)
+        {
+            auto& cell = m_cells[cellIndex(column(points[i].x), row(points[i].y))];
+            m_slot[i] = static_cast<std::uint32_t>(cell.size());
+            cell.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    void remove(std::size_t index)
+    {
+        auto& cell = m_cells[cellIndex(column(m_points[index].x), row(m_points[index].y))];
+        const std::uint32_t slot = m_slot[index];
+        cell[slot] = cell.back();
+        m_slot[cell[slot]] = slot;
+        cell.pop_back();
+    }
+
+    // Closest remaining point, ties going to the lowest index, exactly as a linear scan with a strict
+    // comparison would pick it. Returns the point count when none is left.
+    std::size_t nearest(const glm::dvec3& from) const
+    {
+        std::size_t best = m_points.size();
+        double bestDist = std::numeric_limits<double>::max();
+        forRings(from, [&](double ringBound) { return best < m_points.size() && ringBound > bestDist; },
+                 [&](std::uint32_t index) {
+                     const double dist = horizontalDistance(from, m_points[index]);
+                     if (dist < bestDist || (dist == bestDist && index < best))
+                     {
+                         bestDist = dist;
+                         best = index;
+                     }
+                 });
+        return best;
+    }
+
+    // The k closest points with distinct owner(index) other than skipOwner, nearest first.
+    template <typename Owner>
+    void nearestOwners(const glm::dvec3& from,
+                       std::size_t k,
+                       std::uint32_t skipOwner,
+                       const Owner& owner,
+                       std::vector<std::pair<double, std::uint32_t>>& out) const
+    {
+        out.clear();
+        forRings(from, [&](double ringBound) { return out.size() == k && ringBound > out.back().first; },
+                 [&](std::uint32_t index) {
+                     const std::uint32_t id = owner(index);
+                     if (id == skipOwner)
+                     {
+                         return;
+                     }
+                     const double dist = horizontalDistance(from, m_points[index]);
+                     const auto existing = std::find_if(out.begin(), out.end(), [&](const auto& entry) {
+                         return entry.second == id;
+                     });
+                     if (existing != out.end())
+                     {
+                         if (dist >= existing->first)
+                         {
+                             return;
+                         }
+                         out.erase(existing);
+                     }
+                     else if (out.size() == k)
+                     {
+                         if (dist >= out.back().first)
+                         {
+                             return;
+                         }
+                         out.pop_back();
+                     }
+                     out.insert(std::upper_bound(out.begin(), out.end(), std::make_pair(dist, id)),
+                                std::make_pair(dist, id));
+                 });
+    }
+
+private:
+    long long column(double x) const
+    {
+        return static_cast<long long>(std::floor((x - m_minX) / m_cellSize));
+    }
+
+    long long row(double y) const
+    {
+        return static_cast<long long>(std::floor((y - m_minY) / m_cellSize));
+    }
+
+    std::size_t cellIndex(long long col, long long r) const
+    {
+        return static_cast<std::size_t>(std::clamp(r, 0LL, m_rows - 1) * m_columns
+                                        + std::clamp(col, 0LL, m_columns - 1));
+    }
+
+    // Visits the cells in square rings around from, innermost first, until done(bound) holds for the
+    // smallest distance any point of the next ring can have.
+    template <typename Done, typename Visit>
+    void forRings(const glm::dvec3& from, const Done& done, const Visit& visit) const
+    {
+        const long long cx = column(from.x);
+        const long long cy = row(from.y);
+        const long long firstRing = std::max({-cx, cx - (m_columns - 1), -cy, cy - (m_rows - 1), 0LL});
+        const long long lastRing = std::max({std::abs(cx), std::abs(cx - (m_columns - 1)), std::abs(cy),
+                                             std::abs(cy - (m_rows - 1))});
+
+        const auto visitCell = [&](long long col, long long r) {
+            if (col < 0 || col >= m_columns || r < 0 || r >= m_rows)
+            {
+                return;
+            }
+            for (std::uint32_t index : m_cells[static_cast<std::size_t>(r * m_columns + col)])
+            {
+                visit(index);
+            }
+        };
+
+        for (long long ring = firstRing; ring <= lastRing; ++ring)
+        {
+            if (ring > 0)
+            {
+                // Points in this ring lie outside the square of the rings inside it.
+                const double left = from.x - (m_minX + static_cast<double>(cx - ring + 1) * m_cellSize);
+                const double right = m_minX + static_cast<double>(cx + ring) * m_cellSize - from.x;
+                const double bottom = from.y - (m_minY + static_cast<double>(cy - ring + 1) * m_cellSize);
+                const double top = m_minY + static_cast<double>(cy + ring) * m_cellSize - from.y;
+                if (done(std::max(0.0, std::min({left, right, bottom, top}))))
+                {
+                    return;
+                }
+            }
+            if (ring == 0)
+            {
+                visitCell(cx, cy);
+                continue;
+            }
+            const long long colBegin = std::max(cx - ring, 0LL);
+            const long long colEnd = std::min(cx + ring, m_columns - 1);
+            for (long long col = colBegin; col <= colEnd; ++col)
+            {
+                visitCell(col, cy - ring);
+                visitCell(col, cy + ring);
+            }
+            const long long rowBegin = std::max(cy - ring + 1, 0LL);
+            const long long rowEnd = std::min(cy + ring - 1, m_rows - 1);
+            for (long long r = rowBegin; r <= rowEnd; ++r)
+            {
+                visitCell(cx - ring, r);
+                visitCell(cx + ring, r);
+            }
+        }
+    }
+
+    const std::vector<glm::dvec3>& m_points;
+    std::vector<std::uint32_t> m_slot;
+    std::vector<std::vector<std::uint32_t>> m_cells;
+    double m_minX{0.0};
+    double m_minY{0.0};
+    double m_cellSize{1.0};
+    long long m_columns{1};
+    long long m_rows{1};
+};
+
+// For each polyline, the polylines it must keep its relative order with: those passing within the
+// clearance whose lowest points differ. Empty when there are too many to be worth checking.
+std::vector<std::vector<std::uint32_t>> buildConflicts(const std::vector<Polyline>& polylines,
+                                                       std::size_t begin,
+                                                       std::size_t count,
+                                                       double clearance,
+                                                       bool& tooDense)
+{
+    tooDense = false;
+    std::vector<std::vector<std::uint32_t>> conflicts(count);
+    if (clearance <= 0.0)
+    {
+        return conflicts;
+    }
+
+    // Cells of side clearance that each polyline passes through, grown by one cell so polylines in
+    // neighbouring cells meet in a shared one.
+    std::vector<double> minZ(count, 0.0);
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> marks;
+    std::vector<std::uint64_t> touched;
+    const auto cellKey = [](long long col, long long r) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(col)) << 32)
+               | static_cast<std::uint32_t>(r);
+    };
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::vector<Vertex>& pts = polylines[begin + i].pts;
+        touched.clear();
+        double lowest = std::numeric_limits<double>::max();
+        long long lastCol = std::numeric_limits<long long>::min();
+        long long lastRow = std::numeric_limits<long long>::min();
+        for (std::size_t p = 0; p < pts.size(); ++p)
+        {
+            lowest = std::min(lowest, static_cast<double>(pts[p].p.z));
+            const glm::dvec3 a(pts[p].p);
+            const glm::dvec3 b(pts[std::min(p + 1, pts.size() - 1)].p);
+            const int steps = std::max(1, static_cast<int>(std::ceil(horizontalDistance(a, b) / clearance)));
+            for (int s = 0; s < steps; ++s)
+            {
+                const glm::dvec3 q = a + (b - a) * (static_cast<double>(s) / static_cast<double>(steps));
+                const auto col = static_cast<long long>(std::floor(q.x / clearance));
+                const auto r = static_cast<long long>(std::floor(q.y / clearance));
+                if (col != lastCol || r != lastRow)
+                {
+                    touched.push_back(cellKey(col, r));
+                    lastCol = col;
+                    lastRow = r;
+                }
+            }
+        }
+        minZ[i] = pts.empty() ? 0.0 : lowest;
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        const std::size_t own = touched.size();
+        for (std::size_t t = 0; t < own; ++t)
+        {
+            const auto col = static_cast<long long>(static_cast<std::int32_t>(touched[t] >> 32));
+            const auto r = static_cast<long long>(static_cast<std::int32_t>(touched[t] & 0xffffffffu));
+            for (long long dy = -1; dy <= 1; ++dy)
+            {
+                for (long long dx = -1; dx <= 1; ++dx)
+                {
+                    if (dx != 0 || dy != 0)
+                    {
+                        touched.push_back(cellKey(col + dx, r + dy));
+                    }
+                }
+            }
+        }
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (std::uint64_t key : touched)
+        {
+            marks.emplace_back(key, static_cast<std::uint32_t>(i));
+        }
+    }
+    std::sort(marks.begin(), marks.end());
+
+    const std::size_t pairBudget = kMaxConflictsPerPolyline * count;
+    std::size_t pairs = 0;
+    for (std::size_t first = 0; first < marks.size();)
+    {
+        std::size_t last = first + 1;
+        while (last < marks.size() && marks[last].first == marks[first].first)
+        {
+            ++last;
+        }
+        for (std::size_t a = first; a < last; ++a)
+        {
+            for (std::size_t b = a + 1; b < last; ++b)
+            {
+                const std::uint32_t ea = marks[a].second;
+                const std::uint32_t eb = marks[b].second;
+                if (std::abs(minZ[ea] - minZ[eb]) > 1e-4)
+                {
+                    conflicts[ea].push_back(eb);
+                    conflicts[eb].push_back(ea);
+                    if (++pairs > pairBudget)
+                    {
+                        tooDense = true;
+                        return {};
+                    }
+                }
+            }
+        }
+        first = last;
+    }
+    for (auto& list : conflicts)
+    {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    return conflicts;
+}
+
+// 2-opt and Or-opt moves over a nearest-neighbour order. Elements are indices into the pass range; an
+// element's head is where the tool enters it and its tail where it leaves.
+class OrderImprover
+{
+public:
+    OrderImprover(std::vector<std::uint32_t>& order,
+                  std::vector<char>& flipped,
+                  const std::vector<glm::dvec3>& starts,
+                  const std::vector<glm::dvec3>& ends,
+                  const glm::dvec3* seed,
+                  bool allowReverse,
+                  const std::vector<std::vector<std::uint32_t>>& conflicts)
+        : m_order(order)
+        , m_flipped(flipped)
+        , m_starts(starts)
+        , m_ends(ends)
+        , m_seed(seed)
+        , m_allowReverse(allowReverse)
+        , m_conflicts(conflicts)
+        , m_position(order.size(), 0)
+    {
+        const std::size_t count = order.size();
+        for (std::size_t p = 0; p < count; ++p)
+        {
+            m_position[order[p]] = static_cast<std::uint32_t>(p);
+        }
+
+        // Candidate neighbours: polylines with an end point near either end of this one.
+        std::vector<glm::dvec3> endpoints;
+        endpoints.reserve(2 * count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            endpoints.push_back(starts[i]);
+            endpoints.push_back(ends[i]);
+        }
+        const PointGrid grid(endpoints);
+        const auto owner = [](std::uint32_t index) { return index / 2; };
+        m_candidates.resize(count);
+        std::vector<std::pair<double, std::uint32_t>> nearest;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto& list = m_candidates[i];
+            for (const glm::dvec3& from : {starts[i], ends[i]})
+            {
+                grid.nearestOwners(from, kCandidateCount, static_cast<std::uint32_t>(i), owner, nearest);
+                for (const auto& entry : nearest)
+                {
+                    list.push_back(entry.second);
+                }
+            }
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+        }
+    }
+
+    // Applies improving moves until none is left, maxSteps positions have been tried or the deadline, if
+    // any, passes; returns the number applied.
+    std::size_t run(std::size_t maxSteps,
+                    const std::optional<std::chrono::steady_clock::time_point>& deadline,
+                    bool& exhausted)
+    {
+        exhausted = false;
+        std::size_t applied = 0;
+        std::size_t steps = 0;
+        bool improved = true;
+        while (improved)
+        {
+            improved = false;
+            for (std::size_t p = 0; p < m_order.size(); ++p)
+            {
+                if (steps++ == maxSteps
+                    || (deadline && (steps & 63) == 0 && std::chrono::steady_clock::now() >= *deadline))
+                {
+                    exhausted = true;
+                    return applied;
+                }
+                if (tryOrOpt(p) || tryTwoOpt(p))
+                {
+                    improved = true;
+                    ++applied;
+                }
+            }
+        }
+        return applied;
+    }
+
+private:
+    static constexpr std::ptrdiff_t kNone = -1;
+
+    glm::dvec3 head(std::uint32_t element) const
+    {
+        return m_flipped[element] ? m_ends[element] : m_starts[element];
+    }
+
+    glm::dvec3 tail(std::uint32_t element) const
+    {
+        return m_flipped[element] ? m_starts[element] : m_ends[element];
+    }
+
+    bool symmetric(std::uint32_t element) const
+    {
+        return m_starts[element] == m_ends[element];
+    }
+
+    // Air move from the element at position from (or the seed for -1) to the point to; 0 without a source.
+    double linkFrom(std::ptrdiff_t from, const glm::dvec3& to) const
+    {
+        if (from >= 0)
+        {
+            return horizontalDistance(tail(m_order[static_cast<std::size_t>(from)]), to);
+        }
+        return m_seed ? horizontalDistance(*m_seed, to) : 0.0;
+    }
+
+    double linkTo(const glm::dvec3& from, std::ptrdiff_t to) const
+    {
+        if (to < 0 || static_cast<std::size_t>(to) >= m_order.size())
+        {
+            return 0.0;
+        }
+        return horizontalDistance(from, head(m_order[static_cast<std::size_t>(to)]));
+    }
+
+    double link(std::ptrdiff_t from, std::ptrdiff_t to) const
+    {
+        if (to < 0 || static_cast<std::size_t>(to) >= m_order.size())
+        {
+            return 0.0;
+        }
+        return linkFrom(from, head(m_order[static_cast<std::size_t>(to)]));
+    }
+
+    // True when an element in positions [first, last] must stay on its side of a partner at a position
+    // in [rangeFirst, rangeLast].
+    bool crossesConflict(std::size_t first, std::size_t last, std::size_t rangeFirst, std::size_t rangeLast) const
+    {
+        if (m_conflicts.empty())
+        {
+            return false;
+        }
+        for (std::size_t p = first; p <= last; ++p)
+        {
+            for (std::uint32_t partner : m_conflicts[m_order[p]])
+            {
+                const std::size_t partnerPos = m_position[partner];
+                if (partnerPos >= rangeFirst && partnerPos <= rangeLast)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void updatePositions(std::size_t first, std::size_t last)
+    {
+        for (std::size_t p = first; p <= last; ++p)
+        {
+            m_position[m_order[p]] = static_cast<std::uint32_t>(p);
+        }
+    }
+
+    // Moves the chain of one to three elements starting at position p, keeping its direction, to sit right
+    // after position target (-1 for the front).
+    bool tryOrOpt(std::size_t p)
+    {
+        const std::size_t count = m_order.size();
+        for (std::size_t length = 1; length <= 3 && p + length <= count; ++length)
+        {
+            const auto first = static_cast<std::ptrdiff_t>(p);
+            const auto last = static_cast<std::ptrdiff_t>(p + length - 1);
+            const glm::dvec3 chainHead = head(m_order[p]);
+            const glm::dvec3 chainTail = tail(m_order[p + length - 1]);
+            const double removeGain = link(first - 1, first) + linkTo(chainTail, last + 1) - link(first - 1, last + 1);
+            if (removeGain <= kMinImprovement_mm)
+            {
+                continue;
+            }
+
+            std::ptrdiff_t bestTarget = kNone - 1;
+            double bestDelta = -kMinImprovement_mm;
+            const auto consider = [&](std::ptrdiff_t target) {
+                if (target >= first - 1 && target <= last)
+                {
+                    return;
+                }
+                const double insertCost = linkFrom(target, chainHead) + linkTo(chainTail, target + 1)
+                                          - link(target, target + 1);
+                const double delta = insertCost - removeGain;
+                if (delta < bestDelta)
+                {
+                    bestDelta = delta;
+                    bestTarget = target;
+                }
+            };
+            for (std::size_t offset = 0; offset < length; ++offset)
+            {
+                for (std::uint32_t candidate : m_candidates[m_order[p + offset]])
+                {
+                    const auto candidatePos = static_cast<std::ptrdiff_t>(m_position[candidate]);
+                    consider(candidatePos);
+                    consider(candidatePos - 1);
+                }
+            }
+            if (m_seed)
+            {
+                consider(kNone);
+            }
+            if (bestTarget < kNone)
+            {
+                continue;
+            }
+
+            if (bestTarget < first)
+            {
+                const auto jumpedFirst = static_cast<std::size_t>(bestTarget + 1);
+                if (crossesConflict(p, p + length - 1, jumpedFirst, p - 1))
+                {
+                    continue;
+                }
+                std::rotate(m_order.begin() + bestTarget + 1, m_order.begin() + first, m_order.begin() + last + 1);
+                updatePositions(jumpedFirst, p + length - 1);
+            }
+            else
+            {
+                const auto target = static_cast<std::size_t>(bestTarget);
+                if (crossesConflict(p, p + length - 1, p + length, target))
+                {
+                    continue;
+                }
+                std::rotate(m_order.begin() + first, m_order.begin() + last + 1, m_order.begin() + bestTarget + 1);
+                updatePositions(p, target);
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Reverses the run of elements from position p to a later position, which turns each of them around:
+    // closed loops keep their direction since they start where they end, open polylines are flipped.
+    bool tryTwoOpt(std::size_t p)
+    {
+        if (p == 0 && !m_seed)
+        {
+            return false;
+        }
+        const auto first = static_cast<std::ptrdiff_t>(p);
+        const glm::dvec3 before = p > 0 ? tail(m_order[p - 1]) : *m_seed;
+        const double oldIn = link(first - 1, first);
+
+        std::ptrdiff_t bestLast = kNone;
+        double bestDelta = -kMinImprovement_mm;
+        const std::uint32_t anchor = p > 0 ? m_order[p - 1] : m_order[p];
+        for (std::uint32_t candidate : m_candidates[anchor])
+        {
+            const auto last = static_cast<std::ptrdiff_t>(m_position[candidate]);
+            if (last <= first)
+            {
+                continue;
+            }
+            const double oldOut = linkTo(tail(m_order[static_cast<std::size_t>(last)]), last + 1);
+            const double newIn = horizontalDistance(before, tail(m_order[static_cast<std::size_t>(last)]));
+            const double newOut = linkTo(head(m_order[p]), last + 1);
+            const double delta = newIn + newOut - oldIn - oldOut;
+            if (delta < bestDelta)
+            {
+                bestDelta = delta;
+                bestLast = last;
+            }
+        }
+        if (bestLast == kNone)
+        {
+            return false;
+        }
+
+        const auto last = static_cast<std::size_t>(bestLast);
+        for (std::size_t q = p; q <= last; ++q)
+        {
+            if (!m_allowReverse && !symmetric(m_order[q]))
+            {
+                return false;
+            }
+        }
+        if (crossesConflict(p, last, p, last))
+        {
+            return false;
+        }
+
+        std::reverse(m_order.begin() + first, m_order.begin() + bestLast + 1);
+        for (std::size_t q = p; q <= last; ++q)
+        {
+            if (!symmetric(m_order[q]))
+            {
+                m_flipped[m_order[q]] = m_flipped[m_order[q]] ? 0 : 1;
+            }
+        }
+        updatePositions(p, last);
+        return true;
+    }
+
+    std::vector<std::uint32_t>& m_order;
+    std::vector<char>& m_flipped;
+    const std::vector<glm::dvec3>& m_starts;
+    const std::vector<glm::dvec3>& m_ends;
+    const glm::dvec3* m_seed;
+    bool m_allowReverse{false};
+    const std::vector<std::vector<std::uint32_t>>& m_conflicts;
+    std::vector<std::uint32_t> m_position;
+    std::vector<std::vector<std::uint32_t>> m_candidates;
+};
+
+double rapidLength(const std::vector<std::uint32_t>& order,
+                   const std::vector<char>& flipped,
+                   const std::vector<glm::dvec3>& starts,
+                   const std::vector<glm::dvec3>& ends,
+                   const glm::dvec3* seed)
+{
+    double total = 0.0;
+    const glm::dvec3* previous = seed;
+    for (std::uint32_t element : order)
+    {
+        const glm::dvec3& head = flipped[element] ? ends[element] : starts[element];
+        if (previous)
+        {
+            total += horizontalDistance(*previous, head);
+        }
+        previous = flipped[element] ? &starts[element] : &ends[element];
+    }
+    return total;
+}
+
+} // namespace
+
+glm::dvec3 orderPassRange(std::vector<Polyline>& polylines,
+                          std::size_t begin,
+                          std::size_t end,
+                          const glm::dvec3* seedPosition,
+                          const PassOrderingOptions& options,
+                          PassOrderingStats* stats)
+{
+    if (stats)
+    {
+        *stats = PassOrderingStats{};
+    }
+    if (begin >= end)
+    {
+        return seedPosition ? *seedPosition : glm::dvec3{};
+    }
+
+    const std::size_t count = end - begin;
+    if (count == 1)
+    {
+        const Polyline& poly = polylines[begin];
+        if (poly.pts.empty())
+        {
+            return seedPosition ? *seedPosition : glm::dvec3{};
+        }
+        if (stats && seedPosition)
+        {
+            stats->rapidBefore_mm = horizontalDistance(*seedPosition, glm::dvec3(poly.pts.front().p));
+            stats->rapidNearestNeighbour_mm = stats->rapidBefore_mm;
+            stats->rapidAfter_mm = stats->rapidBefore_mm;
+        }
+        return glm::dvec3(poly.pts.back().p);
+    }
+
+    std::vector<glm::dvec3> starts(count);
+    std::vector<glm::dvec3> ends(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Polyline& poly = polylines[begin + i];
+        starts[i] = poly.pts.empty() ? glm::dvec3{} : glm::dvec3(poly.pts.front().p);
+        ends[i] = poly.pts.empty() ? glm::dvec3{} : glm::dvec3(poly.pts.back().p);
+    }
+
+    std::vector<std::uint32_t> order;
+    order.reserve(count);
+    std::vector<char> flipped(count, 0);
+    if (stats)
+    {
+        std::vector<std::uint32_t> identity(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            identity[i] = static_cast<std::uint32_t>(i);
+        }
+        stats->rapidBefore_mm = rapidLength(identity, flipped, starts, ends, seedPosition);
+    }
+
+    // Greedy nearest neighbour on start points, beginning next to the seed or, without one, at the start
+    // closest to the XY origin.
+    PointGrid grid(starts);
+    std::size_t current = 0;
+    if (seedPosition)
+    {
+        current = grid.nearest(*seedPosition);
+    }
+    else
+    {
+        double bestMetric = std::numeric_limits<double>::max();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double metric = std::abs(starts[i].x) + std::abs(starts[i].y);
+            if (metric < bestMetric)
+            {
+                bestMetric = metric;
+                current = i;
+            }
+        }
+    }
+    while (true)
+    {
+        grid.remove(current);
+        order.push_back(static_cast<std::uint32_t>(current));
+        if (order.size() == count)
+        {
+            break;
+        }
+        current = grid.nearest(ends[current]);
+    }
+
+    if (stats)
+    {
+        stats->rapidNearestNeighbour_mm = rapidLength(order, flipped, starts, ends, seedPosition);
+    }
+
+    if (options.improveSteps > 0 && count > 2)
+    {
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        if (options.improveBudget_ms > 0.0)
+        {
+            deadline = std::chrono::steady_clock::now()
+                       + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double, std::milli>(options.improveBudget_ms));
+        }
+        bool tooDense = false;
+        const auto conflicts = buildConflicts(polylines, begin, count, options.clearance_mm, tooDense);
+        if (!tooDense)
+        {
+            OrderImprover improver(order, flipped, starts, ends, seedPosition, options.allowReverse, conflicts);
+            bool exhausted = false;
+            const std::size_t improvements = improver.run(options.improveSteps, deadline, exhausted);
+            if (stats)
+            {
+                stats->improvements = improvements;
+                stats->budgetExhausted = exhausted;
+            }
+        }
+    }
+
+    if (stats)
+    {
+        stats->rapidAfter_mm = rapidLength(order, flipped, starts, ends, seedPosition);
+    }
+
+    std::vector<Polyline> reordered;
+    reordered.reserve(count);
+    for (std::uint32_t index : order)
+    {
+        reordered.push_back(std::move(polylines[begin + index]));
+        if (flipped[index])
+        {
+            std::reverse(reordered.back().pts.begin(), reordered.back().pts.end());
+        }
+    }
+    std::move(reordered.begin(), reordered.end(), polylines.begin() + static_cast<std::ptrdiff_t>(begin));
+
+    const std::uint32_t lastElement = order.back();
+    return flipped[lastElement] ? starts[lastElement] : ends[lastElement];
+}
+
+} // namespace tp
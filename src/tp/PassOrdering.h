@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tp/Toolpath.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace tp
+{
+
+struct PassOrderingOptions
+{
+    // Polylines closer than this in XY whose lowest points differ keep the relative order the
+    // nearest-neighbour stage gave them, so improvements never cut a deeper level before the one above it.
+    double clearance_mm{0.0};
+    // Open polylines may be cut end to start. Closed loops keep their direction either way.
+    bool allowReverse{false};
+    // Steps of the 2-opt/Or-opt stage after the greedy order, each trying the moves at one position of the
+    // order; 0 keeps the nearest-neighbour order. The stage stops at a local optimum or when the steps run
+    // out, so the result depends only on the input.
+    std::size_t improveSteps{0};
+    // Optional wall-clock cap on the same stage; 0 sets none. A cap that runs out makes the result depend
+    // on timing.
+    double improveBudget_ms{0.0};
+};
+
+// Horizontal air distance between consecutive polylines (and from the seed to the first), in mm.
+struct PassOrderingStats
+{
+    double rapidBefore_mm{0.0};
+    double rapidNearestNeighbour_mm{0.0};
+    double rapidAfter_mm{0.0};
+    std::size_t improvements{0};
+    // The improvement stage ran out of steps or time before reaching a local optimum.
+    bool budgetExhausted{false};
+};
+
+// Orders polylines[begin, end) to shorten the air moves between them: greedy nearest neighbour from the
+// seed (or from the start closest to the XY origin) over a uniform grid of start points, then
+// improvement moves under options.improveSteps and options.improveBudget_ms. Returns where the last
+// polyline ends.
+glm::dvec3 orderPassRange(std::vector<Polyline>& polylines,
+                          std::size_t begin,
+                          std::size_t end,
+                          const glm::dvec3* seedPosition,
+                          const PassOrderingOptions& options = {},
+                          PassOrderingStats* stats = nullptr);
+
+} // namespace tp
@@ -0,0 +1,907 @@
+#include "tp/PolygonClipper.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace tp
+{
+
+namespace
+{
+
+// Grid coordinates stay within +-2^29 of the origin, so every orientation test fits in 64 bits.
+constexpr double kGridLimit = 536870912.0;
+// Rounding the crossing points can make pieces cross again; each round splits at the new crossings.
+constexpr int kMaxSplitRounds = 16;
+// The intersection grid has at most this many cells per edge.
+constexpr double kCellsPerEdge = 2.0;
+// Arcs are never flatter than this fraction of the offset distance, which bounds the points per circle.
+constexpr double kMinArcTolerance = 1e-6;
+// Shifted points closer than this many grid steps can swap places when rounded and fold the offset over,
+// so loop vertices this close merge before offsetting and concave corners whose shifted ends are this
+// close take a single mitred point.
+constexpr double kMinOffsetStep = 2.0;
+constexpr double kPi = 3.14159265358979323846;
+constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+// Twice the signed area of triangle abc: positive when c lies left of a->b.
+template <typename P>
+std::int64_t orient(const P& a, const P& b, const P& c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+template <typename P>
+bool samePoint(const P& a, const P& b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+template <typename P>
+bool lessPoint(const P& a, const P& b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+// Whether c, on the line through a and b, lies strictly between them.
+template <typename P>
+bool strictlyBetween(const P& a, const P& b, const P& c)
+{
+    return !samePoint(c, a) && !samePoint(c, b) && c.x >= std::min(a.x, b.x) && c.x <= std::max(a.x, b.x)
+           && c.y >= std::min(a.y, b.y) && c.y <= std::max(a.y, b.y);
+}
+
+// Grid points as keys that sort like lessPoint().
+template <typename P>
+std::uint64_t pointKey(const P& p)
+{
+    constexpr std::int64_t kBias = std::int64_t{1} << 31;
+    return (static_cast<std::uint64_t>(p.x + kBias) << 32) | static_cast<std::uint64_t>(p.y + kBias);
+}
+
+int signOf(std::int64_t value)
+{
+    return (value > 0) - (value < 0);
+}
+
+bool filled(std::int32_t winding, FillRule fillRule)
+{
+    switch (fillRule)
+    {
+    case FillRule::EvenOdd:
+        return (winding & 1) != 0;
+    case FillRule::NonZero:
+        return winding != 0;
+    case FillRule::Positive:
+        return winding > 0;
+    }
+    return false;
+}
+
+bool inResult(ClipOperation operation, bool subject, bool clip)
+{
+    switch (operation)
+    {
+    case ClipOperation::Union:
+        return subject || clip;
+    case ClipOperation::Intersection:
+        return subject && clip;
+    case ClipOperation::Difference:
+        return subject && !clip;
+    case ClipOperation::Xor:
+        return subject != clip;
+    }
+    return false;
+}
+
+} // namespace
+
+PolygonClipper::PolygonClipper(double resolution_mm)
+    : m_resolution(std::max(1e-12, resolution_mm))
+{
+}
+
+void PolygonClipper::addPath(std::span<const glm::dvec2> path, Role role)
+{
+    if (path.size() < 3)
+    {
+        return;
+    }
+    m_inputPaths.push_back({m_inputPoints.size(), path.size(), role});
+    m_inputPoints.insert(m_inputPoints.end(), path.begin(), path.end());
+}
+
+void PolygonClipper::addPaths(std::span<const Path2> paths, Role role)
+{
+    for (const Path2& path : paths)
+    {
+        addPath(path, role);
+    }
+}
+
+void PolygonClipper::clear()
+{
+    m_inputPoints.clear();
+    m_inputPaths.clear();
+}
+
+std::vector<Path2> PolygonClipper::execute(ClipOperation operation, FillRule fillRule)
+{
+    setGrid(0.0);
+    buildEdges();
+    clear();
+    clipEdges(operation, fillRule);
+    return takeLoops();
+}
+
+std::vector<Path2> PolygonClipper::offset(double delta_mm, FillRule fillRule, double arcTolerance_mm)
+{
+    // Drop the clip paths, then resolve the subject into simple loops with the filled side on their left.
+    std::erase_if(m_inputPaths, [](const PathSpan& path) { return path.role != Role::Subject; });
+    setGrid(std::abs(delta_mm) + std::max(arcTolerance_mm, 0.0));
+    buildEdges();
+    clear();
+    clipEdges(ClipOperation::Union, fillRule);
+
+    const double delta = delta_mm * m_scale;
+    if (std::abs(delta) < 0.5 || m_loopEnds.empty())
+    {
+        return takeLoops();
+    }
+
+    // Shift every edge by delta along its outward normal, fill the gaps at convex corners with arcs and
+    // join concave corners through the original vertex. The raw loops self-intersect wherever the offset
+    // folds over; under the positive fill rule only what lies within delta of the region survives.
+    // Arcs are drawn with segments tangent to the true arc, which keep outside it by at most the tolerance
+    // with one point fewer than chords would; a corner that turns little takes a single such point, the
+    // mitre. A concave corner takes the mitre too when it cuts at most half of either edge, since the
+    // region it leaves out is then covered by both edges' shifted strips.
+    const double tolerance = std::clamp(arcTolerance_mm * m_scale,
+                                        std::abs(delta) * kMinArcTolerance,
+                                        std::abs(delta));
+    const double stepAngle = 2.0 * std::acos(std::abs(delta) / (std::abs(delta) + tolerance));
+    const auto push = [&](const glm::dvec2& p) {
+        m_rawPoints.push_back({static_cast<std::int64_t>(std::llround(p.x)),
+                               static_cast<std::int64_t>(std::llround(p.y))});
+    };
+
+    m_edges.clear();
+    std::size_t begin = 0;
+    for (const std::size_t end : m_loopEnds)
+    {
+        m_corners.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const glm::dvec2 point(static_cast<double>(m_loopPoints[i].x), static_cast<double>(m_loopPoints[i].y));
+            if (m_corners.empty() || glm::distance(point, m_corners.back()) >= kMinOffsetStep)
+            {
+                m_corners.push_back(point);
+            }
+        }
+        while (m_corners.size() > 1 && glm::distance(m_corners.back(), m_corners.front()) < kMinOffsetStep)
+        {
+            m_corners.pop_back();
+        }
+        begin = end;
+
+        // A loop within a couple of steps of a point grows into a disc, and shrinks away.
+        m_rawPoints.clear();
+        if (m_corners.size() < 3)
+        {
+            if (delta > 0.0)
+            {
+                const int steps = std::max(3, static_cast<int>(std::ceil(2.0 * kPi / stepAngle)));
+                const double radius = delta / std::cos(kPi / static_cast<double>(steps));
+                for (int step = 0; step < steps; ++step)
+                {
+                    const double turn = 2.0 * kPi * static_cast<double>(step) / static_cast<double>(steps);
+                    push(m_corners.front() + glm::dvec2(std::cos(turn), std::sin(turn)) * radius);
+                }
+                addEdges(m_rawPoints.data(), m_rawPoints.size(), Role::Subject);
+            }
+            continue;
+        }
+
+        const std::size_t count = m_corners.size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const glm::dvec2 current = m_corners[i];
+            const glm::dvec2 edgeBefore = current - m_corners[(i + count - 1) % count];
+            const glm::dvec2 edgeAfter = m_corners[(i + 1) % count] - current;
+            const double lengthBefore = glm::length(edgeBefore);
+            const double lengthAfter = glm::length(edgeAfter);
+            const glm::dvec2 before = edgeBefore / lengthBefore;
+            const glm::dvec2 after = edgeAfter / lengthAfter;
+            const glm::dvec2 normalBefore(before.y, -before.x);
+            const glm::dvec2 normalAfter(after.y, -after.x);
+            const double sine = before.x * after.y - before.y * after.x;
+            const double cosine = glm::dot(before, after);
+            if (sine * delta > 0.0)
+            {
+                // Each step's point lies delta / cos(step / 2) out along the middle of the step, so the first
+                // and last ones fall on the shifted edges.
+                const double angle = std::atan2(sine, cosine);
+                const int steps = std::max(1, static_cast<int>(std::ceil(std::abs(angle) / stepAngle)));
+                const double halfStep = 0.5 * angle / static_cast<double>(steps);
+                const double radius = delta / std::cos(halfStep);
+                for (int step = 0; step < steps; ++step)
+                {
+                    const double turn = halfStep * static_cast<double>(2 * step + 1);
+                    const double c = std::cos(turn);
+                    const double s = std::sin(turn);
+                    const glm::dvec2 normal(normalBefore.x * c - normalBefore.y * s,
+                                            normalBefore.x * s + normalBefore.y * c);
+                    push(current + normal * radius);
+                }
+            }
+            // The mitre point lies delta * tan(turn / 2) along each edge from the shifted corner.
+            else if (cosine > 0.0
+                     && (std::abs(delta) * glm::distance(normalBefore, normalAfter) < kMinOffsetStep
+                         || 2.0 * std::abs(delta * sine) / (1.0 + cosine) <= std::min(lengthBefore, lengthAfter)))
+            {
+                push(current + (normalBefore + normalAfter) * (delta / (1.0 + cosine)));
+            }
+            else
+            {
+                push(current + normalBefore * delta);
+                push(current);
+                push(current + normalAfter * delta);
+            }
+        }
+        addEdges(m_rawPoints.data(), m_rawPoints.size(), Role::Subject);
+    }
+
+    clipEdges(ClipOperation::Union, FillRule::Positive);
+    return takeLoops();
+}
+
+void PolygonClipper::setGrid(double margin)
+{
+    if (m_inputPoints.empty())
+    {
+        m_origin = glm::dvec2(0.0);
+        m_scale = 1.0 / m_resolution;
+        return;
+    }
+
+    glm::dvec2 low(std::numeric_limits<double>::infinity());
+    glm::dvec2 high(-std::numeric_limits<double>::infinity());
+    for (const glm::dvec2& p : m_inputPoints)
+    {
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    // Coarsen by halving and keep the origin on the grid, so inputs that are collinear on the resolution
+    // grid stay collinear after snapping.
+    const glm::dvec2 centre = 0.5 * (low + high);
+    const double halfExtent = 0.5 * std::max(high.x - low.x, high.y - low.y) + margin;
+    m_scale = 1.0 / m_resolution;
+    while (halfExtent * m_scale + 1.0 > kGridLimit)
+    {
+        m_scale *= 0.5;
+    }
+    m_origin = glm::dvec2(std::round(centre.x * m_scale), std::round(centre.y * m_scale)) / m_scale;
+}
+
+PolygonClipper::Point PolygonClipper::toGrid(const glm::dvec2& p) const
+{
+    return {static_cast<std::int64_t>(std::llround((p.x - m_origin.x) * m_scale)),
+            static_cast<std::int64_t>(std::llround((p.y - m_origin.y) * m_scale))};
+}
+
+glm::dvec2 PolygonClipper::fromGrid(const Point& p) const
+{
+    return m_origin + glm::dvec2(static_cast<double>(p.x), static_cast<double>(p.y)) / m_scale;
+}
+
+void PolygonClipper::addEdges(const Point* points, std::size_t count, Role role)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Point& a = points[i];
+        const Point& b = points[(i + 1) % count];
+        if (samePoint(a, b))
+        {
+            continue;
+        }
+        const bool forward = lessPoint(a, b);
+        Edge edge;
+        edge.p = forward ? a : b;
+        edge.q = forward ? b : a;
+        (role == Role::Subject ? edge.windSubject : edge.windClip) = forward ? 1 : -1;
+        m_edges.push_back(edge);
+    }
+}
+
+void PolygonClipper::buildEdges()
+{
+    m_edges.clear();
+    for (const PathSpan& path : m_inputPaths)
+    {
+        m_rawPoints.clear();
+        for (std::size_t i = 0; i < path.count; ++i)
+        {
+            m_rawPoints.push_back(toGrid(m_inputPoints[path.offset + i]));
+        }
+        addEdges(m_rawPoints.data(), m_rawPoints.size(), path.role);
+    }
+}
+
+void PolygonClipper::clipEdges(ClipOperation operation, FillRule fillRule)
+{
+    for (int round = 0; round < kMaxSplitRounds && findSplits(); ++round)
+    {
+        applySplits();
+    }
+    mergeEdges();
+    computeWinding();
+    linkBoundary(operation, fillRule);
+}
+
+// Collects every point where an edge meets the inside of another: proper crossings, rounded to the grid,
+// and end points lying on other edges, which also covers collinear overlaps.
+bool PolygonClipper::findSplits()
+{
+    m_splits.clear();
+    const std::size_t edgeCount = m_edges.size();
+    if (edgeCount < 2)
+    {
+        return false;
+    }
+
+    Point low{std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::max()};
+    Point high{std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::min()};
+    double extentSum = 0.0;
+    for (const Edge& edge : m_edges)
+    {
+        low.x = std::min(low.x, edge.p.x);
+        high.x = std::max(high.x, edge.q.x);
+        low.y = std::min({low.y, edge.p.y, edge.q.y});
+        high.y = std::max({high.y, edge.p.y, edge.q.y});
+        extentSum += static_cast<double>(std::max(edge.q.x - edge.p.x, std::abs(edge.q.y - edge.p.y)));
+    }
+
+    // Cells about as wide as the average edge, coarser when that would make too many of them.
+    const double width = static_cast<double>(high.x - low.x) + 1.0;
+    const double height = static_cast<double>(high.y - low.y) + 1.0;
+    double cellSize = std::max(1.0, extentSum / static_cast<double>(edgeCount));
+    const double maxCells = kCellsPerEdge * static_cast<double>(edgeCount);
+    if ((width / cellSize + 1.0) * (height / cellSize + 1.0) > maxCells)
+    {
+        cellSize = std::max(cellSize, std::sqrt(width * height / maxCells) + 1.0);
+        while ((width / cellSize + 1.0) * (height / cellSize + 1.0) > maxCells)
+        {
+            cellSize *= 1.25;
+        }
+    }
+    const auto cell = static_cast<std::int64_t>(std::ceil(cellSize));
+    const std::int64_t columns = (high.x - low.x) / cell + 1;
+    const std::int64_t rows = (high.y - low.y) / cell + 1;
+    const auto cellCount = static_cast<std::size_t>(columns * rows);
+
+    // Visits the cells an edge passes through, column by column.
+    const auto forEachCell = [&](const Edge& edge, auto&& visit) {
+        const std::int64_t firstColumn = (edge.p.x - low.x) / cell;
+        const std::int64_t lastColumn = (edge.q.x - low.x) / cell;
+        const double slope = (edge.q.x > edge.p.x) ? static_cast<double>(edge.q.y - edge.p.y)
+                                                         / static_cast<double>(edge.q.x - edge.p.x)
+                                                   : 0.0;
+        for (std::int64_t column = firstColumn; column <= lastColumn; ++column)
+        {
+            std::int64_t bottom = std::min(edge.p.y, edge.q.y);
+            std::int64_t top = std::max(edge.p.y, edge.q.y);
+            if (firstColumn != lastColumn)
+            {
+                const double x0 = static_cast<double>(std::max(edge.p.x, low.x + column * cell) - edge.p.x);
+                const double x1 = static_cast<double>(std::min(edge.q.x, low.x + (column + 1) * cell) - edge.p.x);
+                const double y0 = static_cast<double>(edge.p.y) + slope * x0;
+                const double y1 = static_cast<double>(edge.p.y) + slope * x1;
+                bottom = std::max(bottom, static_cast<std::int64_t>(std::floor(std::min(y0, y1) - 1e-6)));
+                top = std::min(top, static_cast<std::int64_t>(std::ceil(std::max(y0, y1) + 1e-6)));
+            }
+            const std::int64_t firstRow = (bottom - low.y) / cell;
+            const std::int64_t lastRow = (top - low.y) / cell;
+            for (std::int64_t row = firstRow; row <= lastRow; ++row)
+            {
+                visit(static_cast<std::size_t>(row * columns + column));
+            }
+        }
+    };
+
+    // Each edge's cells in edge order, then the edges of each cell in cell order.
+    m_cellStart.assign(cellCount + 1, 0);
+    m_edgeCells.clear();
+    m_edgeCellStart.resize(edgeCount + 1);
+    for (std::size_t i = 0; i < edgeCount; ++i)
+    {
+        m_edgeCellStart[i] = static_cast<std::uint32_t>(m_edgeCells.size());
+        forEachCell(m_edges[i], [&](std::size_t index) {
+            m_edgeCells.push_back(static_cast<std::uint32_t>(index));
+            ++m_cellStart[index + 1];
+        });
+    }
+    m_edgeCellStart[edgeCount] = static_cast<std::uint32_t>(m_edgeCells.size());
+    std::partial_sum(m_cellStart.begin(), m_cellStart.end(), m_cellStart.begin());
+    m_cellEdges.resize(m_cellStart.back());
+    for (std::size_t i = 0; i < edgeCount; ++i)
+    {
+        for (std::uint32_t k = m_edgeCellStart[i]; k < m_edgeCellStart[i + 1]; ++k)
+        {
+            m_cellEdges[m_cellStart[m_edgeCells[k]]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+    // Filling advanced every start to the next cell's; shift them back.
+    for (std::size_t index = cellCount; index > 0; --index)
+    {
+        m_cellStart[index] = m_cellStart[index - 1];
+    }
+    m_cellStart[0] = 0;
+
+    const auto addSplit = [&](std::uint32_t edge, const Point& point) { m_splits.push_back({edge, point}); };
+    const auto testPair = [&](std::uint32_t i, std::uint32_t j) {
+        const Edge& e = m_edges[i];
+        const Edge& f = m_edges[j];
+        if (e.q.x < f.p.x || f.q.x < e.p.x || std::max(e.p.y, e.q.y) < std::min(f.p.y, f.q.y)
+            || std::max(f.p.y, f.q.y) < std::min(e.p.y, e.q.y))
+        {
+            return;
+        }
+        const std::int64_t d1 = orient(f.p, f.q, e.p);
+        const std::int64_t d2 = orient(f.p, f.q, e.q);
+        const std::int64_t d3 = orient(e.p, e.q, f.p);
+        const std::int64_t d4 = orient(e.p, e.q, f.q);
+        if (signOf(d1) * signOf(d2) < 0 && signOf(d3) * signOf(d4) < 0)
+        {
+            const double t = static_cast<double>(d1) / (static_cast<double>(d1) - static_cast<double>(d2));
+            Point crossing{e.p.x + static_cast<std::int64_t>(std::llround(t * static_cast<double>(e.q.x - e.p.x))),
+                           e.p.y + static_cast<std::int64_t>(std::llround(t * static_cast<double>(e.q.y - e.p.y)))};
+            // Where edges cross next to an end point, new points a step apart keep spawning new crossings
+            // round after round; taking the end point instead adds no new points.
+            for (const Point& end : {e.p, e.q, f.p, f.q})
+            {
+                if (std::abs(crossing.x - end.x) <= 1 && std::abs(crossing.y - end.y) <= 1)
+                {
+                    crossing = end;
+                    break;
+                }
+            }
+            if (!samePoint(crossing, e.p) && !samePoint(crossing, e.q))
+            {
+                addSplit(i, crossing);
+            }
+            if (!samePoint(crossing, f.p) && !samePoint(crossing, f.q))
+            {
+                addSplit(j, crossing);
+            }
+            return;
+        }
+        if (d1 == 0 && strictlyBetween(f.p, f.q, e.p))
+        {
+            addSplit(j, e.p);
+        }
+        if (d2 == 0 && strictlyBetween(f.p, f.q, e.q))
+        {
+            addSplit(j, e.q);
+        }
+        if (d3 == 0 && strictlyBetween(e.p, e.q, f.p))
+        {
+            addSplit(i, f.p);
+        }
+        if (d4 == 0 && strictlyBetween(e.p, e.q, f.q))
+        {
+            addSplit(i, f.q);
+        }
+    };
+
+    // Each pair sharing a cell is tested once, by the lower-numbered edge; cells list their edges in order.
+    m_lastTested.assign(edgeCount, kNone);
+    for (std::size_t i = 0; i < edgeCount; ++i)
+    {
+        const auto edge = static_cast<std::uint32_t>(i);
+        for (std::uint32_t k = m_edgeCellStart[i]; k < m_edgeCellStart[i + 1]; ++k)
+        {
+            const auto first = m_cellEdges.begin() + m_cellStart[m_edgeCells[k]];
+            const auto last = m_cellEdges.begin() + m_cellStart[m_edgeCells[k] + 1];
+            for (auto it = std::upper_bound(first, last, edge); it != last; ++it)
+            {
+                if (m_lastTested[*it] != edge)
+                {
+                    m_lastTested[*it] = edge;
+                    testPair(edge, *it);
+                }
+            }
+        }
+    }
+    return !m_splits.empty();
+}
+
+void PolygonClipper::applySplits()
+{
+    std::sort(m_splits.begin(), m_splits.end(), [&](const Split& a, const Split& b) {
+        if (a.edge != b.edge)
+        {
+            return a.edge < b.edge;
+        }
+        const Edge& edge = m_edges[a.edge];
+        const std::int64_t dx = edge.q.x - edge.p.x;
+        const std::int64_t dy = edge.q.y - edge.p.y;
+        return (a.point.x - edge.p.x) * dx + (a.point.y - edge.p.y) * dy
+               < (b.point.x - edge.p.x) * dx + (b.point.y - edge.p.y) * dy;
+    });
+
+    // Pieces follow the parent from p to q; rounding can turn a piece around, so each is re-oriented.
+    const auto addPiece = [&](const Point& from, const Point& to, const Edge& parent) {
+        if (samePoint(from, to))
+        {
+            return;
+        }
+        const bool forward = lessPoint(from, to);
+        m_nextEdges.push_back({forward ? from : to,
+                               forward ? to : from,
+                               forward ? parent.windSubject : -parent.windSubject,
+                               forward ? parent.windClip : -parent.windClip});
+    };
+
+    m_nextEdges.clear();
+    std::size_t split = 0;
+    for (std::size_t i = 0; i < m_edges.size(); ++i)
+    {
+        const Edge& edge = m_edges[i];
+        if (split == m_splits.size() || m_splits[split].edge != i)
+        {
+            m_nextEdges.push_back(edge);
+            continue;
+        }
+        Point from = edge.p;
+        for (; split < m_splits.size() && m_splits[split].edge == i; ++split)
+        {
+            addPiece(from, m_splits[split].point, edge);
+            from = m_splits[split].point;
+        }
+        addPiece(from, edge.q, edge);
+    }
+    std::swap(m_edges, m_nextEdges);
+}
+
+// Sorts the edges by start point. Pieces covering the same stretch add up their winds; pieces whose
+// winds cancel bound nothing.
+void PolygonClipper::mergeEdges()
+{
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge& a, const Edge& b) {
+        if (!samePoint(a.p, b.p))
+        {
+            return lessPoint(a.p, b.p);
+        }
+        return lessPoint(a.q, b.q);
+    });
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_edges.size();)
+    {
+        Edge merged = m_edges[i];
+        for (++i; i < m_edges.size() && samePoint(m_edges[i].p, merged.p) && samePoint(m_edges[i].q, merged.q); ++i)
+        {
+            merged.windSubject += m_edges[i].windSubject;
+            merged.windClip += m_edges[i].windClip;
+        }
+        if (merged.windSubject != 0 || merged.windClip != 0)
+        {
+            m_edges[kept++] = merged;
+        }
+    }
+    m_edges.resize(kept);
+}
+
+// Sweeps left to right keeping the edges under the sweep line sorted bottom to top. An edge starting at
+// the sweep line takes its winding from the edge just below it; no two edges cross, so the order holds
+// until one of them ends.
+void PolygonClipper::computeWinding()
+{
+    const std::size_t edgeCount = m_edges.size();
+    m_below.assign(edgeCount, {});
+    m_byStart.clear();
+    m_vertical.clear();
+    for (std::size_t i = 0; i < edgeCount; ++i)
+    {
+        (m_edges[i].p.x == m_edges[i].q.x ? m_vertical : m_byStart).push_back(static_cast<std::uint32_t>(i));
+    }
+    // mergeEdges() left the edges sorted by their start points.
+    m_byEnd.clear();
+    for (const std::uint32_t edge : m_byStart)
+    {
+        m_byEnd.emplace_back(m_edges[edge].q.x, edge);
+    }
+    std::sort(m_byEnd.begin(), m_byEnd.end());
+
+    // Whether edge a runs below edge b where both span, from the later start point's side of the other
+    // edge, or the far end's side when they start together.
+    const auto below = [&](std::uint32_t a, std::uint32_t b) {
+        if (a == b)
+        {
+            return false;
+        }
+        const Edge& ea = m_edges[a];
+        const Edge& eb = m_edges[b];
+        if (eb.p.x >= ea.p.x)
+        {
+            std::int64_t side = orient(ea.p, ea.q, eb.p);
+            if (side == 0)
+            {
+                side = orient(ea.p, ea.q, eb.q);
+            }
+            return (side != 0) ? side > 0 : a < b;
+        }
+        std::int64_t side = orient(eb.p, eb.q, ea.p);
+        if (side == 0)
+        {
+            side = orient(eb.p, eb.q, ea.q);
+        }
+        return (side != 0) ? side < 0 : a < b;
+    };
+    const auto above = [&](std::uint32_t edge) {
+        const Winding& winding = m_below[edge];
+        return Winding{winding.subject + m_edges[edge].windSubject, winding.clip + m_edges[edge].windClip};
+    };
+
+    m_status.clear();
+    std::size_t nextStart = 0;
+    std::size_t nextEnd = 0;
+    std::size_t nextVertical = 0;
+    while (nextStart < m_byStart.size() || nextVertical < m_vertical.size())
+    {
+        constexpr std::int64_t kFar = std::numeric_limits<std::int64_t>::max();
+        const std::int64_t x = std::min((nextStart < m_byStart.size()) ? m_edges[m_byStart[nextStart]].p.x : kFar,
+                                        (nextVertical < m_vertical.size()) ? m_edges[m_vertical[nextVertical]].p.x
+                                                                           : kFar);
+
+        for (; nextEnd < m_byEnd.size() && m_byEnd[nextEnd].first <= x; ++nextEnd)
+        {
+            const std::uint32_t edge = m_byEnd[nextEnd].second;
+            auto it = std::lower_bound(m_status.begin(), m_status.end(), edge, below);
+            if (it == m_status.end() || *it != edge)
+            {
+                it = std::find(m_status.begin(), m_status.end(), edge);
+            }
+            m_status.erase(it);
+        }
+
+        // Edges starting here go in bottom to top, so each one's lower neighbour already has its winding.
+        std::size_t startEnd = nextStart;
+        while (startEnd < m_byStart.size() && m_edges[m_byStart[startEnd]].p.x == x)
+        {
+            ++startEnd;
+        }
+        std::sort(m_byStart.begin() + static_cast<std::ptrdiff_t>(nextStart),
+                  m_byStart.begin() + static_cast<std::ptrdiff_t>(startEnd),
+                  below);
+        for (; nextStart < startEnd; ++nextStart)
+        {
+            const std::uint32_t edge = m_byStart[nextStart];
+            const auto it = std::lower_bound(m_status.begin(), m_status.end(), edge, below);
+            m_below[edge] = (it == m_status.begin()) ? Winding{} : above(*(it - 1));
+            m_status.insert(it, edge);
+        }
+
+        // Just right of a vertical edge, every edge starting at or passing below its lower end is below.
+        for (; nextVertical < m_vertical.size() && m_edges[m_vertical[nextVertical]].p.x == x; ++nextVertical)
+        {
+            const std::uint32_t edge = m_vertical[nextVertical];
+            const Point& base = m_edges[edge].p;
+            const auto it = std::partition_point(m_status.begin(), m_status.end(), [&](std::uint32_t other) {
+                return orient(m_edges[other].p, m_edges[other].q, base) >= 0;
+            });
+            m_below[edge] = (it == m_status.begin()) ? Winding{} : above(*(it - 1));
+        }
+    }
+}
+
+// Keeps the edges with the result on exactly one side, directed so the result lies on their left, and
+// walks them into loops. Where several loops meet at a vertex the walk takes the first edge clockwise
+// from the one it arrived on, which keeps every loop around a single face.
+void PolygonClipper::linkBoundary(ClipOperation operation, FillRule fillRule)
+{
+    m_boundary.clear();
+    for (std::size_t i = 0; i < m_edges.size(); ++i)
+    {
+        const Edge& edge = m_edges[i];
+        // Left of an edge is above it, or for vertical edges (running upwards) left of it.
+        const Winding& right = m_below[i];
+        const Winding left{right.subject + edge.windSubject, right.clip + edge.windClip};
+        const bool insideLeft = inResult(operation, filled(left.subject, fillRule), filled(left.clip, fillRule));
+        const bool insideRight = inResult(operation, filled(right.subject, fillRule), filled(right.clip, fillRule));
+        if (insideLeft != insideRight)
+        {
+            const Point& from = insideLeft ? edge.p : edge.q;
+            const Point& to = insideLeft ? edge.q : edge.p;
+            m_boundary.push_back({pointKey(from), from, to});
+        }
+    }
+    std::sort(m_boundary.begin(), m_boundary.end(), [](const DirectedEdge& a, const DirectedEdge& b) {
+        return a.fromKey < b.fromKey;
+    });
+
+    // Where the edges leaving each edge's end start in m_boundary, found by merging the end points, in
+    // order, against the start points.
+    m_order.clear();
+    for (std::size_t i = 0; i < m_boundary.size(); ++i)
+    {
+        m_order.emplace_back(pointKey(m_boundary[i].to), static_cast<std::uint32_t>(i));
+    }
+    std::sort(m_order.begin(), m_order.end());
+    m_nextOut.assign(m_boundary.size(), kNone);
+    std::size_t out = 0;
+    for (const auto& [key, edge] : m_order)
+    {
+        while (out < m_boundary.size() && m_boundary[out].fromKey < key)
+        {
+            ++out;
+        }
+        if (out < m_boundary.size() && m_boundary[out].fromKey == key)
+        {
+            m_nextOut[edge] = static_cast<std::uint32_t>(out);
+        }
+    }
+
+    m_used.assign(m_boundary.size(), 0);
+    m_loopPoints.clear();
+    m_loopEnds.clear();
+    for (std::size_t start = 0; start < m_boundary.size(); ++start)
+    {
+        if (m_used[start])
+        {
+            continue;
+        }
+
+        const std::size_t loopBegin = m_loopPoints.size();
+        m_used[start] = 1;
+        m_loopPoints.push_back(m_boundary[start].from);
+        std::size_t current = start;
+        bool closed = false;
+        while (true)
+        {
+            const Point vertex = m_boundary[current].to;
+            const std::uint32_t firstOut = m_nextOut[current];
+            const auto first = m_boundary.begin() + ((firstOut == kNone) ? static_cast<std::ptrdiff_t>(m_boundary.size())
+                                                                         : static_cast<std::ptrdiff_t>(firstOut));
+            auto last = first;
+            while (last != m_boundary.end() && last->fromKey == first->fromKey)
+            {
+                ++last;
+            }
+            const glm::dvec2 back(static_cast<double>(m_boundary[current].from.x - vertex.x),
+                                  static_cast<double>(m_boundary[current].from.y - vertex.y));
+            std::size_t next = kNone;
+            double nextTurn = std::numeric_limits<double>::infinity();
+            for (auto it = first; it != last; ++it)
+            {
+                const auto candidate = static_cast<std::size_t>(it - m_boundary.begin());
+                if (m_used[candidate] && candidate != start)
+                {
+                    continue;
+                }
+                if (last - first == 1)
+                {
+                    next = candidate;
+                    break;
+                }
+                const glm::dvec2 out(static_cast<double>(it->to.x - vertex.x), static_cast<double>(it->to.y - vertex.y));
+                double turn = -std::atan2(back.x * out.y - back.y * out.x, glm::dot(back, out));
+                if (turn <= 0.0)
+                {
+                    turn += 2.0 * kPi;
+                }
+                if (turn < nextTurn)
+                {
+                    nextTurn = turn;
+                    next = candidate;
+                }
+            }
+
+            if (next == kNone)
+            {
+                break;
+            }
+            if (next == start)
+            {
+                closed = true;
+                break;
+            }
+            m_used[next] = 1;
+            m_loopPoints.push_back(vertex);
+            current = next;
+        }
+
+        if (closed)
+        {
+            appendLoop(loopBegin);
+        }
+        else
+        {
+            m_loopPoints.resize(loopBegin);
+        }
+    }
+}
+
+// Drops collinear points (splitting leaves many) from the loop at the end of m_loopPoints, and the loop
+// itself when nothing with area is left.
+void PolygonClipper::appendLoop(std::size_t begin)
+{
+    std::size_t end = begin;
+    for (std::size_t i = begin; i < m_loopPoints.size(); ++i)
+    {
+        const Point point = m_loopPoints[i];
+        while (end - begin >= 2 && orient(m_loopPoints[end - 2], m_loopPoints[end - 1], point) == 0)
+        {
+            --end;
+        }
+        m_loopPoints[end++] = point;
+    }
+
+    std::size_t first = begin;
+    while (end - first >= 3)
+    {
+        if (orient(m_loopPoints[end - 2], m_loopPoints[end - 1], m_loopPoints[first]) == 0)
+        {
+            --end;
+        }
+        else if (orient(m_loopPoints[end - 1], m_loopPoints[first], m_loopPoints[first + 1]) == 0)
+        {
+            ++first;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // Rounding the crossings can leave slivers on the order of a grid step where three edges nearly meet;
+    // drop loops whose mean width is under half a step.
+    double doubleArea = 0.0;
+    double perimeter = 0.0;
+    for (std::size_t i = first; i < end; ++i)
+    {
+        const Point& a = m_loopPoints[i];
+        const Point& b = m_loopPoints[(i + 1 < end) ? i + 1 : first];
+        doubleArea += static_cast<double>(a.x) * static_cast<double>(b.y)
+                      - static_cast<double>(b.x) * static_cast<double>(a.y);
+        perimeter += std::hypot(static_cast<double>(b.x - a.x), static_cast<double>(b.y - a.y));
+    }
+    if (end - first < 3 || 2.0 * std::abs(doubleArea) < perimeter)
+    {
+        m_loopPoints.resize(begin);
+        return;
+    }
+    std::copy(m_loopPoints.begin() + static_cast<std::ptrdiff_t>(first),
+              m_loopPoints.begin() + static_cast<std::ptrdiff_t>(end),
+              m_loopPoints.begin() + static_cast<std::ptrdiff_t>(begin));
+    m_loopPoints.resize(begin + end - first);
+    m_loopEnds.push_back(m_loopPoints.size());
+}
+
+std::vector<Path2> PolygonClipper::takeLoops()
+{
+    std::vector<Path2> loops;
+    loops.reserve(m_loopEnds.size());
+    std::size_t begin = 0;
+    for (const std::size_t end : m_loopEnds)
+    {
+        Path2 loop;
+        loop.reserve(end - begin);
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            loop.push_back(fromGrid(m_loopPoints[i]));
+        }
+        loops.push_back(std::move(loop));
+        begin = end;
+    }
+    m_loopPoints.clear();
+    m_loopEnds.clear();
+    return loops;
+}
+
+} // namespace tp
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+// A closed polygon: the last point joins back to the first and is not repeated.
+using Path2 = std::vector<glm::dvec2>;
+
+// Which points a set of possibly overlapping, self-intersecting paths fills, by their winding number.
+enum class FillRule
+{
+    EvenOdd,
+    NonZero,
+    Positive
+};
+
+enum class ClipOperation
+{
+    Union,
+    Intersection,
+    Difference,
+    Xor
+};
+
+// Boolean operations and offsets of closed polygons, computed exactly on an integer grid: every edge is
+// split where it meets another, the winding number on either side of each piece comes from a sweep
+// across the plane, and the pieces with the filled side on their left are linked into loops. Results
+// never self-intersect; outer boundaries run counter-clockwise and holes clockwise, and loops that touch
+// do so only at vertices.
+//
+// Add paths, then call execute() or offset(), which consume them. A clipper keeps its buffers between
+// calls, so keep one per worker when clipping many levels. Not thread-safe; use one clipper per thread.
+class PolygonClipper
+{
+public:
+    enum class Role
+    {
+        Subject,
+        Clip
+    };
+
+    // Coordinates snap to a grid of resolution_mm, coarsened when the input spans more than 2^30 steps.
+    explicit PolygonClipper(double resolution_mm = 1e-6);
+
+    void addPath(std::span<const glm::dvec2> path, Role role = Role::Subject);
+    void addPaths(std::span<const Path2> paths, Role role = Role::Subject);
+    void clear();
+
+    // Region filled by the subject paths combined with the region filled by the clip paths, both under
+    // fillRule.
+    std::vector<Path2> execute(ClipOperation operation, FillRule fillRule);
+
+    // Region filled by the subject paths, grown by delta_mm (shrunk when negative) with round corners
+    // that stay within arcTolerance_mm of the true arc. Loops that grow into each other merge, and holes
+    // and islands narrower than twice the distance vanish. Clip paths are ignored.
+    std::vector<Path2> offset(double delta_mm, FillRule fillRule, double arcTolerance_mm);
+
+private:
+    struct Point
+    {
+        std::int64_t x{0};
+        std::int64_t y{0};
+    };
+
+    // Stored from its lower-left end p to q; the winds count the input edges along it, +1 for each one
+    // running from p to q and -1 for each one running back.
+    struct Edge
+    {
+        Point p;
+        Point q;
+        std::int32_t windSubject{0};
+        std::int32_t windClip{0};
+    };
+
+    struct Winding
+    {
+        std::int32_t subject{0};
+        std::int32_t clip{0};
+    };
+
+    struct Split
+    {
+        std::uint32_t edge{0};
+        Point point;
+    };
+
+    struct PathSpan
+    {
+        std::size_t offset{0};
+        std::size_t count{0};
+        Role role{Role::Subject};
+    };
+
+    struct DirectedEdge
+    {
+        std::uint64_t fromKey{0};
+        Point from;
+        Point to;
+    };
+
+    void setGrid(double margin);
+    [[nodiscard]] Point toGrid(const glm::dvec2& p) const;
+    [[nodiscard]] glm::dvec2 fromGrid(const Point& p) const;
+    void addEdges(const Point* points, std::size_t count, Role role);
+    void buildEdges();
+    void clipEdges(ClipOperation operation, FillRule fillRule);
+    bool findSplits();
+    void applySplits();
+    void mergeEdges();
+    void computeWinding();
+    void linkBoundary(ClipOperation operation, FillRule fillRule);
+    void appendLoop(std::size_t begin);
+    std::vector<Path2> takeLoops();
+
+    double m_resolution{1e-6};
+    glm::dvec2 m_origin{0.0};
+    double m_scale{1.0};
+
+    std::vector<glm::dvec2> m_inputPoints;
+    std::vector<PathSpan> m_inputPaths;
+
+    std::vector<Edge> m_edges;
+    std::vector<Edge> m_nextEdges;
+    std::vector<Split> m_splits;
+    // Uniform grid over the edges for the intersection search: edges listed per cell, CSR style.
+    std::vector<std::uint32_t> m_cellStart;
+    std::vector<std::uint32_t> m_cellEdges;
+    std::vector<std::uint32_t> m_edgeCellStart;
+    std::vector<std::uint32_t> m_edgeCells;
+    std::vector<std::uint32_t> m_lastTested;
+
+    // Winding number just below each edge, or just right of it for vertical edges.
+    std::vector<Winding> m_below;
+    std::vector<std::uint32_t> m_byStart;
+    // End x and index of every non-vertical edge.
+    std::vector<std::pair<std::int64_t, std::uint32_t>> m_byEnd;
+    std::vector<std::uint32_t> m_vertical;
+    std::vector<std::uint32_t> m_status;
+
+    std::vector<DirectedEdge> m_boundary;
+    // First edge leaving the end of each boundary edge, or all ones.
+    std::vector<std::uint32_t> m_nextOut;
+    std::vector<std::uint8_t> m_used;
+    // End point keys of the boundary edges with their indices.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> m_order;
+    // Result loops as runs of grid points; m_loopEnds[i] is where loop i ends.
+    std::vector<Point> m_loopPoints;
+    std::vector<std::size_t> m_loopEnds;
+    // Offset scratch: the raw shifted path of one loop, and that loop's corners.
+    std::vector<Point> m_rawPoints;
+    std::vector<glm::dvec2> m_corners;
+};
+
+} // namespace tp
@@ -14,6 +14,7 @@ namespace tp
 enum class MotionType
 {
     Cut,
+    // Feed move between two cuts that keeps the tool down near the material instead of retracting.
     Link,
     Rapid
 };
@@ -31,7 +32,7 @@ struct Polyline
 
     [[nodiscard]] bool isRapid() const noexcept
     {
-        return motion != MotionType::Cut;
+        return motion == MotionType::Rapid;
     }
 };
 
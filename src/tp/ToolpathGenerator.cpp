@@ -8,7 +8,13 @@
 #include "common/Enforce.h"
 #include "common/log.h"
 #include "render/Model.h"
+#include "tp/CycleTime.h"
+#include "tp/ModelGeometryContext.h"
+#include "tp/PassOrdering.h"
+#include "tp/heightfield/AdaptiveHeightField.h"
 #include "tp/heightfield/HeightField.h"
+#include "tp/heightfield/HeightFieldDiskCache.h"
+#include "tp/heightfield/MaxZPyramid.h"
 #include "tp/heightfield/UniformGrid.h"
 #include "tp/GougeChecker.h"
 #include "tp/ocl/OclAdapter.h"
@@ -17,16 +23,23 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <execution>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <memory>
 #include <limits>
 #include <mutex>
 #include <numbers>
 #include <numeric>
+#include <optional>
 #include <iterator>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <glm/geometric.hpp>
@@ -55,6 +68,15 @@ constexpr double kMaxRampAngleDeg = 45.0;
 // ratios that exceed the travel envelope that our jerk-limited planners can follow.
 constexpr double kMinRampHorizontalFactor = 0.25;
 constexpr double kMaxRampHorizontalFactor = 6.0;
+// Stay-down links join cuts at most this many tool diameters apart and lift over the model by at most
+// this many; farther or higher links go through the clearance plane, where rapids are cheaper.
+constexpr double kMaxStayDownLinkFactor = 2.0;
+constexpr double kMaxStayDownLiftFactor = 0.5;
+// Links may pass this close to the model inside the tool radius, so that they can run along the walls the
+// passes themselves touch.
+constexpr double kLinkContactTolerance = 1e-3;
+// How often the thread merging concurrent passes checks the caller's cancel flag to hand it on to the workers.
+constexpr std::chrono::milliseconds kPassCancelPollInterval{20};
 
 class ScopedTimer
 {
@@ -187,7 +209,7 @@ void pruneSequentialDuplicates(std::vector<glm::dvec3>& points)
     points = std::move(pruned);
 }
 
-void appendCutPolyline(std::vector<Polyline>& passes, const std::vector<glm::dvec3>& points)
+void appendPathPolyline(std::vector<Polyline>& passes, MotionType motion, const std::vector<glm::dvec3>& points)
 {
     if (points.size() < 2)
     {
@@ -195,7 +217,7 @@ void appendCutPolyline(std::vector<Polyline>& passes, const std::vector<glm::dve
     }
 
     Polyline poly;
-    poly.motion = MotionType::Cut;
+    poly.motion = motion;
 
     glm::dvec3 prev = points.front();
     poly.pts.push_back({toVec3(prev)});
@@ -215,6 +237,11 @@ void appendCutPolyline(std::vector<Polyline>& passes, const std::vector<glm::dve
     }
 }
 
+void appendCutPolyline(std::vector<Polyline>& passes, const std::vector<glm::dvec3>& points)
+{
+    appendPathPolyline(passes, MotionType::Cut, points);
+}
+
 glm::dvec2 selectDirection2D(const std::vector<glm::dvec3>& points, bool forward)
 {
     if (points.size() < 2)
@@ -359,49 +386,85 @@ std::vector<glm::dvec3> buildHelicalEntry(const glm::dvec3& targetPoint,
     return helix;
 }
 
-void applyMachineMotion(Toolpath& toolpath,
-                        const Machine& machine,
-                        const Stock& stock,
-                        const UserParams& params)
+double cutterOffsetFor(const UserParams& params)
 {
-    if (toolpath.passes.empty())
+    if (params.cutterType == UserParams::CutterType::BallNose)
     {
-        return;
+        return std::max(0.0, params.toolDiameter * 0.5);
     }
+    return 0.0;
+}
 
-    const double stockTop = stock.topZ_mm;
-    double clearanceZ = std::max(machine.clearanceZ_mm, stockTop + kMinClearanceOffset);
-    double safeZ = std::max(machine.safeZ_mm, clearanceZ + kMinSafeGap);
-    if (clearanceZ >= safeZ)
+double pathLength(const std::vector<glm::dvec3>& points)
+{
+    double length = 0.0;
+    for (std::size_t i = 1; i < points.size(); ++i)
     {
-        clearanceZ = std::max(stockTop + kMinClearanceOffset, safeZ - kMinSafeGap);
-        safeZ = clearanceZ + kMinSafeGap;
+        length += glm::length(points[i] - points[i - 1]);
     }
+    return length;
+}
 
-    const double requestedRamp = std::isfinite(params.rampAngleDeg) ? params.rampAngleDeg : kDefaultRampAngleDeg;
-    const double rampAngleRad = std::clamp(requestedRamp, kMinRampAngleDeg, kMaxRampAngleDeg) * std::numbers::pi / 180.0;
-    const double safeToolDiameter = std::max(params.toolDiameter, 0.1);
-    const double minHorizontal = std::max(kMinRampHorizontalFactor * safeToolDiameter, 0.25);
-    const double maxHorizontal = std::max(kMaxRampHorizontalFactor * safeToolDiameter, minHorizontal * 2.0);
-    const bool enableRamp = params.enableRamp;
-    const bool enableHelical = params.enableHelical;
-    const double leadIn = std::max(params.leadInLength, 0.0);
-    const double leadOut = std::max(params.leadOutLength, 0.0);
-    const double rampRadius = (params.rampRadius > kPositionEpsilon)
-                                  ? params.rampRadius
-                                  : safeToolDiameter * 0.5;
+// What links between cuts are checked against. Without a checker every link retracts to the safe plane.
+struct LinkGeometry
+{
+    const GougeChecker* checker{nullptr};
+    double modelTopZ{std::numeric_limits<double>::infinity()};
+};
 
-    std::vector<Polyline> result;
-    result.reserve(toolpath.passes.size() * 5);
+// Links cut polylines into machine motion one at a time: optional lead-in/out, an entry ramp or helix
+// down from the clearance plane and an exit ramp back up. Between two cuts the tool stays down when the
+// model allows it, otherwise crosses at the clearance plane, and only climbs to the safe plane when the
+// model reaches into the clearance plane. A cut's exit waits for the next cut, so finish() must follow
+// the last one. Streaming generation links each pass as soon as it has been reordered.
+class MachineMotionLinker
+{
+public:
+    MachineMotionLinker(const Machine& machine, const Stock& stock, const UserParams& params, LinkGeometry geometry = {})
+        : m_geometry(geometry)
+    {
+        const double stockTop = stock.topZ_mm;
+        m_clearanceZ = std::max(machine.clearanceZ_mm, stockTop + kMinClearanceOffset);
+        m_safeZ = std::max(machine.safeZ_mm, m_clearanceZ + kMinSafeGap);
+        if (m_clearanceZ >= m_safeZ)
+        {
+            m_clearanceZ = std::max(stockTop + kMinClearanceOffset, m_safeZ - kMinSafeGap);
+            m_safeZ = m_clearanceZ + kMinSafeGap;
+        }
 
-    glm::dvec3 lastSafe{};
-    bool haveLast = false;
+        const double requestedRamp = std::isfinite(params.rampAngleDeg) ? params.rampAngleDeg : kDefaultRampAngleDeg;
+        m_rampAngleRad = std::clamp(requestedRamp, kMinRampAngleDeg, kMaxRampAngleDeg) * std::numbers::pi / 180.0;
+        const double safeToolDiameter = std::max(params.toolDiameter, 0.1);
+        m_minHorizontal = std::max(kMinRampHorizontalFactor * safeToolDiameter, 0.25);
+        m_maxHorizontal = std::max(kMaxRampHorizontalFactor * safeToolDiameter, m_minHorizontal * 2.0);
+        m_enableRamp = params.enableRamp;
+        m_enableHelical = params.enableHelical;
+        m_leadIn = std::max(params.leadInLength, 0.0);
+        m_leadOut = std::max(params.leadOutLength, 0.0);
+        m_rampRadius = (params.rampRadius > kPositionEpsilon)
+                           ? params.rampRadius
+                           : safeToolDiameter * 0.5;
+
+        m_linking = m_geometry.checker ? params.linking : UserParams::Linking::SafePlane;
+        m_toolRadius = safeToolDiameter * 0.5;
+        m_cutterOffset = cutterOffsetFor(params);
+        m_keepStock = std::max({params.stockAllowance_mm, params.leaveStock_mm, 0.0});
+        m_maxStayDownLength = kMaxStayDownLinkFactor * safeToolDiameter;
+        m_maxStayDownLift = kMaxStayDownLiftFactor * safeToolDiameter;
+        m_sampleSpacing = std::max(0.25, m_toolRadius * 0.5);
+        // Discs of the tool radius this far apart cover a straight sweep up to the contact tolerance from its edge.
+        m_contactSpacing = std::max(2.0 * std::sqrt(2.0 * m_toolRadius * kLinkContactTolerance), kLinkContactTolerance);
+        const double feed = (machine.maxFeed_mm_min > 0.0) ? std::min(params.feed, machine.maxFeed_mm_min) : params.feed;
+        m_feed = std::max(feed, 1.0);
+        m_rapidFeed = std::max(machine.rapidFeed_mm_min, m_feed);
+    }
 
-    for (const Polyline& poly : toolpath.passes)
+    // Appends the motion for one polyline to result; rapids and short polylines are dropped.
+    void append(const Polyline& poly, std::vector<Polyline>& result)
     {
         if (poly.motion != MotionType::Cut || poly.pts.size() < 2)
         {
-            continue;
+            return;
         }
 
         std::vector<glm::dvec3> cutPoints;
@@ -417,24 +480,24 @@ void applyMachineMotion(Toolpath& toolpath,
         std::vector<glm::dvec3> pathPoints;
         pathPoints.reserve(cutPoints.size() + 2);
 
-        if (leadIn > kPositionEpsilon)
+        if (m_leadIn > kPositionEpsilon)
         {
-            const glm::dvec3 leadStart = offsetPoint(cutPoints.front(), entryDir, leadIn, cutPoints.front().z, true);
+            const glm::dvec3 leadStart = offsetPoint(cutPoints.front(), entryDir, m_leadIn, cutPoints.front().z, true);
             pathPoints.push_back(leadStart);
         }
 
         pathPoints.insert(pathPoints.end(), cutPoints.begin(), cutPoints.end());
 
-        if (leadOut > kPositionEpsilon)
+        if (m_leadOut > kPositionEpsilon)
         {
-            const glm::dvec3 leadEnd = offsetPoint(cutPoints.back(), exitDir, leadOut, cutPoints.back().z, false);
+            const glm::dvec3 leadEnd = offsetPoint(cutPoints.back(), exitDir, m_leadOut, cutPoints.back().z, false);
             pathPoints.push_back(leadEnd);
         }
 
         pruneSequentialDuplicates(pathPoints);
         if (pathPoints.size() < 2)
         {
-            continue;
+            return;
         }
 
         entryDir = selectDirection2D(pathPoints, true);
@@ -442,29 +505,29 @@ void applyMachineMotion(Toolpath& toolpath,
 
         const glm::dvec3& entryPoint = pathPoints.front();
         const glm::dvec3& exitPoint = pathPoints.back();
-        const double entryDrop = std::max(0.0, clearanceZ - entryPoint.z);
-        const double exitDrop = std::max(0.0, clearanceZ - exitPoint.z);
+        const double entryDrop = std::max(0.0, m_clearanceZ - entryPoint.z);
+        const double exitDrop = std::max(0.0, m_clearanceZ - exitPoint.z);
 
         std::vector<glm::dvec3> entryPath;
-        glm::dvec3 entryClear{entryPoint.x, entryPoint.y, (entryDrop > kPositionEpsilon) ? clearanceZ : entryPoint.z};
+        glm::dvec3 entryClear{entryPoint.x, entryPoint.y, (entryDrop > kPositionEpsilon) ? m_clearanceZ : entryPoint.z};
 
         if (entryDrop > kPositionEpsilon)
         {
-            if (enableHelical)
+            if (m_enableHelical)
             {
-                entryPath = buildHelicalEntry(entryPoint, entryDir, clearanceZ, entryDrop, rampAngleRad, rampRadius);
+                entryPath = buildHelicalEntry(entryPoint, entryDir, m_clearanceZ, entryDrop, m_rampAngleRad, m_rampRadius);
             }
 
             if (entryPath.empty())
             {
-                if (enableRamp)
+                if (m_enableRamp)
                 {
-                    const double entryHorizontal = computeRampDistance(entryDrop, rampAngleRad, minHorizontal, maxHorizontal);
-                    entryClear = offsetPoint(entryPoint, entryDir, entryHorizontal, clearanceZ, true);
+                    const double entryHorizontal = computeRampDistance(entryDrop, m_rampAngleRad, m_minHorizontal, m_maxHorizontal);
+                    entryClear = offsetPoint(entryPoint, entryDir, entryHorizontal, m_clearanceZ, true);
                 }
                 else
                 {
-                    entryClear = {entryPoint.x, entryPoint.y, clearanceZ};
+                    entryClear = {entryPoint.x, entryPoint.y, m_clearanceZ};
                 }
                 entryPath = {entryClear, entryPoint};
             }
@@ -476,165 +539,359 @@ void applyMachineMotion(Toolpath& toolpath,
 
         pruneSequentialDuplicates(entryPath);
 
-        glm::dvec3 entrySafe{entryClear.x, entryClear.y, safeZ};
+        glm::dvec3 entrySafe{entryClear.x, entryClear.y, m_safeZ};
 
-        if (!haveLast)
+        if (m_havePending)
         {
-            appendPolyline(result, MotionType::Rapid, {entrySafe, entryClear});
+            if (!linkFromPending(entryPoint, entryPath, entryClear, result))
+            {
+                appendCutPolyline(result, entryPath);
+            }
         }
         else
         {
-            appendPolyline(result, MotionType::Rapid, {lastSafe, entrySafe});
-            appendPolyline(result, MotionType::Rapid, {entrySafe, entryClear});
+            if (!m_haveLast)
+            {
+                appendPolyline(result, MotionType::Rapid, {entrySafe, entryClear});
+            }
+            else
+            {
+                appendPolyline(result, MotionType::Rapid, {m_lastSafe, entrySafe});
+                appendPolyline(result, MotionType::Rapid, {entrySafe, entryClear});
+            }
+            appendCutPolyline(result, entryPath);
         }
 
-        appendCutPolyline(result, entryPath);
         appendCutPolyline(result, pathPoints);
 
         std::vector<glm::dvec3> exitPath;
-        glm::dvec3 exitClear{exitPoint.x, exitPoint.y, (exitDrop > kPositionEpsilon) ? clearanceZ : exitPoint.z};
+        glm::dvec3 exitClear{exitPoint.x, exitPoint.y, (exitDrop > kPositionEpsilon) ? m_clearanceZ : exitPoint.z};
 
         if (exitDrop > kPositionEpsilon)
         {
-            if (enableRamp)
+            if (m_enableRamp)
             {
-                const double exitHorizontal = computeRampDistance(exitDrop, rampAngleRad, minHorizontal, maxHorizontal);
-                exitClear = offsetPoint(exitPoint, exitDir, exitHorizontal, clearanceZ, false);
+                const double exitHorizontal = computeRampDistance(exitDrop, m_rampAngleRad, m_minHorizontal, m_maxHorizontal);
+                exitClear = offsetPoint(exitPoint, exitDir, exitHorizontal, m_clearanceZ, false);
             }
             exitPath = {exitPoint, exitClear};
         }
 
         pruneSequentialDuplicates(exitPath);
-        appendCutPolyline(result, exitPath);
-
-        glm::dvec3 exitSafe{exitClear.x, exitClear.y, safeZ};
-        appendPolyline(result, MotionType::Rapid, {exitClear, exitSafe});
 
-        lastSafe = exitSafe;
-        haveLast = true;
+        m_pendingExitPoint = exitPoint;
+        m_pendingExitPath = std::move(exitPath);
+        m_pendingExitClear = exitClear;
+        m_havePending = true;
     }
 
-    toolpath.passes = std::move(result);
-}
-
-glm::dvec3 reorderPassRange(std::vector<Polyline>& polylines,
-                            std::size_t begin,
-                            std::size_t end,
-                            const glm::dvec3* seedPosition)
-{
-    if (begin >= end)
+    // Leaves the last cut appended so far up to the safe plane.
+    void finish(std::vector<Polyline>& result)
     {
-        return seedPosition ? *seedPosition : glm::dvec3{};
+        if (!m_havePending)
+        {
+            return;
+        }
+
+        appendCutPolyline(result, m_pendingExitPath);
+        const glm::dvec3 exitSafe{m_pendingExitClear.x, m_pendingExitClear.y, m_safeZ};
+        appendPolyline(result, MotionType::Rapid, {m_pendingExitClear, exitSafe});
+
+        m_lastSafe = exitSafe;
+        m_haveLast = true;
+        m_havePending = false;
     }
 
-    const std::size_t count = end - begin;
-    if (count == 0)
+    [[nodiscard]] const LinkingStats& stats() const noexcept
     {
-        return seedPosition ? *seedPosition : glm::dvec3{};
+        return m_stats;
     }
 
-    if (count == 1)
-    {
-        const Polyline& poly = polylines[begin];
-        if (poly.pts.empty())
+private:
+    // Joins the pending exit to the next cut's entry. Returns true when the tool stays down, in which case
+    // the entry ramp is skipped; otherwise the entry ramp still has to follow.
+    bool linkFromPending(const glm::dvec3& entryPoint,
+                         const std::vector<glm::dvec3>& entryPath,
+                         const glm::dvec3& entryClear,
+                         std::vector<Polyline>& result)
+    {
+        m_havePending = false;
+        const double rampFeedLength = pathLength(m_pendingExitPath) + pathLength(entryPath);
+        const double retractTime = moveTime(rampFeedLength,
+                                            (m_safeZ - m_pendingExitClear.z)
+                                                + horizontalDistance(m_pendingExitClear, entryClear)
+                                                + (m_safeZ - entryClear.z));
+
+        if (m_linking == UserParams::Linking::StayDown)
         {
-            return seedPosition ? *seedPosition : glm::dvec3{};
+            std::vector<glm::dvec3> link = stayDownLink(m_pendingExitPoint, entryPoint);
+            if (!link.empty())
+            {
+                m_stats.timeSaved_s += retractTime - moveTime(pathLength(link), 0.0);
+                ++m_stats.stayDown;
+                appendPathPolyline(result, MotionType::Link, link);
+                return true;
+            }
         }
-        return toDVec3(poly.pts.back().p);
+
+        appendCutPolyline(result, m_pendingExitPath);
+        if (m_linking != UserParams::Linking::SafePlane && rapidClearsModel(m_pendingExitClear, entryClear))
+        {
+            m_stats.timeSaved_s += retractTime - moveTime(rampFeedLength, glm::length(entryClear - m_pendingExitClear));
+            ++m_stats.clearancePlane;
+            appendPolyline(result, MotionType::Rapid, {m_pendingExitClear, entryClear});
+            return false;
+        }
+
+        ++m_stats.safePlane;
+        const glm::dvec3 exitSafe{m_pendingExitClear.x, m_pendingExitClear.y, m_safeZ};
+        const glm::dvec3 entrySafe{entryClear.x, entryClear.y, m_safeZ};
+        appendPolyline(result, MotionType::Rapid, {m_pendingExitClear, exitSafe});
+        appendPolyline(result, MotionType::Rapid, {exitSafe, entrySafe});
+        appendPolyline(result, MotionType::Rapid, {entrySafe, entryClear});
+        m_lastSafe = exitSafe;
+        m_haveLast = true;
+        return false;
     }
 
-    std::vector<std::size_t> order;
-    order.reserve(count);
-    std::vector<bool> used(count, false);
+    // Feed move from the end of one cut to the start of the next that keeps as much stock as the pass and
+    // both of its ends do, lifted over the model where needed. Empty when the cuts are too far apart, the
+    // move would descend more steeply than a ramp or need more than a small lift, or its ends already sit
+    // so deep in the model bound that it says nothing about what lies between them.
+    std::vector<glm::dvec3> stayDownLink(const glm::dvec3& from, const glm::dvec3& to)
+    {
+        const double length = horizontalDistance(from, to);
+        const double rampSlope = std::tan(m_rampAngleRad);
+        if (length > m_maxStayDownLength || from.z - to.z > length * rampSlope + kPositionEpsilon)
+        {
+            return {};
+        }
 
-    auto startPoint = [&](std::size_t rel) -> glm::dvec3 {
-        const Polyline& poly = polylines[begin + rel];
-        return poly.pts.empty() ? glm::dvec3{} : toDVec3(poly.pts.front().p);
-    };
-    auto endPoint = [&](std::size_t rel) -> glm::dvec3 {
-        const Polyline& poly = polylines[begin + rel];
-        return poly.pts.empty() ? glm::dvec3{} : toDVec3(poly.pts.back().p);
-    };
+        const int count = linkSampleCount(length, m_sampleSpacing);
+        const std::vector<double> floors = clearanceFloors(from, to, count);
+        double allowance = std::min(from.z - floors.front(), to.z - floors.back());
+        if (allowance < -m_toolRadius)
+        {
+            return {};
+        }
+        allowance = std::isfinite(allowance) ? std::min(allowance, m_keepStock) : m_keepStock;
 
-    auto chooseClosest = [&](const glm::dvec3& from) -> std::size_t {
-        double bestDist = std::numeric_limits<double>::max();
-        std::size_t bestIndex = count;
-        for (std::size_t i = 0; i < count; ++i)
+        std::vector<glm::dvec3> points;
+        points.reserve(static_cast<std::size_t>(count) + 1);
+        bool lifted = false;
+        for (int i = 0; i <= count; ++i)
         {
-            if (used[i])
+            glm::dvec3 point = from + (to - from) * (static_cast<double>(i) / static_cast<double>(count));
+            const double lift = floors[static_cast<std::size_t>(i)] + allowance - point.z;
+            if (lift > kPositionEpsilon)
             {
-                continue;
+                if (lift > m_maxStayDownLift)
+                {
+                    return {};
+                }
+                point.z += lift;
+                lifted = true;
             }
-
-            const double dist = horizontalDistance(from, startPoint(i));
-            if (dist < bestDist)
+            if (point.z > m_clearanceZ)
+            {
+                return {};
+            }
+            if (!points.empty()
+                && points.back().z - point.z > horizontalDistance(points.back(), point) * rampSlope + kPositionEpsilon)
             {
-                bestDist = dist;
-                bestIndex = i;
+                return {};
             }
+            points.push_back(point);
         }
-        return bestIndex;
-    };
 
-    std::size_t current = 0;
-    if (seedPosition)
+        if (!lifted)
+        {
+            return {from, to};
+        }
+        return points;
+    }
+
+    // True when a straight rapid between two points at or above the clearance plane passes over the model.
+    bool rapidClearsModel(const glm::dvec3& a, const glm::dvec3& b)
     {
-        const std::size_t candidate = chooseClosest(*seedPosition);
-        if (candidate < count)
+        const double lowest = std::min(a.z, b.z);
+        if (m_geometry.modelTopZ + m_cutterOffset <= lowest)
         {
-            current = candidate;
+            return true;
         }
+
+        const int count = linkSampleCount(horizontalDistance(a, b), std::max(m_sampleSpacing, m_toolRadius));
+        const std::vector<double> floors = clearanceFloors(a, b, count);
+        return std::all_of(floors.begin(), floors.end(), [lowest](double floor) { return floor <= lowest; });
     }
-    else
+
+    // Samples for a link of the given length: at most `spacing` apart, and never farther than the contact
+    // spacing clearanceFloors relies on.
+    [[nodiscard]] int linkSampleCount(double length, double spacing) const
     {
-        double bestMetric = std::numeric_limits<double>::max();
-        for (std::size_t i = 0; i < count; ++i)
+        return std::max(1, static_cast<int>(std::ceil(length / std::min(spacing, m_contactSpacing))));
+    }
+
+    // Lowest tool Z clearing the model at count + 1 evenly spaced samples from a to b, -inf where nothing
+    // lies under the tool; the samples must be at most the contact spacing apart. Each sample looks under
+    // a disc of the exact tool radius, so a tool touching a wall the way the passes do still fits, and
+    // every point of the model the sweep reaches by more than kLinkContactTolerance lies in the disc of
+    // a sample at most a tool radius along from it. Each floor takes the largest value of the samples
+    // that far either side of its two neighbouring gaps, so a straight move between two samples that
+    // stays above both of theirs clears the model.
+    std::vector<double> clearanceFloors(const glm::dvec3& a, const glm::dvec3& b, int count)
+    {
+        std::vector<double> covered(static_cast<std::size_t>(count) + 1);
+        for (int i = 0; i <= count; ++i)
         {
-            const glm::dvec3 start = startPoint(i);
-            const double metric = std::abs(start.x) + std::abs(start.y);
-            if (metric < bestMetric)
-            {
-                bestMetric = metric;
-                current = i;
-            }
+            const glm::dvec3 point = a + (b - a) * (static_cast<double>(i) / static_cast<double>(count));
+            const std::optional<double> height =
+                m_geometry.checker->maxHeightUnderDisc(point.x, point.y, m_toolRadius, m_query);
+            covered[static_cast<std::size_t>(i)] =
+                height ? *height + m_cutterOffset : -std::numeric_limits<double>::infinity();
+        }
+
+        const double spacing = horizontalDistance(a, b) / static_cast<double>(count);
+        const std::size_t reach =
+            (spacing > 0.0) ? static_cast<std::size_t>(std::ceil(m_toolRadius / spacing)) + 1 : covered.size();
+        std::vector<double> floors(covered.size());
+        for (std::size_t i = 0; i < covered.size(); ++i)
+        {
+            const std::size_t first = (i > reach) ? i - reach : 0;
+            const std::size_t last = std::min(i + reach, covered.size() - 1);
+            floors[i] = *std::max_element(covered.begin() + static_cast<std::ptrdiff_t>(first),
+                                          covered.begin() + static_cast<std::ptrdiff_t>(last) + 1);
         }
+        return floors;
     }
 
-    used[current] = true;
-    order.push_back(current);
-    glm::dvec3 cursor = endPoint(current);
+    // Seconds for the given distances at the cutting feed and the rapid feed.
+    [[nodiscard]] double moveTime(double feedLength, double rapidLength) const
+    {
+        return 60.0 * (feedLength / m_feed + rapidLength / m_rapidFeed);
+    }
+
+    double m_clearanceZ{0.0};
+    double m_safeZ{0.0};
+    double m_rampAngleRad{0.0};
+    double m_minHorizontal{0.0};
+    double m_maxHorizontal{0.0};
+    bool m_enableRamp{true};
+    bool m_enableHelical{false};
+    double m_leadIn{0.0};
+    double m_leadOut{0.0};
+    double m_rampRadius{0.0};
+    glm::dvec3 m_lastSafe{};
+    bool m_haveLast{false};
+
+    LinkGeometry m_geometry;
+    UserParams::Linking m_linking{UserParams::Linking::SafePlane};
+    double m_toolRadius{0.0};
+    double m_cutterOffset{0.0};
+    double m_keepStock{0.0};
+    double m_maxStayDownLength{0.0};
+    double m_maxStayDownLift{0.0};
+    double m_sampleSpacing{1.0};
+    double m_contactSpacing{1.0};
+    double m_feed{1.0};
+    double m_rapidFeed{1.0};
+    GougeChecker::QueryContext m_query;
+    glm::dvec3 m_pendingExitPoint{};
+    std::vector<glm::dvec3> m_pendingExitPath;
+    glm::dvec3 m_pendingExitClear{};
+    bool m_havePending{false};
+    LinkingStats m_stats;
+};
 
-    while (order.size() < count)
+void applyMachineMotion(Toolpath& toolpath,
+                        const Machine& machine,
+                        const Stock& stock,
+                        const UserParams& params)
+{
+    if (toolpath.passes.empty())
     {
-        std::size_t next = chooseClosest(cursor);
-        if (next >= count)
+        return;
+    }
+
+    MachineMotionLinker linker(machine, stock, params);
+    std::vector<Polyline> result;
+    result.reserve(toolpath.passes.size() * 5);
+    for (const Polyline& poly : toolpath.passes)
+    {
+        linker.append(poly, result);
+    }
+    linker.finish(result);
+
+    toolpath.passes = std::move(result);
+}
+
+// Drops raster samples the chord between the kept neighbours can stand in for. Points lie on one line in
+// XY, so each chord is a straight cut and a dropped sample k is covered when the chord's Z there lies in
+// [z_k, z_k + tolerance]. Seen from the last kept point every sample bounds the slope a chord may take,
+// so one sweep keeps the tightest slope interval and ends the chord at the last point whose slope still
+// fits it. The chord never passes below a sample, so thinning cannot gouge what the samples cleared.
+void thinRasterRow(std::vector<Vertex>& pts, double tolerance)
+{
+    if (tolerance <= 0.0 || pts.size() < 3)
+    {
+        return;
+    }
+
+    const auto distance = [](const glm::vec3& a, const glm::vec3& b) {
+        return std::hypot(static_cast<double>(b.x) - a.x, static_cast<double>(b.y) - a.y);
+    };
+
+    std::size_t kept = 0;
+    std::size_t anchorIndex = 0;
+    glm::vec3 anchor = pts.front().p;
+    double slopeMin = -std::numeric_limits<double>::infinity();
+    double slopeMax = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 1; i < pts.size(); ++i)
+    {
+        double run = distance(anchor, pts[i].p);
+        double rise = static_cast<double>(pts[i].p.z) - anchor.z;
+        if (run <= kPositionEpsilon)
         {
-            for (std::size_t i = 0; i < count; ++i)
+            // A repeated XY point is covered by the anchor only when the anchor sits in its band.
+            if (rise <= 0.0 && rise >= -tolerance)
             {
-                if (!used[i])
-                {
-                    next = i;
-                    break;
-                }
+                continue;
             }
+            pts[++kept] = pts[i];
+            anchor = pts[i].p;
+            anchorIndex = i;
+            slopeMin = -std::numeric_limits<double>::infinity();
+            slopeMax = std::numeric_limits<double>::infinity();
+            continue;
         }
-        used[next] = true;
-        order.push_back(next);
-        cursor = endPoint(next);
-    }
 
-    std::vector<Polyline> reordered;
-    reordered.reserve(count);
-    for (std::size_t index : order)
-    {
-        reordered.push_back(std::move(polylines[begin + index]));
+        const double slope = rise / run;
+        if (slope < slopeMin || slope > slopeMax)
+        {
+            // The previous sample was the last valid chord end; it becomes the new anchor, and with no
+            // dropped samples behind it any next point is reachable.
+            pts[++kept] = pts[i - 1];
+            anchor = pts[i - 1].p;
+            anchorIndex = i - 1;
+            run = distance(anchor, pts[i].p);
+            rise = static_cast<double>(pts[i].p.z) - anchor.z;
+            slopeMin = -std::numeric_limits<double>::infinity();
+            slopeMax = std::numeric_limits<double>::infinity();
+            if (run <= kPositionEpsilon)
+            {
+                continue;
+            }
+        }
+
+        slopeMin = std::max(slopeMin, rise / run);
+        slopeMax = std::min(slopeMax, (rise + tolerance) / run);
     }
-    for (std::size_t i = 0; i < count; ++i)
+
+    if (anchorIndex + 1 < pts.size())
     {
-        polylines[begin + i] = std::move(reordered[i]);
+        pts[++kept] = pts.back();
     }
-
-    return cursor;
+    pts.resize(kept + 1);
 }
 
 std::function<void(int)> makePassProgressCallback(const std::function<void(int)>& callback,
@@ -661,15 +918,6 @@ std::function<void(int)> makePassProgressCallback(const std::function<void(int)>
     };
 }
 
-double cutterOffsetFor(const UserParams& params)
-{
-    if (params.cutterType == UserParams::CutterType::BallNose)
-    {
-        return std::max(0.0, params.toolDiameter * 0.5);
-    }
-    return 0.0;
-}
-
 double normalizeAngleDeg(double angle)
 {
     double normalized = std::fmod(angle, 360.0);
@@ -704,16 +952,27 @@ double computeHeightFieldResolution(double stepOverMm)
     return std::max(0.1, std::min(clamped * 0.5, 0.5));
 }
 
+// Process-wide height fields keyed by mesh identity and resolution. Entries are held under a byte
+// budget and evicted least recently used first; callers keep their own shared_ptr, so evicting an
+// entry that is still in use only drops the cache's reference.
 class HeightFieldCache
 {
 public:
+    static constexpr std::size_t kDefaultCapacityBytes = std::size_t{1} << 30;
+
     struct Entry
     {
-        const render::Model* model{nullptr};
+        std::weak_ptr<const void> meshToken;
         double resolution{0.5};
         std::size_t vertexCount{0};
         std::size_t indexCount{0};
+        // Exactly one of field and adaptive is set; adaptive entries are also keyed by their tolerance.
         std::shared_ptr<heightfield::HeightField> field;
+        std::shared_ptr<const heightfield::AdaptiveHeightField> adaptive;
+        double tolerance{0.0};
+        std::shared_ptr<const heightfield::MaxZPyramid> pyramid;
+        std::size_t bytes{0};
+        std::uint64_t lastUse{0};
     };
 
     static HeightFieldCache& instance()
@@ -731,20 +990,35 @@ public:
         reused = false;
         logMessage.clear();
 
+        const std::weak_ptr<const void> meshToken = model.meshToken();
         const std::size_t vertexCount = model.vertices().size();
         const std::size_t indexCount = model.indices().size();
 
+        // Coarsest cached field whose resolution divides the requested one; downsampling it is much
+        // cheaper than a rebuild.
+        std::shared_ptr<const heightfield::HeightField> finer;
+        double quantum = 0.0;
+        auto layout = heightfield::HeightField::SampleLayout::RowMajor;
+        bool lazy = false;
+        std::shared_future<std::shared_ptr<heightfield::HeightField>> inFlight;
+        std::promise<std::shared_ptr<heightfield::HeightField>> promise;
+        std::uint64_t pendingId = 0;
         {
             std::lock_guard<std::mutex> lock(m_mutex);
-            for (const Entry& entry : m_entries)
+            quantum = m_quantum;
+            layout = m_layout;
+            lazy = m_lazy;
+            dropExpiredLocked();
+            for (Entry& entry : m_entries)
             {
-                if (entry.model == &model
-                    && std::abs(entry.resolution - resolution) < 1e-6
-                    && entry.vertexCount == vertexCount
-                    && entry.indexCount == indexCount
-                    && entry.field
-                    && entry.field->isValid())
+                if (!sameMesh(entry, meshToken, vertexCount, indexCount) || !entry.field || !entry.field->isValid())
                 {
+                    continue;
+                }
+                if (std::abs(entry.resolution - resolution) < 1e-6)
+                {
+                    entry.lastUse = ++m_clock;
+                    ++m_stats.hits;
                     reused = true;
                     std::ostringstream oss;
                     oss.setf(std::ios::fixed);
@@ -754,63 +1028,751 @@ public:
                     logMessage = oss.str();
                     return entry.field;
                 }
+                const double ratio = resolution / entry.resolution;
+                if (ratio > 1.5 && std::abs(ratio - std::round(ratio)) < 1e-9
+                    && (!finer || entry.resolution > finer->resolution()))
+                {
+                    finer = entry.field;
+                }
+            }
+            const auto pending = std::find_if(m_pending.begin(), m_pending.end(), [&](const PendingBuild& build) {
+                return !build.meshToken.owner_before(meshToken) && !meshToken.owner_before(build.meshToken)
+                       && build.vertexCount == vertexCount && build.indexCount == indexCount
+                       && std::abs(build.resolution - resolution) < 1e-6;
+            });
+            if (pending != m_pending.end())
+            {
+                inFlight = pending->result;
+            }
+            else
+            {
+                ++m_stats.misses;
+                pendingId = ++m_clock;
+                m_pending.push_back({meshToken, resolution, vertexCount, indexCount, pendingId,
+                                     promise.get_future().share()});
             }
         }
 
+        if (inFlight.valid())
+        {
+            // A concurrent pass is already building this field; share it instead of building it twice.
+            // If that build was cancelled and this caller was not, try again from the start.
+            std::shared_ptr<heightfield::HeightField> field = inFlight.get();
+            if (!field)
+            {
+                return cancelFlag.load(std::memory_order_relaxed)
+                           ? nullptr
+                           : acquire(model, resolution, cancelFlag, logMessage, reused);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_stats.hits;
+            }
+            reused = true;
+            std::ostringstream oss;
+            oss.setf(std::ios::fixed);
+            oss.precision(2);
+            oss << "Height field shared with a concurrent pass (" << field->columns() << "x" << field->rows()
+                << " @ " << resolution << " mm)";
+            logMessage = oss.str();
+            return field;
+        }
+
+        PendingBuildScope pendingScope(*this, pendingId, std::move(promise));
+
         if (cancelFlag.load(std::memory_order_relaxed))
         {
             return nullptr;
         }
 
-        heightfield::UniformGrid grid(model, resolution);
+        if (finer && finer->populate(cancelFlag))
+        {
+            const auto start = std::chrono::steady_clock::now();
+            auto field = std::make_shared<heightfield::HeightField>();
+            if (field->downsample(*finer, resolution))
+            {
+                const double ms =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::ostringstream oss;
+                oss.setf(std::ios::fixed);
+                oss.precision(2);
+                oss << "Height field downsampled from " << finer->resolution() << " mm (" << field->columns() << "x"
+                    << field->rows() << " @ " << resolution << " mm) in " << ms << " ms";
+                appendQuantization(*field, quantum, oss);
+                logMessage = oss.str();
+                remember(meshToken, resolution, vertexCount, indexCount, field, &CacheStats::downsampled);
+                return pendingScope.publish(field);
+            }
+        }
+
+        // A field built in an earlier session (or for an identical re-import) is mapped from disk.
+        auto& diskCache = heightfield::HeightFieldDiskCache::instance();
+        const bool useDiskCache = diskCache.isEnabled();
+        heightfield::HeightFieldDiskCache::MeshHash meshHash{};
+        if (useDiskCache)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            meshHash = heightfield::HeightFieldDiskCache::hashMesh(model);
+            if (auto mapped = diskCache.load(meshHash, resolution))
+            {
+                const double ms =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                reused = true;
+                std::ostringstream oss;
+                oss.setf(std::ios::fixed);
+                oss.precision(2);
+                oss << "Height field mapped from disk cache (" << mapped->columns() << "x" << mapped->rows()
+                    << " @ " << resolution << " mm) in " << ms << " ms";
+                logMessage = oss.str();
+                remember(meshToken, resolution, vertexCount, indexCount, mapped, &CacheStats::diskHits);
+                return pendingScope.publish(mapped);
+            }
+        }
+
+        // Scan conversion only reads the grid's triangle records, never its cell index, so one cell per
+        // tile keeps the index small; at the lattice resolution it can dwarf the field itself. The grid is
+        // kept with the model, so rebuilding at this resolution skips indexing the mesh again.
+        auto grid = ModelGeometryContext::forModel(model)->uniformGrid(
+            model, resolution * static_cast<double>(heightfield::HeightField::kTileSize));
+
+        if (cancelFlag.load(std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        auto field = std::make_shared<heightfield::HeightField>();
+        heightfield::HeightField::BuildStats stats;
+        if (lazy)
+        {
+            // Tiles are scan-converted as the raster reaches them, so the pass starts right away. The
+            // field is neither quantized nor written to disk while tiles may still be missing.
+            if (!field->buildLazy(std::move(grid), resolution, cancelFlag, &stats))
+            {
+                return nullptr;
+            }
+            std::ostringstream oss;
+            oss.setf(std::ios::fixed);
+            oss.precision(2);
+            oss << "Height field set up for lazy build (" << field->columns() << "x" << field->rows() << " @ "
+                << resolution << " mm, " << field->pendingTiles() << " tiles) in " << stats.buildMilliseconds
+                << " ms";
+            logMessage = oss.str();
+            remember(meshToken, resolution, vertexCount, indexCount, field, &CacheStats::builds);
+            return pendingScope.publish(field);
+        }
+
+        if (!field->build(*grid, resolution, cancelFlag, &stats, heightfield::HeightField::BuildMode::ScanConversion, layout))
+        {
+            return nullptr;
+        }
+
+        std::ostringstream oss;
+        oss.setf(std::ios::fixed);
+        oss.precision(2);
+        oss << "Height field built (" << field->columns() << "x" << field->rows()
+            << " @ " << resolution << " mm, valid " << stats.validSamples << "/" << stats.totalSamples
+            << (layout == heightfield::HeightField::SampleLayout::Tiled ? ", tiled" : "")
+            << ") in " << stats.buildMilliseconds << " ms";
+        if (useDiskCache && diskCache.store(meshHash, resolution, *field))
+        {
+            oss << "; stored in disk cache";
+        }
+        appendQuantization(*field, quantum, oss);
+        logMessage = oss.str();
+
+        remember(meshToken, resolution, vertexCount, indexCount, field, &CacheStats::builds);
+        return pendingScope.publish(field);
+    }
+
+    // Adaptive fields are cheap to rebuild, so they are kept in memory only.
+    std::shared_ptr<const heightfield::AdaptiveHeightField> acquireAdaptive(const render::Model& model,
+                                                                            double resolution,
+                                                                            double tolerance,
+                                                                            const std::atomic<bool>& cancelFlag,
+                                                                            std::string& logMessage,
+                                                                            bool& reused)
+    {
+        reused = false;
+        logMessage.clear();
+
+        const std::weak_ptr<const void> meshToken = model.meshToken();
+        const std::size_t vertexCount = model.vertices().size();
+        const std::size_t indexCount = model.indices().size();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            dropExpiredLocked();
+            for (Entry& entry : m_entries)
+            {
+                if (sameMesh(entry, meshToken, vertexCount, indexCount) && entry.adaptive
+                    && std::abs(entry.resolution - resolution) < 1e-6 && std::abs(entry.tolerance - tolerance) < 1e-9)
+                {
+                    entry.lastUse = ++m_clock;
+                    ++m_stats.hits;
+                    reused = true;
+                    std::ostringstream oss;
+                    oss.setf(std::ios::fixed);
+                    oss.precision(3);
+                    oss << "Adaptive height field cache hit (" << entry.adaptive->leafCount() << " leaves @ "
+                        << resolution << " mm, tol " << tolerance << " mm)";
+                    logMessage = oss.str();
+                    return entry.adaptive;
+                }
+            }
+            ++m_stats.misses;
+        }
+
+        heightfield::UniformGrid grid(model, resolution);
+
+        if (cancelFlag.load(std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        auto field = std::make_shared<heightfield::AdaptiveHeightField>();
+        heightfield::AdaptiveHeightField::BuildStats stats;
+        if (!field->build(grid, resolution, tolerance, cancelFlag, &stats))
+        {
+            return nullptr;
+        }
+
+        std::ostringstream oss;
+        oss.setf(std::ios::fixed);
+        oss.precision(2);
+        oss << "Adaptive height field built (" << field->columns() << "x" << field->rows() << " @ " << resolution
+            << " mm, samples " << stats.evaluatedSamples << "/" << stats.denseSamples << ", leaves "
+            << stats.leafCount << ") in " << stats.buildMilliseconds << " ms";
+        logMessage = oss.str();
+
+        Entry newEntry;
+        newEntry.meshToken = meshToken;
+        newEntry.resolution = resolution;
+        newEntry.vertexCount = vertexCount;
+        newEntry.indexCount = indexCount;
+        newEntry.adaptive = field;
+        newEntry.tolerance = tolerance;
+        newEntry.bytes = field->memoryBytes();
+        insert(std::move(newEntry), &CacheStats::builds);
+        return field;
+    }
+
+    // Built on first use by a cutter-aware raster pass and kept with the field it was built from.
+    std::shared_ptr<const heightfield::MaxZPyramid> acquirePyramid(
+        const std::shared_ptr<heightfield::HeightField>& field,
+        std::string& logMessage)
+    {
+        logMessage.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const Entry& entry : m_entries)
+            {
+                if (entry.field == field && entry.pyramid)
+                {
+                    return entry.pyramid;
+                }
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto pyramid = std::make_shared<const heightfield::MaxZPyramid>(*field);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::ostringstream oss;
+        oss.setf(std::ios::fixed);
+        oss.precision(2);
+        oss << "Max-Z pyramid built (" << pyramid->levelCount() << " levels, "
+            << static_cast<double>(pyramid->memoryBytes()) / (1024.0 * 1024.0) << " MiB) in " << ms << " ms";
+        logMessage = oss.str();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (Entry& entry : m_entries)
+            {
+                if (entry.field == field)
+                {
+                    if (!entry.pyramid)
+                    {
+                        entry.pyramid = pyramid;
+                        entry.bytes += pyramid->memoryBytes();
+                        trimLocked(entry.field.get());
+                    }
+                    return entry.pyramid;
+                }
+            }
+        }
+        return pyramid;
+    }
+
+    HeightFieldCacheStats stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropExpiredLocked();
+        HeightFieldCacheStats result;
+        result.hits = m_stats.hits;
+        result.misses = m_stats.misses;
+        result.builds = m_stats.builds;
+        result.downsampled = m_stats.downsampled;
+        result.diskHits = m_stats.diskHits;
+        result.evictions = m_stats.evictions;
+        result.invalidations = m_stats.invalidations;
+        result.entries = m_entries.size();
+        result.bytes = totalBytesLocked();
+        result.capacityBytes = m_capacityBytes;
+        return result;
+    }
+
+    void setCapacity(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacityBytes = bytes;
+        trimLocked(nullptr);
+    }
+
+    // Fields built or downsampled from now on are stored quantized; fields already cached are kept.
+    void setQuantum(double quantumMm)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quantum = std::max(0.0, quantumMm);
+    }
+
+    [[nodiscard]] double quantum()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_quantum;
+    }
+
+    // Layout for fields built from now on; downsampled fields follow their source.
+    void setLayout(heightfield::HeightField::SampleLayout layout)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_layout = layout;
+    }
+
+    // Fields built from now on are tiled and built tile by tile on first use.
+    void setLazy(bool lazy)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lazy = lazy;
+    }
+
+private:
+    struct CacheStats
+    {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t builds{0};
+        std::uint64_t downsampled{0};
+        std::uint64_t diskHits{0};
+        std::uint64_t evictions{0};
+        std::uint64_t invalidations{0};
+    };
+
+    // A dense field some caller is building right now. Callers asking for the same field meanwhile wait on
+    // result instead of starting a second build.
+    struct PendingBuild
+    {
+        std::weak_ptr<const void> meshToken;
+        double resolution{0.0};
+        std::size_t vertexCount{0};
+        std::size_t indexCount{0};
+        std::uint64_t id{0};
+        std::shared_future<std::shared_ptr<heightfield::HeightField>> result;
+    };
+
+    // Retires a pending build on every exit path of acquire(), handing waiters the published field or
+    // nullptr when the build failed, was cancelled or threw.
+    class PendingBuildScope
+    {
+    public:
+        PendingBuildScope(HeightFieldCache& cache,
+                          std::uint64_t id,
+                          std::promise<std::shared_ptr<heightfield::HeightField>> promise)
+            : m_cache(cache)
+            , m_id(id)
+            , m_promise(std::move(promise))
+        {
+        }
+
+        PendingBuildScope(const PendingBuildScope&) = delete;
+        PendingBuildScope& operator=(const PendingBuildScope&) = delete;
+
+        ~PendingBuildScope()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_cache.m_mutex);
+                std::erase_if(m_cache.m_pending, [this](const PendingBuild& build) { return build.id == m_id; });
+            }
+            m_promise.set_value(m_field);
+        }
+
+        std::shared_ptr<heightfield::HeightField> publish(std::shared_ptr<heightfield::HeightField> field)
+        {
+            m_field = field;
+            return field;
+        }
+
+    private:
+        HeightFieldCache& m_cache;
+        std::uint64_t m_id{0};
+        std::promise<std::shared_ptr<heightfield::HeightField>> m_promise;
+        std::shared_ptr<heightfield::HeightField> m_field;
+    };
+
+    HeightFieldCache() = default;
+
+    // Disk entries are written from the Float64 samples before this runs; mapped fields stay as they are.
+    static void appendQuantization(heightfield::HeightField& field, double quantum, std::ostringstream& oss)
+    {
+        heightfield::HeightField::BuildStats stats;
+        if (quantum <= 0.0 || !field.quantize(quantum, &stats))
+        {
+            return;
+        }
+        oss << "; quantized to "
+            << (field.encoding() == heightfield::HeightField::SampleEncoding::Quantized16 ? "int16" : "int32")
+            << " (max error " << stats.quantizationError * 1000.0 << " um)";
+    }
+
+    static bool sameMesh(const Entry& entry,
+                         const std::weak_ptr<const void>& meshToken,
+                         std::size_t vertexCount,
+                         std::size_t indexCount)
+    {
+        return !entry.meshToken.owner_before(meshToken) && !meshToken.owner_before(entry.meshToken)
+               && entry.vertexCount == vertexCount && entry.indexCount == indexCount;
+    }
+
+    void remember(const std::weak_ptr<const void>& meshToken,
+                  double resolution,
+                  std::size_t vertexCount,
+                  std::size_t indexCount,
+                  const std::shared_ptr<heightfield::HeightField>& field,
+                  std::uint64_t CacheStats::*counter)
+    {
+        Entry newEntry;
+        newEntry.meshToken = meshToken;
+        newEntry.resolution = resolution;
+        newEntry.vertexCount = vertexCount;
+        newEntry.indexCount = indexCount;
+        newEntry.field = field;
+        newEntry.bytes = field->memoryBytes();
+        insert(std::move(newEntry), counter);
+    }
+
+    // Replaces any entry of the same kind for the same mesh, resolution and tolerance.
+    void insert(Entry newEntry, std::uint64_t CacheStats::*counter)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++(m_stats.*counter);
+        auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) {
+            return sameMesh(entry, newEntry.meshToken, newEntry.vertexCount, newEntry.indexCount)
+                   && std::abs(entry.resolution - newEntry.resolution) < 1e-6
+                   && (entry.adaptive != nullptr) == (newEntry.adaptive != nullptr)
+                   && std::abs(entry.tolerance - newEntry.tolerance) < 1e-9;
+        });
+        m_entries.erase(it, m_entries.end());
+        newEntry.lastUse = ++m_clock;
+        const void* keep = entryKey(newEntry);
+        m_entries.push_back(std::move(newEntry));
+        trimLocked(keep);
+    }
+
+    static const void* entryKey(const Entry& entry)
+    {
+        return entry.field ? static_cast<const void*>(entry.field.get()) : entry.adaptive.get();
+    }
+
+    // Entries whose model was destroyed or given new mesh data can never be hit again.
+    void dropExpiredLocked()
+    {
+        auto it = std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) {
+            return entry.meshToken.expired();
+        });
+        m_stats.invalidations += static_cast<std::uint64_t>(std::distance(it, m_entries.end()));
+        m_entries.erase(it, m_entries.end());
+    }
+
+    std::size_t totalBytesLocked() const
+    {
+        std::size_t bytes = 0;
+        for (const Entry& entry : m_entries)
+        {
+            bytes += entry.bytes;
+        }
+        return bytes;
+    }
+
+    // Evicts least recently used entries until the budget holds. The entry for keep is never evicted,
+    // so a single field larger than the budget still survives until the next insertion.
+    void trimLocked(const void* keep)
+    {
+        dropExpiredLocked();
+        std::size_t bytes = totalBytesLocked();
+        while (bytes > m_capacityBytes)
+        {
+            auto victim = m_entries.end();
+            for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+            {
+                if (entryKey(*it) != keep && (victim == m_entries.end() || it->lastUse < victim->lastUse))
+                {
+                    victim = it;
+                }
+            }
+            if (victim == m_entries.end())
+            {
+                break;
+            }
+            bytes -= victim->bytes;
+            m_entries.erase(victim);
+            ++m_stats.evictions;
+        }
+    }
+
+    std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    std::vector<PendingBuild> m_pending;
+    std::size_t m_capacityBytes{kDefaultCapacityBytes};
+    double m_quantum{0.0};
+    heightfield::HeightField::SampleLayout m_layout{heightfield::HeightField::SampleLayout::RowMajor};
+    bool m_lazy{false};
+    std::uint64_t m_clock{0};
+    CacheStats m_stats;
+};
+
+// Everything the cut geometry of a completed pass (reordered, leave-stock fixup applied) depends on besides
+// the mesh. Feed, spindle, ramps, leads and the machine planes only shape the linking that follows; the safe
+// plane's one effect on the fixup is checked separately by PassGeometryCache.
+struct PassGeometryKey
+{
+    ai::StrategyStep::Type stepType{ai::StrategyStep::Type::Raster};
+    double stepover{0.0};
+    double stepdown{0.0};
+    double angleDeg{0.0};
+    bool finishPass{false};
+    bool rough{false};
+    double allowance{0.0};
+    std::size_t planIndex{0};
+    double toolDiameter{0.0};
+    double stepOver{0.0};
+    double maxDepthPerPass{0.0};
+    double rasterAngleDeg{0.0};
+    double stockAllowance{0.0};
+    double leaveStock{0.0};
+    bool useHeightField{true};
+    bool cutterAwareRaster{false};
+    bool adaptiveHeightField{false};
+    double adaptiveTolerance{0.0};
+    double chordTolerance{0.0};
+    double arcTolerance{0.0};
+    UserParams::CutterType cutterType{UserParams::CutterType::FlatEndmill};
+    UserParams::CutDirection cutDirection{UserParams::CutDirection::Climb};
+    double stockTopZ{0.0};
+    double heightFieldQuantum{0.0};
+    std::size_t orderingSteps{0};
+    double orderingBudget{0.0};
+    bool reverseOpenPolylines{false};
+    // Where the previous pass ended; reordering starts from there.
+    bool seeded{false};
+    glm::dvec3 seed{0.0};
+
+    bool operator==(const PassGeometryKey&) const = default;
+};
+
+PassGeometryKey makePassGeometryKey(const UserParams& params, double heightFieldQuantum)
+{
+    PassGeometryKey key;
+    key.toolDiameter = params.toolDiameter;
+    key.stepOver = params.stepOver;
+    key.maxDepthPerPass = params.maxDepthPerPass;
+    key.rasterAngleDeg = params.rasterAngleDeg;
+    key.stockAllowance = params.stockAllowance_mm;
+    key.leaveStock = params.leaveStock_mm;
+    key.useHeightField = params.useHeightField;
+    key.cutterAwareRaster = params.cutterAwareRaster;
+    key.adaptiveHeightField = params.adaptiveHeightField;
+    key.adaptiveTolerance = params.adaptiveHeightFieldTolerance_mm;
+    key.chordTolerance = params.rasterChordTolerance_mm;
+    key.arcTolerance = params.waterlineArcTolerance_mm;
+    key.cutterType = params.cutterType;
+    key.cutDirection = params.cutDirection;
+    key.stockTopZ = params.stock.topZ_mm;
+    key.heightFieldQuantum = heightFieldQuantum;
+    key.orderingSteps = params.passOrderingSteps;
+    key.orderingBudget = params.passOrderingBudget_ms;
+    key.reverseOpenPolylines = params.reverseOpenPolylines;
+    return key;
+}
+
+struct PassGeometry
+{
+    // Cut polylines of the pass in final order, before linking.
+    std::vector<Polyline> polylines;
+    // End of the reordered pass; the next pass is reordered from here.
+    glm::dvec3 end{0.0};
+};
+
+// Completed passes of recent runs, so a regeneration that only changes feeds or linking parameters can
+// skip straight to linking. Process-wide and keyed on the model's mesh token like HeightFieldCache.
+class PassGeometryCache
+{
+public:
+    static constexpr std::size_t kDefaultCapacityBytes = std::size_t{256} << 20;
+
+    static PassGeometryCache& instance()
+    {
+        static PassGeometryCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const PassGeometry> find(const render::Model& model, const PassGeometryKey& key, double safeZ)
+    {
+        const std::weak_ptr<const void> meshToken = model.meshToken();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropExpiredLocked();
+        for (Entry& entry : m_entries)
+        {
+            if (sameMesh(entry, meshToken, model.vertices().size(), model.indices().size()) && entry.key == key
+                && (entry.safeZ == safeZ || (clampFree(entry, entry.safeZ) && clampFree(entry, safeZ))))
+            {
+                entry.lastUse = ++m_clock;
+                ++m_stats.hits;
+                return entry.geometry;
+            }
+        }
+        ++m_stats.misses;
+        return nullptr;
+    }
+
+    // highestFixupZ is the highest Z the leave-stock fixup asked for before clamping to safeZ.
+    void insert(const render::Model& model,
+                const PassGeometryKey& key,
+                double safeZ,
+                double highestFixupZ,
+                std::shared_ptr<const PassGeometry> geometry)
+    {
+        Entry newEntry;
+        newEntry.meshToken = model.meshToken();
+        newEntry.vertexCount = model.vertices().size();
+        newEntry.indexCount = model.indices().size();
+        newEntry.key = key;
+        newEntry.safeZ = safeZ;
+        newEntry.highestFixupZ = highestFixupZ;
+        newEntry.bytes = sizeof(PassGeometry);
+        for (const Polyline& poly : geometry->polylines)
+        {
+            newEntry.bytes += sizeof(Polyline) + poly.pts.size() * sizeof(Vertex);
+        }
+        newEntry.geometry = std::move(geometry);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_entries, [&](const Entry& entry) {
+            return sameMesh(entry, newEntry.meshToken, newEntry.vertexCount, newEntry.indexCount)
+                   && entry.key == newEntry.key;
+        });
+        newEntry.lastUse = ++m_clock;
+        m_entries.push_back(std::move(newEntry));
+        trimLocked();
+    }
+
+    PassGeometryCacheStats stats()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropExpiredLocked();
+        PassGeometryCacheStats result;
+        result.hits = m_stats.hits;
+        result.misses = m_stats.misses;
+        result.entries = m_entries.size();
+        result.bytes = totalBytesLocked();
+        result.capacityBytes = m_capacityBytes;
+        return result;
+    }
+
+    void setCapacity(std::size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacityBytes = bytes;
+        trimLocked();
+    }
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<const void> meshToken;
+        std::size_t vertexCount{0};
+        std::size_t indexCount{0};
+        PassGeometryKey key;
+        double safeZ{0.0};
+        double highestFixupZ{-std::numeric_limits<double>::infinity()};
+        std::shared_ptr<const PassGeometry> geometry;
+        std::size_t bytes{0};
+        std::uint64_t lastUse{0};
+    };
+
+    struct CacheStats
+    {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+    };
 
-        if (cancelFlag.load(std::memory_order_relaxed))
-        {
-            return nullptr;
-        }
+    PassGeometryCache() = default;
 
-        auto field = std::make_shared<heightfield::HeightField>();
-        heightfield::HeightField::BuildStats stats;
-        if (!field->build(grid, resolution, cancelFlag, &stats))
-        {
-            return nullptr;
-        }
+    static bool sameMesh(const Entry& entry,
+                         const std::weak_ptr<const void>& meshToken,
+                         std::size_t vertexCount,
+                         std::size_t indexCount)
+    {
+        return !entry.meshToken.owner_before(meshToken) && !meshToken.owner_before(entry.meshToken)
+               && entry.vertexCount == vertexCount && entry.indexCount == indexCount;
+    }
 
-        std::ostringstream oss;
-        oss.setf(std::ios::fixed);
-        oss.precision(2);
-        oss << "Height field built (" << field->columns() << "x" << field->rows()
-            << " @ " << resolution << " mm, valid " << stats.validSamples << "/" << stats.totalSamples
-            << ") in " << stats.buildMilliseconds << " ms";
-        logMessage = oss.str();
+    // The leave-stock fixup caps its heights at a positive safe plane; a plane above every height it asked
+    // for leaves the pass exactly as it would be without one.
+    static bool clampFree(const Entry& entry, double safeZ)
+    {
+        return safeZ <= 0.0 || entry.highestFixupZ <= safeZ;
+    }
 
-        Entry newEntry;
-        newEntry.model = &model;
-        newEntry.resolution = resolution;
-        newEntry.vertexCount = vertexCount;
-        newEntry.indexCount = indexCount;
-        newEntry.field = field;
+    void dropExpiredLocked()
+    {
+        std::erase_if(m_entries, [](const Entry& entry) { return entry.meshToken.expired(); });
+    }
 
+    std::size_t totalBytesLocked() const
+    {
+        std::size_t bytes = 0;
+        for (const Entry& entry : m_entries)
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) {
-                return entry.model == &model && std::abs(entry.resolution - resolution) < 1e-6;
-            });
-            m_entries.erase(it, m_entries.end());
-            m_entries.push_back(std::move(newEntry));
+            bytes += entry.bytes;
         }
-
-        return field;
+        return bytes;
     }
 
-private:
-    HeightFieldCache() = default;
+    // Evicts least recently used entries until the budget holds; a budget of 0 keeps nothing.
+    void trimLocked()
+    {
+        dropExpiredLocked();
+        std::size_t bytes = totalBytesLocked();
+        while (bytes > m_capacityBytes && !m_entries.empty())
+        {
+            const auto victim =
+                std::min_element(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+                    return a.lastUse < b.lastUse;
+                });
+            bytes -= victim->bytes;
+            m_entries.erase(victim);
+        }
+    }
 
     std::mutex m_mutex;
     std::vector<Entry> m_entries;
+    std::size_t m_capacityBytes{kDefaultCapacityBytes};
+    std::uint64_t m_clock{0};
+    CacheStats m_stats;
 };
 
-void finalizeToolpath(Toolpath& toolpath, const UserParams& params)
+// Fills in the feed, spindle, machine and stock a toolpath is emitted with, clamped to the machine limits
+// and with the clearance and safe planes lifted above the stock.
+void applyToolpathSettings(Toolpath& toolpath, const UserParams& params)
 {
     Stock stock = params.stock;
     stock.ensureValid();
@@ -837,12 +1799,52 @@ void finalizeToolpath(Toolpath& toolpath, const UserParams& params)
     toolpath.rapidFeed = machine.rapidFeed_mm_min;
     toolpath.machine = machine;
     toolpath.stock = stock;
+}
 
-    applyMachineMotion(toolpath, machine, stock, params);
+void finalizeToolpath(Toolpath& toolpath, const UserParams& params)
+{
+    applyToolpathSettings(toolpath, params);
+    applyMachineMotion(toolpath, toolpath.machine, toolpath.stock, params);
 }
 
 } // namespace
 
+HeightFieldCacheStats ToolpathGenerator::heightFieldCacheStats()
+{
+    return HeightFieldCache::instance().stats();
+}
+
+PassGeometryCacheStats ToolpathGenerator::passGeometryCacheStats()
+{
+    return PassGeometryCache::instance().stats();
+}
+
+void ToolpathGenerator::setPassGeometryCacheCapacity(std::size_t bytes)
+{
+    PassGeometryCache::instance().setCapacity(bytes);
+}
+
+void ToolpathGenerator::setHeightFieldCacheCapacity(std::size_t bytes)
+{
+    HeightFieldCache::instance().setCapacity(bytes);
+}
+
+void ToolpathGenerator::setHeightFieldQuantum(double quantumMm)
+{
+    HeightFieldCache::instance().setQuantum(quantumMm);
+}
+
+void ToolpathGenerator::setHeightFieldTiling(bool tiled)
+{
+    HeightFieldCache::instance().setLayout(tiled ? heightfield::HeightField::SampleLayout::Tiled
+                                                 : heightfield::HeightField::SampleLayout::RowMajor);
+}
+
+void ToolpathGenerator::setHeightFieldLazyBuild(bool lazy)
+{
+    HeightFieldCache::instance().setLazy(lazy);
+}
+
 const char* ToolpathGenerator::passLabel(const PassProfile& profile)
 {
     return (profile.kind == PassProfile::Kind::Rough) ? "Roughing" : "Finishing";
@@ -972,6 +1974,18 @@ Toolpath ToolpathGenerator::generate(const render::Model& model,
                                      const std::function<void(int)>& progressCallback,
                                      ai::StrategyDecision* outDecision,
                                      std::string* bannerMessage) const
+{
+    return generateStreaming(model, params, ai, cancelFlag, {}, progressCallback, outDecision, bannerMessage);
+}
+
+Toolpath ToolpathGenerator::generateStreaming(const render::Model& model,
+                                              const UserParams& params,
+                                              ai::IPathAI& ai,
+                                              const std::atomic<bool>& cancelFlag,
+                                              const ToolpathSink& sink,
+                                              const std::function<void(int)>& progressCallback,
+                                              ai::StrategyDecision* outDecision,
+                                              std::string* bannerMessage) const
 {
     Toolpath toolpath;
 
@@ -1036,8 +2050,95 @@ Toolpath ToolpathGenerator::generate(const render::Model& model,
     Toolpath aggregated;
     aggregated.strategySteps = appliedDecision.steps;
     std::string bannerText;
-    std::vector<std::pair<std::size_t, std::size_t>> passRanges;
-    passRanges.reserve(passPlan.size());
+
+    // Raw passes collect in aggregated; each finished pass is reordered (seeded with where the previous
+    // pass ended), given the point-wise leave-stock fixup unless its raster already dropped the full
+    // cutter, and appended to linked. Every step only looks back, so linking pass by pass gives the same
+    // toolpath as linking all passes at the end.
+    Toolpath settings;
+    settings.strategySteps = appliedDecision.steps;
+    applyToolpathSettings(settings, params);
+    const std::shared_ptr<ModelGeometryContext> geometry = ModelGeometryContext::forModel(model);
+    LinkGeometry linkGeometry;
+    if (params.linking != UserParams::Linking::SafePlane)
+    {
+        linkGeometry.checker = &geometry->gougeChecker(model);
+        linkGeometry.modelTopZ = static_cast<double>(model.bounds().max.z());
+    }
+    MachineMotionLinker linker(settings.machine, settings.stock, params, linkGeometry);
+    std::vector<Polyline> linked;
+    glm::dvec3 seed{};
+    bool haveSeed = false;
+
+    // Links aggregated.passes[begin, end), which are already in final order, and hands them to the sink.
+    const auto linkPass = [&](std::size_t passIndex, std::size_t begin, std::size_t end) {
+        const std::size_t linkedBegin = linked.size();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            linker.append(aggregated.passes[i], linked);
+        }
+        linker.finish(linked);
+        if (sink && linked.size() > linkedBegin)
+        {
+            ToolpathChunk chunk;
+            chunk.settings = &settings;
+            chunk.polylines = std::span<const Polyline>(linked).subspan(linkedBegin);
+            chunk.passIndex = passIndex;
+            chunk.passCount = passPlan.size();
+            sink(chunk);
+        }
+    };
+
+    PassOrderingOptions ordering;
+    ordering.clearance_mm = params.toolDiameter;
+    ordering.allowReverse = params.reverseOpenPolylines;
+    ordering.improveSteps = params.passOrderingSteps;
+    ordering.improveBudget_ms = std::max(0.0, params.passOrderingBudget_ms);
+
+    // Returns the highest Z the leave-stock fixup asked for, for PassGeometryCache.
+    const auto completePass = [&](std::size_t passIndex, std::size_t begin, std::size_t end, bool leaveStock) {
+        const glm::dvec3* seedPtr = haveSeed ? &seed : nullptr;
+        PassOrderingStats orderingStats;
+        seed = orderPassRange(aggregated.passes, begin, end, seedPtr, ordering, &orderingStats);
+        haveSeed = true;
+        LOG_INFO(Tp,
+                 QStringLiteral("Pass %1 ordering: rapids %2 mm in generated order, %3 mm nearest neighbour, "
+                                "%4 mm after %5 improvements%6")
+                     .arg(static_cast<qulonglong>(passIndex + 1))
+                     .arg(orderingStats.rapidBefore_mm, 0, 'f', 1)
+                     .arg(orderingStats.rapidNearestNeighbour_mm, 0, 'f', 1)
+                     .arg(orderingStats.rapidAfter_mm, 0, 'f', 1)
+                     .arg(static_cast<qulonglong>(orderingStats.improvements))
+                     .arg(orderingStats.budgetExhausted ? QStringLiteral(" (budget used up)") : QString()));
+
+        double highestFixupZ = -std::numeric_limits<double>::infinity();
+        if (leaveStock && params.leaveStock_mm > 1e-6)
+        {
+            highestFixupZ =
+                applyLeaveStockAdjustment(aggregated, geometry->gougeChecker(model), params, {{begin, end}});
+        }
+
+        linkPass(passIndex, begin, end);
+        return highestFixupZ;
+    };
+
+    PassGeometryCache& passCache = PassGeometryCache::instance();
+    const PassGeometryKey paramsKey = makePassGeometryKey(params, HeightFieldCache::instance().quantum());
+    const auto passKey = [&](std::size_t passIndex, const glm::dvec3* passSeed) {
+        const auto& profile = passPlan[passIndex];
+        PassGeometryKey key = paramsKey;
+        key.stepType = profile.step.type;
+        key.stepover = profile.step.stepover;
+        key.stepdown = profile.step.stepdown;
+        key.angleDeg = profile.step.angle_deg;
+        key.finishPass = profile.step.finish_pass;
+        key.rough = profile.kind == PassProfile::Kind::Rough;
+        key.allowance = profile.allowance;
+        key.planIndex = profile.index;
+        key.seeded = passSeed != nullptr;
+        key.seed = passSeed ? *passSeed : glm::dvec3(0.0);
+        return key;
+    };
 
 #if TP_WITH_OCL
     bool usedOcl = false;
@@ -1090,7 +2191,7 @@ Toolpath ToolpathGenerator::generate(const render::Model& model,
             oss.precision(2);
             oss << passLabel(profile) << ": OCL path generated in " << elapsed << " ms";
             bannerText = oss.str();
-            passRanges.emplace_back(0, aggregated.passes.size());
+            completePass(0, 0, aggregated.passes.size(), true);
         }
         else if (!oclError.empty())
         {
@@ -1106,71 +2207,266 @@ Toolpath ToolpathGenerator::generate(const render::Model& model,
 
     if (aggregated.empty())
     {
-        for (std::size_t passIndex = 0; passIndex < passPlan.size(); ++passIndex)
+        // Passes only read the model, its geometry context and the process-wide caches, so up to
+        // params.concurrentPasses of them run at once.
+        struct PassOutput
         {
-            if (cancelFlag.load(std::memory_order_relaxed))
+            Toolpath toolpath;
+            std::string log;
+            bool footprintChecked{false};
+            std::exception_ptr error;
+            // Set when the pass is taken from PassGeometryCache instead of being generated.
+            std::shared_ptr<const PassGeometry> reused;
+        };
+        std::vector<PassOutput> outputs(passPlan.size());
+
+        // Every pass is reordered from where the previous one ended, so cached geometry can only be reused
+        // for a run of passes from the start of the plan.
+        {
+            glm::dvec3 prefixSeed{};
+            bool prefixSeeded = false;
+            for (std::size_t passIndex = 0; passIndex < passPlan.size(); ++passIndex)
             {
-                return Toolpath{};
+                outputs[passIndex].reused = passCache.find(model,
+                                                           passKey(passIndex, prefixSeeded ? &prefixSeed : nullptr),
+                                                           params.machine.safeZ_mm);
+                if (!outputs[passIndex].reused)
+                {
+                    break;
+                }
+                prefixSeed = outputs[passIndex].reused->end;
+                prefixSeeded = true;
+            }
+        }
+
+        // passCancel is the caller's flag, or with concurrent passes one that also stops them when a pass fails.
+        const auto runPass = [&](std::size_t passIndex,
+                                 const std::function<void(int)>& subProgress,
+                                 const std::atomic<bool>& passCancel) {
+            if (passCancel.load(std::memory_order_relaxed))
+            {
+                return;
             }
 
             const auto& profile = passPlan[passIndex];
-            auto subProgress = makePassProgressCallback(progressCallback, passIndex, passPlan.size());
-            std::string passLog;
-            Toolpath passToolpath;
+            PassOutput& output = outputs[passIndex];
+            if (output.reused)
+            {
+                if (subProgress)
+                {
+                    subProgress(100);
+                }
+                return;
+            }
 
-            if (profile.step.type == ai::StrategyStep::Type::Waterline)
-            {
-                passToolpath = generateWaterlineSlicer(model,
-                                                       params,
-                                                       profile,
-                                                       cancelFlag,
-                                                       subProgress,
-                                                       &passLog);
-            }
-            else if (params.useHeightField)
-            {
-                passToolpath = generateRasterTopography(model,
-                                                        params,
-                                                        profile,
-                                                        cancelFlag,
-                                                        subProgress,
-                                                        &passLog);
-            }
+            if (profile.step.type == ai::StrategyStep::Type::Waterline)
+            {
+                output.toolpath = generateWaterlineSlicer(model,
+                                                          geometry->slicer(model),
+                                                          params,
+                                                          profile,
+                                                          passCancel,
+                                                          subProgress,
+                                                          &output.log);
+            }
+            else if (params.useHeightField)
+            {
+                output.toolpath = generateRasterTopography(model,
+                                                           params,
+                                                           profile,
+                                                           passCancel,
+                                                           subProgress,
+                                                           &output.log);
+                output.footprintChecked = params.cutterAwareRaster && !output.toolpath.empty();
+            }
 
-            if (passToolpath.empty())
+            if (output.toolpath.empty())
             {
-                passToolpath = generateFallbackRaster(model,
-                                                      params,
-                                                      profile,
-                                                      cancelFlag,
-                                                      subProgress);
-            }
-
-            if (cancelFlag.load(std::memory_order_relaxed))
-            {
-                return Toolpath{};
+                output.toolpath = generateFallbackRaster(model,
+                                                         params,
+                                                         profile,
+                                                         passCancel,
+                                                         subProgress);
+            }
+        };
+
+        // Appends a generated pass in plan order and hands it on; false once generation is cancelled.
+        const auto mergePass = [&](std::size_t passIndex) {
+            PassOutput& output = outputs[passIndex];
+            if (output.error)
+            {
+                std::rethrow_exception(output.error);
+            }
+
+            if (cancelFlag.load(std::memory_order_relaxed))
+            {
+                return false;
             }
 
-            if (!passLog.empty())
+            if (output.reused)
+            {
+                output.log = makePassLog(passPlan[passIndex], "cut geometry reused");
+            }
+            if (!output.log.empty())
             {
                 if (!bannerText.empty())
                 {
                     bannerText += " | ";
                 }
-                bannerText += passLog;
+                bannerText += output.log;
             }
-
-            if (!passToolpath.passes.empty())
-            {
-                for (auto& poly : passToolpath.passes)
-                {
-                    poly.strategyStep = static_cast<int>(profile.index);
-                }
-                const std::size_t offset = aggregated.passes.size();
-                aggregated.passes.insert(aggregated.passes.end(),
-                                         std::make_move_iterator(passToolpath.passes.begin()),
-                                         std::make_move_iterator(passToolpath.passes.end()));
-                passRanges.emplace_back(offset, aggregated.passes.size());
+
+            const std::size_t offset = aggregated.passes.size();
+            if (output.reused)
+            {
+                aggregated.passes.insert(aggregated.passes.end(),
+                                         output.reused->polylines.begin(),
+                                         output.reused->polylines.end());
+                seed = output.reused->end;
+                haveSeed = true;
+                linkPass(passIndex, offset, aggregated.passes.size());
+            }
+            else if (!output.toolpath.passes.empty())
+            {
+                for (auto& poly : output.toolpath.passes)
+                {
+                    poly.strategyStep = static_cast<int>(passPlan[passIndex].index);
+                }
+                aggregated.passes.insert(aggregated.passes.end(),
+                                         std::make_move_iterator(output.toolpath.passes.begin()),
+                                         std::make_move_iterator(output.toolpath.passes.end()));
+                const PassGeometryKey key = passKey(passIndex, haveSeed ? &seed : nullptr);
+                const double highestFixupZ =
+                    completePass(passIndex, offset, aggregated.passes.size(), !output.footprintChecked);
+
+                auto cached = std::make_shared<PassGeometry>();
+                cached->polylines.assign(aggregated.passes.begin() + static_cast<std::ptrdiff_t>(offset),
+                                         aggregated.passes.end());
+                cached->end = seed;
+                passCache.insert(model, key, params.machine.safeZ_mm, highestFixupZ, std::move(cached));
+            }
+            output.toolpath = Toolpath{};
+            output.reused.reset();
+            return true;
+        };
+
+        const std::size_t workerCount =
+            std::min(passPlan.size(), static_cast<std::size_t>(std::max(1, params.concurrentPasses)));
+        if (workerCount <= 1)
+        {
+            for (std::size_t passIndex = 0; passIndex < passPlan.size(); ++passIndex)
+            {
+                if (cancelFlag.load(std::memory_order_relaxed))
+                {
+                    return Toolpath{};
+                }
+
+                runPass(passIndex,
+                        makePassProgressCallback(progressCallback, passIndex, passPlan.size()),
+                        cancelFlag);
+                if (!mergePass(passIndex))
+                {
+                    return Toolpath{};
+                }
+            }
+        }
+        else
+        {
+            // Workers take passes in plan order. This thread merges each pass once it is done and reports the
+            // combined progress, so the progress callback and the sink only ever run here. The workers poll
+            // passesStopped, which this thread sets when the caller cancels and a worker sets when its pass
+            // throws, so a failure stops the passes still running instead of waiting for them.
+            std::mutex passMutex;
+            std::condition_variable passChanged;
+            std::vector<char> passDone(passPlan.size(), 0);
+            std::vector<int> passPercent(passPlan.size(), 0);
+            bool progressChanged = false;
+            std::optional<std::size_t> failedPass;
+            std::atomic<std::size_t> nextPass{0};
+            std::atomic<bool> passesStopped{false};
+
+            std::vector<std::jthread> workers;
+            workers.reserve(workerCount);
+            for (std::size_t worker = 0; worker < workerCount; ++worker)
+            {
+                workers.emplace_back([&] {
+                    for (std::size_t passIndex = nextPass.fetch_add(1);
+                         passIndex < passPlan.size() && !passesStopped.load(std::memory_order_relaxed);
+                         passIndex = nextPass.fetch_add(1))
+                    {
+                        std::function<void(int)> subProgress;
+                        if (progressCallback)
+                        {
+                            subProgress = [&, passIndex](int percent) {
+                                {
+                                    std::lock_guard<std::mutex> lock(passMutex);
+                                    passPercent[passIndex] = std::clamp(percent, passPercent[passIndex], 100);
+                                    progressChanged = true;
+                                }
+                                passChanged.notify_all();
+                            };
+                        }
+                        try
+                        {
+                            runPass(passIndex, subProgress, passesStopped);
+                        }
+                        catch (...)
+                        {
+                            outputs[passIndex].error = std::current_exception();
+                            passesStopped.store(true, std::memory_order_relaxed);
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock(passMutex);
+                            passDone[passIndex] = 1;
+                            if (outputs[passIndex].error && !failedPass)
+                            {
+                                failedPass = passIndex;
+                            }
+                        }
+                        passChanged.notify_all();
+                    }
+                });
+            }
+
+            int reportedPercent = 0;
+            for (std::size_t passIndex = 0; passIndex < passPlan.size(); ++passIndex)
+            {
+                bool done = false;
+                while (!done)
+                {
+                    int percentSum = 0;
+                    std::optional<std::size_t> failed;
+                    {
+                        std::unique_lock<std::mutex> lock(passMutex);
+                        passChanged.wait_for(lock, kPassCancelPollInterval, [&] {
+                            return progressChanged || passDone[passIndex] != 0 || failedPass.has_value();
+                        });
+                        progressChanged = false;
+                        done = passDone[passIndex] != 0;
+                        failed = failedPass;
+                        percentSum = std::accumulate(passPercent.begin(), passPercent.end(), 0);
+                    }
+                    // The workers, told to stop, are joined as this scope is left.
+                    if (failed)
+                    {
+                        std::rethrow_exception(outputs[*failed].error);
+                    }
+                    if (cancelFlag.load(std::memory_order_relaxed))
+                    {
+                        passesStopped.store(true, std::memory_order_relaxed);
+                        return Toolpath{};
+                    }
+                    const int percent = std::min(99, percentSum / static_cast<int>(passPlan.size()));
+                    if (progressCallback && percent > reportedPercent)
+                    {
+                        reportedPercent = percent;
+                        progressCallback(percent);
+                    }
+                }
+                if (!mergePass(passIndex))
+                {
+                    return Toolpath{};
+                }
             }
         }
     }
@@ -1189,17 +2485,32 @@ Toolpath ToolpathGenerator::generate(const render::Model& model,
         return aggregated;
     }
 
-    glm::dvec3 seed{};
-    bool haveSeed = false;
-    for (const auto& range : passRanges)
+    aggregated = std::move(settings);
+    aggregated.passes = std::move(linked);
+
+    const LinkingStats& linking = linker.stats();
+    if (linking.stayDown + linking.clearancePlane > 0)
     {
-        const glm::dvec3* seedPtr = haveSeed ? &seed : nullptr;
-        seed = reorderPassRange(aggregated.passes, range.first, range.second, seedPtr);
-        haveSeed = true;
+        std::ostringstream oss;
+        oss.setf(std::ios::fixed);
+        oss.precision(1);
+        oss << "Links: " << linking.stayDown << " stay-down, " << linking.clearancePlane << " clearance plane, "
+            << linking.safePlane << " safe plane; about " << linking.timeSaved_s << " s saved";
+        LOG_INFO(Tp, QString::fromStdString(oss.str()));
+        if (!bannerText.empty())
+        {
+            bannerText += " | ";
+        }
+        bannerText += oss.str();
     }
 
-    applyLeaveStockAdjustment(aggregated, model, params);
-    finalizeToolpath(aggregated, params);
+    const CycleTimeEstimate cycle = estimateCycleTime(aggregated);
+    LOG_INFO(Tp,
+             QStringLiteral("Estimated cycle time %1 s (cuts %2 s, links %3 s, rapids %4 s)")
+                 .arg(cycle.total_s, 0, 'f', 1)
+                 .arg(cycle.cut_s, 0, 'f', 1)
+                 .arg(cycle.link_s, 0, 'f', 1)
+                 .arg(cycle.rapid_s, 0, 'f', 1));
 
     if (progressCallback)
     {
@@ -1276,17 +2587,54 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
                       &cancelFlag);
 
     std::string cacheLog;
-    auto heightField = HeightFieldCache::instance().acquire(model, resolution, cancelFlag, cacheLog, reused);
-    if (logMessage)
+    std::shared_ptr<heightfield::HeightField> heightField;
+    std::shared_ptr<const heightfield::AdaptiveHeightField> adaptiveField;
+    if (params.adaptiveHeightField && !params.cutterAwareRaster)
     {
-        *logMessage = makePassLog(profile, cacheLog);
+        adaptiveField = HeightFieldCache::instance().acquireAdaptive(
+            model, resolution, std::max(1e-3, params.adaptiveHeightFieldTolerance_mm), cancelFlag, cacheLog, reused);
     }
-    if (!heightField || !heightField->isValid())
+    else
+    {
+        heightField = HeightFieldCache::instance().acquire(model, resolution, cancelFlag, cacheLog, reused);
+    }
+    if ((!heightField || !heightField->isValid()) && (!adaptiveField || !adaptiveField->isValid()))
     {
+        if (logMessage)
+        {
+            *logMessage = makePassLog(profile, cacheLog);
+        }
         return Toolpath{};
     }
 
+    // Cutter-aware mode drops the whole tool footprint onto the field, so the pass is gouge-free on the
+    // sampled surface and already carries the leave-stock offset.
+    std::shared_ptr<const heightfield::MaxZPyramid> pyramid;
+    if (params.cutterAwareRaster)
+    {
+        // The pyramid reads every sample, so finish a lazy field in parallel first.
+        if (!heightField->populate(cancelFlag))
+        {
+            return Toolpath{};
+        }
+        std::string pyramidLog;
+        pyramid = HeightFieldCache::instance().acquirePyramid(heightField, pyramidLog);
+        if (!pyramidLog.empty())
+        {
+            cacheLog += "; " + pyramidLog;
+        }
+    }
+    if (logMessage)
+    {
+        *logMessage = makePassLog(profile, cacheLog);
+    }
+
     const double cutterOffset = cutterOffsetFor(params);
+    const double toolRadius = std::max(0.0, params.toolDiameter * 0.5);
+    const auto footprint = (params.cutterType == UserParams::CutterType::BallNose)
+                               ? heightfield::MaxZPyramid::Footprint::Ball
+                               : heightfield::MaxZPyramid::Footprint::Flat;
+    const double leaveStock = pyramid ? std::max(0.0, params.leaveStock_mm) : 0.0;
     const double topZ = params.stock.topZ_mm;
     const double maxDepthPerPass = std::max(profile.step.stepdown, 0.1);
 
@@ -1330,6 +2678,30 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
     const int rows = std::max(1, static_cast<int>(std::ceil(spanYRot / rowSpacing)));
     const int totalIterations = rows + 1;
 
+    // A lazy field builds its tiles on first touch. The prefetcher walks the rows ahead of the raster and
+    // builds the tiles under them, skipping rows the raster has already passed; a tile it is still
+    // building when the raster arrives is waited for, not built twice.
+    std::atomic<int> rasterRow{0};
+    std::jthread prefetcher;
+    if (heightField && heightField->pendingTiles() > 0 && params.prefetchHeightFieldTiles)
+    {
+        prefetcher = std::jthread([&, field = heightField](std::stop_token stop) {
+            for (int row = 0; row <= rows; ++row)
+            {
+                row = std::max(row, rasterRow.load(std::memory_order_relaxed) + 1);
+                if (row > rows || stop.stop_requested() || cancelFlag.load(std::memory_order_relaxed)
+                    || field->pendingTiles() == 0)
+                {
+                    return;
+                }
+                const double yRot = std::min(minYRot + static_cast<double>(row) * rowSpacing, maxYRot);
+                const auto start = unrotate2D(minXRot, yRot);
+                const auto end = unrotate2D(maxXRot, yRot);
+                field->prefetch(start.first, start.second, end.first, end.second);
+            }
+        });
+    }
+
     struct SamplePoint
     {
         double x;
@@ -1337,10 +2709,7 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
         double z;
     };
 
-    std::vector<SamplePoint> segmentPoints;
-    segmentPoints.reserve(256);
-
-    const auto flushSegment = [&](std::vector<SamplePoint>& points) {
+    const auto flushSegment = [&](std::vector<SamplePoint>& points, std::vector<Polyline>& out) {
         if (points.size() < 2)
         {
             points.clear();
@@ -1376,24 +2745,23 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
                                               static_cast<float>(p.y),
                                               static_cast<float>(cutZ))});
             }
+            thinRasterRow(poly.pts, params.rasterChordTolerance_mm);
 
             if (params.cutDirection == UserParams::CutDirection::Conventional)
             {
                 std::reverse(poly.pts.begin(), poly.pts.end());
             }
 
-            toolpath.passes.push_back(std::move(poly));
+            out.push_back(std::move(poly));
         }
 
         points.clear();
     };
 
-    for (int row = 0; row <= rows; ++row)
-    {
-        if (cancelFlag.load(std::memory_order_relaxed))
-        {
-            return Toolpath{};
-        }
+    // Appends one row's polylines to out; returns false when cancelled part way.
+    const auto generateRow = [&](int row, std::vector<Polyline>& out) {
+        thread_local std::vector<SamplePoint> segmentPoints;
+        segmentPoints.clear();
 
         const double yRot = std::min(minYRot + static_cast<double>(row) * rowSpacing, maxYRot);
         const bool leftToRight = (row % 2) == 0;
@@ -1402,13 +2770,11 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
         const double spanX = std::abs(endXRot - startXRot);
         const int steps = std::max(1, static_cast<int>(std::ceil(spanX / resolution)));
 
-        segmentPoints.clear();
-
         for (int step = 0; step <= steps; ++step)
         {
             if (cancelFlag.load(std::memory_order_relaxed))
             {
-                return Toolpath{};
+                return false;
             }
 
             const double t = static_cast<double>(step) / static_cast<double>(steps);
@@ -1427,23 +2793,68 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
             const double sampleY = xy.second;
 
             double sampleZ = 0.0;
-            if (heightField->interpolate(sampleX, sampleY, sampleZ))
+            if (adaptiveField ? adaptiveField->interpolate(sampleX, sampleY, sampleZ)
+                              : heightField->interpolate(sampleX, sampleY, sampleZ))
             {
-                double targetZ = sampleZ + cutterOffset + profile.allowance;
+                double referenceZ = sampleZ + cutterOffset;
+                double droppedZ = 0.0;
+                if (pyramid && pyramid->dropCutter(sampleX, sampleY, toolRadius, footprint, droppedZ))
+                {
+                    referenceZ = std::max(referenceZ, droppedZ);
+                }
+                double targetZ = referenceZ + leaveStock + profile.allowance;
                 targetZ = std::min(targetZ, topZ);
                 segmentPoints.push_back({sampleX, sampleY, targetZ});
             }
             else
             {
-                flushSegment(segmentPoints);
+                flushSegment(segmentPoints, out);
             }
         }
 
-        flushSegment(segmentPoints);
+        flushSegment(segmentPoints, out);
+        return true;
+    };
+
+    // Rows are independent once the field exists. Each batch is generated in parallel into per-row buckets
+    // and appended in row order, so the result matches a sequential sweep; progress is reported and
+    // cancellation checked between batches on the calling thread.
+    const int batchSize = static_cast<int>(std::max(16u, 4 * std::thread::hardware_concurrency()));
+    std::vector<std::vector<Polyline>> rowPasses(static_cast<std::size_t>(batchSize));
+    std::vector<int> batchRows;
+    batchRows.reserve(static_cast<std::size_t>(batchSize));
+    for (int batchBegin = 0; batchBegin <= rows; batchBegin += batchSize)
+    {
+        if (cancelFlag.load(std::memory_order_relaxed))
+        {
+            return Toolpath{};
+        }
+
+        const int batchEnd = std::min(rows + 1, batchBegin + batchSize);
+        rasterRow.store(batchEnd - 1, std::memory_order_relaxed);
+        batchRows.resize(static_cast<std::size_t>(batchEnd - batchBegin));
+        std::iota(batchRows.begin(), batchRows.end(), batchBegin);
+        std::for_each(std::execution::par, batchRows.begin(), batchRows.end(), [&](int row) {
+            std::vector<Polyline>& bucket = rowPasses[static_cast<std::size_t>(row - batchBegin)];
+            bucket.clear();
+            generateRow(row, bucket);
+        });
+
+        if (cancelFlag.load(std::memory_order_relaxed))
+        {
+            return Toolpath{};
+        }
+
+        for (std::size_t i = 0; i < batchRows.size(); ++i)
+        {
+            toolpath.passes.insert(toolpath.passes.end(),
+                                   std::make_move_iterator(rowPasses[i].begin()),
+                                   std::make_move_iterator(rowPasses[i].end()));
+        }
 
         if (progressCallback)
         {
-            const int percent = std::clamp(static_cast<int>(((row + 1) * 100.0) / totalIterations), 0, 99);
+            const int percent = std::clamp(static_cast<int>((batchEnd * 100.0) / totalIterations), 0, 99);
             progressCallback(percent);
         }
     }
@@ -1458,6 +2869,7 @@ Toolpath ToolpathGenerator::generateRasterTopography(const render::Model& model,
 }
 
 Toolpath ToolpathGenerator::generateWaterlineSlicer(const render::Model& model,
+                                                    const waterline::ZSlicer& slicer,
                                                     const UserParams& params,
                                                     const PassProfile& profile,
                                                     const std::atomic<bool>& cancelFlag,
@@ -1489,8 +2901,6 @@ Toolpath ToolpathGenerator::generateWaterlineSlicer(const render::Model& model,
                                   ? params.toolDiameter * 0.5
                                   : 0.0;
 
-    tp::waterline::ZSlicer slicer(model, 1e-4);
-
     std::size_t loopCount = 0;
     int levelCount = 0;
     double elapsedMs = 0.0;
@@ -1536,45 +2946,69 @@ Toolpath ToolpathGenerator::generateWaterlineSlicer(const render::Model& model,
         int processedLevels = 0;
         const bool applyOffset = (params.cutterType == UserParams::CutterType::FlatEndmill);
 
+        std::vector<double> levels;
         for (double planeZ = maxZ; planeZ >= minZ - 1e-6; planeZ -= stepDown)
+        {
+            levels.push_back(planeZ);
+        }
+
+        // Each batch of levels is sliced in parallel with the slicer's scratch buffers reused from level to
+        // level; progress is reported and cancellation checked between batches on the calling thread.
+        const std::size_t batchSize = std::max<std::size_t>(16, 4 * std::thread::hardware_concurrency());
+        for (std::size_t batchBegin = 0; batchBegin < levels.size(); batchBegin += batchSize)
         {
             if (cancelFlag.load(std::memory_order_relaxed))
             {
                 return Toolpath{};
             }
 
-            const auto loops = slicer.slice(planeZ, toolRadius, applyOffset);
-            if (!loops.empty())
+            const std::size_t batchCount = std::min(batchSize, levels.size() - batchBegin);
+            const auto batchLoops = slicer.sliceLevels(std::span<const double>(levels).subspan(batchBegin, batchCount),
+                                                       toolRadius,
+                                                       applyOffset,
+                                                       waterline::ZSlicer::SliceMode::Parallel,
+                                                       &cancelFlag,
+                                                       params.waterlineArcTolerance_mm);
+            if (cancelFlag.load(std::memory_order_relaxed))
             {
-                ++levelCount;
-                for (const auto& loop : loops)
-                {
-                    if (loop.size() < 3)
-                    {
-                        continue;
-                    }
+                return Toolpath{};
+            }
 
-                    Polyline poly;
-                    poly.motion = MotionType::Cut;
-                    poly.strategyStep = static_cast<int>(profile.index);
-                    poly.pts.reserve(loop.size());
-                    for (const auto& pt : loop)
-                    {
-                        const double targetZ = std::min(static_cast<double>(pt.z) + allowance, topZ);
-                        poly.pts.push_back({glm::vec3(static_cast<float>(pt.x),
-                                                       static_cast<float>(pt.y),
-                                                       static_cast<float>(targetZ))});
-                    }
-                    if (params.cutDirection == UserParams::CutDirection::Conventional)
+            for (const auto& loops : batchLoops)
+            {
+                if (!loops.empty())
+                {
+                    ++levelCount;
+                    for (const auto& loop : loops)
                     {
-                        std::reverse(poly.pts.begin(), poly.pts.end());
+                        if (loop.size() < 3)
+                        {
+                            continue;
+                        }
+
+                        Polyline poly;
+                        poly.motion = MotionType::Cut;
+                        poly.strategyStep = static_cast<int>(profile.index);
+                        poly.pts.reserve(loop.size());
+                        for (const auto& pt : loop)
+                        {
+                            const double targetZ = std::min(static_cast<double>(pt.z) + allowance, topZ);
+                            poly.pts.push_back({glm::vec3(static_cast<float>(pt.x),
+                                                           static_cast<float>(pt.y),
+                                                           static_cast<float>(targetZ))});
+                        }
+                        if (params.cutDirection == UserParams::CutDirection::Conventional)
+                        {
+                            std::reverse(poly.pts.begin(), poly.pts.end());
+                        }
+                        toolpath.passes.push_back(std::move(poly));
+                        ++loopCount;
                     }
-                    toolpath.passes.push_back(std::move(poly));
-                    ++loopCount;
                 }
+
+                ++processedLevels;
             }
 
-            ++processedLevels;
             if (progressCallback)
             {
                 const int percent = std::clamp(static_cast<int>((processedLevels * 100.0) / totalLevels), 0, 99);
@@ -1717,49 +3151,58 @@ Toolpath ToolpathGenerator::generateFallbackRaster(const render::Model& model,
     return toolpath;
 }
 
-void ToolpathGenerator::applyLeaveStockAdjustment(Toolpath& toolpath,
-                                                  const render::Model& model,
-                                                  const UserParams& params) const
+double ToolpathGenerator::applyLeaveStockAdjustment(Toolpath& toolpath,
+                                                    const GougeChecker& checker,
+                                                    const UserParams& params,
+                                                    const std::vector<std::pair<std::size_t, std::size_t>>& ranges) const
 {
-    if (toolpath.passes.empty() || params.leaveStock_mm <= 1e-6)
+    double highestZ = -std::numeric_limits<double>::infinity();
+    if (toolpath.passes.empty() || ranges.empty() || params.leaveStock_mm <= 1e-6)
     {
-        return;
+        return highestZ;
     }
 
-    GougeChecker checker(model);
+    GougeChecker::QueryContext queryContext;
 
-    for (Polyline& poly : toolpath.passes)
+    for (const auto& range : ranges)
     {
-        if (poly.motion != MotionType::Cut || poly.pts.size() < 2)
+        const std::size_t end = std::min(range.second, toolpath.passes.size());
+        for (std::size_t polyIndex = range.first; polyIndex < end; ++polyIndex)
         {
-            continue;
-        }
-
-        for (Vertex& vertex : poly.pts)
-        {
-            GougeChecker::Vec3 sample = vertex.p;
-            sample.z = static_cast<float>(params.stock.topZ_mm + 1.0);
-            const auto surfaceZOpt = checker.surfaceHeightAt(sample);
-            if (!surfaceZOpt)
+            Polyline& poly = toolpath.passes[polyIndex];
+            if (poly.motion != MotionType::Cut || poly.pts.size() < 2)
             {
                 continue;
             }
 
-            double desiredZ = *surfaceZOpt + params.leaveStock_mm;
-            if (params.machine.safeZ_mm > 0.0)
+            for (Vertex& vertex : poly.pts)
             {
-                desiredZ = std::min(desiredZ, params.machine.safeZ_mm);
-            }
+                GougeChecker::Vec3 sample = vertex.p;
+                sample.z = static_cast<float>(params.stock.topZ_mm + 1.0);
+                const auto surfaceZOpt = checker.surfaceHeightAt(sample, queryContext);
+                if (!surfaceZOpt)
+                {
+                    continue;
+                }
 
-            const double currentZ = static_cast<double>(vertex.p.z);
-            if (desiredZ <= currentZ + 1e-6)
-            {
-                continue;
-            }
+                double desiredZ = *surfaceZOpt + params.leaveStock_mm;
+                highestZ = std::max(highestZ, desiredZ);
+                if (params.machine.safeZ_mm > 0.0)
+                {
+                    desiredZ = std::min(desiredZ, params.machine.safeZ_mm);
+                }
 
-            vertex.p.z = static_cast<float>(desiredZ);
+                const double currentZ = static_cast<double>(vertex.p.z);
+                if (desiredZ <= currentZ + 1e-6)
+                {
+                    continue;
+                }
+
+                vertex.p.z = static_cast<float>(desiredZ);
+            }
         }
     }
+    return highestZ;
 }
 
 } // namespace tp
@@ -4,8 +4,12 @@
 #include "ai/IPathAI.h"
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace render
@@ -16,6 +20,13 @@ class Model;
 namespace tp
 {
 
+class GougeChecker;
+
+namespace waterline
+{
+class ZSlicer;
+}
+
 struct UserParams
 {
     enum class CutterType
@@ -30,6 +41,16 @@ struct UserParams
         Conventional
     };
 
+    enum class Linking
+    {
+        // Every cut retracts to the safe plane before the next one.
+        SafePlane,
+        // Cuts are joined through the clearance plane wherever the model stays below it.
+        ClearancePlane,
+        // Neighbouring cuts are also joined at feed without leaving the material when the model allows it.
+        StayDown
+    };
+
     double toolDiameter{6.0};
     double stepOver{3.0};
     double maxDepthPerPass{1.0};
@@ -47,6 +68,40 @@ struct UserParams
     double leadInLength{0.0};
     double leadOutLength{0.0};
     bool useHeightField{true};
+    // Raster passes drop the full cutter footprint onto the height field (max-Z pyramid) instead of
+    // offsetting the surface under the tool centre; those passes skip the point-wise leave-stock fixup.
+    bool cutterAwareRaster{false};
+    // Raster passes sample an adaptive quadtree height field that only refines where the surface departs
+    // from a bilinear patch by more than the tolerance. Ignored with cutterAwareRaster, whose pyramid
+    // needs the dense lattice.
+    bool adaptiveHeightField{false};
+    double adaptiveHeightFieldTolerance_mm{0.01};
+    // When the height field is built lazily, a helper thread builds the tiles under upcoming raster rows.
+    bool prefetchHeightFieldTiles{true};
+    // Raster rows keep only the samples needed to stay within this distance above the sampled surface;
+    // flat and colinear spans collapse to their end points. The chord never dips below a sample, so
+    // thinning leaves at most this much extra stock. 0 keeps every lattice sample.
+    double rasterChordTolerance_mm{0.005};
+    // Flat-end waterline loops round their outside corners with arcs tessellated at most this far outside
+    // the true arcs, which leaves at most this much extra stock there. Never finer than the slicer's own
+    // tolerance.
+    double waterlineArcTolerance_mm{0.005};
+    // Up to this many passes of the plan are generated at the same time; 1 runs them one after another.
+    // Results are merged in plan order either way.
+    int concurrentPasses{2};
+    // Optional: each pass may take this many steps improving its nearest-neighbour order with 2-opt and
+    // Or-opt moves, each step trying the moves at one position of the order. The default 0 keeps the
+    // greedy order, which matches the order passes had before. A step count rather than a time keeps the
+    // order, and so the G-code, the same on fast and slow machines.
+    std::size_t passOrderingSteps{0};
+    // Optional wall-clock cap on the same stage; 0 sets none. A cap that runs out makes the order depend
+    // on how fast the machine is.
+    double passOrderingBudget_ms{0.0};
+    // Lets pass ordering cut open polylines end to start, which mixes climb and conventional cuts.
+    bool reverseOpenPolylines{false};
+    // How consecutive cuts of a pass are joined. Each link is checked against the model and falls back
+    // to the next more cautious way when the check fails; passes always start from the safe plane.
+    Linking linking{Linking::StayDown};
     CutterType cutterType{CutterType::FlatEndmill};
     CutDirection cutDirection{CutDirection::Climb};
     bool useStrategyOverride{false};
@@ -59,11 +114,78 @@ struct UserParams
     } post{};
 };
 
+// Counters of the process-wide height field cache, for diagnostics.
+struct HeightFieldCacheStats
+{
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::uint64_t builds{0};
+    std::uint64_t downsampled{0};
+    std::uint64_t diskHits{0};
+    std::uint64_t evictions{0};
+    // Entries dropped because their model was destroyed or its mesh replaced.
+    std::uint64_t invalidations{0};
+    std::size_t entries{0};
+    std::size_t bytes{0};
+    std::size_t capacityBytes{0};
+};
+
+// Counters of the process-wide cache of completed pass geometry, for diagnostics.
+struct PassGeometryCacheStats
+{
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+    std::size_t entries{0};
+    std::size_t bytes{0};
+    std::size_t capacityBytes{0};
+};
+
+// How the cuts of a generated toolpath were joined, and the machining time that saved compared with
+// retracting to the safe plane between every pair of cuts.
+struct LinkingStats
+{
+    std::size_t stayDown{0};
+    std::size_t clearancePlane{0};
+    std::size_t safePlane{0};
+    double timeSaved_s{0.0};
+};
+
+// One finished pass handed out by ToolpathGenerator::generateStreaming() while later passes are still
+// being generated.
+struct ToolpathChunk
+{
+    // Feed, spindle, machine, stock and strategy steps of the toolpath being built; passes stay empty.
+    const Toolpath* settings{nullptr};
+    // Linked motion of the pass (rapids, entries, cuts and exits) in final order. Appending the chunks in
+    // order reproduces the passes of the returned toolpath. Only valid during the callback.
+    std::span<const Polyline> polylines;
+    // Position of the pass in the plan; passes that produce no motion are skipped.
+    std::size_t passIndex{0};
+    std::size_t passCount{0};
+};
+
+using ToolpathSink = std::function<void(const ToolpathChunk&)>;
+
 class ToolpathGenerator
 {
 public:
     ToolpathGenerator() = default;
 
+    [[nodiscard]] static HeightFieldCacheStats heightFieldCacheStats();
+    // Passes whose cut geometry was reused because only feeds or linking parameters changed since.
+    [[nodiscard]] static PassGeometryCacheStats passGeometryCacheStats();
+    // Byte budget for cached pass geometry; 0 turns the cache off.
+    static void setPassGeometryCacheCapacity(std::size_t bytes);
+    // Byte budget for cached height fields and their pyramids; shrinking it evicts immediately.
+    static void setHeightFieldCacheCapacity(std::size_t bytes);
+    // Z step for storing newly built height fields as int16/int32 codes; 0 keeps doubles.
+    static void setHeightFieldQuantum(double quantumMm);
+    // Store newly built height fields in 64x64 tiles instead of rows; pays off for rotated rasters.
+    static void setHeightFieldTiling(bool tiled);
+    // Build new height fields tile by tile as raster passes first touch them instead of up front. Lazy
+    // fields are always tiled and are neither quantized nor written to the disk cache.
+    static void setHeightFieldLazyBuild(bool lazy);
+
     Toolpath generate(const render::Model& model,
                       const UserParams& params,
                       ai::IPathAI& ai,
@@ -72,6 +194,18 @@ public:
                       ai::StrategyDecision* outDecision = nullptr,
                       std::string* bannerMessage = nullptr) const;
 
+    // Same result as generate(), but each pass is reordered, linked and passed to the sink on the calling
+    // thread as soon as it is complete, so consumers can start on it while later passes are computed. A
+    // cancelled run returns an empty toolpath; chunks already delivered must then be discarded.
+    Toolpath generateStreaming(const render::Model& model,
+                               const UserParams& params,
+                               ai::IPathAI& ai,
+                               const std::atomic<bool>& cancelFlag,
+                               const ToolpathSink& sink,
+                               const std::function<void(int)>& progressCallback = {},
+                               ai::StrategyDecision* outDecision = nullptr,
+                               std::string* bannerMessage = nullptr) const;
+
 private:
     struct PassProfile
     {
@@ -100,6 +234,7 @@ private:
                                       std::string* logMessage) const;
 
     Toolpath generateWaterlineSlicer(const render::Model& model,
+                                     const waterline::ZSlicer& slicer,
                                      const UserParams& params,
                                      const PassProfile& profile,
                                      const std::atomic<bool>& cancelFlag,
@@ -111,7 +246,11 @@ private:
                                     const PassProfile& profile,
                                     const std::atomic<bool>& cancelFlag,
                                     const std::function<void(int)>& progressCallback) const;
-    void applyLeaveStockAdjustment(Toolpath& toolpath, const render::Model& model, const UserParams& params) const;
+    // Returns the highest Z the fixup asked for before capping it at the safe plane.
+    double applyLeaveStockAdjustment(Toolpath& toolpath,
+                                     const GougeChecker& checker,
+                                     const UserParams& params,
+                                     const std::vector<std::pair<std::size_t, std::size_t>>& ranges) const;
 };
 
 } // namespace tp
@@ -17,36 +17,93 @@ inline double lengthSquared(const glm::dvec3& v)
     return glm::dot(v, v);
 }
 
+// Narrowing rounds to nearest; cull bounds must round outward so float storage never rejects a
+// sample that the double data would accept. Both are the identity when Real is double.
+tp::TriangleGrid::Real roundDown(double value)
+{
+    using Real = tp::TriangleGrid::Real;
+    Real narrowed = static_cast<Real>(value);
+    if (static_cast<double>(narrowed) > value)
+    {
+        narrowed = std::nextafter(narrowed, -std::numeric_limits<Real>::infinity());
+    }
+    return narrowed;
+}
+
+tp::TriangleGrid::Real roundUp(double value)
+{
+    using Real = tp::TriangleGrid::Real;
+    Real narrowed = static_cast<Real>(value);
+    if (static_cast<double>(narrowed) < value)
+    {
+        narrowed = std::nextafter(narrowed, std::numeric_limits<Real>::infinity());
+    }
+    return narrowed;
+}
+
 } // namespace
 
 namespace tp
 {
 
-double TriangleGrid::Triangle::planeHeightAt(double x, double y) const
+bool TriangleGrid::cullContainsXY(std::uint32_t index, double x, double y, double eps) const
 {
-    if (!validNormalZ)
+    const CullRecord& cull = m_cull[index];
+
+    const double dx = x - static_cast<double>(cull.centroidX);
+    const double dy = y - static_cast<double>(cull.centroidY);
+    if ((dx * dx + dy * dy) > static_cast<double>(cull.boundingRadiusSq) + eps)
     {
-        return std::numeric_limits<double>::quiet_NaN();
+        return false;
     }
-    return (-planeD - normal.x * x - normal.y * y) * invNormalZ;
+
+    return x >= static_cast<double>(cull.minX) - eps && x <= static_cast<double>(cull.maxX) + eps
+           && y >= static_cast<double>(cull.minY) - eps && y <= static_cast<double>(cull.maxY) + eps;
 }
 
-bool TriangleGrid::Triangle::barycentricContains(const glm::dvec3& point, double eps) const
+bool TriangleGrid::surfaceHeightAt(std::uint32_t index,
+                                   double x,
+                                   double y,
+                                   double eps,
+                                   double barycentricEps,
+                                   double& zOut) const
 {
-    if (!validBarycentric)
+    const SurfaceRecord& surf = m_surface[index];
+    if (!surf.valid)
+    {
+        return false;
+    }
+
+    // Barycentric coordinates are preserved by the projection onto XY, so the 2D test is exact for
+    // points on the plane.
+    const double px = x - static_cast<double>(surf.originX);
+    const double py = y - static_cast<double>(surf.originY);
+    const double z = static_cast<double>(surf.slopeX) * px + static_cast<double>(surf.slopeY) * py
+                     + static_cast<double>(surf.originZ);
+    if (!std::isfinite(z))
     {
         return false;
     }
 
-    const glm::dvec3 v2 = point - v0;
-    const double d20 = glm::dot(v2, edge0);
-    const double d21 = glm::dot(v2, edge1);
+    const CullRecord& cull = m_cull[index];
+    if (z < static_cast<double>(cull.minZ) - eps || z > static_cast<double>(cull.maxZ) + eps)
+    {
+        return false;
+    }
 
-    const double v = (dot11 * d20 - dot01 * d21) * invDet;
-    const double w = (dot00 * d21 - dot01 * d20) * invDet;
+    const double invDet = static_cast<double>(surf.invDet);
+    const double v = (px * static_cast<double>(surf.edge1Y) - py * static_cast<double>(surf.edge1X)) * invDet;
+    const double w = (py * static_cast<double>(surf.edge0X) - px * static_cast<double>(surf.edge0Y)) * invDet;
     const double u = 1.0 - v - w;
 
-    return u >= -eps && v >= -eps && w >= -eps && u <= 1.0 + eps && v <= 1.0 + eps && w <= 1.0 + eps;
+    if (u < -barycentricEps || v < -barycentricEps || w < -barycentricEps || u > 1.0 + barycentricEps
+        || v > 1.0 + barycentricEps || w > 1.0 + barycentricEps)
+    {
+        return false;
+    }
+
+    zOut = z;
+    return true;
 }
 
 TriangleGrid::TriangleGrid(const render::Model& model, double targetCellSizeMm)
@@ -56,11 +113,11 @@ TriangleGrid::TriangleGrid(const render::Model& model, double targetCellSizeMm)
 
 void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
 {
-    m_triangles.clear();
+    m_cull.clear();
+    m_surface.clear();
+    m_corners.clear();
     m_cellRanges.clear();
     m_cellIndices.clear();
-    m_visitMarks.clear();
-    m_visitStamp = 1;
 
     const auto& vertices = model.vertices();
     const auto& indices = model.indices();
@@ -82,7 +139,9 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
     m_boundsMax = glm::dvec2(bounds.max.x(), bounds.max.y());
 
     const std::size_t triangleCount = indices.size() / 3;
-    m_triangles.reserve(triangleCount);
+    m_cull.reserve(triangleCount);
+    m_surface.reserve(triangleCount);
+    m_corners.reserve(triangleCount);
 
     for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
     {
@@ -94,54 +153,96 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
             continue;
         }
 
-        Triangle tri;
-        tri.v0 = glm::dvec3(vertices[ia].position.x(), vertices[ia].position.y(), vertices[ia].position.z());
-        tri.v1 = glm::dvec3(vertices[ib].position.x(), vertices[ib].position.y(), vertices[ib].position.z());
-        tri.v2 = glm::dvec3(vertices[ic].position.x(), vertices[ic].position.y(), vertices[ic].position.z());
+        // Derived data is computed in double and only narrowed when stored.
+        const glm::dvec3 v0(vertices[ia].position.x(), vertices[ia].position.y(), vertices[ia].position.z());
+        const glm::dvec3 v1(vertices[ib].position.x(), vertices[ib].position.y(), vertices[ib].position.z());
+        const glm::dvec3 v2(vertices[ic].position.x(), vertices[ic].position.y(), vertices[ic].position.z());
 
-        tri.edge0 = tri.v1 - tri.v0;
-        tri.edge1 = tri.v2 - tri.v0;
-        tri.normal = glm::cross(tri.edge0, tri.edge1);
+        const glm::dvec3 edge0 = v1 - v0;
+        const glm::dvec3 edge1 = v2 - v0;
+        glm::dvec3 normal = glm::cross(edge0, edge1);
 
-        const double normalLengthSq = lengthSquared(tri.normal);
+        const double normalLengthSq = lengthSquared(normal);
         if (normalLengthSq <= kEpsilon)
         {
             continue;
         }
-        tri.normal /= std::sqrt(normalLengthSq);
-
-        tri.centroid = (tri.v0 + tri.v1 + tri.v2) / 3.0;
-        tri.bboxMin = glm::min(glm::min(tri.v0, tri.v1), tri.v2);
-        tri.bboxMax = glm::max(glm::max(tri.v0, tri.v1), tri.v2);
-        tri.maxZ = std::max({tri.v0.z, tri.v1.z, tri.v2.z});
-        tri.minZ = std::min({tri.v0.z, tri.v1.z, tri.v2.z});
-
-        const double r0 = lengthSquared(tri.v0 - tri.centroid);
-        const double r1 = lengthSquared(tri.v1 - tri.centroid);
-        const double r2 = lengthSquared(tri.v2 - tri.centroid);
-        tri.boundingRadiusSq = std::max({r0, r1, r2});
-
-        tri.dot00 = glm::dot(tri.edge0, tri.edge0);
-        tri.dot01 = glm::dot(tri.edge0, tri.edge1);
-        tri.dot11 = glm::dot(tri.edge1, tri.edge1);
-        const double denom = tri.dot00 * tri.dot11 - tri.dot01 * tri.dot01;
-        if (std::abs(denom) > kEpsilon)
+        normal /= std::sqrt(normalLengthSq);
+
+        const glm::dvec3 bboxMin = glm::min(glm::min(v0, v1), v2);
+        const glm::dvec3 bboxMax = glm::max(glm::max(v0, v1), v2);
+
+        CullRecord cull;
+        cull.centroidX = static_cast<Real>((v0.x + v1.x + v2.x) / 3.0);
+        cull.centroidY = static_cast<Real>((v0.y + v1.y + v2.y) / 3.0);
+        // Measured from the stored centroid so the circle still encloses the triangle after narrowing.
+        const glm::dvec3 centroid((v0 + v1 + v2) / 3.0);
+        const glm::dvec3 storedCentroid(static_cast<double>(cull.centroidX),
+                                        static_cast<double>(cull.centroidY),
+                                        centroid.z);
+        const double r0 = lengthSquared(v0 - storedCentroid);
+        const double r1 = lengthSquared(v1 - storedCentroid);
+        const double r2 = lengthSquared(v2 - storedCentroid);
+        cull.boundingRadiusSq = roundUp(std::max({r0, r1, r2}));
+        cull.minX = roundDown(bboxMin.x);
+        cull.minY = roundDown(bboxMin.y);
+        cull.maxX = roundUp(bboxMax.x);
+        cull.maxY = roundUp(bboxMax.y);
+
+        double minZ = bboxMin.z;
+        double maxZ = bboxMax.z;
+
+        SurfaceRecord surf;
+        const double dot00 = glm::dot(edge0, edge0);
+        const double dot01 = glm::dot(edge0, edge1);
+        const double dot11 = glm::dot(edge1, edge1);
+        const double denom = dot00 * dot11 - dot01 * dot01;
+        const double denom2D = edge0.x * edge1.y - edge0.y * edge1.x;
+        if (std::abs(denom) > kEpsilon && std::abs(normal.z) > kEpsilon && std::abs(denom2D) > 0.0)
         {
-            tri.invDet = 1.0 / denom;
-            tri.validBarycentric = true;
-        }
-
-        tri.planeD = -glm::dot(tri.normal, tri.v0);
-        if (std::abs(tri.normal.z) > kEpsilon)
-        {
-            tri.invNormalZ = 1.0 / tri.normal.z;
-            tri.validNormalZ = true;
+            surf.slopeX = static_cast<Real>(-normal.x / normal.z);
+            surf.slopeY = static_cast<Real>(-normal.y / normal.z);
+            surf.originX = static_cast<Real>(v0.x);
+            surf.originY = static_cast<Real>(v0.y);
+            surf.originZ = static_cast<Real>(v0.z);
+            surf.edge0X = static_cast<Real>(edge0.x);
+            surf.edge0Y = static_cast<Real>(edge0.y);
+            surf.edge1X = static_cast<Real>(edge1.x);
+            surf.edge1Y = static_cast<Real>(edge1.y);
+            surf.invDet = static_cast<Real>(1.0 / denom2D);
+            surf.valid = true;
+
+            if constexpr (sizeof(Real) < sizeof(double))
+            {
+                // The narrowed plane differs from the true one by a linear function, so its largest
+                // deviation over the triangle is at a corner. Widen the Z range by that much.
+                const auto storedPlaneAt = [&surf](const glm::dvec3& v) {
+                    return static_cast<double>(surf.slopeX) * (v.x - static_cast<double>(surf.originX))
+                           + static_cast<double>(surf.slopeY) * (v.y - static_cast<double>(surf.originY))
+                           + static_cast<double>(surf.originZ);
+                };
+                const double deviation = std::max({std::abs(storedPlaneAt(v0) - v0.z),
+                                                   std::abs(storedPlaneAt(v1) - v1.z),
+                                                   std::abs(storedPlaneAt(v2) - v2.z)});
+                minZ -= deviation;
+                maxZ += deviation;
+            }
         }
-
-        m_triangles.push_back(tri);
+        cull.minZ = roundDown(minZ);
+        cull.maxZ = roundUp(maxZ);
+
+        Corners corners;
+        corners.v0 = RealVec3(v0);
+        corners.v1 = RealVec3(v1);
+        corners.v2 = RealVec3(v2);
+        corners.normalZ = static_cast<Real>(normal.z);
+
+        m_cull.push_back(cull);
+        m_surface.push_back(surf);
+        m_corners.push_back(corners);
     }
 
-    if (m_triangles.empty())
+    if (m_cull.empty())
     {
         m_cellsX = 1;
         m_cellsY = 1;
@@ -162,7 +263,7 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
     }
     else
     {
-        const double approx = std::sqrt(static_cast<double>(m_triangles.size()));
+        const double approx = std::sqrt(static_cast<double>(m_cull.size()));
         int base = std::max(1, static_cast<int>(std::round(approx)));
         const double aspect = spanY > kEpsilon ? spanX / spanY : 1.0;
         if (aspect >= 1.0)
@@ -207,9 +308,9 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
         return clampIndex(static_cast<int>(std::floor(rel)), cells);
     };
 
-    for (std::uint32_t triIndex = 0; triIndex < static_cast<std::uint32_t>(m_triangles.size()); ++triIndex)
+    for (std::uint32_t triIndex = 0; triIndex < static_cast<std::uint32_t>(m_cull.size()); ++triIndex)
     {
-        const Triangle& tri = m_triangles[triIndex];
+        const CullRecord& tri = m_cull[triIndex];
 
         int ixMin = 0;
         int ixMax = m_cellsX - 1;
@@ -218,16 +319,16 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
 
         if (m_invCellSizeX > 0.0 && m_cellsX > 1)
         {
-            const double minXRel = (tri.bboxMin.x - m_boundsMin.x) * m_invCellSizeX;
-            const double maxXRel = (tri.bboxMax.x - m_boundsMin.x) * m_invCellSizeX;
+            const double minXRel = (static_cast<double>(tri.minX) - m_boundsMin.x) * m_invCellSizeX;
+            const double maxXRel = (static_cast<double>(tri.maxX) - m_boundsMin.x) * m_invCellSizeX;
             ixMin = clampIndex(static_cast<int>(std::floor(minXRel)), m_cellsX);
             ixMax = clampIndex(static_cast<int>(std::floor(maxXRel + kEpsilon)), m_cellsX);
         }
 
         if (m_invCellSizeY > 0.0 && m_cellsY > 1)
         {
-            const double minYRel = (tri.bboxMin.y - m_boundsMin.y) * m_invCellSizeY;
-            const double maxYRel = (tri.bboxMax.y - m_boundsMin.y) * m_invCellSizeY;
+            const double minYRel = (static_cast<double>(tri.minY) - m_boundsMin.y) * m_invCellSizeY;
+            const double maxYRel = (static_cast<double>(tri.maxY) - m_boundsMin.y) * m_invCellSizeY;
             iyMin = clampIndex(static_cast<int>(std::floor(minYRel)), m_cellsY);
             iyMax = clampIndex(static_cast<int>(std::floor(maxYRel + kEpsilon)), m_cellsY);
         }
@@ -252,9 +353,9 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
 
     std::vector<std::uint32_t> writeCursor = offsets;
 
-    for (std::uint32_t triIndex = 0; triIndex < static_cast<std::uint32_t>(m_triangles.size()); ++triIndex)
+    for (std::uint32_t triIndex = 0; triIndex < static_cast<std::uint32_t>(m_cull.size()); ++triIndex)
     {
-        const Triangle& tri = m_triangles[triIndex];
+        const CullRecord& tri = m_cull[triIndex];
 
         int ixMin = 0;
         int ixMax = m_cellsX - 1;
@@ -263,16 +364,16 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
 
         if (m_invCellSizeX > 0.0 && m_cellsX > 1)
         {
-            const double minXRel = (tri.bboxMin.x - m_boundsMin.x) * m_invCellSizeX;
-            const double maxXRel = (tri.bboxMax.x - m_boundsMin.x) * m_invCellSizeX;
+            const double minXRel = (static_cast<double>(tri.minX) - m_boundsMin.x) * m_invCellSizeX;
+            const double maxXRel = (static_cast<double>(tri.maxX) - m_boundsMin.x) * m_invCellSizeX;
             ixMin = clampIndex(static_cast<int>(std::floor(minXRel)), m_cellsX);
             ixMax = clampIndex(static_cast<int>(std::floor(maxXRel + kEpsilon)), m_cellsX);
         }
 
         if (m_invCellSizeY > 0.0 && m_cellsY > 1)
         {
-            const double minYRel = (tri.bboxMin.y - m_boundsMin.y) * m_invCellSizeY;
-            const double maxYRel = (tri.bboxMax.y - m_boundsMin.y) * m_invCellSizeY;
+            const double minYRel = (static_cast<double>(tri.minY) - m_boundsMin.y) * m_invCellSizeY;
+            const double maxYRel = (static_cast<double>(tri.maxY) - m_boundsMin.y) * m_invCellSizeY;
             iyMin = clampIndex(static_cast<int>(std::floor(minYRel)), m_cellsY);
             iyMax = clampIndex(static_cast<int>(std::floor(maxYRel + kEpsilon)), m_cellsY);
         }
@@ -298,8 +399,8 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
         auto begin = m_cellIndices.begin() + offset;
         auto end = begin + count;
         std::sort(begin, end, [this](std::uint32_t lhs, std::uint32_t rhs) {
-            const double lhsMax = m_triangles[lhs].maxZ;
-            const double rhsMax = m_triangles[rhs].maxZ;
+            const double lhsMax = static_cast<double>(m_cull[lhs].maxZ);
+            const double rhsMax = static_cast<double>(m_cull[rhs].maxZ);
             if (std::abs(lhsMax - rhsMax) < kEpsilon)
             {
                 return lhs < rhs;
@@ -307,8 +408,6 @@ void TriangleGrid::build(const render::Model& model, double targetCellSizeMm)
             return lhsMax > rhsMax;
         });
     }
-
-    m_visitMarks.resize(m_triangles.size(), 0);
 }
 
 int TriangleGrid::clampIndex(int value, int maxExclusive)
@@ -328,24 +427,40 @@ int TriangleGrid::clampIndex(int value, int maxExclusive)
     return value;
 }
 
+TriangleGrid::QueryContext& TriangleGrid::threadContext()
+{
+    // Visit stamps only have to be unique within one query, so a single per-thread context can be
+    // shared by every grid the thread touches.
+    thread_local QueryContext context;
+    return context;
+}
+
 void TriangleGrid::gatherCellRange(int ixMin,
                                    int iyMin,
                                    int ixMax,
                                    int iyMax,
-                                   std::vector<std::uint32_t>& out) const
+                                   std::vector<std::uint32_t>& out,
+                                   QueryContext& context) const
 {
-    if (m_triangles.empty())
+    if (m_cull.empty())
     {
         out.clear();
         return;
     }
 
-    ++m_visitStamp;
-    if (m_visitStamp == 0)
+    if (context.visitMarks.size() < m_cull.size())
+    {
+        context.visitMarks.resize(m_cull.size(), 0);
+    }
+
+    ++context.visitStamp;
+    if (context.visitStamp == 0)
     {
-        std::fill(m_visitMarks.begin(), m_visitMarks.end(), 0);
-        m_visitStamp = 1;
+        std::fill(context.visitMarks.begin(), context.visitMarks.end(), 0);
+        context.visitStamp = 1;
     }
+    const std::uint32_t stamp = context.visitStamp;
+    std::uint32_t* marks = context.visitMarks.data();
 
     out.clear();
 
@@ -366,15 +481,15 @@ void TriangleGrid::gatherCellRange(int ixMin,
             for (const std::uint32_t* it = begin; it != end; ++it)
             {
                 const std::uint32_t idx = *it;
-                if (idx >= m_triangles.size())
+                if (idx >= m_cull.size())
                 {
                     continue;
                 }
-                if (m_visitMarks[idx] == m_visitStamp)
+                if (marks[idx] == stamp)
                 {
                     continue;
                 }
-                m_visitMarks[idx] = m_visitStamp;
+                marks[idx] = stamp;
                 out.push_back(idx);
             }
         }
@@ -382,14 +497,46 @@ void TriangleGrid::gatherCellRange(int ixMin,
 
     if (out.empty())
     {
-        out.resize(m_triangles.size());
+        out.resize(m_cull.size());
         std::iota(out.begin(), out.end(), 0u);
     }
 }
 
+void TriangleGrid::gatherCandidatesXY(double x, double y, int radius, QueryContext& context) const
+{
+    gatherXY(x, y, radius, context.candidates, context);
+}
+
+void TriangleGrid::gatherCandidatesAABB(double minX,
+                                        double minY,
+                                        double maxX,
+                                        double maxY,
+                                        QueryContext& context) const
+{
+    gatherAABB(minX, minY, maxX, maxY, context.candidates, context);
+}
+
 void TriangleGrid::gatherCandidatesXY(double x, double y, int radius, std::vector<std::uint32_t>& out) const
 {
-    if (m_triangles.empty())
+    gatherXY(x, y, radius, out, threadContext());
+}
+
+void TriangleGrid::gatherCandidatesAABB(double minX,
+                                        double minY,
+                                        double maxX,
+                                        double maxY,
+                                        std::vector<std::uint32_t>& out) const
+{
+    gatherAABB(minX, minY, maxX, maxY, out, threadContext());
+}
+
+void TriangleGrid::gatherXY(double x,
+                            double y,
+                            int radius,
+                            std::vector<std::uint32_t>& out,
+                            QueryContext& context) const
+{
+    if (m_cull.empty())
     {
         out.clear();
         return;
@@ -397,7 +544,7 @@ void TriangleGrid::gatherCandidatesXY(double x, double y, int radius, std::vecto
 
     if (m_cellsX <= 1 || m_cellsY <= 1 || m_invCellSizeX <= 0.0 || m_invCellSizeY <= 0.0)
     {
-        out.resize(m_triangles.size());
+        out.resize(m_cull.size());
         std::iota(out.begin(), out.end(), 0u);
         return;
     }
@@ -409,16 +556,17 @@ void TriangleGrid::gatherCandidatesXY(double x, double y, int radius, std::vecto
     int iy = clampIndex(static_cast<int>(std::floor(relY)), m_cellsY);
 
     radius = std::max(0, radius);
-    gatherCellRange(ix - radius, iy - radius, ix + radius, iy + radius, out);
+    gatherCellRange(ix - radius, iy - radius, ix + radius, iy + radius, out, context);
 }
 
-void TriangleGrid::gatherCandidatesAABB(double minX,
-                                        double minY,
-                                        double maxX,
-                                        double maxY,
-                                        std::vector<std::uint32_t>& out) const
+void TriangleGrid::gatherAABB(double minX,
+                              double minY,
+                              double maxX,
+                              double maxY,
+                              std::vector<std::uint32_t>& out,
+                              QueryContext& context) const
 {
-    if (m_triangles.empty())
+    if (m_cull.empty())
     {
         out.clear();
         return;
@@ -426,7 +574,7 @@ void TriangleGrid::gatherCandidatesAABB(double minX,
 
     if (m_cellsX <= 1 || m_cellsY <= 1 || m_invCellSizeX <= 0.0 || m_invCellSizeY <= 0.0)
     {
-        out.resize(m_triangles.size());
+        out.resize(m_cull.size());
         std::iota(out.begin(), out.end(), 0u);
         return;
     }
@@ -441,8 +589,7 @@ void TriangleGrid::gatherCandidatesAABB(double minX,
     const int iyMin = clampIndex(static_cast<int>(std::floor(minRelY)), m_cellsY);
     const int iyMax = clampIndex(static_cast<int>(std::floor(maxRelY + kEpsilon)), m_cellsY);
 
-    gatherCellRange(ixMin, iyMin, ixMax, iyMax, out);
+    gatherCellRange(ixMin, iyMin, ixMax, iyMax, out, context);
 }
 
 } // namespace tp
-
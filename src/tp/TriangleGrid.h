@@ -14,31 +14,63 @@ namespace tp
 class TriangleGrid
 {
 public:
-    struct Triangle
+#if TP_TRIANGLE_GRID_FLOAT32
+    using Real = float;
+    using RealVec3 = glm::vec3;
+#else
+    using Real = double;
+    using RealVec3 = glm::dvec3;
+#endif
+
+    // Hot culling fields, read for every candidate. Kept apart from the surface data so rejected
+    // candidates only touch one small record.
+    struct CullRecord
     {
-        glm::dvec3 v0{0.0};
-        glm::dvec3 v1{0.0};
-        glm::dvec3 v2{0.0};
-        glm::dvec3 normal{0.0};
-        glm::dvec3 bboxMin{0.0};
-        glm::dvec3 bboxMax{0.0};
-        glm::dvec3 centroid{0.0};
-        glm::dvec3 edge0{0.0};
-        glm::dvec3 edge1{0.0};
-        double dot00{0.0};
-        double dot01{0.0};
-        double dot11{0.0};
-        double invDet{0.0};
-        double planeD{0.0};
-        double maxZ{0.0};
-        double minZ{0.0};
-        double boundingRadiusSq{0.0};
-        double invNormalZ{0.0};
-        bool validBarycentric{false};
-        bool validNormalZ{false};
-
-        [[nodiscard]] double planeHeightAt(double x, double y) const;
-        [[nodiscard]] bool barycentricContains(const glm::dvec3& point, double eps) const;
+        Real minX{0};
+        Real minY{0};
+        Real maxX{0};
+        Real maxY{0};
+        Real minZ{0};
+        Real maxZ{0};
+        Real centroidX{0};
+        Real centroidY{0};
+        Real boundingRadiusSq{0};
+    };
+
+    // Plane and barycentric fields, read only for candidates that survive culling. The plane is stored
+    // relative to the first corner, z = originZ + slopeX * (x - originX) + slopeY * (y - originY), and
+    // containment is tested in the XY projection.
+    struct SurfaceRecord
+    {
+        Real slopeX{0};
+        Real slopeY{0};
+        Real originX{0};
+        Real originY{0};
+        Real originZ{0};
+        Real edge0X{0};
+        Real edge0Y{0};
+        Real edge1X{0};
+        Real edge1Y{0};
+        Real invDet{0};
+        bool valid{false};
+    };
+
+    // Full corner positions for distance queries (GougeChecker); cold relative to the records above.
+    struct Corners
+    {
+        RealVec3 v0{0};
+        RealVec3 v1{0};
+        RealVec3 v2{0};
+        Real normalZ{0};
+    };
+
+    // Caller-owned scratch for candidate queries. The grid itself is never mutated by a query, so
+    // concurrent callers only need one context each.
+    struct QueryContext
+    {
+        std::vector<std::uint32_t> candidates;
+        std::vector<std::uint32_t> visitMarks;
+        std::uint32_t visitStamp{0};
     };
 
     TriangleGrid() = default;
@@ -46,9 +78,26 @@ public:
 
     void build(const render::Model& model, double targetCellSizeMm);
 
-    [[nodiscard]] bool empty() const noexcept { return m_triangles.empty(); }
-    [[nodiscard]] std::size_t triangleCount() const noexcept { return m_triangles.size(); }
-    [[nodiscard]] const Triangle& triangle(std::uint32_t index) const { return m_triangles[index]; }
+    [[nodiscard]] bool empty() const noexcept { return m_cull.empty(); }
+    [[nodiscard]] std::size_t triangleCount() const noexcept { return m_cull.size(); }
+    [[nodiscard]] const CullRecord& cull(std::uint32_t index) const { return m_cull[index]; }
+    [[nodiscard]] const SurfaceRecord& surface(std::uint32_t index) const { return m_surface[index]; }
+    [[nodiscard]] const Corners& corners(std::uint32_t index) const { return m_corners[index]; }
+    [[nodiscard]] double maxZ(std::uint32_t index) const { return static_cast<double>(m_cull[index].maxZ); }
+    [[nodiscard]] std::size_t triangleBytes() const noexcept
+    {
+        return m_cull.size() * (sizeof(CullRecord) + sizeof(SurfaceRecord) + sizeof(Corners));
+    }
+
+    // Bounding-circle and XY bounding-box rejection.
+    [[nodiscard]] bool cullContainsXY(std::uint32_t index, double x, double y, double eps) const;
+    // Plane height at (x, y) if the point lies inside the triangle's XY projection and Z range.
+    [[nodiscard]] bool surfaceHeightAt(std::uint32_t index,
+                                       double x,
+                                       double y,
+                                       double eps,
+                                       double barycentricEps,
+                                       double& zOut) const;
 
     [[nodiscard]] const glm::dvec2& boundsMin() const noexcept { return m_boundsMin; }
     [[nodiscard]] const glm::dvec2& boundsMax() const noexcept { return m_boundsMax; }
@@ -57,6 +106,11 @@ public:
     [[nodiscard]] std::size_t cellCount() const noexcept { return m_cellRanges.size(); }
     [[nodiscard]] std::size_t cellIndexCount() const noexcept { return m_cellIndices.size(); }
 
+    // Results are written to context.candidates.
+    void gatherCandidatesXY(double x, double y, int radius, QueryContext& context) const;
+    void gatherCandidatesAABB(double minX, double minY, double maxX, double maxY, QueryContext& context) const;
+
+    // Convenience overloads backed by a thread-local QueryContext.
     void gatherCandidatesXY(double x, double y, int radius, std::vector<std::uint32_t>& out) const;
     void gatherCandidatesAABB(double minX,
                               double minY,
@@ -71,10 +125,25 @@ private:
         std::uint32_t count{0};
     };
 
-    void gatherCellRange(int ixMin, int iyMin, int ixMax, int iyMax, std::vector<std::uint32_t>& out) const;
+    void gatherXY(double x, double y, int radius, std::vector<std::uint32_t>& out, QueryContext& context) const;
+    void gatherAABB(double minX,
+                    double minY,
+                    double maxX,
+                    double maxY,
+                    std::vector<std::uint32_t>& out,
+                    QueryContext& context) const;
+    void gatherCellRange(int ixMin,
+                         int iyMin,
+                         int ixMax,
+                         int iyMax,
+                         std::vector<std::uint32_t>& out,
+                         QueryContext& context) const;
     [[nodiscard]] static int clampIndex(int value, int maxExclusive);
+    [[nodiscard]] static QueryContext& threadContext();
 
-    std::vector<Triangle> m_triangles;
+    std::vector<CullRecord> m_cull;
+    std::vector<SurfaceRecord> m_surface;
+    std::vector<Corners> m_corners;
     glm::dvec2 m_boundsMin{0.0};
     glm::dvec2 m_boundsMax{0.0};
     int m_cellsX{1};
@@ -85,9 +154,6 @@ private:
     double m_invCellSizeY{0.0};
     std::vector<CellRange> m_cellRanges;
     std::vector<std::uint32_t> m_cellIndices;
-
-    mutable std::vector<std::uint32_t> m_visitMarks;
-    mutable std::uint32_t m_visitStamp{1};
 };
 
 } // namespace tp
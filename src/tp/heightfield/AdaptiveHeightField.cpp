@@ -0,0 +1,418 @@
+#include "tp/heightfield/AdaptiveHeightField.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <numeric>
+
+#include "common/log.h"
+
+#include <QtCore/QString>
+
+namespace tp::heightfield
+{
+
+namespace
+{
+
+constexpr double kNan = std::numeric_limits<double>::quiet_NaN();
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kEpsilon = 1e-9;
+
+// Largest leaf edge. Bigger blocks save little once a flat region is a single leaf, and keep each
+// block's scratch lattice small enough to stay in cache.
+constexpr double kMaxBlockMm = 12.8;
+constexpr std::size_t kMaxBlockLevels = 7;
+
+// Same lattice as HeightField: include the far edge of the bounds.
+std::size_t latticeSize(double extent, double resolution)
+{
+    return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(extent / resolution - kEpsilon)) + 1);
+}
+
+double bilinear(const std::array<double, 4>& z, double u, double v)
+{
+    const double z0 = z[0] * (1.0 - u) + z[1] * u;
+    const double z1 = z[2] * (1.0 - u) + z[3] * u;
+    return z0 * (1.0 - v) + z1 * v;
+}
+
+} // namespace
+
+// Builds one block's quadtree. Samples are evaluated on demand and remembered on a scratch lattice
+// covering the block, so parents and children share their common lattice points.
+class AdaptiveHeightField::BlockBuilder
+{
+public:
+    BlockBuilder(const AdaptiveHeightField& field,
+                 const UniformGrid& grid,
+                 UniformGrid::QueryContext& context,
+                 std::size_t blockCol,
+                 std::size_t blockRow)
+        : m_field(field)
+        , m_grid(grid)
+        , m_context(context)
+        , m_size(std::size_t{1} << field.m_blockLevels)
+        , m_col0(blockCol << field.m_blockLevels)
+        , m_row0(blockRow << field.m_blockLevels)
+        , m_samples((m_size + 1) * (m_size + 1), kNan)
+        , m_evaluated((m_size + 1) * (m_size + 1), 0)
+    {
+    }
+
+    Block build()
+    {
+        m_block.nodes.emplace_back();
+        subdivide(0, m_col0, m_row0, m_size);
+        return std::move(m_block);
+    }
+
+    [[nodiscard]] std::size_t evaluatedSamples() const noexcept { return m_evaluatedCount; }
+
+private:
+    double sample(std::size_t col, std::size_t row)
+    {
+        const std::size_t index = (row - m_row0) * (m_size + 1) + (col - m_col0);
+        if (!m_evaluated[index])
+        {
+            m_evaluated[index] = 1;
+            ++m_evaluatedCount;
+            const double x = m_field.m_minX + static_cast<double>(col) * m_field.m_resolution;
+            const double y = m_field.m_minY + static_cast<double>(row) * m_field.m_resolution;
+            double z = 0.0;
+            if (m_grid.sampleMaxZAtXY(x, y, z, m_context))
+            {
+                m_samples[index] = z;
+            }
+        }
+        return m_samples[index];
+    }
+
+    // True if a triangle overlapping the node can rise more than the tolerance above the node's bilinear
+    // patch, or reaches an empty node at all when patch is null. The overlap is the node clipped to the
+    // triangle's bounding box. Plane minus patch is bilinear, so its maximum over the overlap is at one of
+    // the overlap's corners; the triangle's max Z minus the patch's lowest corner there caps it.
+    bool candidateExceeds(std::size_t col0, std::size_t row0, std::size_t size, const std::array<double, 4>* patch)
+    {
+        const double res = m_field.m_resolution;
+        const double x0 = m_field.m_minX + static_cast<double>(col0) * res;
+        const double y0 = m_field.m_minY + static_cast<double>(row0) * res;
+        const double x1 = x0 + static_cast<double>(size) * res;
+        const double y1 = y0 + static_cast<double>(size) * res;
+        const double span = static_cast<double>(size) * res;
+
+        const double tolerance = m_field.m_tolerance;
+        const double limit = patch ? std::min({(*patch)[0], (*patch)[1], (*patch)[2], (*patch)[3]}) + tolerance : -kInf;
+
+        const TriangleGrid& triangles = m_grid.triangles();
+        triangles.gatherCandidatesAABB(x0 - kEpsilon, y0 - kEpsilon, x1 + kEpsilon, y1 + kEpsilon, m_context);
+
+        bool exceeds = false;
+        for (std::uint32_t index : m_context.candidates)
+        {
+            const TriangleGrid::CullRecord& cull = triangles.cull(index);
+            const double maxZ = static_cast<double>(cull.maxZ);
+            if (maxZ <= limit)
+            {
+                continue;
+            }
+            const TriangleGrid::SurfaceRecord& surface = triangles.surface(index);
+            if (!surface.valid)
+            {
+                // Vertical faces never produce a sample.
+                continue;
+            }
+            const double bx0 = std::max(x0, static_cast<double>(cull.minX));
+            const double bx1 = std::min(x1, static_cast<double>(cull.maxX));
+            const double by0 = std::max(y0, static_cast<double>(cull.minY));
+            const double by1 = std::min(y1, static_cast<double>(cull.maxY));
+            if (bx0 > bx1 + kEpsilon || by0 > by1 + kEpsilon)
+            {
+                continue;
+            }
+
+            if (!patch)
+            {
+                exceeds = true;
+                break;
+            }
+
+            const double slopeX = static_cast<double>(surface.slopeX);
+            const double slopeY = static_cast<double>(surface.slopeY);
+            const double originX = static_cast<double>(surface.originX);
+            const double originY = static_cast<double>(surface.originY);
+            const double originZ = static_cast<double>(surface.originZ);
+            double reach = -kInf;
+            double patchLow = kInf;
+            for (const double x : {bx0, bx1})
+            {
+                for (const double y : {by0, by1})
+                {
+                    const double z = bilinear(*patch, std::clamp((x - x0) / span, 0.0, 1.0),
+                                              std::clamp((y - y0) / span, 0.0, 1.0));
+                    reach = std::max(reach, originZ + slopeX * (x - originX) + slopeY * (y - originY) - z);
+                    patchLow = std::min(patchLow, z);
+                }
+            }
+            if (std::min(reach, maxZ - patchLow) > tolerance)
+            {
+                exceeds = true;
+                break;
+            }
+        }
+        m_context.candidates.clear();
+        return exceeds;
+    }
+
+    bool needsSplit(std::size_t col0, std::size_t row0, std::size_t size)
+    {
+        if (col0 + size >= m_field.m_columns || row0 + size >= m_field.m_rows)
+        {
+            // Straddles the far edge of the lattice.
+            return true;
+        }
+
+        const std::size_t half = size / 2;
+        std::array<std::array<double, 3>, 3> z{};
+        std::size_t covered = 0;
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                z[j][i] = sample(col0 + i * half, row0 + j * half);
+                if (!std::isnan(z[j][i]))
+                {
+                    ++covered;
+                }
+            }
+        }
+
+        const double tolerance = m_field.m_tolerance;
+        if (covered == 0)
+        {
+            // Empty unless a feature slips between the samples.
+            return candidateExceeds(col0, row0, size, nullptr);
+        }
+        if (covered != 9)
+        {
+            return true;
+        }
+
+        const std::array<double, 4> corners{z[0][0], z[0][2], z[2][0], z[2][2]};
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                const double expected = bilinear(corners, 0.5 * static_cast<double>(i), 0.5 * static_cast<double>(j));
+                if (std::abs(z[j][i] - expected) > tolerance)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return candidateExceeds(col0, row0, size, &corners);
+    }
+
+    void subdivide(std::size_t nodeIndex, std::size_t col0, std::size_t row0, std::size_t size)
+    {
+        const std::size_t cellColumns = m_field.m_columns - 1;
+        const std::size_t cellRows = m_field.m_rows - 1;
+        if (col0 >= cellColumns || row0 >= cellRows)
+        {
+            // Entirely past the lattice; never reached by interpolate().
+            m_block.nodes[nodeIndex].leaf = static_cast<std::uint32_t>(m_block.corners.size() / 4);
+            m_block.corners.insert(m_block.corners.end(), 4, kNan);
+            return;
+        }
+
+        if (size > 1 && needsSplit(col0, row0, size))
+        {
+            const std::size_t firstChild = m_block.nodes.size();
+            m_block.nodes.resize(firstChild + 4);
+            m_block.nodes[nodeIndex].firstChild = static_cast<std::uint32_t>(firstChild);
+            const std::size_t half = size / 2;
+            for (std::size_t quadrant = 0; quadrant < 4; ++quadrant)
+            {
+                subdivide(firstChild + quadrant, col0 + (quadrant & 1) * half, row0 + (quadrant >> 1) * half, half);
+            }
+            return;
+        }
+
+        m_block.nodes[nodeIndex].leaf = static_cast<std::uint32_t>(m_block.corners.size() / 4);
+        m_block.corners.push_back(sample(col0, row0));
+        m_block.corners.push_back(sample(col0 + size, row0));
+        m_block.corners.push_back(sample(col0, row0 + size));
+        m_block.corners.push_back(sample(col0 + size, row0 + size));
+    }
+
+    const AdaptiveHeightField& m_field;
+    const UniformGrid& m_grid;
+    UniformGrid::QueryContext& m_context;
+    std::size_t m_size{1};
+    std::size_t m_col0{0};
+    std::size_t m_row0{0};
+    std::vector<double> m_samples;
+    std::vector<std::uint8_t> m_evaluated;
+    std::size_t m_evaluatedCount{0};
+    Block m_block;
+};
+
+bool AdaptiveHeightField::build(const UniformGrid& grid,
+                                double resolutionMm,
+                                double toleranceMm,
+                                const std::atomic<bool>& cancelFlag,
+                                BuildStats* stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_valid = false;
+    m_resolution = std::max(0.1, resolutionMm);
+    m_tolerance = std::max(0.0, toleranceMm);
+    m_minX = grid.minX();
+    m_minY = grid.minY();
+    m_maxX = grid.maxX();
+    m_maxY = grid.maxY();
+    m_columns = latticeSize(std::max(m_maxX - m_minX, m_resolution), m_resolution);
+    m_rows = latticeSize(std::max(m_maxY - m_minY, m_resolution), m_resolution);
+
+    m_blockLevels = 0;
+    while (m_blockLevels < kMaxBlockLevels
+           && static_cast<double>(std::size_t{2} << m_blockLevels) * m_resolution <= kMaxBlockMm + kEpsilon)
+    {
+        ++m_blockLevels;
+    }
+    const std::size_t blockSize = std::size_t{1} << m_blockLevels;
+    m_blockColumns = (m_columns - 1 + blockSize - 1) / blockSize;
+    m_blockRows = (m_rows - 1 + blockSize - 1) / blockSize;
+    m_blocks.assign(m_blockColumns * m_blockRows, Block{});
+
+    std::vector<std::size_t> evaluated(m_blocks.size(), 0);
+    std::vector<std::size_t> blockIndices(m_blocks.size());
+    std::iota(blockIndices.begin(), blockIndices.end(), std::size_t{0});
+
+    std::for_each(std::execution::par, blockIndices.begin(), blockIndices.end(), [&](std::size_t index) {
+        if (cancelFlag.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        // The context's visit marks span every triangle, so it is reused across blocks.
+        thread_local UniformGrid::QueryContext context;
+        BlockBuilder builder(*this, grid, context, index % m_blockColumns, index / m_blockColumns);
+        m_blocks[index] = builder.build();
+        evaluated[index] = builder.evaluatedSamples();
+    });
+
+    const double elapsedMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (cancelFlag.load(std::memory_order_relaxed))
+    {
+        m_blocks.clear();
+        LOG_INFO(Tp, QStringLiteral("Adaptive HeightField build cancelled after %1 ms").arg(elapsedMs, 0, 'f', 2));
+        return false;
+    }
+
+    m_sampleCount = std::accumulate(evaluated.begin(), evaluated.end(), std::size_t{0});
+    m_leafCount = 0;
+    for (const Block& block : m_blocks)
+    {
+        m_leafCount += block.corners.size() / 4;
+    }
+    m_valid = true;
+
+    const std::size_t denseSamples = m_columns * m_rows;
+    LOG_INFO(Tp,
+             QStringLiteral("Adaptive HeightField build (%1x%2 @ %3 mm, tol=%4 mm) completed in %5 ms "
+                            "(samples=%6/%7, leaves=%8, %9 bytes)")
+                 .arg(static_cast<qulonglong>(m_columns))
+                 .arg(static_cast<qulonglong>(m_rows))
+                 .arg(m_resolution, 0, 'f', 3)
+                 .arg(m_tolerance, 0, 'f', 3)
+                 .arg(elapsedMs, 0, 'f', 2)
+                 .arg(static_cast<qulonglong>(m_sampleCount))
+                 .arg(static_cast<qulonglong>(denseSamples))
+                 .arg(static_cast<qulonglong>(m_leafCount))
+                 .arg(static_cast<qulonglong>(memoryBytes())));
+
+    if (stats)
+    {
+        stats->buildMilliseconds = elapsedMs;
+        stats->evaluatedSamples = m_sampleCount;
+        stats->denseSamples = denseSamples;
+        stats->leafCount = m_leafCount;
+    }
+    return true;
+}
+
+std::size_t AdaptiveHeightField::memoryBytes() const noexcept
+{
+    std::size_t bytes = m_blocks.size() * sizeof(Block);
+    for (const Block& block : m_blocks)
+    {
+        bytes += block.nodes.size() * sizeof(Node) + block.corners.size() * sizeof(double);
+    }
+    return bytes;
+}
+
+bool AdaptiveHeightField::interpolate(double x, double y, double& zOut) const
+{
+    if (!m_valid)
+    {
+        return false;
+    }
+
+    if (x < m_minX - kEpsilon || x > m_minX + m_resolution * static_cast<double>(m_columns - 1) + kEpsilon
+        || y < m_minY - kEpsilon || y > m_minY + m_resolution * static_cast<double>(m_rows - 1) + kEpsilon)
+    {
+        return false;
+    }
+
+    const double fx = std::clamp((x - m_minX) / m_resolution, 0.0, static_cast<double>(m_columns - 1));
+    const double fy = std::clamp((y - m_minY) / m_resolution, 0.0, static_cast<double>(m_rows - 1));
+    const std::size_t ix = static_cast<std::size_t>(std::floor(fx));
+    const std::size_t iy = static_cast<std::size_t>(std::floor(fy));
+    const std::size_t cellX = std::min(ix, m_columns - 2);
+    const std::size_t cellY = std::min(iy, m_rows - 2);
+
+    const Block& block = m_blocks[(cellY >> m_blockLevels) * m_blockColumns + (cellX >> m_blockLevels)];
+    std::size_t size = std::size_t{1} << m_blockLevels;
+    std::size_t col0 = (cellX >> m_blockLevels) << m_blockLevels;
+    std::size_t row0 = (cellY >> m_blockLevels) << m_blockLevels;
+    const Node* node = &block.nodes.front();
+    while (node->firstChild != 0)
+    {
+        size /= 2;
+        const std::size_t right = (cellX >= col0 + size) ? 1 : 0;
+        const std::size_t top = (cellY >= row0 + size) ? 1 : 0;
+        col0 += right * size;
+        row0 += top * size;
+        node = &block.nodes[node->firstChild + right + 2 * top];
+    }
+
+    const double* corner = block.corners.data() + std::size_t{node->leaf} * 4;
+    if (size == 1 && (ix != cellX || iy != cellY))
+    {
+        // On the far edge of the lattice the dense field reads the single sample there.
+        const double z = corner[(ix - col0) + 2 * (iy - row0)];
+        if (std::isnan(z))
+        {
+            return false;
+        }
+        zOut = z;
+        return true;
+    }
+
+    const std::array<double, 4> z{corner[0], corner[1], corner[2], corner[3]};
+    if (std::isnan(z[0]) || std::isnan(z[1]) || std::isnan(z[2]) || std::isnan(z[3]))
+    {
+        return false;
+    }
+    const double scale = static_cast<double>(size);
+    zOut = bilinear(z, (fx - static_cast<double>(col0)) / scale, (fy - static_cast<double>(row0)) / scale);
+    return true;
+}
+
+} // namespace tp::heightfield
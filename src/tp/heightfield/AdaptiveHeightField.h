@@ -0,0 +1,101 @@
+#pragma once
+
+#include "tp/heightfield/UniformGrid.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tp::heightfield
+{
+
+// Height field on the same lattice as HeightField, stored as a forest of quadtrees whose leaves are
+// bilinear patches. A node is only split where bilinear interpolation of its corners would miss the
+// surface by more than the tolerance: where an edge midpoint or the centre deviates from the
+// corners' bilinear value, where coverage changes inside the node, or where a triangle overlapping
+// the node could rise more than the tolerance above that bilinear patch (a curved face between the
+// samples, a steep face or a rib narrower than the node). Flat and gently curved regions collapse into
+// a few large leaves; leaves one lattice cell wide hold exactly the samples the dense field would hold.
+// The field is never more than the tolerance below the dense one. A groove narrower than a leaf can
+// be bridged, which leaves stock but never gouges.
+class AdaptiveHeightField
+{
+public:
+    struct BuildStats
+    {
+        double buildMilliseconds{0.0};
+        // Lattice samples actually evaluated against the mesh.
+        std::size_t evaluatedSamples{0};
+        // Samples a dense HeightField at the same resolution would evaluate.
+        std::size_t denseSamples{0};
+        std::size_t leafCount{0};
+    };
+
+    AdaptiveHeightField() = default;
+    AdaptiveHeightField(const AdaptiveHeightField&) = delete;
+    AdaptiveHeightField& operator=(const AdaptiveHeightField&) = delete;
+    AdaptiveHeightField(AdaptiveHeightField&&) noexcept = default;
+    AdaptiveHeightField& operator=(AdaptiveHeightField&&) noexcept = default;
+
+    bool build(const UniformGrid& grid,
+               double resolutionMm,
+               double toleranceMm,
+               const std::atomic<bool>& cancelFlag,
+               BuildStats* stats = nullptr);
+
+    [[nodiscard]] bool isValid() const noexcept { return m_valid; }
+    [[nodiscard]] double minX() const noexcept { return m_minX; }
+    [[nodiscard]] double minY() const noexcept { return m_minY; }
+    [[nodiscard]] double maxX() const noexcept { return m_maxX; }
+    [[nodiscard]] double maxY() const noexcept { return m_maxY; }
+    [[nodiscard]] double resolution() const noexcept { return m_resolution; }
+    [[nodiscard]] double tolerance() const noexcept { return m_tolerance; }
+    // Lattice dimensions of the equivalent dense field.
+    [[nodiscard]] std::size_t columns() const noexcept { return m_columns; }
+    [[nodiscard]] std::size_t rows() const noexcept { return m_rows; }
+    [[nodiscard]] std::size_t leafCount() const noexcept { return m_leafCount; }
+    [[nodiscard]] std::size_t sampleCount() const noexcept { return m_sampleCount; }
+    [[nodiscard]] std::size_t memoryBytes() const noexcept;
+
+    // Same contract as HeightField::interpolate(): false outside the lattice or where a bilinear patch
+    // touches an uncovered sample.
+    [[nodiscard]] bool interpolate(double x, double y, double& zOut) const;
+
+private:
+    // firstChild == 0 marks a leaf (index 0 is always the block root, never a child); children are
+    // stored as four consecutive nodes in (x0 y0), (x1 y0), (x0 y1), (x1 y1) order.
+    struct Node
+    {
+        std::uint32_t firstChild{0};
+        std::uint32_t leaf{0};
+    };
+
+    // One quadtree per square block of 2^m_blockLevels lattice cells. Leaf corners are stored in the
+    // same order as children; NaN marks an uncovered corner.
+    struct Block
+    {
+        std::vector<Node> nodes;
+        std::vector<double> corners;
+    };
+
+    class BlockBuilder;
+
+    double m_minX{0.0};
+    double m_minY{0.0};
+    double m_maxX{0.0};
+    double m_maxY{0.0};
+    double m_resolution{1.0};
+    double m_tolerance{0.0};
+    std::size_t m_columns{0};
+    std::size_t m_rows{0};
+    std::size_t m_blockLevels{0};
+    std::size_t m_blockColumns{0};
+    std::size_t m_blockRows{0};
+    std::size_t m_leafCount{0};
+    std::size_t m_sampleCount{0};
+    bool m_valid{false};
+    std::vector<Block> m_blocks;
+};
+
+} // namespace tp::heightfield
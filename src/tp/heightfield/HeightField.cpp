@@ -132,44 +132,300 @@ int threadOverride()
     return overrideValue;
 }
 
+// Lattice samples per tile edge for scan conversion; 64x64 doubles keeps a tile's samples in L2. Equal to
+// the storage tile, so a tiled build writes each tile contiguously.
+constexpr std::size_t kScanTileSize = HeightField::kTileSize;
+
 struct RowRange
 {
     std::size_t begin{0};
     std::size_t end{0};
 };
 
+struct SampleSpan
+{
+    std::size_t colBegin{0};
+    std::size_t colEnd{0};
+    std::size_t rowBegin{0};
+    std::size_t rowEnd{0};
+};
+
+// Include the far edge of the bounds so the last raster step still lands on sampled data.
+std::size_t latticeSize(double extent, double resolution)
+{
+    return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(extent / resolution - kEpsilon)) + 1);
+}
+
+std::size_t effectiveThreadCount()
+{
+    const auto hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const int userOverride = threadOverride();
+    return static_cast<std::size_t>(
+        std::max<int>(1, (userOverride > 0) ? userOverride : static_cast<int>(hardwareThreads)));
+}
+
+struct Lattice
+{
+    double minX{0.0};
+    double minY{0.0};
+    double resolution{1.0};
+    std::size_t columns{0};
+    std::size_t rows{0};
+};
+
+Lattice latticeOf(const HeightField& field)
+{
+    return Lattice{field.minX(), field.minY(), field.resolution(), field.columns(), field.rows()};
+}
+
+// Lattice samples a triangle may cover, widened by one sample on each side; the exact per-sample test in
+// UniformGrid decides coverage.
+SampleSpan triangleSpan(const TriangleGrid& triangles, const Lattice& lattice, std::uint32_t index)
+{
+    const TriangleGrid::CullRecord& tri = triangles.cull(index);
+    const double invResolution = 1.0 / lattice.resolution;
+    const auto toIndex = [](double rel, std::size_t count) -> std::size_t {
+        if (!(rel > 0.0))
+        {
+            return 0;
+        }
+        return std::min(count - 1, static_cast<std::size_t>(rel));
+    };
+    SampleSpan span;
+    span.colBegin =
+        toIndex(std::floor((static_cast<double>(tri.minX) - lattice.minX) * invResolution) - 1.0, lattice.columns);
+    span.colEnd =
+        toIndex(std::ceil((static_cast<double>(tri.maxX) - lattice.minX) * invResolution) + 1.0, lattice.columns) + 1;
+    span.rowBegin =
+        toIndex(std::floor((static_cast<double>(tri.minY) - lattice.minY) * invResolution) - 1.0, lattice.rows);
+    span.rowEnd =
+        toIndex(std::ceil((static_cast<double>(tri.maxY) - lattice.minY) * invResolution) + 1.0, lattice.rows) + 1;
+    return span;
+}
+
+// Triangles binned into fixed lattice tiles (CSR layout, same as TriangleGrid), so each tile owns its
+// slice of the samples exclusively and the splat needs no atomics.
+struct TileBins
+{
+    std::size_t tilesX{0};
+    std::size_t tileCount{0};
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> triangles;
+};
+
+TileBins binTriangles(const TriangleGrid& triangles, const Lattice& lattice)
+{
+    TileBins bins;
+    bins.tilesX = (lattice.columns + kScanTileSize - 1) / kScanTileSize;
+    bins.tileCount = bins.tilesX * ((lattice.rows + kScanTileSize - 1) / kScanTileSize);
+    const auto triangleCount = static_cast<std::uint32_t>(triangles.triangleCount());
+
+    const auto forEachTile = [&](std::uint32_t index, auto&& visit) {
+        const SampleSpan span = triangleSpan(triangles, lattice, index);
+        for (std::size_t ty = span.rowBegin / kScanTileSize; ty <= (span.rowEnd - 1) / kScanTileSize; ++ty)
+        {
+            for (std::size_t tx = span.colBegin / kScanTileSize; tx <= (span.colEnd - 1) / kScanTileSize; ++tx)
+            {
+                visit(ty * bins.tilesX + tx);
+            }
+        }
+    };
+
+    std::vector<std::uint32_t> tileCounts(bins.tileCount, 0);
+    for (std::uint32_t index = 0; index < triangleCount; ++index)
+    {
+        forEachTile(index, [&](std::size_t tile) { ++tileCounts[tile]; });
+    }
+
+    bins.offsets.assign(bins.tileCount + 1, 0);
+    std::inclusive_scan(tileCounts.begin(), tileCounts.end(), bins.offsets.begin() + 1);
+
+    bins.triangles.resize(bins.offsets.back());
+    std::vector<std::uint32_t> writeCursor(bins.offsets.begin(), bins.offsets.end() - 1);
+    for (std::uint32_t index = 0; index < triangleCount; ++index)
+    {
+        forEachTile(index, [&](std::size_t tile) { bins.triangles[writeCursor[tile]++] = index; });
+    }
+    return bins;
+}
+
+// Scan-converts one tile of a tiled field into its contiguous slot. Rows outer, so each tile row is
+// finished in a lattice-wide scratch row (the row kernel indexes by lattice column) and then copied;
+// triangles are widened once per tile. Samples outside the lattice are left untouched. Returns false
+// when cancelled part way.
+bool fillTile(const UniformGrid& grid,
+              const Lattice& lattice,
+              const TileBins& bins,
+              std::size_t tile,
+              double* tileSamples,
+              std::uint8_t* tileCoverage,
+              const std::atomic<bool>* cancelFlag,
+              std::size_t& validOut)
+{
+    const TriangleGrid& triangles = grid.triangles();
+    const std::size_t tileColBegin = (tile % bins.tilesX) * kScanTileSize;
+    const std::size_t tileRowBegin = (tile / bins.tilesX) * kScanTileSize;
+    const std::size_t tileColEnd = std::min(lattice.columns, tileColBegin + kScanTileSize);
+    const std::size_t tileRowEnd = std::min(lattice.rows, tileRowBegin + kScanTileSize);
+
+    thread_local std::vector<std::pair<RowTriangle, SampleSpan>> tileTris;
+    thread_local std::vector<double> scratchRow;
+    tileTris.clear();
+    scratchRow.resize(lattice.columns);
+    for (std::uint32_t entry = bins.offsets[tile]; entry < bins.offsets[tile + 1]; ++entry)
+    {
+        const std::uint32_t index = bins.triangles[entry];
+        const RowTriangle tri = RowTriangle::load(triangles, index);
+        if (!tri.valid)
+        {
+            continue;
+        }
+        SampleSpan span = triangleSpan(triangles, lattice, index);
+        span.colBegin = std::max(span.colBegin, tileColBegin);
+        span.colEnd = std::min(span.colEnd, tileColEnd);
+        span.rowBegin = std::max(span.rowBegin, tileRowBegin);
+        span.rowEnd = std::min(span.rowEnd, tileRowEnd);
+        tileTris.emplace_back(tri, span);
+    }
+
+    std::size_t localValid = 0;
+    for (std::size_t row = tileRowBegin; row < tileRowEnd; ++row)
+    {
+        if (cancelFlag && cancelFlag->load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        std::fill(scratchRow.begin() + static_cast<std::ptrdiff_t>(tileColBegin),
+                  scratchRow.begin() + static_cast<std::ptrdiff_t>(tileColEnd),
+                  kNan);
+        const double y = lattice.minY + static_cast<double>(row) * lattice.resolution;
+        for (const auto& [tri, span] : tileTris)
+        {
+            if (row >= span.rowBegin && row < span.rowEnd)
+            {
+                grid.sampleTriangleRow(tri, y, lattice.minX, lattice.resolution, span.colBegin, span.colEnd,
+                                       scratchRow.data());
+            }
+        }
+
+        const std::size_t rowOffset = (row - tileRowBegin) * kScanTileSize;
+        for (std::size_t col = tileColBegin; col < tileColEnd; ++col)
+        {
+            const double z = scratchRow[col];
+            const std::uint8_t covered = std::isnan(z) ? 0 : 1;
+            tileSamples[rowOffset + col - tileColBegin] = z;
+            tileCoverage[rowOffset + col - tileColBegin] = covered;
+            localValid += covered;
+        }
+    }
+    validOut = localValid;
+    return true;
+}
+
+constexpr std::uint8_t kTilePending = 0;
+constexpr std::uint8_t kTileBuilding = 1;
+constexpr std::uint8_t kTileReady = 2;
+
 } // namespace
 
-bool HeightField::build(const UniformGrid& grid,
-                        double resolutionMm,
-                        const std::atomic<bool>& cancelFlag,
-                        BuildStats* stats)
+// Deferred scan conversion of a field set up by buildLazy(). The storage pointers alias the field's
+// own vectors, whose buffers do not move while the field is alive.
+struct HeightField::LazyTiles
 {
-    m_resolution = std::max(0.1, resolutionMm);
-    m_minX = grid.minX();
-    m_minY = grid.minY();
-    m_maxX = grid.maxX();
-    m_maxY = grid.maxY();
+    std::shared_ptr<const UniformGrid> grid;
+    Lattice lattice;
+    TileBins bins;
+    double* samples{nullptr};
+    std::uint8_t* coverage{nullptr};
+    std::unique_ptr<std::atomic<std::uint8_t>[]> states;
+    std::atomic<std::size_t> pending{0};
+};
 
-    const double extentX = std::max(m_maxX - m_minX, m_resolution);
-    const double extentY = std::max(m_maxY - m_minY, m_resolution);
+bool HeightField::downsample(const HeightField& source, double resolutionMm)
+{
+    m_valid = false;
+    if (!source.isValid())
+    {
+        return false;
+    }
 
-    m_columns = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(extentX / m_resolution)));
-    m_rows = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(extentY / m_resolution)));
+    const double resolution = std::max(0.1, resolutionMm);
+    const double ratio = resolution / source.m_resolution;
+    const auto factor = static_cast<std::size_t>(std::llround(ratio));
+    if (factor < 2 || std::abs(ratio - static_cast<double>(factor)) > 1e-9)
+    {
+        return false;
+    }
 
-    m_samples.assign(m_columns * m_rows, kNan);
-    m_coverage.assign(m_columns * m_rows, 0);
+    const std::size_t columns = latticeSize(std::max(source.m_maxX - source.m_minX, resolution), resolution);
+    const std::size_t rows = latticeSize(std::max(source.m_maxY - source.m_minY, resolution), resolution);
 
-    const auto hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
-    const int userOverride = threadOverride();
-    const std::size_t effectiveThreads = static_cast<std::size_t>(std::max<int>(1, (userOverride > 0) ? userOverride
-                                                                                                      : static_cast<int>(hardwareThreads)));
+    m_resolution = resolution;
+    m_minX = source.m_minX;
+    m_minY = source.m_minY;
+    m_maxX = source.m_maxX;
+    m_maxY = source.m_maxY;
+    m_columns = columns;
+    m_rows = rows;
+    setLayout(source.m_layout);
+    m_lazy.reset();
+    m_samples.assign(storageSize(), kNan);
+    m_coverage.assign(storageSize(), 0);
+    m_mapping.reset();
+    resetEncoding();
+
+    // The coarse lattice can overshoot the fine one by less than a coarse step at the far edges. Those
+    // samples lie past the model bounds, where a build finds no triangle either, so they stay uncovered.
+    const std::size_t sourceRows = std::min(m_rows, (source.m_rows - 1) / factor + 1);
+    const std::size_t sourceColumns = std::min(m_columns, (source.m_columns - 1) / factor + 1);
+    for (std::size_t row = 0; row < sourceRows; ++row)
+    {
+        // sampleAt() decodes quantized samples and builds the tiles of a lazy source on first touch.
+        if (source.m_encoding != SampleEncoding::Float64 || source.m_lazy)
+        {
+            for (std::size_t col = 0; col < sourceColumns; ++col)
+            {
+                double z = 0.0;
+                if (source.sampleAt(col * factor, row * factor, z))
+                {
+                    m_samples[offset(col, row)] = z;
+                    m_coverage[offset(col, row)] = 1;
+                }
+            }
+            continue;
+        }
+        for (std::size_t col = 0; col < sourceColumns; ++col)
+        {
+            const std::size_t sourceIndex = source.offset(col * factor, row * factor);
+            m_samples[offset(col, row)] = source.m_sampleData[sourceIndex];
+            m_coverage[offset(col, row)] = source.m_coverageData[sourceIndex];
+        }
+    }
+
+    m_sampleData = m_samples.data();
+    m_coverageData = m_coverage.data();
+    m_valid = true;
+    return true;
+}
 
-    const QString timerLabel = QStringLiteral("HeightField build (%1x%2 @ %3 mm, threads=%4)")
+bool HeightField::build(const UniformGrid& grid,
+                        double resolutionMm,
+                        const std::atomic<bool>& cancelFlag,
+                        BuildStats* stats,
+                        BuildMode mode,
+                        SampleLayout layout)
+{
+    allocate(grid, resolutionMm, layout);
+    const std::size_t effectiveThreads = effectiveThreadCount();
+
+    const QString timerLabel = QStringLiteral("HeightField build (%1x%2 @ %3 mm, threads=%4, mode=%5)")
                                    .arg(static_cast<qulonglong>(m_columns))
                                    .arg(static_cast<qulonglong>(m_rows))
                                    .arg(m_resolution, 0, 'f', 3)
-                                   .arg(static_cast<qulonglong>(effectiveThreads));
+                                   .arg(static_cast<qulonglong>(effectiveThreads))
+                                   .arg(mode == BuildMode::ScanConversion ? QStringLiteral("scan")
+                                                                          : QStringLiteral("point"));
 
     std::atomic<std::size_t> validCounter{0};
     double elapsedMs = 0.0;
@@ -207,89 +463,264 @@ bool HeightField::build(const UniformGrid& grid,
                           },
                           &cancelFlag);
 
-        std::vector<RowRange> workItems;
-        const std::size_t totalRows = m_rows;
-        const std::size_t baseChunk = (totalRows >= effectiveThreads)
-                                          ? std::max<std::size_t>(1, totalRows / (effectiveThreads * 4))
-                                          : 1;
-        const std::size_t chunkSize = std::max<std::size_t>(16, baseChunk);
+        const std::size_t valid = (mode == BuildMode::ScanConversion)
+                                      ? scanConvert(grid, effectiveThreads, cancelFlag)
+                                      : samplePoints(grid, effectiveThreads, cancelFlag);
+        validCounter.store(valid, std::memory_order_relaxed);
+    }
 
-        for (std::size_t row = 0; row < totalRows; row += chunkSize)
-        {
-            workItems.push_back(RowRange{row, std::min(totalRows, row + chunkSize)});
-        }
+    if (cancelFlag.load(std::memory_order_relaxed))
+    {
+        m_valid = false;
+        return false;
+    }
+
+    if (stats)
+    {
+        stats->buildMilliseconds = elapsedMs;
+        stats->validSamples = validCounter.load(std::memory_order_relaxed);
+        stats->totalSamples = m_columns * m_rows;
+    }
 
-        const bool runParallel = effectiveThreads > 1 && workItems.size() > 1;
+    m_valid = true;
+    return true;
+}
+
+std::size_t HeightField::samplePoints(const UniformGrid& grid,
+                                      std::size_t effectiveThreads,
+                                      const std::atomic<bool>& cancelFlag)
+{
+    std::vector<RowRange> workItems;
+    const std::size_t totalRows = m_rows;
+    const std::size_t baseChunk = (totalRows >= effectiveThreads)
+                                      ? std::max<std::size_t>(1, totalRows / (effectiveThreads * 4))
+                                      : 1;
+    const std::size_t chunkSize = std::max<std::size_t>(16, baseChunk);
+
+    for (std::size_t row = 0; row < totalRows; row += chunkSize)
+    {
+        workItems.push_back(RowRange{row, std::min(totalRows, row + chunkSize)});
+    }
+
+    const bool runParallel = effectiveThreads > 1 && workItems.size() > 1;
+    std::atomic<std::size_t> validCounter{0};
 
-        const auto worker = [&](const RowRange& range) {
-            std::size_t localValid = 0;
-            for (std::size_t row = range.begin; row < range.end; ++row)
+    const auto worker = [&](const RowRange& range) {
+        std::size_t localValid = 0;
+        for (std::size_t row = range.begin; row < range.end; ++row)
+        {
+            if (cancelFlag.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+
+            const double y = m_minY + static_cast<double>(row) * m_resolution;
+            for (std::size_t col = 0; col < m_columns; ++col)
             {
                 if (cancelFlag.load(std::memory_order_relaxed))
                 {
                     break;
                 }
 
-                const double y = m_minY + static_cast<double>(row) * m_resolution;
-                const std::size_t rowOffset = row * m_columns;
-                for (std::size_t col = 0; col < m_columns; ++col)
+                const double x = m_minX + static_cast<double>(col) * m_resolution;
+                double z = 0.0;
+                if (grid.sampleMaxZAtXY(x, y, z))
                 {
-                    if (cancelFlag.load(std::memory_order_relaxed))
-                    {
-                        break;
-                    }
-
-                    const double x = m_minX + static_cast<double>(col) * m_resolution;
-                    double z = 0.0;
-                    if (grid.sampleMaxZAtXY(x, y, z))
-                    {
-                        const std::size_t sampleIndex = rowOffset + col;
-                        m_samples[sampleIndex] = z;
-                        m_coverage[sampleIndex] = 1;
-                        ++localValid;
-                    }
+                    const std::size_t sampleIndex = offset(col, row);
+                    m_samples[sampleIndex] = z;
+                    m_coverage[sampleIndex] = 1;
+                    ++localValid;
                 }
             }
-            return localValid;
-        };
+        }
+        return localValid;
+    };
 
-        if (runParallel)
+    if (runParallel)
+    {
+        std::for_each(std::execution::par, workItems.begin(), workItems.end(), [&](const RowRange& range) {
+            const std::size_t local = worker(range);
+            if (local > 0)
+            {
+                validCounter.fetch_add(local, std::memory_order_relaxed);
+            }
+        });
+    }
+    else
+    {
+        for (const RowRange& range : workItems)
         {
-            std::for_each(std::execution::par, workItems.begin(), workItems.end(), [&](const RowRange& range) {
-                const std::size_t local = worker(range);
-                if (local > 0)
-                {
-                    validCounter.fetch_add(local, std::memory_order_relaxed);
-                }
-            });
+            const std::size_t local = worker(range);
+            if (local > 0)
+            {
+                validCounter.fetch_add(local, std::memory_order_relaxed);
+            }
+            if (cancelFlag.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+    }
+
+    return validCounter.load(std::memory_order_relaxed);
+}
+
+std::size_t HeightField::scanConvert(const UniformGrid& grid,
+                                     std::size_t effectiveThreads,
+                                     const std::atomic<bool>& cancelFlag)
+{
+    const TriangleGrid& triangles = grid.triangles();
+    if (triangles.triangleCount() == 0)
+    {
+        return 0;
+    }
+
+    const Lattice lattice = latticeOf(*this);
+    const TileBins bins = binTriangles(triangles, lattice);
+
+    if (cancelFlag.load(std::memory_order_relaxed))
+    {
+        return 0;
+    }
+
+    std::vector<std::size_t> tiles(bins.tileCount);
+    std::iota(tiles.begin(), tiles.end(), 0);
+    std::atomic<std::size_t> validCounter{0};
+
+    const auto tiledWorker = [&](std::size_t tile) {
+        std::size_t localValid = 0;
+        const std::size_t tileOffset = tile << (2 * kTileShift);
+        if (fillTile(grid, lattice, bins, tile, m_samples.data() + tileOffset, m_coverage.data() + tileOffset,
+                     &cancelFlag, localValid)
+            && localValid > 0)
+        {
+            validCounter.fetch_add(localValid, std::memory_order_relaxed);
+        }
+    };
+
+    const auto rowMajorWorker = [&](std::size_t tile) {
+        const std::size_t tileColBegin = (tile % bins.tilesX) * kScanTileSize;
+        const std::size_t tileRowBegin = (tile / bins.tilesX) * kScanTileSize;
+        const std::size_t tileColEnd = std::min(m_columns, tileColBegin + kScanTileSize);
+        const std::size_t tileRowEnd = std::min(m_rows, tileRowBegin + kScanTileSize);
+
+        for (std::uint32_t entry = bins.offsets[tile]; entry < bins.offsets[tile + 1]; ++entry)
+        {
+            if (cancelFlag.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            const std::uint32_t index = bins.triangles[entry];
+            const SampleSpan span = triangleSpan(triangles, lattice, index);
+            const std::size_t colBegin = std::max(span.colBegin, tileColBegin);
+            const std::size_t colEnd = std::min(span.colEnd, tileColEnd);
+            const std::size_t rowBegin = std::max(span.rowBegin, tileRowBegin);
+            const std::size_t rowEnd = std::min(span.rowEnd, tileRowEnd);
+
+            const RowTriangle tri = RowTriangle::load(triangles, index);
+            if (!tri.valid)
+            {
+                continue;
+            }
+
+            // Samples start as NaN, so the row kernel's max-update doubles as the coverage test.
+            for (std::size_t row = rowBegin; row < rowEnd; ++row)
+            {
+                const double y = m_minY + static_cast<double>(row) * m_resolution;
+                grid.sampleTriangleRow(tri, y, m_minX, m_resolution, colBegin, colEnd, &m_samples[row * m_columns]);
+            }
+        }
+
+        std::size_t localValid = 0;
+        for (std::size_t row = tileRowBegin; row < tileRowEnd; ++row)
+        {
+            const std::size_t rowOffset = row * m_columns;
+            for (std::size_t col = tileColBegin; col < tileColEnd; ++col)
+            {
+                const std::uint8_t covered = std::isnan(m_samples[rowOffset + col]) ? 0 : 1;
+                m_coverage[rowOffset + col] = covered;
+                localValid += covered;
+            }
+        }
+        if (localValid > 0)
+        {
+            validCounter.fetch_add(localValid, std::memory_order_relaxed);
+        }
+    };
+
+    const auto worker = [&](std::size_t tile) {
+        if (m_layout == SampleLayout::Tiled)
+        {
+            tiledWorker(tile);
         }
         else
         {
-            for (const RowRange& range : workItems)
+            rowMajorWorker(tile);
+        }
+    };
+
+    if (effectiveThreads > 1 && tiles.size() > 1)
+    {
+        std::for_each(std::execution::par, tiles.begin(), tiles.end(), worker);
+    }
+    else
+    {
+        for (std::size_t tile : tiles)
+        {
+            worker(tile);
+            if (cancelFlag.load(std::memory_order_relaxed))
             {
-                const std::size_t local = worker(range);
-                if (local > 0)
-                {
-                    validCounter.fetch_add(local, std::memory_order_relaxed);
-                }
-                if (cancelFlag.load(std::memory_order_relaxed))
-                {
-                    break;
-                }
+                break;
             }
         }
     }
 
+    return validCounter.load(std::memory_order_relaxed);
+}
+
+bool HeightField::buildLazy(std::shared_ptr<const UniformGrid> grid,
+                            double resolutionMm,
+                            const std::atomic<bool>& cancelFlag,
+                            BuildStats* stats)
+{
+    if (!grid)
+    {
+        m_valid = false;
+        m_lazy.reset();
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    allocate(*grid, resolutionMm, SampleLayout::Tiled);
+
+    auto lazy = std::make_shared<LazyTiles>();
+    lazy->lattice = latticeOf(*this);
+    lazy->bins = binTriangles(grid->triangles(), lazy->lattice);
     if (cancelFlag.load(std::memory_order_relaxed))
     {
         m_valid = false;
         return false;
     }
+    lazy->grid = std::move(grid);
+    lazy->samples = m_samples.data();
+    lazy->coverage = m_coverage.data();
+    lazy->states = std::make_unique<std::atomic<std::uint8_t>[]>(lazy->bins.tileCount);
+    lazy->pending.store(lazy->bins.tileCount, std::memory_order_relaxed);
+    m_lazy = std::move(lazy);
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO(Tp, QStringLiteral("HeightField lazy setup (%1x%2 @ %3 mm, %4 tiles) completed in %5 ms")
+                      .arg(static_cast<qulonglong>(m_columns))
+                      .arg(static_cast<qulonglong>(m_rows))
+                      .arg(m_resolution, 0, 'f', 3)
+                      .arg(static_cast<qulonglong>(m_lazy->bins.tileCount))
+                      .arg(ms, 0, 'f', 2));
 
     if (stats)
     {
-        stats->buildMilliseconds = elapsedMs;
-        stats->validSamples = validCounter.load(std::memory_order_relaxed);
+        stats->buildMilliseconds = ms;
+        stats->validSamples = 0;
         stats->totalSamples = m_columns * m_rows;
     }
 
@@ -297,14 +728,249 @@ bool HeightField::build(const UniformGrid& grid,
     return true;
 }
 
+std::size_t HeightField::pendingTiles() const noexcept
+{
+    return m_lazy ? m_lazy->pending.load(std::memory_order_relaxed) : 0;
+}
+
+void HeightField::ensureTile(std::size_t tile) const
+{
+    if (m_lazy->states[tile].load(std::memory_order_acquire) != kTileReady)
+    {
+        buildTile(tile, nullptr);
+    }
+}
+
+bool HeightField::buildTile(std::size_t tile, const std::atomic<bool>* cancelFlag) const
+{
+    LazyTiles& lazy = *m_lazy;
+    std::atomic<std::uint8_t>& state = lazy.states[tile];
+    for (;;)
+    {
+        std::uint8_t current = state.load(std::memory_order_acquire);
+        if (current == kTileReady)
+        {
+            return true;
+        }
+        if (current == kTileBuilding)
+        {
+            // Another thread owns the tile; wait for it rather than scan-converting twice.
+            state.wait(kTileBuilding, std::memory_order_acquire);
+            continue;
+        }
+        if (state.compare_exchange_weak(current, kTileBuilding, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+
+    const std::size_t tileOffset = tile << (2 * kTileShift);
+    std::size_t valid = 0;
+    const bool completed = fillTile(*lazy.grid, lazy.lattice, lazy.bins, tile, lazy.samples + tileOffset,
+                                    lazy.coverage + tileOffset, cancelFlag, valid);
+    state.store(completed ? kTileReady : kTilePending, std::memory_order_release);
+    state.notify_all();
+    if (completed)
+    {
+        lazy.pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return completed;
+}
+
+bool HeightField::populate(const std::atomic<bool>& cancelFlag) const
+{
+    if (!m_lazy || pendingTiles() == 0)
+    {
+        return true;
+    }
+
+    std::vector<std::size_t> tiles(m_lazy->bins.tileCount);
+    std::iota(tiles.begin(), tiles.end(), 0);
+    const auto worker = [&](std::size_t tile) {
+        if (!cancelFlag.load(std::memory_order_relaxed))
+        {
+            buildTile(tile, &cancelFlag);
+        }
+    };
+    if (effectiveThreadCount() > 1 && tiles.size() > 1)
+    {
+        std::for_each(std::execution::par, tiles.begin(), tiles.end(), worker);
+    }
+    else
+    {
+        std::for_each(tiles.begin(), tiles.end(), worker);
+    }
+    return pendingTiles() == 0;
+}
+
+void HeightField::prefetch(double x0, double y0, double x1, double y1) const
+{
+    if (!m_valid || pendingTiles() == 0)
+    {
+        return;
+    }
+
+    // Walk the segment a quarter tile at a time and touch the tile under each point and the one under its
+    // diagonal lattice neighbour. A tile the segment only clips at a corner may be skipped; it is then built on the
+    // first query like any other.
+    const double step = static_cast<double>(kTileSize) * m_resolution * 0.25;
+    const double length = std::hypot(x1 - x0, y1 - y0);
+    const std::size_t steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(length / step)));
+    const double lastCol = static_cast<double>(m_columns - 1);
+    const double lastRow = static_cast<double>(m_rows - 1);
+    for (std::size_t i = 0; i <= steps; ++i)
+    {
+        const double t = static_cast<double>(i) / static_cast<double>(steps);
+        const double fx = std::clamp((x0 + (x1 - x0) * t - m_minX) / m_resolution, 0.0, lastCol);
+        const double fy = std::clamp((y0 + (y1 - y0) * t - m_minY) / m_resolution, 0.0, lastRow);
+        const auto col = static_cast<std::size_t>(fx);
+        const auto row = static_cast<std::size_t>(fy);
+        ensureTile(offset(col, row) >> (2 * kTileShift));
+        ensureTile(offset(std::min(col + 1, m_columns - 1), std::min(row + 1, m_rows - 1)) >> (2 * kTileShift));
+    }
+}
+
+void HeightField::allocate(const UniformGrid& grid, double resolutionMm, SampleLayout layout)
+{
+    m_resolution = std::max(0.1, resolutionMm);
+    m_minX = grid.minX();
+    m_minY = grid.minY();
+    m_maxX = grid.maxX();
+    m_maxY = grid.maxY();
+
+    const double extentX = std::max(m_maxX - m_minX, m_resolution);
+    const double extentY = std::max(m_maxY - m_minY, m_resolution);
+
+    m_columns = latticeSize(extentX, m_resolution);
+    m_rows = latticeSize(extentY, m_resolution);
+    setLayout(layout);
+
+    m_lazy.reset();
+    m_samples.assign(storageSize(), kNan);
+    m_coverage.assign(storageSize(), 0);
+    m_mapping.reset();
+    resetEncoding();
+    m_sampleData = m_samples.data();
+    m_coverageData = m_coverage.data();
+}
+
+void HeightField::setLayout(SampleLayout layout) noexcept
+{
+    m_layout = layout;
+    m_tileColumns = (layout == SampleLayout::Tiled) ? (m_columns + kTileSize - 1) / kTileSize : 0;
+    m_tileRows = (layout == SampleLayout::Tiled) ? (m_rows + kTileSize - 1) / kTileSize : 0;
+}
+
+void HeightField::resetEncoding()
+{
+    m_encoding = SampleEncoding::Float64;
+    m_quantum = 0.0;
+    m_quantizedBase = 0.0;
+    m_codes16 = {};
+    m_codes32 = {};
+}
+
+template <typename Code>
+double HeightField::encodeSamples(std::vector<Code>& codes) const
+{
+    constexpr Code kUncovered = std::numeric_limits<Code>::min();
+    constexpr double kFirstCode = static_cast<double>(kUncovered) + 1.0;
+    codes.resize(storageSize());
+    double maxError = 0.0;
+    for (std::size_t i = 0; i < codes.size(); ++i)
+    {
+        const double z = m_sampleData[i];
+        if (std::isnan(z))
+        {
+            codes[i] = kUncovered;
+            continue;
+        }
+        const double steps = std::round((z - m_quantizedBase) / m_quantum);
+        codes[i] = static_cast<Code>(steps + kFirstCode);
+        maxError = std::max(maxError, std::abs(m_quantizedBase + steps * m_quantum - z));
+    }
+    return maxError;
+}
+
+bool HeightField::quantize(double quantumMm, BuildStats* stats)
+{
+    if (!m_valid || m_mapping || m_lazy || m_encoding != SampleEncoding::Float64 || !(quantumMm > 0.0))
+    {
+        return false;
+    }
+
+    double lowest = std::numeric_limits<double>::infinity();
+    double highest = -std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < storageSize(); ++i)
+    {
+        const double z = m_sampleData[i];
+        if (!std::isnan(z))
+        {
+            lowest = std::min(lowest, z);
+            highest = std::max(highest, z);
+        }
+    }
+    if (lowest > highest)
+    {
+        lowest = 0.0;
+        highest = 0.0;
+    }
+
+    // Every code but the sentinel is a Z step.
+    const double steps = std::round((highest - lowest) / quantumMm);
+    SampleEncoding encoding = SampleEncoding::Quantized16;
+    if (steps > 65534.0)
+    {
+        if (steps > 4294967294.0)
+        {
+            return false;
+        }
+        encoding = SampleEncoding::Quantized32;
+    }
+
+    m_quantum = quantumMm;
+    m_quantizedBase = lowest;
+    const double maxError = (encoding == SampleEncoding::Quantized16) ? encodeSamples(m_codes16)
+                                                                       : encodeSamples(m_codes32);
+    m_encoding = encoding;
+    m_samples = {};
+    m_coverage = {};
+    m_sampleData = nullptr;
+    m_coverageData = nullptr;
+
+    if (stats)
+    {
+        stats->quantizationError = maxError;
+    }
+    return true;
+}
+
 bool HeightField::sampleAt(std::size_t col, std::size_t row, double& zOut) const
 {
     if (!m_valid || col >= m_columns || row >= m_rows)
     {
         return false;
     }
+    return sampleAtIndex(offset(col, row), zOut);
+}
 
-    const double value = m_samples[offset(col, row)];
+bool HeightField::sampleAtIndex(std::size_t index, double& zOut) const
+{
+    if (m_lazy)
+    {
+        ensureTile(index >> (2 * kTileShift));
+    }
+    switch (m_encoding)
+    {
+    case SampleEncoding::Quantized16:
+        return decode(m_codes16[index], zOut);
+    case SampleEncoding::Quantized32:
+        return decode(m_codes32[index], zOut);
+    case SampleEncoding::Float64:
+        break;
+    }
+
+    const double value = m_sampleData[index];
     if (std::isnan(value))
     {
         return false;
@@ -320,7 +986,20 @@ bool HeightField::hasSample(std::size_t col, std::size_t row) const
     {
         return false;
     }
-    return m_coverage[offset(col, row)] != 0;
+    if (m_lazy)
+    {
+        ensureTile(offset(col, row) >> (2 * kTileShift));
+    }
+    switch (m_encoding)
+    {
+    case SampleEncoding::Quantized16:
+        return m_codes16[offset(col, row)] != std::numeric_limits<std::int16_t>::min();
+    case SampleEncoding::Quantized32:
+        return m_codes32[offset(col, row)] != std::numeric_limits<std::int32_t>::min();
+    case SampleEncoding::Float64:
+        break;
+    }
+    return m_coverageData[offset(col, row)] != 0;
 }
 
 bool HeightField::interpolate(double x, double y, double& zOut) const
@@ -363,8 +1042,13 @@ bool HeightField::interpolate(double x, double y, double& zOut) const
     double z01 = 0.0;
     double z11 = 0.0;
 
-    if (!sampleAt(ix, iy, z00) || !sampleAt(ix + 1, iy, z10) || !sampleAt(ix, iy + 1, z01)
-        || !sampleAt(ix + 1, iy + 1, z11))
+    // offset() is a sum of a column term and a row term in both layouts, so the diagonal neighbour is
+    // reached by adding both steps.
+    const std::size_t index = offset(ix, iy);
+    const std::size_t colStep = offset(ix + 1, iy) - index;
+    const std::size_t rowStep = offset(ix, iy + 1) - index;
+    if (!sampleAtIndex(index, z00) || !sampleAtIndex(index + colStep, z10) || !sampleAtIndex(index + rowStep, z01)
+        || !sampleAtIndex(index + colStep + rowStep, z11))
     {
         return false;
     }
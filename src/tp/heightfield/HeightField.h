@@ -5,7 +5,10 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <span>
 #include <vector>
 
 namespace tp::heightfield
@@ -19,15 +22,78 @@ public:
         double buildMilliseconds{0.0};
         std::size_t validSamples{0};
         std::size_t totalSamples{0};
+        // Largest |decoded - sampled| Z over covered samples after quantize(); 0 for Float64 storage.
+        double quantizationError{0.0};
+    };
+
+    enum class SampleLayout
+    {
+        RowMajor,
+        // kTileSize x kTileSize tiles in row-major tile order, each row-major inside. Neighbouring rows sit
+        // 512 bytes apart instead of a full lattice row, and a tile is the unit of the scan-converted build.
+        Tiled
+    };
+
+    static constexpr std::size_t kTileSize = 64;
+
+    enum class SampleEncoding
+    {
+        Float64,
+        // z = base + code * quantum; the lowest code of the type marks an uncovered sample.
+        Quantized16,
+        Quantized32
+    };
+
+    enum class BuildMode
+    {
+        // Query the grid once per lattice sample (gather candidates, sort by maxZ, barycentric test).
+        PointSampling,
+        // Walk each triangle once over the lattice samples it covers and keep the max Z per sample.
+        ScanConversion
     };
 
     HeightField() = default;
+    HeightField(const HeightField&) = delete;
+    HeightField& operator=(const HeightField&) = delete;
+    HeightField(HeightField&&) noexcept = default;
+    HeightField& operator=(HeightField&&) noexcept = default;
 
     bool build(const UniformGrid& grid,
                double resolutionMm,
                const std::atomic<bool>& cancelFlag,
-               BuildStats* stats = nullptr);
+               BuildStats* stats = nullptr,
+               BuildMode mode = BuildMode::PointSampling,
+               SampleLayout layout = SampleLayout::RowMajor);
+
+    // Sets up a tiled lattice and bins the triangles, but defers scan conversion: each tile is built
+    // the first time sampleAt(), hasSample() or interpolate() touches it, or by prefetch()/populate().
+    // Concurrent queries are safe; a tile is built once and other readers wait for it. The grid is
+    // kept alive for as long as the field.
+    bool buildLazy(std::shared_ptr<const UniformGrid> grid,
+                   double resolutionMm,
+                   const std::atomic<bool>& cancelFlag,
+                   BuildStats* stats = nullptr);
+    // True for fields set up by buildLazy(), including once every tile is built.
+    [[nodiscard]] bool isLazy() const noexcept { return m_lazy != nullptr; }
+    [[nodiscard]] std::size_t pendingTiles() const noexcept;
+    // Builds the tiles under the segment (x0, y0)-(x1, y1) ahead of the queries that will need them.
+    void prefetch(double x0, double y0, double x1, double y1) const;
+    // Builds every remaining tile in parallel. Returns false when cancelled before all tiles are built.
+    bool populate(const std::atomic<bool>& cancelFlag) const;
 
+    // Picks every factor-th sample of a finer field whose resolution divides resolutionMm by an integer
+    // factor >= 2. The coarse lattice points coincide with source samples, so no triangle is touched.
+    // The result keeps the source's layout. Returns false (and leaves the field invalid) when the factor
+    // is not integral.
+    bool downsample(const HeightField& source, double resolutionMm);
+
+    // Re-encodes the samples as integer steps of quantumMm above the lowest sample, rounding to nearest
+    // (error <= quantumMm / 2), and folds coverage into a sentinel code. Uses int16 when the Z range
+    // fits 65535 steps, int32 otherwise. samples() and coverageMask() are empty afterwards; sampleAt(),
+    // hasSample() and interpolate() decode on the fly. Returns false for invalid, mapped, lazy or already
+    // quantized fields, a non-positive quantum, or a range that does not fit int32.
+    bool quantize(double quantumMm, BuildStats* stats = nullptr);
+
     [[nodiscard]] bool isValid() const noexcept { return m_valid; }
     [[nodiscard]] double minX() const noexcept { return m_minX; }
     [[nodiscard]] double minY() const noexcept { return m_minY; }
@@ -36,16 +102,95 @@ public:
     [[nodiscard]] double resolution() const noexcept { return m_resolution; }
     [[nodiscard]] std::size_t columns() const noexcept { return m_columns; }
     [[nodiscard]] std::size_t rows() const noexcept { return m_rows; }
+    [[nodiscard]] SampleLayout layout() const noexcept { return m_layout; }
+    [[nodiscard]] SampleEncoding encoding() const noexcept { return m_encoding; }
+    // Z step of the quantized encoding; 0 for Float64 storage.
+    [[nodiscard]] double quantum() const noexcept { return m_quantum; }
 
     [[nodiscard]] bool interpolate(double x, double y, double& zOut) const;
     [[nodiscard]] bool sampleAt(std::size_t col, std::size_t row, double& zOut) const;
     [[nodiscard]] bool hasSample(std::size_t col, std::size_t row) const;
-    [[nodiscard]] const std::vector<std::uint8_t>& coverageMask() const noexcept { return m_coverage; }
+    // Sample and coverage arrays in storage order (see layout()); samples are NaN where the mesh does not
+    // cover the lattice, including the padding of partial tiles, and in tiles a lazy field has not built
+    // yet. Both are empty for quantized fields.
+    [[nodiscard]] std::span<const double> samples() const noexcept
+    {
+        return {m_sampleData, m_sampleData ? storageSize() : 0};
+    }
+    [[nodiscard]] std::span<const std::uint8_t> coverageMask() const noexcept
+    {
+        return {m_coverageData, m_coverageData ? storageSize() : 0};
+    }
+    // Samples held in storage, including tile padding.
+    [[nodiscard]] std::size_t storageSize() const noexcept
+    {
+        return (m_layout == SampleLayout::Tiled) ? m_tileColumns * m_tileRows * kTileSize * kTileSize
+                                                 : m_columns * m_rows;
+    }
+    [[nodiscard]] std::size_t memoryBytes() const noexcept
+    {
+        switch (m_encoding)
+        {
+        case SampleEncoding::Quantized16:
+            return m_codes16.size() * sizeof(std::int16_t);
+        case SampleEncoding::Quantized32:
+            return m_codes32.size() * sizeof(std::int32_t);
+        case SampleEncoding::Float64:
+            break;
+        }
+        return storageSize() * (sizeof(double) + sizeof(std::uint8_t));
+    }
+    // True when the arrays live in a read-only mapping owned by HeightFieldDiskCache.
+    [[nodiscard]] bool isMapped() const noexcept { return m_mapping != nullptr; }
 
 private:
+    friend class HeightFieldDiskCache;
+
+    static constexpr std::size_t kTileShift = 6;
+    static constexpr std::size_t kTileMask = kTileSize - 1;
+    static_assert(kTileSize == std::size_t{1} << kTileShift);
+
     inline std::size_t offset(std::size_t col, std::size_t row) const noexcept
     {
-        return row * m_columns + col;
+        if (m_layout == SampleLayout::RowMajor)
+        {
+            return row * m_columns + col;
+        }
+        const std::size_t tile = (row >> kTileShift) * m_tileColumns + (col >> kTileShift);
+        return (tile << (2 * kTileShift)) + ((row & kTileMask) << kTileShift) + (col & kTileMask);
+    }
+
+    struct LazyTiles;
+
+    void allocate(const UniformGrid& grid, double resolutionMm, SampleLayout layout);
+    void setLayout(SampleLayout layout) noexcept;
+    void ensureTile(std::size_t tile) const;
+    bool buildTile(std::size_t tile, const std::atomic<bool>* cancelFlag) const;
+    // sampleAt() without the bounds check, for a storage index from offset().
+    bool sampleAtIndex(std::size_t index, double& zOut) const;
+
+    std::size_t samplePoints(const UniformGrid& grid,
+                             std::size_t effectiveThreads,
+                             const std::atomic<bool>& cancelFlag);
+    std::size_t scanConvert(const UniformGrid& grid,
+                            std::size_t effectiveThreads,
+                            const std::atomic<bool>& cancelFlag);
+
+    void resetEncoding();
+    // Fills codes from the Float64 samples; returns the largest rounding error.
+    template <typename Code>
+    double encodeSamples(std::vector<Code>& codes) const;
+
+    template <typename Code>
+    bool decode(Code code, double& zOut) const noexcept
+    {
+        constexpr Code kUncovered = std::numeric_limits<Code>::min();
+        if (code == kUncovered)
+        {
+            return false;
+        }
+        zOut = m_quantizedBase + (static_cast<double>(code) - (static_cast<double>(kUncovered) + 1.0)) * m_quantum;
+        return true;
     }
 
     double m_minX{0.0};
@@ -56,9 +201,24 @@ private:
     std::size_t m_columns{0};
     std::size_t m_rows{0};
     bool m_valid{false};
+    SampleLayout m_layout{SampleLayout::RowMajor};
+    std::size_t m_tileColumns{0};
+    std::size_t m_tileRows{0};
 
     std::vector<double> m_samples;
     std::vector<std::uint8_t> m_coverage;
+
+    SampleEncoding m_encoding{SampleEncoding::Float64};
+    double m_quantum{0.0};
+    double m_quantizedBase{0.0};
+    std::vector<std::int16_t> m_codes16;
+    std::vector<std::int32_t> m_codes32;
+
+    // Point at m_samples/m_coverage after build(), or into m_mapping for fields loaded from disk.
+    const double* m_sampleData{nullptr};
+    const std::uint8_t* m_coverageData{nullptr};
+    std::shared_ptr<const void> m_mapping;
+    std::shared_ptr<LazyTiles> m_lazy;
 };
 
 } // namespace tp::heightfield
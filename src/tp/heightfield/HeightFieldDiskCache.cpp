@@ -0,0 +1,468 @@
+#include "tp/heightfield/HeightFieldDiskCache.h"
+
+#include "common/log.h"
+#include "render/Model.h"
+#include "tp/TriangleGrid.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QByteArrayView>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QString>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace tp::heightfield
+{
+
+namespace
+{
+
+constexpr std::array<char, 8> kMagic{'C', 'N', 'C', 'T', 'C', 'H', 'F', 'C'};
+constexpr std::uint32_t kFormatVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304u;
+constexpr std::uint64_t kPayloadAlignment = 64;
+constexpr const char* kEntryExtension = ".hfc";
+
+// Samples depend on the triangle storage precision, so entries from the other precision are misses.
+constexpr std::uint32_t kStorageFlags = std::is_same_v<TriangleGrid::Real, float> ? 1u : 0u;
+
+struct FileHeader
+{
+    std::array<char, 8> magic{};
+    std::uint32_t version{0};
+    std::uint32_t byteOrderMark{0};
+    std::uint32_t headerBytes{0};
+    std::uint32_t storageFlags{0};
+    HeightFieldDiskCache::MeshHash meshHash{};
+    // HeightField::SampleLayout; entries written before tiling have 0 (row-major) here.
+    std::uint32_t layout{0};
+    double resolution{0.0};
+    double minX{0.0};
+    double minY{0.0};
+    double maxX{0.0};
+    double maxY{0.0};
+    std::uint64_t columns{0};
+    std::uint64_t rows{0};
+    std::uint64_t sampleOffset{0};
+    std::uint64_t coverageOffset{0};
+    std::uint64_t fileBytes{0};
+};
+static_assert(std::is_trivially_copyable_v<FileHeader>);
+static_assert(sizeof(FileHeader) % 8 == 0);
+
+constexpr std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Read-only view of a whole file. Pages are only read when touched.
+class MappedFile
+{
+public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+    }
+
+    static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileW(path.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+        {
+            return nullptr;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view)
+        {
+            return nullptr;
+        }
+        return std::shared_ptr<const MappedFile>(
+            new MappedFile(static_cast<const std::byte*>(view), static_cast<std::size_t>(size.QuadPart)));
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        const auto size = static_cast<std::size_t>(info.st_size);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        return std::shared_ptr<const MappedFile>(new MappedFile(static_cast<const std::byte*>(view), size));
+#endif
+    }
+
+    [[nodiscard]] const std::byte* data() const noexcept { return m_data; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+private:
+    MappedFile(const std::byte* data, std::size_t size)
+        : m_data(data)
+        , m_size(size)
+    {
+    }
+
+    const std::byte* m_data{nullptr};
+    std::size_t m_size{0};
+};
+
+QString toQString(const std::filesystem::path& path)
+{
+#if defined(_WIN32)
+    return QString::fromStdWString(path.wstring());
+#else
+    return QString::fromStdString(path.string());
+#endif
+}
+
+std::filesystem::path temporaryPathFor(const std::filesystem::path& target)
+{
+    static std::atomic<std::uint64_t> counter{0};
+    const auto stamp = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto thread = static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    std::filesystem::path temp = target;
+    temp += ".tmp-" + std::to_string(stamp ^ thread) + "-" + std::to_string(counter.fetch_add(1));
+    return temp;
+}
+
+std::uint64_t evictDirectory(const std::filesystem::path& directory, std::uint64_t maxBytes)
+{
+    struct Candidate
+    {
+        std::filesystem::file_time_type lastUsed;
+        std::uint64_t bytes{0};
+        std::filesystem::path path;
+    };
+
+    std::error_code ec;
+    std::vector<Candidate> candidates;
+    std::uint64_t totalBytes = 0;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() != kEntryExtension || !it->is_regular_file(ec))
+        {
+            continue;
+        }
+        Candidate candidate;
+        candidate.bytes = it->file_size(ec);
+        candidate.lastUsed = it->last_write_time(ec);
+        if (ec)
+        {
+            ec.clear();
+            continue;
+        }
+        candidate.path = it->path();
+        totalBytes += candidate.bytes;
+        candidates.push_back(std::move(candidate));
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+        return lhs.lastUsed < rhs.lastUsed;
+    });
+
+    std::uint64_t freed = 0;
+    for (const Candidate& candidate : candidates)
+    {
+        if (totalBytes <= maxBytes)
+        {
+            break;
+        }
+        if (std::filesystem::remove(candidate.path, ec))
+        {
+            totalBytes -= candidate.bytes;
+            freed += candidate.bytes;
+        }
+        ec.clear();
+    }
+    return freed;
+}
+
+} // namespace
+
+HeightFieldDiskCache& HeightFieldDiskCache::instance()
+{
+    static HeightFieldDiskCache cache;
+    return cache;
+}
+
+void HeightFieldDiskCache::configure(std::filesystem::path directory, std::uint64_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    m_directory = std::move(directory);
+    m_maxBytes = maxBytes;
+}
+
+bool HeightFieldDiskCache::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return !m_directory.empty() && m_maxBytes > 0;
+}
+
+std::filesystem::path HeightFieldDiskCache::directory() const
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return m_directory;
+}
+
+std::uint64_t HeightFieldDiskCache::maxBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return m_maxBytes;
+}
+
+HeightFieldDiskCache::MeshHash HeightFieldDiskCache::hashMesh(const render::Model& model)
+{
+    const auto& vertices = model.vertices();
+    const auto& indices = model.indices();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const std::uint64_t counts[2] = {vertices.size(), indices.size()};
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(counts), sizeof(counts)));
+
+    // Positions are packed into a flat float buffer so padding inside Vertex never reaches the hash.
+    constexpr std::size_t kChunkVertices = 4096;
+    std::vector<float> chunk;
+    chunk.reserve(kChunkVertices * 3);
+    for (std::size_t begin = 0; begin < vertices.size(); begin += kChunkVertices)
+    {
+        const std::size_t end = std::min(vertices.size(), begin + kChunkVertices);
+        chunk.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const auto& position = vertices[i].position;
+            chunk.push_back(position.x());
+            chunk.push_back(position.y());
+            chunk.push_back(position.z());
+        }
+        hash.addData(QByteArrayView(reinterpret_cast<const char*>(chunk.data()),
+                                    static_cast<qsizetype>(chunk.size() * sizeof(float))));
+    }
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(indices.data()),
+                                static_cast<qsizetype>(indices.size() * sizeof(render::Model::Index))));
+
+    const QByteArray digest = hash.result();
+    MeshHash result{};
+    std::memcpy(result.data(), digest.constData(), std::min<std::size_t>(result.size(), digest.size()));
+    return result;
+}
+
+std::filesystem::path HeightFieldDiskCache::entryPath(const MeshHash& hash, double resolution) const
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string name;
+    name.reserve(hash.size() * 2 + 24);
+    for (const std::uint8_t byte : hash)
+    {
+        name.push_back(kHex[byte >> 4]);
+        name.push_back(kHex[byte & 0x0f]);
+    }
+    // Resolution in nanometres keeps the name exact for any resolution the generator picks.
+    name += "-" + std::to_string(std::llround(resolution * 1e6)) + kEntryExtension;
+    return directory() / name;
+}
+
+std::shared_ptr<HeightField> HeightFieldDiskCache::load(const MeshHash& hash, double resolution) const
+{
+    if (!isEnabled())
+    {
+        return nullptr;
+    }
+
+    const std::filesystem::path path = entryPath(hash, resolution);
+    auto mapping = MappedFile::open(path);
+    if (!mapping || mapping->size() < sizeof(FileHeader))
+    {
+        return nullptr;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, mapping->data(), sizeof(FileHeader));
+    const bool tiled = header.layout == static_cast<std::uint32_t>(HeightField::SampleLayout::Tiled);
+    // Bounded dimensions keep the sample count below 2^62.
+    constexpr std::uint64_t kMaxDimension = std::uint64_t{1} << 31;
+    const std::uint64_t tile = HeightField::kTileSize;
+    const std::uint64_t sampleCount = tiled ? ((header.columns + tile - 1) / tile) * ((header.rows + tile - 1) / tile)
+                                                  * tile * tile
+                                            : header.columns * header.rows;
+    if (header.magic != kMagic || header.version != kFormatVersion || header.byteOrderMark != kByteOrderMark
+        || header.headerBytes != sizeof(FileHeader) || header.storageFlags != kStorageFlags
+        || header.meshHash != hash || std::abs(header.resolution - resolution) > 1e-9
+        || header.fileBytes != mapping->size() || header.columns < 2 || header.rows < 2
+        || (!tiled && header.layout != static_cast<std::uint32_t>(HeightField::SampleLayout::RowMajor))
+        || header.columns >= kMaxDimension || header.rows >= kMaxDimension || sampleCount > header.fileBytes
+        || header.sampleOffset % kPayloadAlignment != 0
+        || header.sampleOffset < sizeof(FileHeader)
+        || header.coverageOffset < header.sampleOffset + sampleCount * sizeof(double)
+        || header.coverageOffset + sampleCount > header.fileBytes)
+    {
+        return nullptr;
+    }
+
+    auto field = std::make_shared<HeightField>();
+    field->m_minX = header.minX;
+    field->m_minY = header.minY;
+    field->m_maxX = header.maxX;
+    field->m_maxY = header.maxY;
+    field->m_resolution = header.resolution;
+    field->m_columns = static_cast<std::size_t>(header.columns);
+    field->m_rows = static_cast<std::size_t>(header.rows);
+    field->setLayout(tiled ? HeightField::SampleLayout::Tiled : HeightField::SampleLayout::RowMajor);
+    field->m_sampleData = reinterpret_cast<const double*>(mapping->data() + header.sampleOffset);
+    field->m_coverageData = reinterpret_cast<const std::uint8_t*>(mapping->data() + header.coverageOffset);
+    field->m_mapping = std::move(mapping);
+    field->m_valid = true;
+
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    return field;
+}
+
+bool HeightFieldDiskCache::store(const MeshHash& hash, double resolution, const HeightField& field)
+{
+    if (!isEnabled() || !field.isValid() || field.isLazy()
+        || field.encoding() != HeightField::SampleEncoding::Float64)
+    {
+        return false;
+    }
+
+    FileHeader header;
+    header.magic = kMagic;
+    header.version = kFormatVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.headerBytes = sizeof(FileHeader);
+    header.storageFlags = kStorageFlags;
+    header.meshHash = hash;
+    header.resolution = resolution;
+    header.minX = field.minX();
+    header.minY = field.minY();
+    header.maxX = field.maxX();
+    header.maxY = field.maxY();
+    header.columns = field.columns();
+    header.rows = field.rows();
+    header.layout = static_cast<std::uint32_t>(field.layout());
+    header.sampleOffset = alignUp(sizeof(FileHeader), kPayloadAlignment);
+    const std::span<const double> samples = field.samples();
+    const std::span<const std::uint8_t> coverage = field.coverageMask();
+    header.coverageOffset = header.sampleOffset + samples.size_bytes();
+    header.fileBytes = header.coverageOffset + coverage.size_bytes();
+
+    const std::uint64_t budget = maxBytes();
+    if (header.fileBytes > budget)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    const std::filesystem::path target = entryPath(hash, resolution);
+    std::error_code ec;
+    std::filesystem::create_directories(target.parent_path(), ec);
+    if (ec)
+    {
+        LOG_WARN(Tp, QStringLiteral("Height field disk cache: cannot create %1 (%2)")
+                         .arg(toQString(target.parent_path()))
+                         .arg(QString::fromStdString(ec.message())));
+        return false;
+    }
+
+    const std::filesystem::path temp = temporaryPathFor(target);
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        const std::array<char, kPayloadAlignment> padding{};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        out.write(padding.data(), static_cast<std::streamsize>(header.sampleOffset - sizeof(FileHeader)));
+        out.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size_bytes()));
+        out.write(reinterpret_cast<const char*>(coverage.data()), static_cast<std::streamsize>(coverage.size_bytes()));
+        out.close();
+        if (!out)
+        {
+            std::filesystem::remove(temp, ec);
+            LOG_WARN(Tp, QStringLiteral("Height field disk cache: failed to write %1")
+                             .arg(toQString(temp)));
+            return false;
+        }
+    }
+
+    // Another process may have published the same entry meanwhile; either copy is equivalent.
+    std::filesystem::rename(temp, target, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+
+    evictDirectory(target.parent_path(), budget);
+    return true;
+}
+
+std::uint64_t HeightFieldDiskCache::evict()
+{
+    if (!isEnabled())
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    return evictDirectory(directory(), maxBytes());
+}
+
+} // namespace tp::heightfield
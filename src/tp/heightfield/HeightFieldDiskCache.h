@@ -0,0 +1,68 @@
+#pragma once
+
+#include "tp/heightfield/HeightField.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+namespace render
+{
+class Model;
+}
+
+namespace tp::heightfield
+{
+
+// Content-addressed height fields on disk. Each entry is one file keyed by a hash of the mesh and the
+// lattice resolution: a fixed header followed by the sample and coverage arrays in the in-memory
+// layout. load() maps the file read-only, so opening even a 4000x4000 field costs a header check and
+// pages are faulted in as the raster touches them. The directory is kept under a byte budget by
+// evicting the least recently used entries.
+class HeightFieldDiskCache
+{
+public:
+    using MeshHash = std::array<std::uint8_t, 20>;
+
+    static constexpr std::uint64_t kDefaultMaxBytes = std::uint64_t{2} << 30;
+
+    HeightFieldDiskCache() = default;
+
+    // Process-wide cache used by ToolpathGenerator; disabled until configure() names a directory.
+    static HeightFieldDiskCache& instance();
+
+    // An empty directory disables the cache. The directory is created on the first store().
+    void configure(std::filesystem::path directory, std::uint64_t maxBytes = kDefaultMaxBytes);
+    [[nodiscard]] bool isEnabled() const;
+    [[nodiscard]] std::filesystem::path directory() const;
+    [[nodiscard]] std::uint64_t maxBytes() const;
+
+    // SHA-1 over vertex positions and indices; normals do not affect the height field.
+    [[nodiscard]] static MeshHash hashMesh(const render::Model& model);
+
+    // Maps the entry for (hash, resolution). Returns nullptr when the entry is missing, was written by an
+    // incompatible build, or fails validation. A hit marks the entry as recently used.
+    [[nodiscard]] std::shared_ptr<HeightField> load(const MeshHash& hash, double resolution) const;
+
+    // Writes the field through a temporary file and renames it into place, then evicts entries until the
+    // directory fits the budget. Fields larger than the whole budget, quantized and lazy fields are not
+    // stored.
+    bool store(const MeshHash& hash, double resolution, const HeightField& field);
+
+    // Removes least recently used entries until the cache fits maxBytes(); returns the bytes freed.
+    // Entries that cannot be removed (e.g. still mapped on Windows) are skipped.
+    std::uint64_t evict();
+
+    [[nodiscard]] std::filesystem::path entryPath(const MeshHash& hash, double resolution) const;
+
+private:
+    mutable std::mutex m_configMutex;
+    std::mutex m_writeMutex;
+    std::filesystem::path m_directory;
+    std::uint64_t m_maxBytes{kDefaultMaxBytes};
+};
+
+} // namespace tp::heightfield
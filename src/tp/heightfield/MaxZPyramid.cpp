@@ -0,0 +1,273 @@
+#include "tp/heightfield/MaxZPyramid.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace tp::heightfield
+{
+
+namespace
+{
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// Descent keeps at most the initial blocks plus three siblings per level on the stack; the start level
+// is chosen so the disc spans no more than 6x6 blocks.
+constexpr std::size_t kMaxStack = 256;
+
+struct Node
+{
+    std::size_t level{0};
+    std::size_t col{0};
+    std::size_t row{0};
+    double bound{0.0};
+};
+
+} // namespace
+
+MaxZPyramid::MaxZPyramid(const HeightField& field)
+{
+    build(field);
+}
+
+void MaxZPyramid::build(const HeightField& field)
+{
+    m_levels.clear();
+    if (!field.isValid() || field.columns() == 0 || field.rows() == 0)
+    {
+        return;
+    }
+
+    m_minX = field.minX();
+    m_minY = field.minY();
+    m_resolution = field.resolution();
+
+    Level base;
+    base.columns = field.columns();
+    base.rows = field.rows();
+    base.maxZ.resize(base.columns * base.rows);
+    for (std::size_t row = 0; row < base.rows; ++row)
+    {
+        for (std::size_t col = 0; col < base.columns; ++col)
+        {
+            double z = 0.0;
+            base.maxZ[row * base.columns + col] = field.sampleAt(col, row, z) ? z : -kInf;
+        }
+    }
+    m_levels.push_back(std::move(base));
+
+    while (m_levels.back().columns > 1 || m_levels.back().rows > 1)
+    {
+        const Level& below = m_levels.back();
+        const bool belowIsBase = m_levels.size() == 1;
+
+        Level next;
+        next.columns = (below.columns + 1) / 2;
+        next.rows = (below.rows + 1) / 2;
+        next.maxZ.assign(next.columns * next.rows, -kInf);
+        next.minZ.assign(next.columns * next.rows, kInf);
+
+        for (std::size_t row = 0; row < below.rows; ++row)
+        {
+            for (std::size_t col = 0; col < below.columns; ++col)
+            {
+                const std::size_t src = row * below.columns + col;
+                const double hi = below.maxZ[src];
+                if (hi == -kInf)
+                {
+                    continue;
+                }
+                const double lo = belowIsBase ? hi : below.minZ[src];
+                const std::size_t dst = (row / 2) * next.columns + (col / 2);
+                next.maxZ[dst] = std::max(next.maxZ[dst], hi);
+                next.minZ[dst] = std::min(next.minZ[dst], lo);
+            }
+        }
+        m_levels.push_back(std::move(next));
+    }
+}
+
+std::size_t MaxZPyramid::memoryBytes() const noexcept
+{
+    std::size_t bytes = 0;
+    for (const Level& level : m_levels)
+    {
+        bytes += (level.maxZ.size() + level.minZ.size()) * sizeof(double);
+    }
+    return bytes;
+}
+
+bool MaxZPyramid::blockRange(std::size_t level, std::size_t col, std::size_t row, double& minZ, double& maxZ) const
+{
+    if (level >= m_levels.size())
+    {
+        return false;
+    }
+    const Level& lvl = m_levels[level];
+    if (col >= lvl.columns || row >= lvl.rows)
+    {
+        return false;
+    }
+    const std::size_t index = row * lvl.columns + col;
+    if (lvl.maxZ[index] == -kInf)
+    {
+        return false;
+    }
+    maxZ = lvl.maxZ[index];
+    minZ = (level == 0) ? maxZ : lvl.minZ[index];
+    return true;
+}
+
+bool MaxZPyramid::dropCutter(double x, double y, double radius, Footprint footprint, double& zOut) const
+{
+    if (m_levels.empty() || !(radius >= 0.0) || !std::isfinite(x) || !std::isfinite(y))
+    {
+        return false;
+    }
+
+    const Level& base = m_levels.front();
+    const double r2 = radius * radius;
+    const double invResolution = 1.0 / m_resolution;
+
+    // Lattice samples inside the disc's bounding box.
+    const double colLo = std::ceil((x - radius - m_minX) * invResolution);
+    const double colHi = std::floor((x + radius - m_minX) * invResolution);
+    const double rowLo = std::ceil((y - radius - m_minY) * invResolution);
+    const double rowHi = std::floor((y + radius - m_minY) * invResolution);
+    const double lastCol = static_cast<double>(base.columns - 1);
+    const double lastRow = static_cast<double>(base.rows - 1);
+    if (colHi < 0.0 || rowHi < 0.0 || colLo > lastCol || rowLo > lastRow || colLo > colHi || rowLo > rowHi)
+    {
+        return false;
+    }
+    const std::size_t sampleCol0 = static_cast<std::size_t>(std::max(0.0, colLo));
+    const std::size_t sampleCol1 = static_cast<std::size_t>(std::min(lastCol, colHi));
+    const std::size_t sampleRow0 = static_cast<std::size_t>(std::max(0.0, rowLo));
+    const std::size_t sampleRow1 = static_cast<std::size_t>(std::min(lastRow, rowHi));
+
+    // Start at the coarsest level whose blocks are no wider than the radius.
+    std::size_t startLevel = 0;
+    while (startLevel + 1 < m_levels.size()
+           && static_cast<double>(std::size_t{1} << (startLevel + 1)) * m_resolution <= radius)
+    {
+        ++startLevel;
+    }
+
+    const bool ball = footprint == Footprint::Ball;
+    double best = -kInf;
+    // Lower bound from blocks lying fully inside the disc; prunes without being returned itself.
+    double floorZ = -kInf;
+
+    // Upper bound for a block, or -inf if the block is outside the disc or empty. Level-0 blocks are a
+    // single sample, so the bound is the exact footprint height there.
+    const auto evaluate = [&](std::size_t level, std::size_t col, std::size_t row) -> double {
+        const Level& lvl = m_levels[level];
+        const std::size_t index = row * lvl.columns + col;
+        const double hi = lvl.maxZ[index];
+        if (hi == -kInf)
+        {
+            return -kInf;
+        }
+
+        const std::size_t c0 = col << level;
+        const std::size_t r0 = row << level;
+        const std::size_t c1 = std::min(base.columns, (col + 1) << level) - 1;
+        const std::size_t r1 = std::min(base.rows, (row + 1) << level) - 1;
+        const double x0 = m_minX + static_cast<double>(c0) * m_resolution;
+        const double x1 = m_minX + static_cast<double>(c1) * m_resolution;
+        const double y0 = m_minY + static_cast<double>(r0) * m_resolution;
+        const double y1 = m_minY + static_cast<double>(r1) * m_resolution;
+
+        const double nearDx = std::clamp(x, x0, x1) - x;
+        const double nearDy = std::clamp(y, y0, y1) - y;
+        const double nearD2 = nearDx * nearDx + nearDy * nearDy;
+        if (nearD2 > r2)
+        {
+            return -kInf;
+        }
+
+        if (level > 0)
+        {
+            const double farDx = std::max(x - x0, x1 - x);
+            const double farDy = std::max(y - y0, y1 - y);
+            const double farD2 = farDx * farDx + farDy * farDy;
+            if (farD2 <= r2)
+            {
+                const double lo = lvl.minZ[index];
+                floorZ = std::max(floorZ, ball ? lo + std::sqrt(r2 - farD2) : lo);
+            }
+        }
+
+        return ball ? hi + std::sqrt(r2 - nearD2) : hi;
+    };
+
+    std::array<Node, kMaxStack> stack;
+    std::size_t stackSize = 0;
+    const auto push = [&](std::size_t level, std::size_t col, std::size_t row) {
+        const double bound = evaluate(level, col, row);
+        if (bound == -kInf || bound < floorZ || bound <= best)
+        {
+            return;
+        }
+        if (level == 0)
+        {
+            best = bound;
+            return;
+        }
+        assert(stackSize < kMaxStack);
+        stack[stackSize++] = Node{level, col, row, bound};
+    };
+
+    for (std::size_t row = sampleRow0 >> startLevel; row <= (sampleRow1 >> startLevel); ++row)
+    {
+        for (std::size_t col = sampleCol0 >> startLevel; col <= (sampleCol1 >> startLevel); ++col)
+        {
+            push(startLevel, col, row);
+        }
+    }
+
+    while (stackSize > 0)
+    {
+        const Node node = stack[--stackSize];
+        if (node.bound < floorZ || node.bound <= best)
+        {
+            continue;
+        }
+
+        const std::size_t childLevel = node.level - 1;
+        const Level& lvl = m_levels[childLevel];
+        const std::size_t firstChild = stackSize;
+        for (std::size_t dy = 0; dy < 2; ++dy)
+        {
+            const std::size_t row = node.row * 2 + dy;
+            if (row >= lvl.rows)
+            {
+                continue;
+            }
+            for (std::size_t dx = 0; dx < 2; ++dx)
+            {
+                const std::size_t col = node.col * 2 + dx;
+                if (col < lvl.columns)
+                {
+                    push(childLevel, col, row);
+                }
+            }
+        }
+        // Visit the most promising child first so the others are more likely to be pruned.
+        std::sort(stack.begin() + static_cast<std::ptrdiff_t>(firstChild),
+                  stack.begin() + static_cast<std::ptrdiff_t>(stackSize),
+                  [](const Node& lhs, const Node& rhs) { return lhs.bound < rhs.bound; });
+    }
+
+    if (best == -kInf)
+    {
+        return false;
+    }
+    zOut = best;
+    return true;
+}
+
+} // namespace tp::heightfield
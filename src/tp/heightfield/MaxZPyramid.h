@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tp/heightfield/HeightField.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace tp::heightfield
+{
+
+// Min/max mip pyramid over a HeightField lattice. Level 0 holds the samples; each level above holds the
+// min and max of a 2x2 block of the level below. Footprint queries descend only into blocks that can
+// still beat the best height found so far, so a drop-cutter query costs roughly the same for any tool
+// radius instead of O(r^2) samples.
+class MaxZPyramid
+{
+public:
+    enum class Footprint
+    {
+        // Flat end mill: the tip rests on the highest sample under the disc.
+        Flat,
+        // Ball end mill: the centre rests at max(z + sqrt(r^2 - d^2)) over the disc.
+        Ball
+    };
+
+    MaxZPyramid() = default;
+    explicit MaxZPyramid(const HeightField& field);
+
+    void build(const HeightField& field);
+
+    [[nodiscard]] bool isValid() const noexcept { return !m_levels.empty(); }
+    [[nodiscard]] std::size_t levelCount() const noexcept { return m_levels.size(); }
+    [[nodiscard]] std::size_t memoryBytes() const noexcept;
+
+    // Min/max over the samples of block (col, row) at the given level. Returns false for blocks without
+    // covered samples.
+    [[nodiscard]] bool blockRange(std::size_t level, std::size_t col, std::size_t row, double& minZ, double& maxZ) const;
+
+    // Drops a cutter of the given radius onto the lattice samples at (x, y). For Flat zOut is the tip Z;
+    // for Ball it is the ball centre Z (tip Z + radius), matching cutterOffsetFor(). Uncovered samples
+    // are ignored; returns false when the disc contains no covered sample.
+    [[nodiscard]] bool dropCutter(double x, double y, double radius, Footprint footprint, double& zOut) const;
+
+private:
+    struct Level
+    {
+        std::size_t columns{0};
+        std::size_t rows{0};
+        // -inf / +inf mark blocks without covered samples. minZ is left empty on level 0, where it
+        // equals maxZ for covered samples.
+        std::vector<double> maxZ;
+        std::vector<double> minZ;
+    };
+
+    double m_minX{0.0};
+    double m_minY{0.0};
+    double m_resolution{1.0};
+    std::vector<Level> m_levels;
+};
+
+} // namespace tp::heightfield
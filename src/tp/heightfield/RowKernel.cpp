@@ -0,0 +1,406 @@
+#include "tp/heightfield/RowKernel.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define TP_ROW_KERNEL_SSE2 1
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#    endif
+#else
+#    define TP_ROW_KERNEL_SSE2 0
+#endif
+
+// GCC/Clang only emit AVX2 code inside functions marked for it; MSVC accepts the intrinsics anywhere.
+#if TP_ROW_KERNEL_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#    define TP_ROW_KERNEL_AVX2 1
+#    define TP_TARGET_AVX2 __attribute__((target("avx2")))
+#elif TP_ROW_KERNEL_SSE2 && defined(_MSC_VER)
+#    define TP_ROW_KERNEL_AVX2 1
+#    define TP_TARGET_AVX2
+#else
+#    define TP_ROW_KERNEL_AVX2 0
+#endif
+
+namespace tp::heightfield
+{
+
+namespace
+{
+
+// Row-invariant parts of the per-sample test, hoisted out of the lane loop.
+struct RowConstants
+{
+    double dySq{0.0};
+    double radiusLimit{0.0};
+    double minXLimit{0.0};
+    double maxXLimit{0.0};
+    double minZLimit{0.0};
+    double maxZLimit{0.0};
+    double slopeYTerm{0.0};
+    double py{0.0};
+    double pyEdge0X{0.0};
+    double pyEdge1X{0.0};
+    double baryLow{0.0};
+    double baryHigh{0.0};
+};
+
+// Returns false when no sample of the row can hit the triangle.
+bool prepareRow(const RowTriangle& tri, const RowSample& row, RowConstants& out)
+{
+    if (!tri.valid)
+    {
+        return false;
+    }
+    if (row.y < tri.minY - row.eps || row.y > tri.maxY + row.eps)
+    {
+        return false;
+    }
+
+    const double dy = row.y - tri.centroidY;
+    out.dySq = dy * dy;
+    out.radiusLimit = tri.boundingRadiusSq + row.eps;
+    if (out.dySq > out.radiusLimit)
+    {
+        return false;
+    }
+
+    out.minXLimit = tri.minX - row.eps;
+    out.maxXLimit = tri.maxX + row.eps;
+    out.minZLimit = tri.minZ - row.eps;
+    out.maxZLimit = tri.maxZ + row.eps;
+    out.py = row.y - tri.originY;
+    out.slopeYTerm = tri.slopeY * out.py;
+    out.pyEdge0X = out.py * tri.edge0X;
+    out.pyEdge1X = out.py * tri.edge1X;
+    out.baryLow = -row.barycentricEps;
+    out.baryHigh = 1.0 + row.barycentricEps;
+    return true;
+}
+
+inline void sampleLane(const RowTriangle& tri, const RowConstants& rc, double x, double& zSlot)
+{
+    const double dx = x - tri.centroidX;
+    if ((dx * dx + rc.dySq) > rc.radiusLimit || x < rc.minXLimit || x > rc.maxXLimit)
+    {
+        return;
+    }
+
+    const double px = x - tri.originX;
+    const double z = tri.slopeX * px + rc.slopeYTerm + tri.originZ;
+    if (!(z >= rc.minZLimit && z <= rc.maxZLimit))
+    {
+        return;
+    }
+
+    const double v = (px * tri.edge1Y - rc.pyEdge1X) * tri.invDet;
+    const double w = (rc.pyEdge0X - px * tri.edge0Y) * tri.invDet;
+    const double u = 1.0 - v - w;
+    if (u < rc.baryLow || v < rc.baryLow || w < rc.baryLow || u > rc.baryHigh || v > rc.baryHigh
+        || w > rc.baryHigh)
+    {
+        return;
+    }
+
+    if (!(zSlot >= z))
+    {
+        zSlot = z;
+    }
+}
+
+void rowKernelScalar(const RowTriangle& tri, const RowSample& row, std::size_t begin, std::size_t end, double* zRow)
+{
+    RowConstants rc;
+    if (!prepareRow(tri, row, rc))
+    {
+        return;
+    }
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        sampleLane(tri, rc, row.x0 + static_cast<double>(i) * row.dx, zRow[i]);
+    }
+}
+
+#if TP_ROW_KERNEL_SSE2
+void rowKernelSse2(const RowTriangle& tri, const RowSample& row, std::size_t begin, std::size_t end, double* zRow)
+{
+    RowConstants rc;
+    if (!prepareRow(tri, row, rc))
+    {
+        return;
+    }
+
+    const __m128d x0 = _mm_set1_pd(row.x0);
+    const __m128d stepDx = _mm_set1_pd(row.dx);
+    const __m128d laneOffsets = _mm_set_pd(1.0, 0.0);
+    const __m128d centroidX = _mm_set1_pd(tri.centroidX);
+    const __m128d dySq = _mm_set1_pd(rc.dySq);
+    const __m128d radiusLimit = _mm_set1_pd(rc.radiusLimit);
+    const __m128d minXLimit = _mm_set1_pd(rc.minXLimit);
+    const __m128d maxXLimit = _mm_set1_pd(rc.maxXLimit);
+    const __m128d slopeX = _mm_set1_pd(tri.slopeX);
+    const __m128d slopeYTerm = _mm_set1_pd(rc.slopeYTerm);
+    const __m128d originZ = _mm_set1_pd(tri.originZ);
+    const __m128d minZLimit = _mm_set1_pd(rc.minZLimit);
+    const __m128d maxZLimit = _mm_set1_pd(rc.maxZLimit);
+    const __m128d originX = _mm_set1_pd(tri.originX);
+    const __m128d edge0Y = _mm_set1_pd(tri.edge0Y);
+    const __m128d edge1Y = _mm_set1_pd(tri.edge1Y);
+    const __m128d pyEdge0X = _mm_set1_pd(rc.pyEdge0X);
+    const __m128d pyEdge1X = _mm_set1_pd(rc.pyEdge1X);
+    const __m128d invDet = _mm_set1_pd(tri.invDet);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d baryLow = _mm_set1_pd(rc.baryLow);
+    const __m128d baryHigh = _mm_set1_pd(rc.baryHigh);
+
+    std::size_t i = begin;
+    for (; i + 2 <= end; i += 2)
+    {
+        const __m128d index = _mm_add_pd(_mm_set1_pd(static_cast<double>(i)), laneOffsets);
+        const __m128d x = _mm_add_pd(x0, _mm_mul_pd(index, stepDx));
+
+        const __m128d dx = _mm_sub_pd(x, centroidX);
+        __m128d mask = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(dx, dx), dySq), radiusLimit);
+        mask = _mm_and_pd(mask, _mm_and_pd(_mm_cmpge_pd(x, minXLimit), _mm_cmple_pd(x, maxXLimit)));
+        if (_mm_movemask_pd(mask) == 0)
+        {
+            continue;
+        }
+
+        const __m128d px = _mm_sub_pd(x, originX);
+        const __m128d z = _mm_add_pd(_mm_add_pd(_mm_mul_pd(slopeX, px), slopeYTerm), originZ);
+        mask = _mm_and_pd(mask, _mm_and_pd(_mm_cmpge_pd(z, minZLimit), _mm_cmple_pd(z, maxZLimit)));
+
+        const __m128d v = _mm_mul_pd(_mm_sub_pd(_mm_mul_pd(px, edge1Y), pyEdge1X), invDet);
+        const __m128d w = _mm_mul_pd(_mm_sub_pd(pyEdge0X, _mm_mul_pd(px, edge0Y)), invDet);
+        const __m128d u = _mm_sub_pd(_mm_sub_pd(one, v), w);
+        mask = _mm_and_pd(mask, _mm_and_pd(_mm_cmpge_pd(u, baryLow), _mm_cmple_pd(u, baryHigh)));
+        mask = _mm_and_pd(mask, _mm_and_pd(_mm_cmpge_pd(v, baryLow), _mm_cmple_pd(v, baryHigh)));
+        mask = _mm_and_pd(mask, _mm_and_pd(_mm_cmpge_pd(w, baryLow), _mm_cmple_pd(w, baryHigh)));
+
+        const __m128d current = _mm_loadu_pd(zRow + i);
+        mask = _mm_and_pd(mask, _mm_cmpnge_pd(current, z));
+        if (_mm_movemask_pd(mask) != 0)
+        {
+            _mm_storeu_pd(zRow + i, _mm_or_pd(_mm_and_pd(mask, z), _mm_andnot_pd(mask, current)));
+        }
+    }
+    for (; i < end; ++i)
+    {
+        sampleLane(tri, rc, row.x0 + static_cast<double>(i) * row.dx, zRow[i]);
+    }
+}
+#endif
+
+#if TP_ROW_KERNEL_AVX2
+TP_TARGET_AVX2 inline __m256d inRange(__m256d value, __m256d low, __m256d high)
+{
+    return _mm256_and_pd(_mm256_cmp_pd(value, low, _CMP_GE_OQ), _mm256_cmp_pd(value, high, _CMP_LE_OQ));
+}
+
+TP_TARGET_AVX2 void rowKernelAvx2(const RowTriangle& tri,
+                                  const RowSample& row,
+                                  std::size_t begin,
+                                  std::size_t end,
+                                  double* zRow)
+{
+    RowConstants rc;
+    if (!prepareRow(tri, row, rc))
+    {
+        return;
+    }
+
+    const __m256d x0 = _mm256_set1_pd(row.x0);
+    const __m256d stepDx = _mm256_set1_pd(row.dx);
+    const __m256d laneOffsets = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256d centroidX = _mm256_set1_pd(tri.centroidX);
+    const __m256d dySq = _mm256_set1_pd(rc.dySq);
+    const __m256d radiusLimit = _mm256_set1_pd(rc.radiusLimit);
+    const __m256d minXLimit = _mm256_set1_pd(rc.minXLimit);
+    const __m256d maxXLimit = _mm256_set1_pd(rc.maxXLimit);
+    const __m256d slopeX = _mm256_set1_pd(tri.slopeX);
+    const __m256d slopeYTerm = _mm256_set1_pd(rc.slopeYTerm);
+    const __m256d originZ = _mm256_set1_pd(tri.originZ);
+    const __m256d minZLimit = _mm256_set1_pd(rc.minZLimit);
+    const __m256d maxZLimit = _mm256_set1_pd(rc.maxZLimit);
+    const __m256d originX = _mm256_set1_pd(tri.originX);
+    const __m256d edge0Y = _mm256_set1_pd(tri.edge0Y);
+    const __m256d edge1Y = _mm256_set1_pd(tri.edge1Y);
+    const __m256d pyEdge0X = _mm256_set1_pd(rc.pyEdge0X);
+    const __m256d pyEdge1X = _mm256_set1_pd(rc.pyEdge1X);
+    const __m256d invDet = _mm256_set1_pd(tri.invDet);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d baryLow = _mm256_set1_pd(rc.baryLow);
+    const __m256d baryHigh = _mm256_set1_pd(rc.baryHigh);
+
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m256d index = _mm256_add_pd(_mm256_set1_pd(static_cast<double>(i)), laneOffsets);
+        const __m256d x = _mm256_add_pd(x0, _mm256_mul_pd(index, stepDx));
+
+        const __m256d dx = _mm256_sub_pd(x, centroidX);
+        __m256d mask = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), dySq), radiusLimit, _CMP_LE_OQ);
+        mask = _mm256_and_pd(mask, inRange(x, minXLimit, maxXLimit));
+        if (_mm256_movemask_pd(mask) == 0)
+        {
+            continue;
+        }
+
+        const __m256d px = _mm256_sub_pd(x, originX);
+        const __m256d z = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(slopeX, px), slopeYTerm), originZ);
+        mask = _mm256_and_pd(mask, inRange(z, minZLimit, maxZLimit));
+
+        const __m256d v = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(px, edge1Y), pyEdge1X), invDet);
+        const __m256d w = _mm256_mul_pd(_mm256_sub_pd(pyEdge0X, _mm256_mul_pd(px, edge0Y)), invDet);
+        const __m256d u = _mm256_sub_pd(_mm256_sub_pd(one, v), w);
+        mask = _mm256_and_pd(mask, inRange(u, baryLow, baryHigh));
+        mask = _mm256_and_pd(mask, inRange(v, baryLow, baryHigh));
+        mask = _mm256_and_pd(mask, inRange(w, baryLow, baryHigh));
+
+        const __m256d current = _mm256_loadu_pd(zRow + i);
+        mask = _mm256_and_pd(mask, _mm256_cmp_pd(current, z, _CMP_NGE_UQ));
+        if (_mm256_movemask_pd(mask) != 0)
+        {
+            _mm256_storeu_pd(zRow + i, _mm256_blendv_pd(current, z, mask));
+        }
+    }
+    for (; i < end; ++i)
+    {
+        sampleLane(tri, rc, row.x0 + static_cast<double>(i) * row.dx, zRow[i]);
+    }
+}
+#endif
+
+bool cpuSupportsAvx2()
+{
+#if TP_ROW_KERNEL_AVX2 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#elif TP_ROW_KERNEL_AVX2 && defined(_MSC_VER)
+    int info[4] = {0, 0, 0, 0};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+RowTriangle RowTriangle::load(const TriangleGrid& grid, std::uint32_t index)
+{
+    const TriangleGrid::CullRecord& cull = grid.cull(index);
+    const TriangleGrid::SurfaceRecord& surf = grid.surface(index);
+
+    RowTriangle tri;
+    tri.minX = static_cast<double>(cull.minX);
+    tri.minY = static_cast<double>(cull.minY);
+    tri.maxX = static_cast<double>(cull.maxX);
+    tri.maxY = static_cast<double>(cull.maxY);
+    tri.minZ = static_cast<double>(cull.minZ);
+    tri.maxZ = static_cast<double>(cull.maxZ);
+    tri.centroidX = static_cast<double>(cull.centroidX);
+    tri.centroidY = static_cast<double>(cull.centroidY);
+    tri.boundingRadiusSq = static_cast<double>(cull.boundingRadiusSq);
+    tri.slopeX = static_cast<double>(surf.slopeX);
+    tri.slopeY = static_cast<double>(surf.slopeY);
+    tri.originX = static_cast<double>(surf.originX);
+    tri.originY = static_cast<double>(surf.originY);
+    tri.originZ = static_cast<double>(surf.originZ);
+    tri.edge0X = static_cast<double>(surf.edge0X);
+    tri.edge0Y = static_cast<double>(surf.edge0Y);
+    tri.edge1X = static_cast<double>(surf.edge1X);
+    tri.edge1Y = static_cast<double>(surf.edge1Y);
+    tri.invDet = static_cast<double>(surf.invDet);
+    tri.valid = surf.valid;
+    return tri;
+}
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel level = []() {
+        if (cpuSupportsAvx2())
+        {
+            return SimdLevel::Avx2;
+        }
+        return TP_ROW_KERNEL_SSE2 ? SimdLevel::Sse2 : SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+SimdLevel activeSimdLevel()
+{
+    static const SimdLevel level = []() {
+        const SimdLevel detected = detectSimdLevel();
+        const char* env = std::getenv("CNCTC_SIMD");
+        if (!env)
+        {
+            return detected;
+        }
+        SimdLevel requested = detected;
+        if (std::strcmp(env, "scalar") == 0)
+        {
+            requested = SimdLevel::Scalar;
+        }
+        else if (std::strcmp(env, "sse2") == 0)
+        {
+            requested = SimdLevel::Sse2;
+        }
+        else if (std::strcmp(env, "avx2") == 0)
+        {
+            requested = SimdLevel::Avx2;
+        }
+        return std::min(requested, detected);
+    }();
+    return level;
+}
+
+RowKernelFn rowKernel(SimdLevel level)
+{
+    level = std::min(level, detectSimdLevel());
+    switch (level)
+    {
+#if TP_ROW_KERNEL_AVX2
+    case SimdLevel::Avx2:
+        return &rowKernelAvx2;
+#endif
+#if TP_ROW_KERNEL_SSE2
+    case SimdLevel::Sse2:
+        return &rowKernelSse2;
+#endif
+    default:
+        return &rowKernelScalar;
+    }
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Sse2:
+        return "sse2";
+    case SimdLevel::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+} // namespace tp::heightfield
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "tp/TriangleGrid.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tp::heightfield
+{
+
+enum class SimdLevel
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// One triangle's cull and surface data widened to double, loaded once and reused for every sample
+// of a row.
+struct RowTriangle
+{
+    double minX{0.0};
+    double minY{0.0};
+    double maxX{0.0};
+    double maxY{0.0};
+    double minZ{0.0};
+    double maxZ{0.0};
+    double centroidX{0.0};
+    double centroidY{0.0};
+    double boundingRadiusSq{0.0};
+    double slopeX{0.0};
+    double slopeY{0.0};
+    double originX{0.0};
+    double originY{0.0};
+    double originZ{0.0};
+    double edge0X{0.0};
+    double edge0Y{0.0};
+    double edge1X{0.0};
+    double edge1Y{0.0};
+    double invDet{0.0};
+    bool valid{false};
+
+    [[nodiscard]] static RowTriangle load(const TriangleGrid& grid, std::uint32_t index);
+};
+
+// Samples lie at x0 + i * dx for i in [begin, end) on the line y.
+struct RowSample
+{
+    double y{0.0};
+    double x0{0.0};
+    double dx{1.0};
+    double eps{0.0};
+    double barycentricEps{0.0};
+};
+
+// Raises zRow[i] to the triangle height for every sample the triangle covers. zRow entries that are
+// NaN count as uncovered. Every level evaluates the same expressions as
+// TriangleGrid::cullContainsXY/surfaceHeightAt, lane by lane, so results are bit-identical.
+using RowKernelFn = void (*)(const RowTriangle& tri,
+                             const RowSample& row,
+                             std::size_t begin,
+                             std::size_t end,
+                             double* zRow);
+
+// Highest level supported by the CPU and OS.
+[[nodiscard]] SimdLevel detectSimdLevel();
+// detectSimdLevel() capped by CNCTC_SIMD=scalar|sse2|avx2, resolved once per process.
+[[nodiscard]] SimdLevel activeSimdLevel();
+// Falls back to the scalar kernel when the level is not supported.
+[[nodiscard]] RowKernelFn rowKernel(SimdLevel level);
+[[nodiscard]] const char* simdLevelName(SimdLevel level);
+
+} // namespace tp::heightfield
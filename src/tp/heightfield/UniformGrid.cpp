@@ -37,52 +37,126 @@ QString formatBytes(std::size_t bytes)
 UniformGrid::UniformGrid(const render::Model& model, double cellSizeMm)
     : m_grid(model, std::max(0.1, cellSizeMm))
     , m_cellSize(std::max(0.1, cellSizeMm))
+    , m_simdLevel(activeSimdLevel())
+    , m_rowKernel(rowKernel(m_simdLevel))
 {
-    m_queryBuffer.reserve(128);
-
     const std::size_t cellCount = std::max<std::size_t>(1, m_grid.cellCount());
-    const std::size_t triangleBytes = m_grid.triangleCount() * sizeof(TriangleGrid::Triangle);
+    const std::size_t triangleBytes = m_grid.triangleBytes();
     const std::size_t indexBytes = m_grid.cellIndexCount() * sizeof(std::uint32_t);
+    const std::size_t bytesPerTriangle = m_grid.triangleCount() > 0 ? triangleBytes / m_grid.triangleCount() : 0;
+    const QString precision = sizeof(TriangleGrid::Real) == sizeof(float) ? QStringLiteral("float32")
+                                                                          : QStringLiteral("float64");
     const QString summary = QStringLiteral("UniformGrid: %1x%2 cells (%3 total) for %4 triangles. Memory ~ %5 "
-                                           "(triangles=%6, indices=%7)")
+                                           "(triangles=%6 @ %7 B/tri %8, indices=%9), row kernel=%10")
                                 .arg(std::max(1, m_grid.cellsX()))
                                 .arg(std::max(1, m_grid.cellsY()))
                                 .arg(static_cast<qulonglong>(cellCount))
                                 .arg(static_cast<qulonglong>(m_grid.triangleCount()))
                                 .arg(formatBytes(triangleBytes + indexBytes))
                                 .arg(formatBytes(triangleBytes))
-                                .arg(formatBytes(indexBytes));
+                                .arg(static_cast<qulonglong>(bytesPerTriangle))
+                                .arg(precision)
+                                .arg(formatBytes(indexBytes))
+                                .arg(QString::fromLatin1(simdLevelName(m_simdLevel)));
     LOG_INFO(Tp, summary);
 }
 
-bool UniformGrid::intersect(const TriangleGrid::Triangle& tri, double x, double y, double& zOut) const
+bool UniformGrid::sampleTriangleAt(std::uint32_t index, double x, double y, double& zOut) const
+{
+    return m_grid.cullContainsXY(index, x, y, kEpsilon)
+           && m_grid.surfaceHeightAt(index, x, y, kEpsilon, kBarycentricEpsilon, zOut);
+}
+
+void UniformGrid::sampleTriangleRow(const RowTriangle& tri,
+                                    double y,
+                                    double x0,
+                                    double dx,
+                                    std::size_t begin,
+                                    std::size_t end,
+                                    double* zRow) const
+{
+    const RowSample row{y, x0, dx, kEpsilon, kBarycentricEpsilon};
+    m_rowKernel(tri, row, begin, end, zRow);
+}
+
+std::size_t UniformGrid::sampleMaxZRow(double y, double x0, double dx, std::size_t n, double* out) const
+{
+    thread_local QueryContext context;
+    return sampleMaxZRow(y, x0, dx, n, out, context);
+}
+
+std::size_t UniformGrid::sampleMaxZRow(double y,
+                                       double x0,
+                                       double dx,
+                                       std::size_t n,
+                                       double* out,
+                                       QueryContext& context) const
 {
-    if (!tri.validNormalZ || !tri.validBarycentric)
+    std::fill(out, out + n, std::numeric_limits<double>::quiet_NaN());
+    if (n == 0 || y < minY() - kEpsilon || y > maxY() + kEpsilon)
     {
-        return false;
+        return 0;
     }
 
-    const double z = tri.planeHeightAt(x, y);
-    if (!std::isfinite(z))
+    const double xFirst = x0;
+    const double xLast = x0 + static_cast<double>(n - 1) * dx;
+    const double rowMinX = std::min(xFirst, xLast);
+    const double rowMaxX = std::max(xFirst, xLast);
+    if (rowMaxX < minX() - kEpsilon || rowMinX > maxX() + kEpsilon)
     {
-        return false;
+        return 0;
     }
-    if (z < tri.minZ - kEpsilon || z > tri.maxZ + kEpsilon)
+
+    // Widen by epsilon so triangles binned only into a neighbouring cell still reach samples on a cell
+    // border; the per-lane test keeps the result identical to sampleTriangleAt.
+    m_grid.gatherCandidatesAABB(rowMinX - kEpsilon, y - kEpsilon, rowMaxX + kEpsilon, y + kEpsilon, context);
+
+    const RowSample row{y, x0, dx, kEpsilon, kBarycentricEpsilon};
+    const double invDx = (dx != 0.0) ? 1.0 / dx : 0.0;
+    for (std::uint32_t index : context.candidates)
     {
-        return false;
+        const TriangleGrid::CullRecord& cull = m_grid.cull(index);
+        if (y < static_cast<double>(cull.minY) - kEpsilon || y > static_cast<double>(cull.maxY) + kEpsilon)
+        {
+            continue;
+        }
+
+        std::size_t begin = 0;
+        std::size_t end = n;
+        if (invDx != 0.0)
+        {
+            // Sample range covering the bbox, widened by one on each side; lanes do the exact test.
+            const double a = (static_cast<double>(cull.minX) - kEpsilon - x0) * invDx;
+            const double b = (static_cast<double>(cull.maxX) + kEpsilon - x0) * invDx;
+            const double lo = std::floor(std::min(a, b)) - 1.0;
+            const double hi = std::ceil(std::max(a, b)) + 2.0;
+            if (hi <= 0.0 || lo >= static_cast<double>(n))
+            {
+                continue;
+            }
+            begin = lo > 0.0 ? static_cast<std::size_t>(lo) : 0;
+            end = std::min(n, static_cast<std::size_t>(hi));
+        }
+
+        m_rowKernel(RowTriangle::load(m_grid, index), row, begin, end, out);
     }
+    context.candidates.clear();
 
-    const glm::dvec3 point{x, y, z};
-    if (!tri.barycentricContains(point, kBarycentricEpsilon))
+    std::size_t hits = 0;
+    for (std::size_t i = 0; i < n; ++i)
     {
-        return false;
+        hits += std::isnan(out[i]) ? 0 : 1;
     }
-
-    zOut = z;
-    return true;
+    return hits;
 }
 
 bool UniformGrid::sampleMaxZAtXY(double x, double y, double& zOut) const
+{
+    thread_local QueryContext context;
+    return sampleMaxZAtXY(x, y, zOut, context);
+}
+
+bool UniformGrid::sampleMaxZAtXY(double x, double y, double& zOut, QueryContext& context) const
 {
     if (x < minX() - kEpsilon || x > maxX() + kEpsilon || y < minY() - kEpsilon || y > maxY() + kEpsilon)
     {
@@ -90,15 +164,16 @@ bool UniformGrid::sampleMaxZAtXY(double x, double y, double& zOut) const
     }
 
     const auto evaluate = [&](int radius) -> bool {
-        m_grid.gatherCandidatesXY(x, y, radius, m_queryBuffer);
-        if (m_queryBuffer.empty())
+        std::vector<std::uint32_t>& candidates = context.candidates;
+        m_grid.gatherCandidatesXY(x, y, radius, context);
+        if (candidates.empty())
         {
             return false;
         }
 
-        std::sort(m_queryBuffer.begin(), m_queryBuffer.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
-            const double lhsMax = m_grid.triangle(lhs).maxZ;
-            const double rhsMax = m_grid.triangle(rhs).maxZ;
+        std::sort(candidates.begin(), candidates.end(), [this](std::uint32_t lhs, std::uint32_t rhs) {
+            const double lhsMax = m_grid.maxZ(lhs);
+            const double rhsMax = m_grid.maxZ(rhs);
             if (std::abs(lhsMax - rhsMax) < kEpsilon)
             {
                 return lhs < rhs;
@@ -109,30 +184,15 @@ bool UniformGrid::sampleMaxZAtXY(double x, double y, double& zOut) const
         double currentMax = -std::numeric_limits<double>::infinity();
         bool hit = false;
 
-        for (std::uint32_t idx : m_queryBuffer)
+        for (std::uint32_t idx : candidates)
         {
-            const TriangleGrid::Triangle& tri = m_grid.triangle(idx);
-
-            if (tri.maxZ + kEpsilon < currentMax)
-            {
-                continue;
-            }
-
-            const double dx = x - tri.centroid.x;
-            const double dy = y - tri.centroid.y;
-            if ((dx * dx + dy * dy) > tri.boundingRadiusSq + kEpsilon)
-            {
-                continue;
-            }
-
-            if (x < tri.bboxMin.x - kEpsilon || x > tri.bboxMax.x + kEpsilon || y < tri.bboxMin.y - kEpsilon
-                || y > tri.bboxMax.y + kEpsilon)
+            if (m_grid.maxZ(idx) + kEpsilon < currentMax)
             {
                 continue;
             }
 
             double zCandidate = 0.0;
-            if (intersect(tri, x, y, zCandidate) && zCandidate > currentMax)
+            if (sampleTriangleAt(idx, x, y, zCandidate) && zCandidate > currentMax)
             {
                 currentMax = zCandidate;
                 hit = true;
@@ -143,7 +203,7 @@ bool UniformGrid::sampleMaxZAtXY(double x, double y, double& zOut) const
         {
             zOut = currentMax;
         }
-        m_queryBuffer.clear();
+        candidates.clear();
         return hit;
     };
 
@@ -2,6 +2,7 @@
 
 #include "render/Model.h"
 #include "tp/TriangleGrid.h"
+#include "tp/heightfield/RowKernel.h"
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -17,10 +18,39 @@ namespace tp::heightfield
 class UniformGrid
 {
 public:
+    using QueryContext = TriangleGrid::QueryContext;
+
     UniformGrid(const render::Model& model, double cellSizeMm);
 
+    // Reentrant: all scratch state lives in the caller's context.
+    [[nodiscard]] bool sampleMaxZAtXY(double x, double y, double& zOut, QueryContext& context) const;
+    // Uses a thread-local QueryContext; safe to call from parallel algorithms.
     [[nodiscard]] bool sampleMaxZAtXY(double x, double y, double& zOut) const;
 
+    // Evaluates a single triangle at (x, y) with the same rejection tests used by sampleMaxZAtXY, so
+    // callers that iterate triangles directly (e.g. scan conversion) produce identical coverage.
+    [[nodiscard]] bool sampleTriangleAt(std::uint32_t index, double x, double y, double& zOut) const;
+
+    // Max Z at the n samples x0 + i * dx (i in [0, n)) on the line y. out[i] is NaN where nothing
+    // is hit; returns the number of hits. Candidates are gathered once for the whole row and each
+    // triangle is tested against 2/4 samples at a time by the SIMD row kernel.
+    std::size_t sampleMaxZRow(double y, double x0, double dx, std::size_t n, double* out, QueryContext& context) const;
+    // Uses a thread-local QueryContext.
+    std::size_t sampleMaxZRow(double y, double x0, double dx, std::size_t n, double* out) const;
+
+    // Row form of sampleTriangleAt: raises zRow[i] for i in [begin, end) where the triangle covers
+    // x0 + i * dx. NaN entries count as uncovered.
+    void sampleTriangleRow(const RowTriangle& tri,
+                           double y,
+                           double x0,
+                           double dx,
+                           std::size_t begin,
+                           std::size_t end,
+                           double* zRow) const;
+    [[nodiscard]] SimdLevel simdLevel() const noexcept { return m_simdLevel; }
+
+    [[nodiscard]] const TriangleGrid& triangles() const noexcept { return m_grid; }
+
     [[nodiscard]] double minX() const noexcept { return m_grid.boundsMin().x; }
     [[nodiscard]] double minY() const noexcept { return m_grid.boundsMin().y; }
     [[nodiscard]] double maxX() const noexcept { return m_grid.boundsMax().x; }
@@ -36,11 +66,10 @@ public:
     }
 
 private:
-    [[nodiscard]] bool intersect(const TriangleGrid::Triangle& tri, double x, double y, double& zOut) const;
-
     TriangleGrid m_grid;
     double m_cellSize{1.0};
-    mutable std::vector<std::uint32_t> m_queryBuffer;
+    SimdLevel m_simdLevel{SimdLevel::Scalar};
+    RowKernelFn m_rowKernel{nullptr};
 };
 
 } // namespace tp::heightfield
@@ -59,37 +59,8 @@ std::optional<double> sampleHeight(const TriangleGrid& grid,
             continue;
         }
 
-        const TriangleGrid::Triangle& tri = grid.triangle(index);
-        if (!tri.validNormalZ || !tri.validBarycentric)
-        {
-            continue;
-        }
-
-        const double dx = x - tri.centroid.x;
-        const double dy = y - tri.centroid.y;
-        if ((dx * dx + dy * dy) > tri.boundingRadiusSq + eps)
-        {
-            continue;
-        }
-
-        if (x < tri.bboxMin.x - eps || x > tri.bboxMax.x + eps || y < tri.bboxMin.y - eps || y > tri.bboxMax.y + eps)
-        {
-            continue;
-        }
-
-        const double zCandidate = tri.planeHeightAt(x, y);
-        if (!std::isfinite(zCandidate))
-        {
-            continue;
-        }
-
-        if (zCandidate < tri.minZ - eps || zCandidate > tri.maxZ + eps)
-        {
-            continue;
-        }
-
-        const glm::dvec3 point{x, y, zCandidate};
-        if (!tri.barycentricContains(point, eps))
+        double zCandidate = 0.0;
+        if (!grid.cullContainsXY(index, x, y, eps) || !grid.surfaceHeightAt(index, x, y, eps, eps, zCandidate))
         {
             continue;
         }
@@ -155,9 +126,20 @@ bool OclAdapter::waterline(const render::Model& model,
 
     const auto startTime = std::chrono::steady_clock::now();
 
+    std::vector<double> levels;
     for (double planeZ = maxZ; planeZ >= minZ - 1e-6; planeZ -= stepDown)
     {
-        const auto loops = slicer.slice(planeZ, toolRadius, cutter.type == Cutter::Type::FlatEndmill);
+        levels.push_back(planeZ);
+    }
+
+    const auto levelLoops = slicer.sliceLevels(levels,
+                                               toolRadius,
+                                               cutter.type == Cutter::Type::FlatEndmill,
+                                               waterline::ZSlicer::SliceMode::Parallel,
+                                               nullptr,
+                                               params.waterlineArcTolerance_mm);
+    for (const auto& loops : levelLoops)
+    {
         if (loops.empty())
         {
             continue;
@@ -1,7 +1,9 @@
 #include "tp/waterline/ZSlicer.h"
 
 #include "common/log.h"
+#include "tp/PolygonClipper.h"
 
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -10,11 +12,14 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <execution>
 #include <iterator>
 #include <limits>
 #include <numeric>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 
 #include <QtCore/QString>
@@ -25,6 +30,20 @@ namespace tp::waterline
 namespace
 {
 constexpr double kEpsilon = 1e-9;
+// Buckets are at least as tall as the triangles' average Z extent divided by this, which bounds the
+// bucket lists at about (1 + kBucketEntriesPerTriangle) entries per triangle.
+constexpr double kBucketEntriesPerTriangle = 3.0;
+constexpr std::size_t kMaxBuckets = std::size_t{1} << 20;
+// A plane meets a triangle in at most six points (three vertices within the tolerance, three edge
+// crossings), which pair up into at most three segments.
+constexpr std::size_t kMaxPlanePoints = 6;
+constexpr std::size_t kMaxSegmentsPerTriangle = kMaxPlanePoints / 2;
+constexpr std::uint32_t kNoTwin = std::numeric_limits<std::uint32_t>::max();
+constexpr std::uint32_t kNoSegment = std::numeric_limits<std::uint32_t>::max();
+// The grid the grown loops' edges are tested in has cells this many average edge lengths wide, and at most
+// this many cells per edge.
+constexpr double kCellEdgeLengths = 2.0;
+constexpr double kMaxCellsPerEdge = 4.0;
 template <typename Vec>
 inline auto lengthSquared(const Vec& v) -> decltype(glm::dot(v, v))
 {
@@ -32,6 +51,33 @@ inline auto lengthSquared(const Vec& v) -> decltype(glm::dot(v, v))
 }
 
 
+struct Segment
+{
+    glm::dvec2 a;
+    glm::dvec2 b;
+    bool used{false};
+    // Edges of the triangle (0-2, from corner k to corner k + 1) that a and b lie inside, or -1 when the
+    // segment touches a vertex on the plane.
+    std::int8_t edgeA{-1};
+    std::int8_t edgeB{-1};
+    std::uint32_t triangle{0};
+};
+
+// A closed loop stored as a run of points in one of the scratch point arrays.
+struct LoopSpan
+{
+    std::size_t offset{0};
+    std::size_t count{0};
+};
+
+struct ScoredLoop
+{
+    double area{0.0};
+    LoopSpan points;
+    // Whether the points are in the offset array rather than the traced one.
+    bool offset{false};
+};
+
 struct GridKey
 {
     std::int64_t x{0};
@@ -60,7 +106,7 @@ GridKey quantize(const glm::dvec2& p, double tolerance)
     };
 }
 
-double polygonArea(const std::vector<glm::dvec2>& pts)
+double polygonArea(std::span<const glm::dvec2> pts)
 {
     if (pts.size() < 3)
     {
@@ -82,79 +128,593 @@ double polygonArea(const std::vector<glm::dvec2>& pts)
     return 0.5 * area;
 }
 
-glm::dvec2 rotateCW(const glm::dvec2& v)
+bool nearlyEqual2D(const glm::dvec2& a, const glm::dvec2& b, double tol)
+{
+    return lengthSquared(a - b) <= tol * tol;
+}
+
+// Twice the signed area of triangle abc: positive when c lies left of a->b.
+double orient(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c)
 {
-    return {v.y, -v.x};
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
 }
 
-glm::dvec2 rotateCCW(const glm::dvec2& v)
+struct LoopBox
+{
+    glm::dvec2 min{0.0};
+    glm::dvec2 max{0.0};
+};
+
+bool boxHolds(const LoopBox& outer, const LoopBox& inner)
 {
-    return {-v.y, v.x};
+    return outer.min.x <= inner.min.x && outer.max.x >= inner.max.x && outer.min.y <= inner.min.y
+           && outer.max.y >= inner.max.y;
 }
 
-bool nearlyEqual2D(const glm::dvec2& a, const glm::dvec2& b, double tol)
+// An edge of a grown loop from point a to point b of the grown point array, with its bounding box.
+struct GrownEdge
 {
-    return lengthSquared(a - b) <= tol * tol;
+    glm::dvec2 min{0.0};
+    glm::dvec2 max{0.0};
+    std::uint32_t a{0};
+    std::uint32_t b{0};
+};
+
+// Buffers for growing a level's loops one at a time, kept in the slice scratch.
+struct GrowScratch
+{
+    std::vector<glm::dvec2> corners;
+    std::vector<LoopBox> boxes;
+    std::vector<std::uint32_t> depths;
+    std::vector<std::uint32_t> grownDepths;
+    std::vector<ScoredLoop> grown;
+    // Loops by the left edge of their boxes, and those whose boxes still reach the one being tested.
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint32_t> active;
+    std::vector<GrownEdge> edges;
+    // Uniform grid over the edges: edges listed per cell, CSR style.
+    std::vector<std::uint32_t> cellStart;
+    std::vector<std::uint32_t> cellEdges;
+};
+
+std::span<const glm::dvec2> spanOf(const std::vector<glm::dvec2>& points, const ScoredLoop& loop)
+{
+    return {points.data() + loop.points.offset, loop.points.count};
 }
 
-glm::dvec2 normalForEdge(const glm::dvec2& edge, double area)
+// Even-odd test of p against a closed loop.
+bool encloses(std::span<const glm::dvec2> loop, const glm::dvec2& p)
 {
-    const glm::dvec2 unit = glm::normalize(edge);
-    if (std::abs(area) < kEpsilon)
+    bool inside = false;
+    for (std::size_t i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
     {
-        return rotateCW(unit);
+        const glm::dvec2& a = loop[i];
+        const glm::dvec2& b = loop[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+        {
+            inside = !inside;
+        }
     }
-    return (area > 0.0) ? rotateCW(unit) : rotateCCW(unit);
+    return inside;
 }
 
-std::vector<glm::dvec2> offsetLoop(const std::vector<glm::dvec2>& loop, double radius, double area)
+// Number of other loops around each loop. Loops that do not cross are either nested or apart, so their
+// first points decide. A sweep along X only pairs loops whose boxes overlap there.
+void nestingDepths(const std::vector<glm::dvec2>& points,
+                   std::span<const ScoredLoop> loops,
+                   GrowScratch& scratch,
+                   std::vector<std::uint32_t>& depths)
 {
-    if (radius <= kEpsilon || loop.size() < 3)
+    std::vector<LoopBox>& boxes = scratch.boxes;
+    boxes.clear();
+    for (const ScoredLoop& loop : loops)
     {
-        return loop;
+        LoopBox box{glm::dvec2(std::numeric_limits<double>::infinity()),
+                    glm::dvec2(-std::numeric_limits<double>::infinity())};
+        for (const glm::dvec2& p : spanOf(points, loop))
+        {
+            box.min = glm::min(box.min, p);
+            box.max = glm::max(box.max, p);
+        }
+        boxes.push_back(box);
     }
 
-    const std::size_t count = loop.size();
-    std::vector<glm::dvec2> offsetPoints;
-    offsetPoints.reserve(count);
+    const auto surrounds = [&](std::uint32_t outer, std::uint32_t inner) {
+        return boxHolds(boxes[outer], boxes[inner])
+               && encloses(spanOf(points, loops[outer]), points[loops[inner].points.offset]);
+    };
 
-    for (std::size_t i = 0; i < count; ++i)
+    std::vector<std::uint32_t>& order = scratch.order;
+    order.resize(loops.size());
+    std::iota(order.begin(), order.end(), std::uint32_t{0});
+    std::sort(order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+        return boxes[lhs].min.x < boxes[rhs].min.x;
+    });
+
+    depths.assign(loops.size(), 0);
+    std::vector<std::uint32_t>& active = scratch.active;
+    active.clear();
+    for (const std::uint32_t loop : order)
     {
-        const glm::dvec2& prev = loop[(i + count - 1) % count];
-        const glm::dvec2& curr = loop[i];
-        const glm::dvec2& next = loop[(i + 1) % count];
+        std::erase_if(active, [&](std::uint32_t other) { return boxes[other].max.x < boxes[loop].min.x; });
+        for (const std::uint32_t other : active)
+        {
+            if (surrounds(other, loop))
+            {
+                ++depths[loop];
+            }
+            // Only boxes starting at the same X can hold an earlier one.
+            else if (boxes[other].min.x == boxes[loop].min.x && surrounds(loop, other))
+            {
+                ++depths[other];
+            }
+        }
+        active.push_back(loop);
+    }
+}
 
-        glm::dvec2 vPrev = curr - prev;
-        glm::dvec2 vNext = next - curr;
-        if (lengthSquared(vPrev) < kEpsilon || lengthSquared(vNext) < kEpsilon)
+// Whether two loops whose boxes do not hold one another come within gap of each other, after
+// nestingDepths() has boxed and ordered them.
+bool boxesCrowd(GrowScratch& scratch, double gap)
+{
+    const std::vector<LoopBox>& boxes = scratch.boxes;
+    std::vector<std::uint32_t>& active = scratch.active;
+    active.clear();
+    for (const std::uint32_t loop : scratch.order)
+    {
+        const LoopBox& box = boxes[loop];
+        std::erase_if(active, [&](std::uint32_t other) { return boxes[other].max.x + gap < box.min.x; });
+        for (const std::uint32_t other : active)
+        {
+            const LoopBox& near = boxes[other];
+            if (near.min.y - gap <= box.max.y && box.min.y - gap <= near.max.y && !boxHolds(near, box)
+                && !boxHolds(box, near))
+            {
+                return true;
+            }
+        }
+        active.push_back(loop);
+    }
+    return false;
+}
+
+// True if two edges of the loops meet anywhere other than the point neighbouring edges share; touching
+// counts. Only edges sharing a cell of a uniform grid are tested against each other.
+bool edgesMeet(const std::vector<glm::dvec2>& points, std::span<const ScoredLoop> loops, GrowScratch& scratch)
+{
+    std::vector<GrownEdge>& edges = scratch.edges;
+    edges.clear();
+    LoopBox bounds{glm::dvec2(std::numeric_limits<double>::infinity()),
+                   glm::dvec2(-std::numeric_limits<double>::infinity())};
+    double totalLength = 0.0;
+    for (const ScoredLoop& loop : loops)
+    {
+        for (std::size_t k = 0; k < loop.points.count; ++k)
+        {
+            const auto a = static_cast<std::uint32_t>(loop.points.offset + k);
+            const auto b = static_cast<std::uint32_t>(loop.points.offset + (k + 1) % loop.points.count);
+            edges.push_back({glm::min(points[a], points[b]), glm::max(points[a], points[b]), a, b});
+            bounds.min = glm::min(bounds.min, edges.back().min);
+            bounds.max = glm::max(bounds.max, edges.back().max);
+            totalLength += glm::distance(points[a], points[b]);
+        }
+    }
+    if (edges.size() < 2)
+    {
+        return false;
+    }
+
+    const glm::dvec2 extent = bounds.max - bounds.min;
+    const double edgeCount = static_cast<double>(edges.size());
+    const double cellSize = std::max({kCellEdgeLengths * totalLength / edgeCount,
+                                      std::sqrt(extent.x * extent.y / (kMaxCellsPerEdge * edgeCount)),
+                                      kEpsilon});
+    const auto columns = static_cast<std::size_t>(extent.x / cellSize) + 1;
+    const auto rows = static_cast<std::size_t>(extent.y / cellSize) + 1;
+    const auto cellOf = [&](double value, double origin, std::size_t cells) {
+        return std::min(static_cast<std::size_t>((value - origin) / cellSize), cells - 1);
+    };
+
+    // Each edge is listed in every cell its box covers. The counts are summed into each cell's end, and
+    // the cells are filled back to front, which leaves each entry at its cell's start.
+    std::vector<std::uint32_t>& cellStart = scratch.cellStart;
+    std::vector<std::uint32_t>& cellEdges = scratch.cellEdges;
+    cellStart.assign(columns * rows + 1, 0);
+    const auto forEachCell = [&](const GrownEdge& edge, const auto& visit) {
+        const std::size_t col0 = cellOf(edge.min.x, bounds.min.x, columns);
+        const std::size_t col1 = cellOf(edge.max.x, bounds.min.x, columns);
+        const std::size_t row1 = cellOf(edge.max.y, bounds.min.y, rows);
+        for (std::size_t row = cellOf(edge.min.y, bounds.min.y, rows); row <= row1; ++row)
+        {
+            for (std::size_t col = col0; col <= col1; ++col)
+            {
+                visit(row * columns + col);
+            }
+        }
+    };
+    for (const GrownEdge& edge : edges)
+    {
+        forEachCell(edge, [&](std::size_t cell) { ++cellStart[cell]; });
+    }
+    std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+    cellEdges.resize(cellStart.back());
+    for (std::size_t i = 0; i < edges.size(); ++i)
+    {
+        forEachCell(edges[i], [&](std::size_t cell) { cellEdges[--cellStart[cell]] = static_cast<std::uint32_t>(i); });
+    }
+
+    for (std::size_t cell = 0; cell + 1 < cellStart.size(); ++cell)
+    {
+        for (std::uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+        {
+            const GrownEdge& edge = edges[cellEdges[i]];
+            for (std::uint32_t j = i + 1; j < cellStart[cell + 1]; ++j)
+            {
+                const GrownEdge& other = edges[cellEdges[j]];
+                if (other.max.x < edge.min.x || other.min.x > edge.max.x || other.max.y < edge.min.y
+                    || other.min.y > edge.max.y || other.a == edge.b || other.b == edge.a)
+                {
+                    continue;
+                }
+                const glm::dvec2& a = points[edge.a];
+                const glm::dvec2& b = points[edge.b];
+                const glm::dvec2& c = points[other.a];
+                const glm::dvec2& d = points[other.b];
+                if (orient(a, b, c) * orient(a, b, d) <= 0.0 && orient(c, d, a) * orient(c, d, b) <= 0.0)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Appends a loop grown by radius on its right, walking it backwards when reversed: its edges shift out,
+// convex corners take the arcs PolygonClipper::offset() would, within tolerance outside the true ones, and
+// concave corners join the shifted edges where they meet. Where the path folds back across a corner's
+// shifted edge or into its disc, the points those cover drop out. Returns false for any fold it cannot
+// trim that way, and for loops too small to grow alone.
+bool growLoop(std::span<const glm::dvec2> loop,
+              bool reversed,
+              double radius,
+              double tolerance,
+              std::vector<glm::dvec2>& corners,
+              std::vector<glm::dvec2>& out)
+{
+    // Points on the straight line through their neighbours are not corners.
+    const auto straight = [](const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c) {
+        return glm::dot(b - a, c - b) > 0.0 && std::abs(orient(a, b, c)) <= kEpsilon * glm::distance(a, c);
+    };
+    corners.clear();
+    for (std::size_t i = 0; i < loop.size(); ++i)
+    {
+        const glm::dvec2& point = loop[reversed ? loop.size() - 1 - i : i];
+        if (!corners.empty() && lengthSquared(point - corners.back()) < kEpsilon)
         {
-            offsetPoints.push_back(curr);
             continue;
         }
+        while (corners.size() > 1 && straight(corners[corners.size() - 2], corners.back(), point))
+        {
+            corners.pop_back();
+        }
+        corners.push_back(point);
+    }
+    while (corners.size() > 1 && lengthSquared(corners.back() - corners.front()) < kEpsilon)
+    {
+        corners.pop_back();
+    }
+    while (corners.size() > 2 && straight(corners[corners.size() - 2], corners.back(), corners.front()))
+    {
+        corners.pop_back();
+    }
+    while (corners.size() > 2 && straight(corners.back(), corners.front(), corners[1]))
+    {
+        corners.erase(corners.begin());
+    }
+    if (corners.size() < 3)
+    {
+        return false;
+    }
 
-        vPrev = glm::normalize(vPrev);
-        vNext = glm::normalize(vNext);
+    // Start after the longest edge, where the loop is least likely to fold as it closes.
+    const std::size_t count = corners.size();
+    std::size_t longest = 0;
+    double longestSquared = lengthSquared(corners.front() - corners.back());
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        if (lengthSquared(corners[i] - corners[i - 1]) > longestSquared)
+        {
+            longest = i;
+            longestSquared = lengthSquared(corners[i] - corners[i - 1]);
+        }
+    }
+    std::rotate(corners.begin(), corners.begin() + static_cast<std::ptrdiff_t>(longest), corners.end());
 
-        glm::dvec2 nPrev = normalForEdge(vPrev, area);
-        glm::dvec2 nNext = normalForEdge(vNext, area);
+    const std::size_t start = out.size();
+    const double stepAngle = 2.0 * std::acos(radius / (radius + tolerance));
+    // Whether the last point joins two shifted edges, and where the first of them ends.
+    bool joined = false;
+    glm::dvec2 joinedEnd(0.0);
+    // Whether the last point ends an arc, its last step running along a tangent from the point before.
+    bool arced = false;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::dvec2& current = corners[i];
+        const glm::dvec2& next = corners[(i + 1) % count];
+        const glm::dvec2 before = glm::normalize(current - corners[(i + count - 1) % count]);
+        const glm::dvec2 after = glm::normalize(next - current);
+        const glm::dvec2 normalBefore(before.y, -before.x);
+        const glm::dvec2 normalAfter(after.y, -after.x);
+        const double sine = before.x * after.y - before.y * after.x;
+        const double cosine = glm::dot(before, after);
+        if (sine > 0.0)
+        {
+            const double angle = std::atan2(sine, cosine);
+            const int steps = std::max(1, static_cast<int>(std::ceil(angle / stepAngle)));
+            const double halfStep = 0.5 * angle / static_cast<double>(steps);
+            const auto around = [&](double turn, double distance)
+            {
+                const double c = std::cos(turn);
+                const double s = std::sin(turn);
+                return current + glm::dvec2(normalBefore.x * c - normalBefore.y * s,
+                                            normalBefore.x * s + normalBefore.y * c) * distance;
+            };
 
-        glm::dvec2 bisector = nPrev + nNext;
-        if (lengthSquared(bisector) < kEpsilon)
+            // Points the corner's disc covers drop out, and the arc starts where the path before enters the disc:
+            // there, then where that tangent meets the arc's next one, so the path never cuts inside the arc.
+            // When the shifted edge before the corner has folded away entirely, the line into the join before
+            // it runs on into the disc instead. A path that reaches the shifted edge after the corner before
+            // the disc leaves out the arc and joins that edge.
+            const double reach = radius / std::cos(halfStep);
+            const bool covered = out.size() > start && lengthSquared(out.back() - current) < radius * radius;
+            const bool behind = out.size() > start && glm::dot(around(halfStep, reach) - out.back(), before) <= 0.0;
+            int firstStep = 0;
+            if (behind && !covered && arced)
+            {
+                // The last arc's final step overshoots this one's first along the short shifted edge between
+                // them: the two arcs' tangents there meet outside both discs and the shifted edge.
+                const glm::dvec2 last = out.back();
+                const glm::dvec2 into = last - out[out.size() - 2];
+                const glm::dvec2 firstVertex = around(halfStep, reach);
+                const double c = std::cos(2.0 * halfStep);
+                const double s = std::sin(2.0 * halfStep);
+                const glm::dvec2 onward(before.x * c - before.y * s, before.x * s + before.y * c);
+                const double denominator = into.x * onward.y - into.y * onward.x;
+                if (std::abs(denominator) <= kEpsilon)
+                {
+                    return false;
+                }
+                const glm::dvec2 gap = firstVertex - out[out.size() - 2];
+                const double along = (gap.x * onward.y - gap.y * onward.x) / denominator;
+                const double onwardAlong = (gap.x * into.y - gap.y * into.x) / denominator;
+                if (along <= 0.0 || along >= 1.0 || onwardAlong < 0.0 ||
+                    (steps > 1 && onwardAlong > 2.0 * radius * std::tan(halfStep)))
+                {
+                    return false;
+                }
+                out.back() = out[out.size() - 2] + into * along;
+                firstStep = 1;
+            }
+            else if (covered || behind)
+            {
+                glm::dvec2 dropped = out.back();
+                while (out.size() > start && lengthSquared(out.back() - current) < radius * radius)
+                {
+                    dropped = out.back();
+                    out.pop_back();
+                }
+                if (!covered)
+                {
+                    if (!joined)
+                    {
+                        return false;
+                    }
+                    out.pop_back();
+                }
+                if (out.size() == start)
+                {
+                    return false;
+                }
+
+                // The path runs from kept, relative to the corner, by inward times a parameter: up to the
+                // dropped point, or on from it to the end of its shifted edge.
+                const glm::dvec2 kept = out.back() - current;
+                const glm::dvec2 inward = dropped - out.back();
+                const double inwardSquared = glm::dot(inward, inward);
+                const double lowest = covered ? 0.0 : 1.0;
+                const double highest = covered ? 1.0 : glm::dot(joinedEnd - out.back(), inward) / inwardSquared;
+                const double b = glm::dot(kept, inward);
+                const double discriminant = b * b - inwardSquared * (glm::dot(kept, kept) - radius * radius);
+                const double t = (-b - std::sqrt(std::max(0.0, discriminant))) / inwardSquared;
+                const glm::dvec2 entry = kept + inward * t;
+                const double from = std::atan2(normalBefore.x * entry.y - normalBefore.y * entry.x,
+                                               glm::dot(normalBefore, entry));
+                if (discriminant >= 0.0 && t >= lowest && t <= highest && from >= 0.0 && from <= angle)
+                {
+                    firstStep = std::min(steps, static_cast<int>(from / (2.0 * halfStep)) + 1);
+                    const double to = std::min(angle, 2.0 * halfStep * static_cast<double>(firstStep));
+                    out.push_back(current + entry);
+                    if (to - from > kEpsilon)
+                    {
+                        out.push_back(around(0.5 * (from + to), radius / std::cos(0.5 * (to - from))));
+                    }
+                }
+                else
+                {
+                    const glm::dvec2 shiftedStart = normalAfter * radius;
+                    const double keptSide = orient(shiftedStart, shiftedStart + after, kept);
+                    const double droppedSide = orient(shiftedStart, shiftedStart + after, kept + inward);
+                    const double s = keptSide / (keptSide - droppedSide);
+                    const glm::dvec2 join = kept + inward * s;
+                    if (keptSide >= 0.0 || droppedSide <= keptSide || s < lowest || s > highest ||
+                        glm::dot(join, after) < 0.0)
+                    {
+                        return false;
+                    }
+                    out.push_back(current + join);
+                    joined = !covered;
+                    arced = false;
+                    continue;
+                }
+            }
+            // Each step turns the last spoke on by twice the half step.
+            const double stepCos = std::cos(2.0 * halfStep);
+            const double stepSin = std::sin(2.0 * halfStep);
+            glm::dvec2 spoke = around(halfStep * static_cast<double>(2 * firstStep + 1), reach) - current;
+            for (int step = firstStep; step < steps; ++step)
+            {
+                out.push_back(current + spoke);
+                spoke = glm::dvec2(spoke.x * stepCos - spoke.y * stepSin, spoke.x * stepSin + spoke.y * stepCos);
+            }
+            joined = false;
+            arced = firstStep < steps && out.size() - start > 1;
+            continue;
+        }
+        if (1.0 + cosine <= kEpsilon)
         {
-            bisector = nPrev;
+            return false;
         }
-        bisector = glm::normalize(bisector);
 
-        const double denom = glm::dot(bisector, nPrev);
-        const double scale = (std::abs(denom) > kEpsilon) ? (radius / denom) : radius;
-        offsetPoints.push_back(curr + bisector * scale);
+        glm::dvec2 point = current + (normalBefore + normalAfter) * (radius / (1.0 + cosine));
+        joined = true;
+        arced = false;
+        joinedEnd = current + normalBefore * radius;
+        const glm::dvec2 shiftedStart = current + normalAfter * radius;
+        const auto side = [&](const glm::dvec2& p) { return orient(shiftedStart, shiftedStart + after, p); };
+        if (out.size() > start && side(out.back()) > 0.0)
+        {
+            glm::dvec2 dropped = out.back();
+            while (out.size() > start && side(out.back()) > 0.0)
+            {
+                const glm::dvec2 offEdge = out.back() - current;
+                const double along = std::clamp(glm::dot(offEdge, after), 0.0, glm::distance(current, next));
+                if (lengthSquared(offEdge - after * along) > radius * radius)
+                {
+                    return false;
+                }
+                dropped = out.back();
+                out.pop_back();
+            }
+            if (out.size() == start)
+            {
+                return false;
+            }
+            // Where the last kept edge crosses the shifted edge, which must not lie before the edge starts.
+            const double keptSide = side(out.back());
+            point = out.back() + (dropped - out.back()) * (keptSide / (keptSide - side(dropped)));
+            if (glm::dot(point - current, after) < 0.0)
+            {
+                return false;
+            }
+            joined = false;
+        }
+        out.push_back(point);
+    }
+    return glm::dot(out[start] - out.back(), corners.front() - corners.back()) > 0.0;
+}
+
+// Grows the region the loops enclose, by the even-odd rule, one loop at a time: outer walls move out and
+// pockets shrink, each loop turned so the region is on its left. A loop that folds in a way growLoop()
+// cannot trim is offset alone by the clipper instead, unless loops sit close enough to merge, when the
+// level will likely need the clipper anyway. That is the exact offset as long as the grown loops neither
+// cross nor change how they nest; otherwise the whole level needs the clipper. The grown loops are reversed
+// to run with the material on their right and appended to grownPoints.
+bool growLoopsApart(const std::vector<glm::dvec2>& points,
+                    std::span<const ScoredLoop> loops,
+                    double radius,
+                    double arcTolerance,
+                    GrowScratch& scratch,
+                    PolygonClipper& clipper,
+                    std::vector<glm::dvec2>& grownPoints)
+{
+    nestingDepths(points, loops, scratch, scratch.depths);
+
+    const double tolerance = std::clamp(arcTolerance, radius * 1e-6, radius);
+    std::vector<ScoredLoop>& grown = scratch.grown;
+    grown.clear();
+    std::optional<bool> crowded;
+    for (std::size_t i = 0; i < loops.size(); ++i)
+    {
+        const bool outer = scratch.depths[i] % 2 == 0;
+        const std::size_t start = grownPoints.size();
+        if (growLoop(spanOf(points, loops[i]), outer != (loops[i].area > 0.0), radius, tolerance, scratch.corners,
+                     grownPoints))
+        {
+            std::reverse(grownPoints.begin() + static_cast<std::ptrdiff_t>(start), grownPoints.end());
+        }
+        else
+        {
+            if (!crowded)
+            {
+                crowded = boxesCrowd(scratch, 2.0 * radius);
+            }
+            if (*crowded)
+            {
+                return false;
+            }
+            // The clipper returns the grown island, or the shrunk pocket, counter-clockwise.
+            grownPoints.resize(start);
+            clipper.addPath(spanOf(points, loops[i]));
+            const std::vector<Path2> paths = clipper.offset(outer ? radius : -radius, FillRule::EvenOdd, tolerance);
+            if (paths.size() != 1)
+            {
+                return false;
+            }
+            if (outer)
+            {
+                grownPoints.insert(grownPoints.end(), paths.front().rbegin(), paths.front().rend());
+            }
+            else
+            {
+                grownPoints.insert(grownPoints.end(), paths.front().begin(), paths.front().end());
+            }
+        }
+        // End each loop at its lowest point by X then Y, as the loops the clipper links do, so that
+        // neighbouring levels start alike.
+        const auto first = grownPoints.begin() + static_cast<std::ptrdiff_t>(start);
+        const auto lowest = std::min_element(first, grownPoints.end(), [](const glm::dvec2& a, const glm::dvec2& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+        std::rotate(first, lowest + 1, grownPoints.end());
+        ScoredLoop entry{0.0, {start, grownPoints.size() - start}, true};
+        entry.area = polygonArea(spanOf(grownPoints, entry));
+        if ((entry.area < 0.0) != outer)
+        {
+            return false;
+        }
+        grown.push_back(entry);
     }
 
-    return offsetPoints;
+    if (edgesMeet(grownPoints, grown, scratch))
+    {
+        return false;
+    }
+    nestingDepths(grownPoints, grown, scratch, scratch.grownDepths);
+    return scratch.grownDepths == scratch.depths;
 }
 
 } // namespace
 
+struct ZSlicer::SliceScratch
+{
+    std::vector<Segment> segments;
+    std::vector<std::size_t> slots;
+    // Per-candidate segment counts and their offsets into segments.
+    std::vector<std::size_t> counts;
+    std::vector<std::size_t> offsets;
+    // Segment index of every triangle crossed on two edges, kNoSegment elsewhere; sized to the mesh once and
+    // reset after each level.
+    std::vector<std::uint32_t> segmentOfTriangle;
+    std::unordered_map<GridKey, std::vector<std::pair<std::size_t, bool>>, GridHash> adjacency;
+    std::vector<glm::dvec2> loopPoints;
+    std::vector<glm::dvec2> offsetPoints;
+    std::vector<LoopSpan> loops;
+    std::vector<ScoredLoop> scored;
+    GrowScratch grow;
+    PolygonClipper clipper;
+};
+
 ZSlicer::ZSlicer(const render::Model& model, double toleranceMm)
     : m_tolerance(std::max(1e-6, toleranceMm))
 {
@@ -189,38 +749,264 @@ ZSlicer::ZSlicer(const render::Model& model, double toleranceMm)
         m_minZ = 0.0;
         m_maxZ = 0.0;
     }
+
+    buildBuckets();
+    buildEdgeTwins(model);
+}
+
+void ZSlicer::buildBuckets()
+{
+    m_bucketRanges.clear();
+    m_bucketIndices.clear();
+    m_bucketBase = m_minZ - m_tolerance;
+    if (m_triangles.empty())
+    {
+        return;
+    }
+
+    const double count = static_cast<double>(m_triangles.size());
+    const double range = std::max(m_maxZ - m_minZ + 2.0 * m_tolerance, kEpsilon);
+    double extentSum = 0.0;
+    for (const Triangle& tri : m_triangles)
+    {
+        extentSum += tri.maxZ - tri.minZ + 2.0 * m_tolerance;
+    }
+    const double height = std::max({extentSum / (kBucketEntriesPerTriangle * count),
+                                    range / count,
+                                    range / static_cast<double>(kMaxBuckets)});
+    const double slots = std::clamp(std::ceil(range / height), 1.0, static_cast<double>(kMaxBuckets));
+    const auto buckets = static_cast<std::size_t>(slots);
+    m_invBucketHeight = static_cast<double>(buckets) / range;
+    m_bucketRanges.assign(buckets, {});
+
+    for (const Triangle& tri : m_triangles)
+    {
+        const std::size_t last = bucketFor(tri.maxZ + m_tolerance);
+        for (std::size_t bucket = bucketFor(tri.minZ - m_tolerance); bucket <= last; ++bucket)
+        {
+            ++m_bucketRanges[bucket].count;
+        }
+    }
+    std::uint32_t offset = 0;
+    for (BucketRange& bucket : m_bucketRanges)
+    {
+        bucket.offset = offset;
+        offset += bucket.count;
+        bucket.count = 0;
+    }
+    m_bucketIndices.resize(offset);
+    for (std::size_t index = 0; index < m_triangles.size(); ++index)
+    {
+        const Triangle& tri = m_triangles[index];
+        const std::size_t last = bucketFor(tri.maxZ + m_tolerance);
+        for (std::size_t bucket = bucketFor(tri.minZ - m_tolerance); bucket <= last; ++bucket)
+        {
+            BucketRange& slot = m_bucketRanges[bucket];
+            m_bucketIndices[slot.offset + slot.count++] = static_cast<std::uint32_t>(index);
+        }
+    }
+}
+
+void ZSlicer::buildEdgeTwins(const render::Model& model)
+{
+    const auto& vertices = model.vertices();
+    const auto& indices = model.indices();
+    const std::size_t halfEdgeCount = m_triangles.size() * 3;
+    m_edgeTwins.assign(halfEdgeCount, kNoTwin);
+    m_manifoldEdges = 0;
+    if (halfEdgeCount == 0)
+    {
+        return;
+    }
+
+    // Weld vertices at identical positions, so meshes stored as separate triangles connect too.
+    const auto position = [&](std::uint32_t vertex) {
+        const QVector3D& p = vertices[vertex].position;
+        return std::array<float, 3>{p.x(), p.y(), p.z()};
+    };
+    std::vector<std::uint32_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(std::execution::par, order.begin(), order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+        return position(lhs) < position(rhs);
+    });
+    std::vector<std::uint32_t> welded(vertices.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        const bool same = i > 0 && position(order[i]) == position(order[i - 1]);
+        welded[order[i]] = same ? welded[order[i - 1]] : order[i];
+    }
+
+    const auto endsOf = [&](std::size_t half) {
+        const std::size_t first = half - half % 3;
+        const std::uint32_t from = welded[indices[half]];
+        const std::uint32_t to = welded[indices[first + (half + 1) % 3]];
+        return std::pair<std::uint32_t, std::uint32_t>{std::min(from, to), std::max(from, to)};
+    };
+
+    // List the half-edges by their lower welded end point, CSR-style like the Z buckets, so each short
+    // list holds every half-edge that can share an edge with the others in it.
+    std::vector<std::uint32_t> listStart(vertices.size() + 1, 0);
+    for (std::size_t half = 0; half < halfEdgeCount; ++half)
+    {
+        const auto [low, high] = endsOf(half);
+        if (low != high)
+        {
+            ++listStart[low + 1];
+        }
+    }
+    std::partial_sum(listStart.begin(), listStart.end(), listStart.begin());
+    std::vector<std::uint32_t> fill(listStart.begin(), listStart.end() - 1);
+    std::vector<std::uint32_t> byLowEnd(listStart.back());
+    std::vector<std::uint32_t> highEnd(listStart.back());
+    for (std::size_t half = 0; half < halfEdgeCount; ++half)
+    {
+        const auto [low, high] = endsOf(half);
+        if (low != high)
+        {
+            highEnd[fill[low]] = high;
+            byLowEnd[fill[low]++] = static_cast<std::uint32_t>(half);
+        }
+    }
+
+    // Within a list, half-edges with the same other end are one edge; exactly two of them are twins.
+    for (std::size_t vertex = 0; vertex < vertices.size(); ++vertex)
+    {
+        for (std::uint32_t i = listStart[vertex]; i < listStart[vertex + 1]; ++i)
+        {
+            std::uint32_t matches = 0;
+            std::uint32_t twin = kNoTwin;
+            for (std::uint32_t j = listStart[vertex]; j < listStart[vertex + 1]; ++j)
+            {
+                if (j != i && highEnd[j] == highEnd[i])
+                {
+                    ++matches;
+                    twin = byLowEnd[j];
+                }
+            }
+            if (matches == 1)
+            {
+                m_edgeTwins[byLowEnd[i]] = twin;
+                m_manifoldEdges += (byLowEnd[i] < twin) ? 1 : 0;
+            }
+        }
+    }
+}
+
+std::size_t ZSlicer::bucketFor(double z) const noexcept
+{
+    const double scaled = std::floor((z - m_bucketBase) * m_invBucketHeight);
+    const double last = static_cast<double>(m_bucketRanges.size() - 1);
+    return static_cast<std::size_t>(std::clamp(scaled, 0.0, last));
+}
+
+ZSlicer::BucketRange ZSlicer::bucketAt(double planeZ) const noexcept
+{
+    if (m_bucketRanges.empty() || planeZ < m_minZ - m_tolerance || planeZ > m_maxZ + m_tolerance)
+    {
+        return {};
+    }
+    return m_bucketRanges[bucketFor(planeZ)];
+}
+
+std::size_t ZSlicer::candidateCount(double planeZ) const noexcept
+{
+    return bucketAt(planeZ).count;
 }
 
 std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
                                                      double toolRadius,
                                                      bool applyOffsetForFlat,
-                                                     SliceMode mode) const
+                                                     SliceMode mode,
+                                                     double offsetArcToleranceMm) const
 {
-    struct Segment
+    SliceScratch scratch;
+    return sliceWith(planeZ, toolRadius, applyOffsetForFlat, offsetArcToleranceMm, mode, scratch);
+}
+
+std::vector<std::vector<std::vector<glm::dvec3>>> ZSlicer::sliceLevels(std::span<const double> levels,
+                                                                       double toolRadius,
+                                                                       bool applyOffsetForFlat,
+                                                                       SliceMode mode,
+                                                                       const std::atomic<bool>* cancelFlag,
+                                                                       double offsetArcToleranceMm) const
+{
+    struct LevelRange
     {
-        glm::dvec2 a;
-        glm::dvec2 b;
-        bool used{false};
+        std::size_t begin{0};
+        std::size_t end{0};
     };
 
-    const std::size_t triangleCount = m_triangles.size();
-    if (triangleCount == 0)
+    std::vector<std::vector<std::vector<glm::dvec3>>> result(levels.size());
+    const auto cancelled = [cancelFlag] { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); };
+    const auto hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // A single level, or a single worker, slices level by level and leaves the parallelism to slice itself.
+    if (mode == SliceMode::Sequential || hardwareThreads == 1 || levels.size() < 2)
+    {
+        SliceScratch scratch;
+        for (std::size_t level = 0; level < levels.size() && !cancelled(); ++level)
+        {
+            result[level] =
+                sliceWith(levels[level], toolRadius, applyOffsetForFlat, offsetArcToleranceMm, mode, scratch);
+        }
+        return result;
+    }
+
+    std::vector<LevelRange> workItems;
+    const std::size_t chunkSize = std::max<std::size_t>(1, levels.size() / (hardwareThreads * 4));
+    for (std::size_t level = 0; level < levels.size(); level += chunkSize)
+    {
+        workItems.push_back(LevelRange{level, std::min(levels.size(), level + chunkSize)});
+    }
+
+    std::for_each(std::execution::par, workItems.begin(), workItems.end(), [&](const LevelRange& range) {
+        SliceScratch scratch;
+        for (std::size_t level = range.begin; level < range.end && !cancelled(); ++level)
+        {
+            result[level] = sliceWith(levels[level],
+                                      toolRadius,
+                                      applyOffsetForFlat,
+                                      offsetArcToleranceMm,
+                                      SliceMode::Sequential,
+                                      scratch);
+        }
+    });
+    return result;
+}
+
+std::vector<std::vector<glm::dvec3>> ZSlicer::sliceWith(double planeZ,
+                                                         double toolRadius,
+                                                         bool applyOffsetForFlat,
+                                                         double offsetArcTolerance,
+                                                         SliceMode mode,
+                                                         SliceScratch& scratch) const
+{
+    // Only the triangles listed in the plane's bucket can cross it; the exact test below still rejects
+    // those that end just short of the plane.
+    const BucketRange bucket = bucketAt(planeZ);
+    const std::uint32_t* candidates = m_bucketIndices.data() + bucket.offset;
+    const std::size_t candidateCount = bucket.count;
+    if (candidateCount == 0)
     {
         return {};
     }
 
     const double toleranceSq = m_tolerance * m_tolerance;
 
-    const auto computeSegmentsForTriangle = [&](std::size_t triIndex) -> std::vector<Segment> {
-        std::vector<Segment> local;
+    // Writes the triangle's segments to out, which has room for kMaxSegmentsPerTriangle, and returns how
+    // many there are.
+    const auto segmentsForTriangle = [&](std::size_t triIndex, Segment* out) -> std::size_t {
         const Triangle& tri = m_triangles[triIndex];
         if (planeZ < tri.minZ - m_tolerance || planeZ > tri.maxZ + m_tolerance)
         {
-            return local;
+            return 0;
         }
 
-        std::vector<glm::dvec3> intersections;
-        intersections.reserve(4);
+        std::array<glm::dvec3, kMaxPlanePoints> intersections;
+        std::size_t intersectionCount = 0;
+        std::array<std::int8_t, 3> crossedEdges{};
+        std::size_t crossedCount = 0;
+        bool touchesVertex = false;
 
         const std::array<glm::dvec3, 3> verts = {tri.v0, tri.v1, tri.v2};
         const std::array<int, 3> edgesStart = {0, 1, 2};
@@ -236,38 +1022,40 @@ std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
             const bool on0 = std::abs(d0) <= m_tolerance;
             const bool on1 = std::abs(d1) <= m_tolerance;
 
+            touchesVertex = touchesVertex || on0 || on1;
             if (on0 && on1)
             {
-                intersections.push_back(v0);
-                intersections.push_back(v1);
+                intersections[intersectionCount++] = v0;
+                intersections[intersectionCount++] = v1;
                 continue;
             }
             if (on0)
             {
-                intersections.push_back(v0);
+                intersections[intersectionCount++] = v0;
                 continue;
             }
             if (on1)
             {
-                intersections.push_back(v1);
+                intersections[intersectionCount++] = v1;
                 continue;
             }
             if ((d0 > 0.0 && d1 < 0.0) || (d0 < 0.0 && d1 > 0.0))
             {
                 const double t = d0 / (d0 - d1);
-                const glm::dvec3 p = v0 + t * (v1 - v0);
-                intersections.push_back(p);
+                intersections[intersectionCount++] = v0 + t * (v1 - v0);
+                crossedEdges[crossedCount++] = static_cast<std::int8_t>(e);
             }
         }
 
-        std::vector<glm::dvec3> uniquePoints;
-        uniquePoints.reserve(intersections.size());
-        for (const glm::dvec3& p : intersections)
+        std::array<glm::dvec2, kMaxPlanePoints> uniquePoints;
+        std::size_t uniqueCount = 0;
+        for (std::size_t i = 0; i < intersectionCount; ++i)
         {
+            const glm::dvec2 p(intersections[i].x, intersections[i].y);
             bool duplicate = false;
-            for (const glm::dvec3& existing : uniquePoints)
+            for (std::size_t j = 0; j < uniqueCount; ++j)
             {
-                if (lengthSquared(glm::dvec2(existing) - glm::dvec2(p)) <= toleranceSq)
+                if (lengthSquared(uniquePoints[j] - p) <= toleranceSq)
                 {
                     duplicate = true;
                     break;
@@ -275,84 +1063,126 @@ std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
             }
             if (!duplicate)
             {
-                uniquePoints.push_back(p);
+                uniquePoints[uniqueCount++] = p;
             }
         }
 
-        if (uniquePoints.size() < 2)
-        {
-            return local;
-        }
-
-        const auto addSegmentLocal = [&](const glm::dvec2& a, const glm::dvec2& b) {
-            if (lengthSquared(a - b) <= toleranceSq)
-            {
-                return;
-            }
-            local.push_back({a, b, false});
-        };
-
-        if (uniquePoints.size() == 2)
+        // Two points form the segment; more pair up in order. Only a triangle crossed inside two of its
+        // edges knows which neighbours its segment continues into.
+        const bool crossedTwice = !touchesVertex && crossedCount == 2 && uniqueCount == 2;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i + 1 < uniqueCount; i += 2)
         {
-            addSegmentLocal(glm::dvec2(uniquePoints[0].x, uniquePoints[0].y),
-                            glm::dvec2(uniquePoints[1].x, uniquePoints[1].y));
-        }
-        else
-        {
-            for (std::size_t i = 0; i + 1 < uniquePoints.size(); i += 2)
+            if (lengthSquared(uniquePoints[i] - uniquePoints[i + 1]) > toleranceSq)
             {
-                addSegmentLocal(glm::dvec2(uniquePoints[i].x, uniquePoints[i].y),
-                                glm::dvec2(uniquePoints[i + 1].x, uniquePoints[i + 1].y));
+                Segment& segment = out[count++];
+                segment = {uniquePoints[i], uniquePoints[i + 1], false, -1, -1, static_cast<std::uint32_t>(triIndex)};
+                if (crossedTwice)
+                {
+                    segment.edgeA = crossedEdges[0];
+                    segment.edgeB = crossedEdges[1];
+                }
             }
         }
-
-        return local;
+        return count;
     };
 
-    const bool runParallel = (mode == SliceMode::Parallel) && triangleCount >= 128;
+    const bool runParallel = (mode == SliceMode::Parallel) && candidateCount >= 128;
 
-    std::vector<std::vector<Segment>> perTriangleSegments(triangleCount);
+    std::vector<Segment>& segments = scratch.segments;
+    segments.clear();
     if (runParallel)
     {
-        std::vector<std::size_t> indices(triangleCount);
-        std::iota(indices.begin(), indices.end(), 0);
-        std::for_each(std::execution::par, indices.begin(), indices.end(), [&](std::size_t index) {
-            perTriangleSegments[index] = computeSegmentsForTriangle(index);
+        // Count each candidate's segments, turn the counts into offsets, then have every candidate write its
+        // segments straight to its offset in the flat array, which keeps them in candidate order.
+        scratch.slots.resize(candidateCount);
+        std::iota(scratch.slots.begin(), scratch.slots.end(), 0);
+        scratch.counts.resize(candidateCount);
+        scratch.offsets.resize(candidateCount);
+        std::for_each(std::execution::par, scratch.slots.begin(), scratch.slots.end(), [&](std::size_t index) {
+            std::array<Segment, kMaxSegmentsPerTriangle> local;
+            scratch.counts[index] = segmentsForTriangle(candidates[index], local.data());
+        });
+
+        // Scanning in place gives wrong offsets with the parallel policy in some standard libraries.
+        std::exclusive_scan(std::execution::par,
+                            scratch.counts.begin(),
+                            scratch.counts.end(),
+                            scratch.offsets.begin(),
+                            std::size_t{0});
+        segments.resize(scratch.offsets.back() + scratch.counts.back());
+        std::for_each(std::execution::par, scratch.slots.begin(), scratch.slots.end(), [&](std::size_t index) {
+            if (scratch.counts[index] > 0)
+            {
+                segmentsForTriangle(candidates[index], segments.data() + scratch.offsets[index]);
+            }
         });
     }
     else
     {
-        for (std::size_t index = 0; index < triangleCount; ++index)
+        std::array<Segment, kMaxSegmentsPerTriangle> local;
+        for (std::size_t index = 0; index < candidateCount; ++index)
         {
-            perTriangleSegments[index] = computeSegmentsForTriangle(index);
+            const std::size_t count = segmentsForTriangle(candidates[index], local.data());
+            segments.insert(segments.end(), local.begin(), local.begin() + static_cast<std::ptrdiff_t>(count));
         }
     }
 
-    std::vector<Segment> segments;
-    std::size_t totalSegments = 0;
-    for (const auto& bucket : perTriangleSegments)
-    {
-        totalSegments += bucket.size();
-    }
-    segments.reserve(std::max<std::size_t>(totalSegments, 256));
-    for (auto& bucket : perTriangleSegments)
-    {
-        segments.insert(segments.end(),
-                        std::make_move_iterator(bucket.begin()),
-                        std::make_move_iterator(bucket.end()));
-    }
+    // A segment end inside a triangle edge continues into the segment of the triangle across that edge, so
+    // most of each loop is walked along the mesh's edge twins. Only ends the topology cannot place (vertices
+    // on the plane, open or non-manifold edges, neighbours that touch the plane at a vertex) are matched
+    // by position through the hash.
+    std::vector<std::uint32_t>& segmentOfTriangle = scratch.segmentOfTriangle;
+    if (segmentOfTriangle.size() != m_triangles.size())
+    {
+        segmentOfTriangle.assign(m_triangles.size(), kNoSegment);
+    }
+    for (std::size_t i = 0; i < segments.size(); ++i)
+    {
+        if (segments[i].edgeA >= 0)
+        {
+            segmentOfTriangle[segments[i].triangle] = static_cast<std::uint32_t>(i);
+        }
+    }
 
-    std::unordered_map<GridKey, std::vector<std::pair<std::size_t, bool>>, GridHash> adjacency;
-    adjacency.reserve(segments.size() * 2);
+    // Finds the segment across the edge under one end of segment `index`, and which of its ends is there.
+    const auto linkedSegment = [&](std::size_t index, bool atB, std::size_t& next, bool& nextAtB) {
+        const Segment& seg = segments[index];
+        const int edge = atB ? seg.edgeB : seg.edgeA;
+        if (edge < 0)
+        {
+            return false;
+        }
+        const std::uint32_t twin = m_edgeTwins[std::size_t{seg.triangle} * 3 + static_cast<std::size_t>(edge)];
+        if (twin == kNoTwin || segmentOfTriangle[twin / 3] == kNoSegment)
+        {
+            return false;
+        }
+        next = segmentOfTriangle[twin / 3];
+        const auto twinEdge = static_cast<int>(twin % 3);
+        nextAtB = segments[next].edgeB == twinEdge;
+        return nextAtB || segments[next].edgeA == twinEdge;
+    };
 
+    auto& adjacency = scratch.adjacency;
+    adjacency.clear();
     for (std::size_t i = 0; i < segments.size(); ++i)
     {
-        adjacency[quantize(segments[i].a, m_tolerance)].push_back({i, true});
-        adjacency[quantize(segments[i].b, m_tolerance)].push_back({i, false});
+        std::size_t next = 0;
+        bool nextAtB = false;
+        if (!linkedSegment(i, false, next, nextAtB))
+        {
+            adjacency[quantize(segments[i].a, m_tolerance)].push_back({i, true});
+        }
+        if (!linkedSegment(i, true, next, nextAtB))
+        {
+            adjacency[quantize(segments[i].b, m_tolerance)].push_back({i, false});
+        }
     }
 
-    std::vector<std::vector<glm::dvec2>> loops2d;
-    loops2d.reserve(segments.size() / 3 + 1);
+    std::vector<glm::dvec2>& loopPoints = scratch.loopPoints;
+    loopPoints.clear();
+    scratch.loops.clear();
 
     for (std::size_t i = 0; i < segments.size(); ++i)
     {
@@ -361,56 +1191,39 @@ std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
             continue;
         }
 
-        std::vector<glm::dvec2> loop;
-        loop.reserve(32);
-
+        const std::size_t loopStart = loopPoints.size();
         Segment* startSegment = &segments[i];
         startSegment->used = true;
-        loop.push_back(startSegment->a);
-        loop.push_back(startSegment->b);
+        loopPoints.push_back(startSegment->a);
+        loopPoints.push_back(startSegment->b);
 
         glm::dvec2 currentPoint = startSegment->b;
-        GridKey currentKey = quantize(currentPoint, m_tolerance);
+        std::size_t current = i;
+        bool currentAtB = true;
 
         bool closed = false;
         while (true)
         {
-            bool found = false;
-            auto it = adjacency.find(currentKey);
-            if (it != adjacency.end())
+            // The segment the loop continues into and the end it enters at.
+            std::size_t next = 0;
+            bool enteredAtB = false;
+            bool found = linkedSegment(current, currentAtB, next, enteredAtB) && !segments[next].used;
+            if (!found)
             {
-                for (const auto& entry : it->second)
+                auto it = adjacency.find(quantize(currentPoint, m_tolerance));
+                if (it != adjacency.end())
                 {
-                    Segment& seg = segments[entry.first];
-                    if (seg.used)
-                    {
-                        continue;
-                    }
-
-                    glm::dvec2 nextPoint;
-                    if (entry.second)
+                    for (const auto& entry : it->second)
                     {
-                        if (!nearlyEqual2D(seg.a, currentPoint, m_tolerance))
+                        const Segment& seg = segments[entry.first];
+                        if (!seg.used && nearlyEqual2D(entry.second ? seg.a : seg.b, currentPoint, m_tolerance))
                         {
-                            continue;
+                            next = entry.first;
+                            enteredAtB = !entry.second;
+                            found = true;
+                            break;
                         }
-                        nextPoint = seg.b;
                     }
-                    else
-                    {
-                        if (!nearlyEqual2D(seg.b, currentPoint, m_tolerance))
-                        {
-                            continue;
-                        }
-                        nextPoint = seg.a;
-                    }
-
-                    seg.used = true;
-                    loop.push_back(nextPoint);
-                    currentPoint = nextPoint;
-                    currentKey = quantize(currentPoint, m_tolerance);
-                    found = true;
-                    break;
                 }
             }
 
@@ -419,52 +1232,90 @@ std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
                 break;
             }
 
-            if (nearlyEqual2D(currentPoint, loop.front(), m_tolerance))
+            Segment& seg = segments[next];
+            seg.used = true;
+            current = next;
+            currentAtB = !enteredAtB;
+            currentPoint = currentAtB ? seg.b : seg.a;
+            loopPoints.push_back(currentPoint);
+
+            if (nearlyEqual2D(currentPoint, loopPoints[loopStart], m_tolerance))
             {
                 closed = true;
                 break;
             }
         }
 
-        if (!closed)
+        const std::size_t loopSize = loopPoints.size() - loopStart;
+        if (!closed || loopSize <= 2)
         {
+            loopPoints.resize(loopStart);
             continue;
         }
 
-        if (loop.size() > 2)
-        {
-            loop.pop_back();
-            loops2d.push_back(std::move(loop));
-        }
+        // The closing point repeats the first.
+        loopPoints.pop_back();
+        scratch.loops.push_back({loopStart, loopSize - 1});
+    }
+
+    for (const Segment& seg : segments)
+    {
+        segmentOfTriangle[seg.triangle] = kNoSegment;
     }
 
     std::vector<std::vector<glm::dvec3>> loops3d;
-    if (loops2d.empty())
+    if (scratch.loops.empty())
     {
         return loops3d;
     }
 
-    struct ScoredLoop
-    {
-        double area;
-        std::vector<glm::dvec2> points;
+    const auto pointsOf = [&](const ScoredLoop& loop) {
+        const std::vector<glm::dvec2>& points = loop.offset ? scratch.offsetPoints : loopPoints;
+        return std::span<const glm::dvec2>(points.data() + loop.points.offset, loop.points.count);
     };
 
-    std::vector<ScoredLoop> scored;
-    scored.reserve(loops2d.size());
-    for (auto& loop : loops2d)
+    std::vector<ScoredLoop>& scored = scratch.scored;
+    scored.clear();
+    scratch.offsetPoints.clear();
+    for (const LoopSpan& loop : scratch.loops)
     {
-        const double area = polygonArea(loop);
-        if (std::abs(area) <= kEpsilon)
+        ScoredLoop entry{0.0, loop, false};
+        entry.area = polygonArea(pointsOf(entry));
+        if (std::abs(entry.area) > kEpsilon)
         {
-            continue;
+            scored.push_back(entry);
         }
+    }
 
-        if (applyOffsetForFlat && toolRadius > kEpsilon)
+    // The flat end keeps out of the region the loops enclose, nested loops alternating between material
+    // and pockets. Growing that region by the radius moves outer walls out, shrinks or closes pockets and
+    // merges loops that grow into each other. Most levels grow loop by loop, the clipper taking only loops
+    // that fold too tightly to trim; levels whose grown loops would cross or swallow each other go through
+    // the clipper whole. The grown loops are reversed to run with the material on their right, like the
+    // traced ones.
+    if (applyOffsetForFlat && toolRadius > kEpsilon && !scored.empty())
+    {
+        // Arcs finer than the tolerance the loop points are welded at would only add points.
+        const double arcTolerance = std::max(offsetArcTolerance, m_tolerance);
+        if (growLoopsApart(loopPoints, scored, toolRadius, arcTolerance, scratch.grow, scratch.clipper,
+                           scratch.offsetPoints))
+        {
+            scored.swap(scratch.grow.grown);
+        }
+        else
         {
-            loop = offsetLoop(loop, toolRadius, area);
+            scratch.offsetPoints.clear();
+            for (const ScoredLoop& entry : scored)
+            {
+                scratch.clipper.addPath(pointsOf(entry));
+            }
+            scored.clear();
+            for (const Path2& path : scratch.clipper.offset(toolRadius, FillRule::EvenOdd, arcTolerance))
+            {
+                scored.push_back({-polygonArea(path), {scratch.offsetPoints.size(), path.size()}, true});
+                scratch.offsetPoints.insert(scratch.offsetPoints.end(), path.rbegin(), path.rend());
+            }
         }
-        scored.push_back({polygonArea(loop), std::move(loop)});
     }
 
     if (scored.empty())
@@ -479,9 +1330,10 @@ std::vector<std::vector<glm::dvec3>> ZSlicer::slice(double planeZ,
     loops3d.reserve(scored.size());
     for (const auto& entry : scored)
     {
+        const std::span<const glm::dvec2> points = pointsOf(entry);
         std::vector<glm::dvec3> loop3d;
-        loop3d.reserve(entry.points.size() + 1);
-        for (const glm::dvec2& p : entry.points)
+        loop3d.reserve(points.size() + 1);
+        for (const glm::dvec2& p : points)
         {
             loop3d.push_back({p.x, p.y, planeZ});
         }
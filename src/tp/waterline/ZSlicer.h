@@ -4,6 +4,10 @@
 
 #include <glm/vec3.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 namespace tp::waterline
@@ -14,16 +18,25 @@ class ZSlicer
 public:
     explicit ZSlicer(const render::Model& model, double toleranceMm = 1e-4);
 
+    // Default for the largest gap between the grown loops' rounded corners and the true arcs.
+    static constexpr double kDefaultOffsetArcToleranceMm = 1e-3;
+
     enum class SliceMode
     {
         Sequential,
         Parallel
     };
 
+    // Closed loops where the plane cuts the mesh, largest first. With applyOffsetForFlat the region they
+    // enclose, taken by the even-odd rule, is grown by toolRadius with rounded corners; loops that grow
+    // into each other merge, and the grown loops run with the material on their right. The corners' arcs
+    // are tessellated outside the true arcs by at most offsetArcToleranceMm, and never more finely than
+    // the slicer's own tolerance.
     std::vector<std::vector<glm::dvec3>> slice(double planeZ,
                                                double toolRadius,
                                                bool applyOffsetForFlat,
-                                               SliceMode mode) const;
+                                               SliceMode mode,
+                                               double offsetArcToleranceMm = kDefaultOffsetArcToleranceMm) const;
 
     std::vector<std::vector<glm::dvec3>> slice(double planeZ,
                                                double toolRadius,
@@ -32,9 +45,28 @@ public:
         return slice(planeZ, toolRadius, applyOffsetForFlat, SliceMode::Parallel);
     }
 
+    // Slices every level in one call; entry i holds exactly the loops slice(levels[i], ...) returns. In
+    // parallel mode the workers take contiguous runs of levels and reuse one set of scratch buffers for
+    // all the levels in a run. Levels not yet sliced when cancelFlag is raised come back empty.
+    std::vector<std::vector<std::vector<glm::dvec3>>> sliceLevels(std::span<const double> levels,
+                                                                  double toolRadius,
+                                                                  bool applyOffsetForFlat,
+                                                                  SliceMode mode = SliceMode::Parallel,
+                                                                  const std::atomic<bool>* cancelFlag = nullptr,
+                                                                  double offsetArcToleranceMm =
+                                                                      kDefaultOffsetArcToleranceMm) const;
+
     [[nodiscard]] double minZ() const noexcept { return m_minZ; }
     [[nodiscard]] double maxZ() const noexcept { return m_maxZ; }
 
+    // Triangles slice() examines at planeZ: the Z bucket holding the plane lists every triangle whose Z
+    // range, widened by the tolerance, reaches into it.
+    [[nodiscard]] std::size_t candidateCount(double planeZ) const noexcept;
+    [[nodiscard]] std::size_t bucketCount() const noexcept { return m_bucketRanges.size(); }
+    // Edges shared by exactly two triangles once vertices at identical positions are welded; loops are
+    // walked across these without matching end points by position.
+    [[nodiscard]] std::size_t manifoldEdgeCount() const noexcept { return m_manifoldEdges; }
+
 private:
     struct Triangle
     {
@@ -45,10 +77,39 @@ private:
         double maxZ{0.0};
     };
 
+    struct BucketRange
+    {
+        std::uint32_t offset{0};
+        std::uint32_t count{0};
+    };
+
+    // Segment, adjacency and loop buffers one slice works in, kept between the levels of a batch.
+    struct SliceScratch;
+
+    void buildBuckets();
+    void buildEdgeTwins(const render::Model& model);
+    [[nodiscard]] std::size_t bucketFor(double z) const noexcept;
+    [[nodiscard]] BucketRange bucketAt(double planeZ) const noexcept;
+    std::vector<std::vector<glm::dvec3>> sliceWith(double planeZ,
+                                                   double toolRadius,
+                                                   bool applyOffsetForFlat,
+                                                   double offsetArcTolerance,
+                                                   SliceMode mode,
+                                                   SliceScratch& scratch) const;
+
     double m_tolerance{1e-4};
     double m_minZ{0.0};
     double m_maxZ{0.0};
     std::vector<Triangle> m_triangles;
+    // Uniform Z buckets from m_minZ - m_tolerance; each lists the triangles reaching into it in index order.
+    double m_bucketBase{0.0};
+    double m_invBucketHeight{0.0};
+    std::vector<BucketRange> m_bucketRanges;
+    std::vector<std::uint32_t> m_bucketIndices;
+    // Half-edge 3 * triangle + k (corner k to corner k + 1) to the other triangle's half-edge on the same
+    // edge, or all ones on open and non-manifold edges.
+    std::vector<std::uint32_t> m_edgeTwins;
+    std::size_t m_manifoldEdges{0};
 };
 
 #ifdef TP_ENABLE_ZSLICER_BENCHMARK
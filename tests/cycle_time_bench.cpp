@@ -0,0 +1,105 @@
+#include "tp/CycleTime.h"
+
+#include "common/log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Benchmark: cycle-time estimation throughput on corner-heavy paths, where most moves are too short to
+// reach the feed and every one needs its S-curve peak.
+// Build: cmake --build <build-dir> --target cycle_time_bench
+// Run:   cycle_time_bench [segments]
+
+namespace
+{
+
+constexpr double kFeed = 3'000.0;
+constexpr double kPi = 3.14159265358979323846;
+
+tp::Polyline makePolyline(const std::vector<glm::vec3>& points)
+{
+    tp::Polyline poly;
+    poly.pts.reserve(points.size());
+    for (const glm::vec3& p : points)
+    {
+        poly.pts.push_back({p});
+    }
+    poly.motion = tp::MotionType::Cut;
+    return poly;
+}
+
+// Zigzag at 0.2-0.6 mm per segment with a hard corner at every vertex: the worst case.
+std::vector<glm::vec3> makeZigzag(int segments)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> step(0.2f, 0.6f);
+    std::vector<glm::vec3> points;
+    points.reserve(static_cast<std::size_t>(segments) + 1);
+    glm::vec3 p(0.0f);
+    for (int i = 0; i <= segments; ++i)
+    {
+        points.push_back(p);
+        p += glm::vec3(step(rng), (i % 2 == 0) ? step(rng) : -step(rng), 0.0f);
+    }
+    return points;
+}
+
+// Helix of 0.5 mm radius in 16 segments per turn, like the smallest waterline loops: every corner is
+// the same, so entry and exit speeds match.
+std::vector<glm::vec3> makeSmallHelix(int segments)
+{
+    std::vector<glm::vec3> points;
+    points.reserve(static_cast<std::size_t>(segments) + 1);
+    for (int i = 0; i <= segments; ++i)
+    {
+        const double angle = 2.0 * kPi * static_cast<double>(i) / 16.0;
+        points.emplace_back(static_cast<float>(0.5 * std::cos(angle)),
+                            static_cast<float>(0.5 * std::sin(angle)),
+                            static_cast<float>(-1e-5 * static_cast<double>(i)));
+    }
+    return points;
+}
+
+std::string timeEstimate(const char* name, const std::vector<glm::vec3>& points)
+{
+    tp::Machine machine = tp::makeDefaultMachine();
+    machine.maxAccel_mm_s2 = 500.0;
+    machine.maxJerk_mm_s3 = 10'000.0;
+    machine.junctionDeviation_mm = 0.01;
+    tp::CycleTimeEstimator estimator(machine);
+    const std::vector<tp::Polyline> path{makePolyline(points)};
+
+    // Best of a few runs; the first one also warms the estimator's buffers.
+    double bestMs = std::numeric_limits<double>::infinity();
+    tp::CycleTimeEstimate estimate;
+    for (int run = 0; run < 3; ++run)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        estimate = estimator.estimate(path, kFeed, 0.0);
+        bestMs = std::min(bestMs,
+                          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::ostringstream line;
+    line << name << ": segments=" << estimate.segments << ", elapsed_ms=" << bestMs
+         << ", M_segments_per_s=" << static_cast<double>(estimate.segments) / bestMs / 1e3
+         << ", estimate_s=" << estimate.total_s;
+    return line.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int segments = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 2'000'000;
+    LOG_INFO(Tp, timeEstimate("zigzag", makeZigzag(segments)));
+    LOG_INFO(Tp, timeEstimate("small helix", makeSmallHelix(segments)));
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "ai/IPathAI.h"
+#include "io/ModelImporter.h"
+#include "render/Model.h"
+#include "tp/Machine.h"
+#include "tp/Toolpath.h"
+#include "tp/ToolpathGenerator.h"
+
+#include "common/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Benchmark: raster generation throughput with row-major, tiled and lazily built tiled height fields.
+// The cold run also reports the time until the first raster row is done (time to first polyline).
+// Build: cmake --build <build-dir> --target heightfield_layout_bench
+// Run:   heightfield_layout_bench [scale] [model.stl ...]
+// Without model arguments the STL files in samples/ are used. Models are scaled in XY so the small
+// samples produce fields large enough to fall out of cache (scale 10 gives ~2000x2000 samples).
+
+#ifndef CNCTC_SOURCE_DIR
+#error "CNCTC_SOURCE_DIR must be defined"
+#endif
+
+namespace
+{
+
+class FixedAI : public ai::IPathAI
+{
+public:
+    explicit FixedAI(ai::StrategyDecision decision)
+        : m_decision(std::move(decision))
+    {
+    }
+
+    ai::StrategyDecision predict(const render::Model&, const tp::UserParams&) override
+    {
+        return m_decision;
+    }
+
+private:
+    ai::StrategyDecision m_decision{};
+};
+
+render::Model scaled(const render::Model& source, double scale)
+{
+    std::vector<render::Vertex> vertices = source.vertices();
+    for (render::Vertex& vertex : vertices)
+    {
+        vertex.position.setX(static_cast<float>(vertex.position.x() * scale));
+        vertex.position.setY(static_cast<float>(vertex.position.y() * scale));
+    }
+    render::Model model;
+    model.setMeshData(std::move(vertices), source.indices());
+    return model;
+}
+
+std::size_t countPoints(const tp::Toolpath& toolpath)
+{
+    std::size_t points = 0;
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        points += poly.pts.size();
+    }
+    return points;
+}
+
+double generateMs(const render::Model& model,
+                  tp::UserParams& params,
+                  double angleDeg,
+                  std::size_t& points,
+                  double* firstRowMs = nullptr)
+{
+    ai::StrategyDecision decision;
+    ai::StrategyStep step;
+    step.type = ai::StrategyStep::Type::Raster;
+    step.stepover = params.stepOver;
+    step.stepdown = params.maxDepthPerPass;
+    step.angle_deg = angleDeg;
+    step.finish_pass = true;
+    decision.steps.push_back(step);
+    params.rasterAngleDeg = angleDeg;
+
+    FixedAI ai(decision);
+    tp::ToolpathGenerator generator;
+    std::atomic<bool> cancel{false};
+    const auto start = std::chrono::steady_clock::now();
+    // The first callback reports 0% before any pass starts; the second follows the first raster row.
+    int callbacks = 0;
+    const auto progress = [&](int) {
+        if (++callbacks == 2 && firstRowMs)
+        {
+            *firstRowMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+    const tp::Toolpath toolpath = generator.generate(model, params, ai, cancel, progress);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    points = countPoints(toolpath);
+    return ms;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const double scale = (argc > 1) ? std::max(0.1, std::atof(argv[1])) : 10.0;
+
+    std::vector<std::filesystem::path> files;
+    for (int i = 2; i < argc; ++i)
+    {
+        files.emplace_back(argv[i]);
+    }
+    if (files.empty())
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(CNCTC_SOURCE_DIR) / "samples"))
+        {
+            if (entry.path().extension() == ".stl")
+            {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+    }
+
+    constexpr double kAngles[] = {0.0, 45.0, 90.0};
+    io::ModelImporter importer;
+    for (const std::filesystem::path& file : files)
+    {
+        render::Model loaded;
+        std::string error;
+        if (!importer.load(file, loaded, error) || !loaded.isValid())
+        {
+            LOG_ERR(Tp, "Height field layout benchmark could not load " + file.string() + ": " + error);
+            return 1;
+        }
+        const render::Model model = scaled(loaded, scale);
+
+        tp::UserParams params;
+        params.enableRoughPass = false;
+        params.stockAllowance_mm = 0.0;
+        params.leaveStock_mm = 0.0;
+        params.maxDepthPerPass = 100.0;
+        params.toolDiameter = 3.0;
+        params.stepOver = 0.2; // 0.1 mm lattice, the finest the generator builds
+        params.machine = tp::makeDefaultMachine();
+        params.stock = tp::makeDefaultStock();
+        params.stock.topZ_mm = static_cast<double>(model.bounds().max.z()) + 2.0;
+
+        struct Variant
+        {
+            const char* name;
+            bool tiled;
+            bool lazy;
+        };
+        for (const Variant& variant : {Variant{"row-major", false, false},
+                                       Variant{"tiled", true, false},
+                                       Variant{"tiled-lazy", true, true}})
+        {
+            // Dropping the capacity clears the cache so the first run measures the build.
+            tp::ToolpathGenerator::setHeightFieldCacheCapacity(0);
+            tp::ToolpathGenerator::setHeightFieldCacheCapacity(std::size_t{1} << 30);
+            tp::ToolpathGenerator::setHeightFieldTiling(variant.tiled);
+            tp::ToolpathGenerator::setHeightFieldLazyBuild(variant.lazy);
+
+            std::size_t points = 0;
+            double firstRowMs = 0.0;
+            const double coldMs = generateMs(model, params, 0.0, points, &firstRowMs);
+
+            std::ostringstream summary;
+            summary << "Height field layout benchmark: model=" << file.filename().string()
+                    << ", scale=" << scale
+                    << ", layout=" << variant.name
+                    << ", cold_ms=" << coldMs
+                    << ", first_row_ms=" << firstRowMs;
+            for (const double angle : kAngles)
+            {
+                const double ms = generateMs(model, params, angle, points);
+                summary << ", warm_" << angle << "deg_ms=" << ms
+                        << " (" << (ms > 0.0 ? static_cast<double>(points) / ms : 0.0) << " pts/ms)";
+            }
+            LOG_INFO(Tp, summary.str());
+        }
+    }
+
+    tp::ToolpathGenerator::setHeightFieldTiling(false);
+    tp::ToolpathGenerator::setHeightFieldLazyBuild(false);
+    return 0;
+}
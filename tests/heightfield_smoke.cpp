@@ -1,13 +1,23 @@
+#include "tp/heightfield/AdaptiveHeightField.h"
 #include "tp/heightfield/HeightField.h"
+#include "tp/heightfield/HeightFieldDiskCache.h"
+#include "tp/heightfield/MaxZPyramid.h"
 #include "tp/heightfield/UniformGrid.h"
 
 #include "render/Model.h"
 
 #include <QtGui/QVector3D>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace
@@ -18,6 +28,696 @@ double planeZ(double x, double y)
     return 0.1 * x + 0.2 * y;
 }
 
+bool sameBits(double lhs, double rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+}
+
+render::Model makeWavySurface(int divisions, float size)
+{
+    render::Model model;
+    std::vector<render::Vertex> vertices;
+    std::vector<render::Model::Index> indices;
+    const float step = size / static_cast<float>(divisions);
+    for (int iy = 0; iy <= divisions; ++iy)
+    {
+        for (int ix = 0; ix <= divisions; ++ix)
+        {
+            const float x = static_cast<float>(ix) * step;
+            const float y = static_cast<float>(iy) * step;
+            render::Vertex v;
+            v.position = QVector3D(x, y, 1.5f * std::sin(x * 0.7f) * std::cos(y * 0.4f));
+            v.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices.push_back(v);
+        }
+    }
+    const auto vertexIndex = [divisions](int ix, int iy) {
+        return static_cast<render::Model::Index>(iy * (divisions + 1) + ix);
+    };
+    for (int iy = 0; iy < divisions; ++iy)
+    {
+        for (int ix = 0; ix < divisions; ++ix)
+        {
+            indices.push_back(vertexIndex(ix, iy));
+            indices.push_back(vertexIndex(ix + 1, iy));
+            indices.push_back(vertexIndex(ix + 1, iy + 1));
+            indices.push_back(vertexIndex(ix, iy));
+            indices.push_back(vertexIndex(ix + 1, iy + 1));
+            indices.push_back(vertexIndex(ix, iy + 1));
+        }
+    }
+    model.setMeshData(vertices, indices);
+    return model;
+}
+
+void addQuad(std::vector<render::Vertex>& vertices,
+             std::vector<render::Model::Index>& indices,
+             float x0,
+             float y0,
+             float x1,
+             float y1,
+             float z)
+{
+    const auto base = static_cast<render::Model::Index>(vertices.size());
+    for (const auto& [x, y] : {std::pair{x0, y0}, std::pair{x1, y0}, std::pair{x1, y1}, std::pair{x0, y1}})
+    {
+        render::Vertex v;
+        v.position = QVector3D(x, y, z);
+        v.normal = QVector3D(0.0f, 0.0f, 1.0f);
+        vertices.push_back(v);
+    }
+    for (const render::Model::Index offset : {0u, 1u, 2u, 0u, 2u, 3u})
+    {
+        indices.push_back(base + offset);
+    }
+}
+
+// Flat plate with a boss and a rib narrower than two lattice steps.
+render::Model makeMoldPlate()
+{
+    render::Model model;
+    std::vector<render::Vertex> vertices;
+    std::vector<render::Model::Index> indices;
+    addQuad(vertices, indices, 0.0f, 0.0f, 40.0f, 40.0f, 0.0f);
+    addQuad(vertices, indices, 14.0f, 14.0f, 22.0f, 20.0f, 5.0f);
+    addQuad(vertices, indices, 5.03f, 26.0f, 5.18f, 36.0f, 3.0f);
+    model.setMeshData(vertices, indices);
+    return model;
+}
+
+// Spherical cap over a size x size square, rising 4 mm at its centre, on a regular triangulation.
+render::Model makeDome(int divisions, float size)
+{
+    render::Model model;
+    std::vector<render::Vertex> vertices;
+    std::vector<render::Model::Index> indices;
+    const float step = size / static_cast<float>(divisions);
+    const float half = 0.5f * size;
+    const float radius = 2.0f * size;
+    for (int iy = 0; iy <= divisions; ++iy)
+    {
+        for (int ix = 0; ix <= divisions; ++ix)
+        {
+            const float x = static_cast<float>(ix) * step;
+            const float y = static_cast<float>(iy) * step;
+            const float r2 = (x - half) * (x - half) + (y - half) * (y - half);
+            render::Vertex v;
+            v.position = QVector3D(x, y, std::sqrt(radius * radius - r2) - radius + 4.0f);
+            v.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices.push_back(v);
+        }
+    }
+    for (int iy = 0; iy < divisions; ++iy)
+    {
+        for (int ix = 0; ix < divisions; ++ix)
+        {
+            const auto base = static_cast<render::Model::Index>(iy * (divisions + 1) + ix);
+            const auto above = static_cast<render::Model::Index>(base + divisions + 1);
+            for (const render::Model::Index index : {base, base + 1, above + 1, base, above + 1, above})
+            {
+                indices.push_back(index);
+            }
+        }
+    }
+    model.setMeshData(vertices, indices);
+    return model;
+}
+
+// Every SIMD level must match the scalar kernel bit for bit, and the batched row query must match a
+// brute-force max over sampleTriangleAt.
+void checkRowKernels()
+{
+    using namespace tp::heightfield;
+
+    const render::Model model = makeWavySurface(24, 12.0f);
+    const UniformGrid grid(model, 1.0);
+    const tp::TriangleGrid& triangles = grid.triangles();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    const std::size_t count = 157;
+    const double x0 = -0.37;
+    const double dx = 0.083;
+    const RowKernelFn scalar = rowKernel(SimdLevel::Scalar);
+
+    for (double y = -0.2; y <= 12.2; y += 0.61)
+    {
+        std::vector<double> expected(count, nan);
+        for (std::uint32_t index = 0; index < triangles.triangleCount(); ++index)
+        {
+            scalar(RowTriangle::load(triangles, index), RowSample{y, x0, dx, 1e-9, 1e-7}, 0, count, expected.data());
+        }
+
+        for (const SimdLevel level : {SimdLevel::Sse2, SimdLevel::Avx2})
+        {
+            if (level > detectSimdLevel())
+            {
+                continue;
+            }
+            std::vector<double> actual(count, nan);
+            for (std::uint32_t index = 0; index < triangles.triangleCount(); ++index)
+            {
+                // Odd begin offsets exercise the scalar tail and unaligned loads.
+                rowKernel(level)(RowTriangle::load(triangles, index),
+                                 RowSample{y, x0, dx, 1e-9, 1e-7},
+                                 index % 3,
+                                 count,
+                                 actual.data());
+            }
+            for (std::size_t i = 3; i < count; ++i)
+            {
+                assert(sameBits(expected[i], actual[i]));
+            }
+        }
+
+        std::vector<double> reference(count, nan);
+        std::size_t referenceHits = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double x = x0 + static_cast<double>(i) * dx;
+            for (std::uint32_t index = 0; index < triangles.triangleCount(); ++index)
+            {
+                double z = 0.0;
+                if (grid.sampleTriangleAt(index, x, y, z) && !(reference[i] >= z))
+                {
+                    reference[i] = z;
+                }
+            }
+            referenceHits += std::isnan(reference[i]) ? 0 : 1;
+            assert(sameBits(reference[i], expected[i]));
+        }
+
+        std::vector<double> batched(count, 0.0);
+        const std::size_t hits = grid.sampleMaxZRow(y, x0, dx, count, batched.data());
+        assert(hits == referenceHits);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            assert(sameBits(reference[i], batched[i]));
+        }
+
+        // Walking the row backwards visits the same samples in reverse.
+        std::vector<double> reversed(count, 0.0);
+        const double xEnd = x0 + static_cast<double>(count - 1) * dx;
+        assert(grid.sampleMaxZRow(y, xEnd, -dx, count, reversed.data()) == hits);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double zBack = reversed[count - 1 - i];
+            assert(std::isnan(zBack) == std::isnan(reference[i]));
+            assert(std::isnan(zBack) || std::abs(zBack - reference[i]) < 1e-9);
+        }
+    }
+}
+
+// The pyramid's branch-and-bound drop must return exactly the brute-force maximum over every sample
+// inside the disc, for both footprints and for discs hanging over the field border.
+void checkMaxZPyramid()
+{
+    using namespace tp::heightfield;
+
+    const render::Model model = makeWavySurface(40, 20.0f);
+    const UniformGrid grid(model, 1.0);
+    std::atomic<bool> cancel{false};
+    HeightField field;
+    assert(field.build(grid, 0.13, cancel));
+
+    const MaxZPyramid pyramid(field);
+    assert(pyramid.isValid());
+    assert(pyramid.levelCount() > 1);
+
+    const auto bruteForce = [&](double x, double y, double radius, MaxZPyramid::Footprint footprint, double& zOut) {
+        bool found = false;
+        double best = -std::numeric_limits<double>::infinity();
+        for (std::size_t row = 0; row < field.rows(); ++row)
+        {
+            for (std::size_t col = 0; col < field.columns(); ++col)
+            {
+                double z = 0.0;
+                if (!field.sampleAt(col, row, z))
+                {
+                    continue;
+                }
+                const double dx = field.minX() + static_cast<double>(col) * field.resolution() - x;
+                const double dy = field.minY() + static_cast<double>(row) * field.resolution() - y;
+                const double d2 = dx * dx + dy * dy;
+                if (d2 > radius * radius)
+                {
+                    continue;
+                }
+                const double candidate = footprint == MaxZPyramid::Footprint::Ball
+                                             ? z + std::sqrt(radius * radius - d2)
+                                             : z;
+                best = std::max(best, candidate);
+                found = true;
+            }
+        }
+        zOut = best;
+        return found;
+    };
+
+    for (const double radius : {0.05, 0.4, 1.55, 3.2, 6.35})
+    {
+        for (double y = -1.37; y <= 21.5; y += 2.71)
+        {
+            for (double x = -0.93; x <= 21.5; x += 1.87)
+            {
+                for (const auto footprint : {MaxZPyramid::Footprint::Flat, MaxZPyramid::Footprint::Ball})
+                {
+                    double expected = 0.0;
+                    double actual = 0.0;
+                    const bool expectedHit = bruteForce(x, y, radius, footprint, expected);
+                    const bool actualHit = pyramid.dropCutter(x, y, radius, footprint, actual);
+                    assert(expectedHit == actualHit);
+                    assert(!expectedHit || sameBits(expected, actual));
+                }
+            }
+        }
+    }
+}
+
+// Fields round-trip through the disk cache bit for bit, stale or damaged entries are misses, and the
+// directory stays under its budget by dropping the least recently used entry.
+void checkDiskCache()
+{
+    using namespace tp::heightfield;
+    namespace fs = std::filesystem;
+
+    const fs::path directory = fs::temp_directory_path() / "cnctc_heightfield_smoke_cache";
+    fs::remove_all(directory);
+
+    const render::Model model = makeWavySurface(24, 12.0f);
+    const UniformGrid grid(model, 1.0);
+    std::atomic<bool> cancel{false};
+    HeightField field;
+    assert(field.build(grid, 0.2, cancel));
+
+    HeightFieldDiskCache cache;
+    assert(!cache.isEnabled());
+    cache.configure(directory);
+    assert(cache.isEnabled());
+
+    const HeightFieldDiskCache::MeshHash hash = HeightFieldDiskCache::hashMesh(model);
+    assert(hash == HeightFieldDiskCache::hashMesh(makeWavySurface(24, 12.0f)));
+    assert(hash != HeightFieldDiskCache::hashMesh(makeWavySurface(24, 12.5f)));
+
+    assert(!cache.load(hash, 0.2));
+    assert(cache.store(hash, 0.2, field));
+    assert(!cache.load(hash, 0.25));
+
+    const auto mapped = cache.load(hash, 0.2);
+    assert(mapped && mapped->isValid() && mapped->isMapped());
+    assert(mapped->columns() == field.columns() && mapped->rows() == field.rows());
+    assert(mapped->minX() == field.minX() && mapped->maxY() == field.maxY());
+    assert(std::memcmp(mapped->samples().data(), field.samples().data(), field.samples().size_bytes()) == 0);
+    assert(std::ranges::equal(mapped->coverageMask(), field.coverageMask()));
+    double zBuilt = 0.0;
+    double zMapped = 0.0;
+    assert(field.interpolate(3.3, 7.1, zBuilt) && mapped->interpolate(3.3, 7.1, zMapped));
+    assert(sameBits(zBuilt, zMapped));
+
+    // A truncated entry must be rejected rather than mapped past its end.
+    const fs::path entry = cache.entryPath(hash, 0.2);
+    const std::uintmax_t entryBytes = fs::file_size(entry);
+    fs::resize_file(entry, entryBytes - 8);
+    assert(!cache.load(hash, 0.2));
+
+    // Budget for two entries: after touching A, storing C must evict B.
+    cache.configure(directory, entryBytes * 2 + entryBytes / 2);
+    HeightFieldDiskCache::MeshHash hashA = hash;
+    HeightFieldDiskCache::MeshHash hashB = hash;
+    HeightFieldDiskCache::MeshHash hashC = hash;
+    hashA[0] ^= 1;
+    hashB[0] ^= 2;
+    hashC[0] ^= 4;
+    fs::remove(entry);
+    assert(cache.store(hashA, 0.2, field));
+    assert(cache.store(hashB, 0.2, field));
+    const auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(cache.entryPath(hashA, 0.2), now - std::chrono::hours(2));
+    fs::last_write_time(cache.entryPath(hashB, 0.2), now - std::chrono::hours(1));
+    assert(cache.load(hashA, 0.2));
+    assert(cache.store(hashC, 0.2, field));
+    assert(fs::exists(cache.entryPath(hashA, 0.2)));
+    assert(!fs::exists(cache.entryPath(hashB, 0.2)));
+    assert(fs::exists(cache.entryPath(hashC, 0.2)));
+
+    // A field larger than the whole budget is not written.
+    cache.configure(directory, entryBytes / 2);
+    assert(!cache.store(hash, 0.2, field));
+
+    fs::remove_all(directory);
+}
+
+// Downsampling picks the lattice points a direct build at the coarser resolution would sample; 0.4 mm
+// overshoots the 15 mm extent, so its last row and column lie past the fine lattice.
+void checkDownsample()
+{
+    using namespace tp::heightfield;
+
+    const render::Model model = makeWavySurface(30, 15.0f);
+    const UniformGrid grid(model, 1.0);
+    std::atomic<bool> cancel{false};
+    HeightField fine;
+    assert(fine.build(grid, 0.1, cancel));
+
+    for (const double resolution : {0.2, 0.3, 0.4, 0.5})
+    {
+        HeightField direct;
+        HeightField derived;
+        assert(direct.build(grid, resolution, cancel));
+        assert(derived.downsample(fine, resolution));
+        assert(derived.columns() == direct.columns() && derived.rows() == direct.rows());
+        assert(std::ranges::equal(derived.coverageMask(), direct.coverageMask()));
+        for (std::size_t i = 0; i < direct.samples().size(); ++i)
+        {
+            const double a = direct.samples()[i];
+            const double b = derived.samples()[i];
+            assert(std::isnan(a) == std::isnan(b));
+            assert(std::isnan(a) || std::abs(a - b) < 1e-9);
+        }
+    }
+
+    HeightField rejected;
+    assert(!rejected.downsample(fine, 0.25));
+    assert(!rejected.isValid());
+}
+
+// Tiled storage must hold the same samples as row-major storage for both build modes, and survive
+// downsampling, quantization and a disk cache round trip.
+void checkTiledLayout()
+{
+    using namespace tp::heightfield;
+    namespace fs = std::filesystem;
+
+    // 151x151 samples: three tiles per axis, the last one partial.
+    const render::Model model = makeWavySurface(30, 15.0f);
+    const UniformGrid grid(model, 1.0);
+    std::atomic<bool> cancel{false};
+
+    const auto sameSamples = [](const HeightField& lhs, const HeightField& rhs) {
+        assert(lhs.columns() == rhs.columns() && lhs.rows() == rhs.rows());
+        for (std::size_t row = 0; row < lhs.rows(); ++row)
+        {
+            for (std::size_t col = 0; col < lhs.columns(); ++col)
+            {
+                double a = 0.0;
+                double b = 0.0;
+                assert(lhs.hasSample(col, row) == rhs.hasSample(col, row));
+                assert(lhs.sampleAt(col, row, a) == rhs.sampleAt(col, row, b));
+                assert(!lhs.hasSample(col, row) || sameBits(a, b));
+            }
+        }
+        for (double y = -0.05; y <= 15.1; y += 0.37)
+        {
+            for (double x = -0.05; x <= 15.1; x += 0.29)
+            {
+                double a = 0.0;
+                double b = 0.0;
+                assert(lhs.interpolate(x, y, a) == rhs.interpolate(x, y, b));
+                assert(sameBits(a, b));
+            }
+        }
+    };
+
+    for (const HeightField::BuildMode mode : {HeightField::BuildMode::PointSampling,
+                                              HeightField::BuildMode::ScanConversion})
+    {
+        HeightField rowMajor;
+        HeightField tiled;
+        assert(rowMajor.build(grid, 0.1, cancel, nullptr, mode));
+        assert(tiled.build(grid, 0.1, cancel, nullptr, mode, HeightField::SampleLayout::Tiled));
+        assert(tiled.layout() == HeightField::SampleLayout::Tiled);
+        assert(tiled.storageSize() == 3 * 3 * HeightField::kTileSize * HeightField::kTileSize);
+        assert(tiled.samples().size() == tiled.storageSize());
+        sameSamples(rowMajor, tiled);
+
+        HeightField coarseRowMajor;
+        HeightField coarseTiled;
+        assert(coarseRowMajor.downsample(rowMajor, 0.3));
+        assert(coarseTiled.downsample(tiled, 0.3));
+        assert(coarseTiled.layout() == HeightField::SampleLayout::Tiled);
+        sameSamples(coarseRowMajor, coarseTiled);
+    }
+
+    HeightField tiled;
+    assert(tiled.build(grid, 0.2, cancel, nullptr, HeightField::BuildMode::ScanConversion,
+                       HeightField::SampleLayout::Tiled));
+
+    const fs::path directory = fs::temp_directory_path() / "cnctc_heightfield_smoke_tiled";
+    fs::remove_all(directory);
+    HeightFieldDiskCache cache;
+    cache.configure(directory);
+    const HeightFieldDiskCache::MeshHash hash = HeightFieldDiskCache::hashMesh(model);
+    assert(cache.store(hash, 0.2, tiled));
+    const auto mapped = cache.load(hash, 0.2);
+    assert(mapped && mapped->layout() == HeightField::SampleLayout::Tiled);
+    sameSamples(tiled, *mapped);
+    fs::remove_all(directory);
+
+    HeightField quantized;
+    assert(quantized.build(grid, 0.2, cancel, nullptr, HeightField::BuildMode::ScanConversion,
+                           HeightField::SampleLayout::Tiled));
+    assert(quantized.quantize(0.001));
+    for (std::size_t row = 0; row < tiled.rows(); ++row)
+    {
+        for (std::size_t col = 0; col < tiled.columns(); ++col)
+        {
+            double a = 0.0;
+            double b = 0.0;
+            assert(tiled.sampleAt(col, row, a) == quantized.sampleAt(col, row, b));
+            assert(!tiled.hasSample(col, row) || std::abs(a - b) <= 0.0005 + 1e-12);
+        }
+    }
+}
+
+// A lazy field builds only the tiles that are touched, matches the eager tiled build bit for bit, and
+// stays consistent when several threads race for the same tiles.
+void checkLazy()
+{
+    using namespace tp::heightfield;
+
+    const render::Model model = makeWavySurface(30, 15.0f);
+    const auto grid = std::make_shared<const UniformGrid>(model, 1.0);
+    std::atomic<bool> cancel{false};
+
+    HeightField eager;
+    assert(eager.build(*grid, 0.1, cancel, nullptr, HeightField::BuildMode::ScanConversion,
+                       HeightField::SampleLayout::Tiled));
+
+    HeightField lazy;
+    HeightField::BuildStats stats;
+    assert(lazy.buildLazy(grid, 0.1, cancel, &stats));
+    assert(lazy.isLazy());
+    assert(lazy.layout() == HeightField::SampleLayout::Tiled);
+    assert(lazy.columns() == eager.columns() && lazy.rows() == eager.rows());
+    assert(lazy.pendingTiles() == 9);
+    assert(stats.totalSamples == eager.columns() * eager.rows());
+
+    // One query inside the first tile builds just that tile.
+    double z = 0.0;
+    double expected = 0.0;
+    assert(lazy.interpolate(1.0, 1.0, z) == eager.interpolate(1.0, 1.0, expected));
+    assert(sameBits(z, expected));
+    assert(lazy.pendingTiles() == 8);
+    assert(!lazy.quantize(0.001));
+
+    // Four threads sweep the same points in different orders.
+    std::vector<std::thread> workers;
+    std::atomic<int> mismatches{0};
+    for (int worker = 0; worker < 4; ++worker)
+    {
+        workers.emplace_back([&, worker]() {
+            for (int i = 0; i < 20000; ++i)
+            {
+                const int k = (i * (2 * worker + 1)) % 20000;
+                const double x = -0.05 + (k % 200) * 0.0763;
+                const double y = -0.05 + (k / 200) * 0.1523;
+                double a = 0.0;
+                double b = 0.0;
+                if (lazy.interpolate(x, y, a) != eager.interpolate(x, y, b) || !sameBits(a, b))
+                {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    assert(mismatches.load() == 0);
+    assert(lazy.pendingTiles() == 0);
+
+    const auto lazySamples = lazy.samples();
+    const auto eagerSamples = eager.samples();
+    assert(lazySamples.size() == eagerSamples.size());
+    for (std::size_t i = 0; i < lazySamples.size(); ++i)
+    {
+        assert(sameBits(lazySamples[i], eagerSamples[i]));
+        assert(lazy.coverageMask()[i] == eager.coverageMask()[i]);
+    }
+
+    // Prefetch builds the tiles along a segment; populate() finishes the rest.
+    HeightField prefetched;
+    assert(prefetched.buildLazy(grid, 0.1, cancel));
+    prefetched.prefetch(0.0, 14.0, 14.0, 14.0);
+    assert(prefetched.pendingTiles() == 6);
+    assert(prefetched.populate(cancel));
+    assert(prefetched.pendingTiles() == 0);
+
+    // A lazy source downsamples like an eager one.
+    HeightField source;
+    assert(source.buildLazy(grid, 0.1, cancel));
+    HeightField coarseLazy;
+    HeightField coarseEager;
+    assert(coarseLazy.downsample(source, 0.3));
+    assert(coarseEager.downsample(eager, 0.3));
+    assert(!coarseLazy.isLazy());
+    for (std::size_t row = 0; row < coarseEager.rows(); ++row)
+    {
+        for (std::size_t col = 0; col < coarseEager.columns(); ++col)
+        {
+            double a = 0.0;
+            double b = 0.0;
+            assert(coarseLazy.sampleAt(col, row, a) == coarseEager.sampleAt(col, row, b));
+            assert(!coarseEager.hasSample(col, row) || sameBits(a, b));
+        }
+    }
+}
+
+// Quantized storage decodes every sample to within half a quantum, keeps coverage, and picks int32
+// codes once the Z range exceeds 65535 steps.
+void checkQuantize()
+{
+    using namespace tp::heightfield;
+
+    const render::Model model = makeWavySurface(30, 15.0f);
+    const UniformGrid grid(model, 1.0);
+    std::atomic<bool> cancel{false};
+    HeightField reference;
+    assert(reference.build(grid, 0.1, cancel));
+
+    for (const double quantum : {0.001, 1e-6})
+    {
+        HeightField field;
+        HeightField::BuildStats stats;
+        assert(field.build(grid, 0.1, cancel));
+        assert(field.quantize(quantum, &stats));
+        assert(!field.quantize(quantum));
+        assert(field.quantum() == quantum);
+        assert(stats.quantizationError <= quantum * 0.5 + 1e-12);
+        const bool narrow = quantum > 1e-4;
+        assert(field.encoding()
+               == (narrow ? HeightField::SampleEncoding::Quantized16 : HeightField::SampleEncoding::Quantized32));
+        assert(field.memoryBytes() == field.columns() * field.rows() * (narrow ? 2 : 4));
+        assert(field.samples().empty() && field.coverageMask().empty());
+
+        double maxError = 0.0;
+        for (std::size_t row = 0; row < field.rows(); ++row)
+        {
+            for (std::size_t col = 0; col < field.columns(); ++col)
+            {
+                double expected = 0.0;
+                double decoded = 0.0;
+                const bool covered = reference.sampleAt(col, row, expected);
+                assert(field.hasSample(col, row) == covered);
+                assert(field.sampleAt(col, row, decoded) == covered);
+                if (covered)
+                {
+                    maxError = std::max(maxError, std::abs(decoded - expected));
+                }
+            }
+        }
+        assert(maxError == stats.quantizationError);
+
+        double z = 0.0;
+        double expected = 0.0;
+        assert(reference.interpolate(7.33, 4.21, expected));
+        assert(field.interpolate(7.33, 4.21, z));
+        assert(std::abs(z - expected) <= quantum * 0.5 + 1e-12);
+
+        HeightField coarse;
+        HeightField coarseReference;
+        assert(coarse.downsample(field, 0.2));
+        assert(coarseReference.downsample(reference, 0.2));
+        assert(std::ranges::equal(coarse.coverageMask(), coarseReference.coverageMask()));
+    }
+}
+
+// The adaptive field must reproduce the dense field where the surface is flat or piecewise flat, never
+// fall more than the tolerance below it, and stay within the tolerance of it on a dome, while evaluating
+// far fewer samples.
+void checkAdaptive()
+{
+    using namespace tp::heightfield;
+    std::atomic<bool> cancel{false};
+
+    // maxAbove bounds how far the adaptive field may lie above the dense one, maxError how far below.
+    const auto compare = [](const HeightField& dense,
+                            const AdaptiveHeightField& adaptive,
+                            double maxError,
+                            double maxAbove) {
+        assert(adaptive.columns() == dense.columns() && adaptive.rows() == dense.rows());
+        const double step = dense.resolution() * 0.5;
+        for (double y = dense.minY(); y <= dense.maxY(); y += step)
+        {
+            for (double x = dense.minX(); x <= dense.maxX(); x += step)
+            {
+                double denseZ = 0.0;
+                double adaptiveZ = 0.0;
+                if (dense.interpolate(x, y, denseZ))
+                {
+                    assert(adaptive.interpolate(x, y, adaptiveZ));
+                    assert(denseZ - adaptiveZ <= maxError);
+                    assert(adaptiveZ - denseZ <= maxAbove);
+                }
+            }
+        }
+    };
+
+    const render::Model plate = makeMoldPlate();
+    const UniformGrid plateGrid(plate, 1.0);
+    HeightField plateDense;
+    AdaptiveHeightField plateAdaptive;
+    AdaptiveHeightField::BuildStats plateStats;
+    assert(plateDense.build(plateGrid, 0.1, cancel));
+    assert(plateAdaptive.build(plateGrid, 0.1, 0.01, cancel, &plateStats));
+    compare(plateDense, plateAdaptive, 1e-9, 1e-9);
+    assert(plateStats.denseSamples == plateDense.columns() * plateDense.rows());
+    assert(plateStats.evaluatedSamples * 5 < plateStats.denseSamples);
+    assert(plateAdaptive.memoryBytes() * 5 < plateDense.memoryBytes());
+
+    // The rib falls between the samples of the coarse leaves around it.
+    double z = 0.0;
+    assert(plateAdaptive.interpolate(5.1, 30.0, z) && std::abs(z - 3.0) < 1e-9);
+    assert(plateAdaptive.interpolate(5.0, 30.0, z) && std::abs(z) < 1e-9);
+
+    const render::Model wavy = makeWavySurface(30, 15.0f);
+    const UniformGrid wavyGrid(wavy, 1.0);
+    HeightField wavyDense;
+    AdaptiveHeightField wavyAdaptive;
+    assert(wavyDense.build(wavyGrid, 0.1, cancel));
+    assert(wavyAdaptive.build(wavyGrid, 0.1, 0.01, cancel));
+    compare(wavyDense, wavyAdaptive, 0.01 + 1e-6, 0.05);
+    assert(wavyAdaptive.sampleCount() < wavyDense.columns() * wavyDense.rows());
+
+    // Chords of the cap fall below the sphere between samples, so only the triangle test refines them.
+    const render::Model dome = makeDome(60, 20.0f);
+    const UniformGrid domeGrid(dome, 1.0);
+    HeightField domeDense;
+    AdaptiveHeightField domeAdaptive;
+    assert(domeDense.build(domeGrid, 0.1, cancel));
+    for (const double tolerance : {0.005, 0.01, 0.05})
+    {
+        assert(domeAdaptive.build(domeGrid, 0.1, tolerance, cancel));
+        compare(domeDense, domeAdaptive, tolerance + 1e-6, tolerance + 1e-6);
+        assert(domeAdaptive.sampleCount() * 2 < domeDense.columns() * domeDense.rows());
+    }
+
+    AdaptiveHeightField cancelled;
+    std::atomic<bool> cancelNow{true};
+    assert(!cancelled.build(plateGrid, 0.1, 0.01, cancelNow));
+    assert(!cancelled.isValid());
+}
+
 } // namespace
 
 int main()
@@ -61,6 +761,52 @@ int main()
         }
     }
 
+    // Scan conversion must reproduce the point-sampled coverage exactly, at several resolutions.
+    for (const double resolution : {0.1, 0.3, 0.5, 0.7})
+    {
+        tp::heightfield::HeightField pointField;
+        tp::heightfield::HeightField scanField;
+        tp::heightfield::HeightField::BuildStats pointStats;
+        tp::heightfield::HeightField::BuildStats scanStats;
+        assert(pointField.build(grid,
+                                resolution,
+                                cancel,
+                                &pointStats,
+                                tp::heightfield::HeightField::BuildMode::PointSampling));
+        assert(scanField.build(grid,
+                               resolution,
+                               cancel,
+                               &scanStats,
+                               tp::heightfield::HeightField::BuildMode::ScanConversion));
+        assert(pointField.columns() == scanField.columns());
+        assert(pointField.rows() == scanField.rows());
+        assert(std::ranges::equal(pointField.coverageMask(), scanField.coverageMask()));
+        assert(pointStats.validSamples == scanStats.validSamples);
+
+        for (std::size_t row = 0; row < scanField.rows(); ++row)
+        {
+            for (std::size_t col = 0; col < scanField.columns(); ++col)
+            {
+                double pointZ = 0.0;
+                double scanZ = 0.0;
+                if (pointField.sampleAt(col, row, pointZ))
+                {
+                    assert(scanField.sampleAt(col, row, scanZ));
+                    assert(std::abs(pointZ - scanZ) < 1e-9);
+                }
+            }
+        }
+    }
+
+    checkRowKernels();
+    checkMaxZPyramid();
+    checkDiskCache();
+    checkDownsample();
+    checkTiledLayout();
+    checkLazy();
+    checkQuantize();
+    checkAdaptive();
+
     return 0;
 }
 
@@ -0,0 +1,154 @@
+#include "tp/CycleTime.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+bool near(double a, double b, double tolerance = 1e-9)
+{
+    return std::abs(a - b) <= tolerance * std::max(1.0, std::abs(b));
+}
+
+tp::Polyline makePolyline(const std::vector<glm::vec3>& points, tp::MotionType motion = tp::MotionType::Cut)
+{
+    tp::Polyline poly;
+    for (const glm::vec3& p : points)
+    {
+        poly.pts.push_back({p});
+    }
+    poly.motion = motion;
+    return poly;
+}
+
+tp::Machine makeMachine(double accel, double jerk)
+{
+    tp::Machine machine = tp::makeDefaultMachine();
+    machine.maxAccel_mm_s2 = accel;
+    machine.maxJerk_mm_s3 = jerk;
+    machine.junctionDeviation_mm = 0.01;
+    return machine;
+}
+
+// Trapezoidal time to cover `length` between the given end speeds, cruising at `speed`.
+double trapezoidTime(double entry, double exit, double speed, double length, double accel)
+{
+    const double accelerate = (speed * speed - entry * entry) / (2.0 * accel);
+    const double decelerate = (speed * speed - exit * exit) / (2.0 * accel);
+    return (speed - entry) / accel + (speed - exit) / accel + (length - accelerate - decelerate) / speed;
+}
+
+} // namespace
+
+int main()
+{
+    constexpr double kFeed = 3'000.0;
+    constexpr double kSpeed = kFeed / 60.0;
+    constexpr double kAccel = 500.0;
+    constexpr double kJerk = 10'000.0;
+    const tp::Polyline line = makePolyline({{0.0f, 0.0f, 0.0f}, {100.0f, 0.0f, 0.0f}});
+
+    // Without an acceleration limit every move takes its length over its feed, as the simulator used to
+    // assume; cuts and links share the feed and rapids use the rapid rate.
+    {
+        tp::CycleTimeEstimator estimator(makeMachine(0.0, 0.0));
+        const std::vector<tp::Polyline> moves{
+            line,
+            makePolyline({{100.0f, 0.0f, 0.0f}, {100.0f, 30.0f, 0.0f}}, tp::MotionType::Link),
+            makePolyline({{100.0f, 30.0f, 0.0f}, {100.0f, 30.0f, 0.0f}, {100.0f, 30.0f, 60.0f}}, tp::MotionType::Rapid)};
+        std::vector<double> segmentTimes;
+        const tp::CycleTimeEstimate estimate = estimator.estimate(moves, kFeed, 6'000.0, &segmentTimes);
+        assert(near(estimate.cut_s, 100.0 / kSpeed));
+        assert(near(estimate.link_s, 30.0 / kSpeed));
+        assert(near(estimate.rapid_s, 60.0 / 100.0));
+        assert(near(estimate.total_s, estimate.cut_s + estimate.link_s + estimate.rapid_s));
+        assert(estimate.segments == 4 && segmentTimes.size() == 4);
+        assert(segmentTimes[2] == 0.0);
+        assert(near(std::accumulate(segmentTimes.begin(), segmentTimes.end(), 0.0), estimate.total_s));
+    }
+
+    // A long straight move: the trapezoid adds v/a, and the S-curve another a/j on top.
+    {
+        tp::CycleTimeEstimator trapezoid(makeMachine(kAccel, 0.0));
+        assert(near(trapezoid.estimate({line}, kFeed, 0.0).total_s, 100.0 / kSpeed + kSpeed / kAccel));
+        tp::CycleTimeEstimator sCurve(makeMachine(kAccel, kJerk));
+        assert(near(sCurve.estimate({line}, kFeed, 0.0).total_s, 100.0 / kSpeed + kSpeed / kAccel + kAccel / kJerk));
+
+        // Splitting the move into collinear pieces changes nothing.
+        std::vector<glm::vec3> pieces;
+        for (int i = 0; i <= 1000; ++i)
+        {
+            pieces.emplace_back(0.1f * static_cast<float>(i), 0.0f, 0.0f);
+        }
+        pieces.back() = glm::vec3(100.0f, 0.0f, 0.0f);
+        assert(near(sCurve.estimate({makePolyline(pieces)}, kFeed, 0.0).total_s,
+                    sCurve.estimate({line}, kFeed, 0.0).total_s,
+                    1e-6));
+
+        // Turning back stops the machine, so out and back takes twice as long as one way.
+        const tp::Polyline back = makePolyline({{0.0f, 0.0f, 0.0f}, {100.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+        assert(near(sCurve.estimate({back}, kFeed, 0.0).total_s, 2.0 * sCurve.estimate({line}, kFeed, 0.0).total_s));
+    }
+
+    // Moves too short to reach the feed peak where speeding up meets slowing down.
+    {
+        const tp::Polyline shortLine = makePolyline({{0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}});
+        tp::CycleTimeEstimator trapezoid(makeMachine(kAccel, 0.0));
+        assert(near(trapezoid.estimate({shortLine}, kFeed, 0.0).total_s, 2.0 * std::sqrt(1.0 / kAccel), 1e-6));
+
+        // Jerk limited throughout: each half covers v sqrt(v / j) and takes 2 sqrt(v / j).
+        const tp::Polyline tinyLine = makePolyline({{0.0f, 0.0f, 0.0f}, {0.1f, 0.0f, 0.0f}});
+        tp::CycleTimeEstimator sCurve(makeMachine(kAccel, kJerk));
+        const double peak = std::pow(0.1 * std::sqrt(kJerk) / 2.0, 2.0 / 3.0);
+        assert(near(sCurve.estimate({tinyLine}, kFeed, 0.0).total_s, 4.0 * std::sqrt(peak / kJerk), 1e-6));
+    }
+
+    // Right-angle corners are taken at the junction deviation speed.
+    {
+        const tp::Polyline square = makePolyline(
+            {{0.0f, 0.0f, 0.0f}, {25.0f, 0.0f, 0.0f}, {25.0f, 25.0f, 0.0f}, {0.0f, 25.0f, 0.0f}, {0.0f, 0.0f, 0.0f}});
+        tp::CycleTimeEstimator trapezoid(makeMachine(kAccel, 0.0));
+        const double sinHalf = std::sqrt(0.5);
+        const double corner = std::sqrt(kAccel * 0.01 * sinHalf / (1.0 - sinHalf));
+        const double expected = trapezoidTime(0.0, corner, kSpeed, 25.0, kAccel)
+                                + 2.0 * trapezoidTime(corner, corner, kSpeed, 25.0, kAccel)
+                                + trapezoidTime(corner, 0.0, kSpeed, 25.0, kAccel);
+        assert(near(trapezoid.estimate({square}, kFeed, 0.0).total_s, expected, 1e-6));
+
+        tp::CycleTimeEstimator sCurve(makeMachine(kAccel, kJerk));
+        const double squareTime = sCurve.estimate({square}, kFeed, 0.0).total_s;
+        assert(squareTime > expected && squareTime > sCurve.estimate({line}, kFeed, 0.0).total_s);
+    }
+
+    // Dense zigzag at 0.2-0.6 mm per segment, where most moves never reach the feed. Throughput on it is
+    // measured by cycle_time_bench.
+    {
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> step(0.2f, 0.6f);
+        std::vector<glm::vec3> points;
+        glm::vec3 p(0.0f);
+        for (int i = 0; i < 20'000; ++i)
+        {
+            points.push_back(p);
+            p += glm::vec3(step(rng), (i % 2 == 0) ? step(rng) : -step(rng), 0.0f);
+        }
+        const std::vector<tp::Polyline> zigzag{makePolyline(points)};
+        tp::CycleTimeEstimator estimator(makeMachine(kAccel, kJerk));
+        const tp::CycleTimeEstimate estimate = estimator.estimate(zigzag, kFeed, 0.0);
+        assert(estimate.total_s > 0.0 && std::isfinite(estimate.total_s));
+
+        double length = 0.0;
+        for (std::size_t i = 1; i < points.size(); ++i)
+        {
+            length += static_cast<double>(glm::length(points[i] - points[i - 1]));
+        }
+        assert(estimate.total_s > length / kSpeed);
+    }
+
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include <cassert>
 #include <cmath>
 #include <algorithm>
+#include <map>
 #include <utility>
 #include <vector>
 
@@ -164,6 +165,71 @@ const tp::Polyline* findPlanarCutByY(const tp::Toolpath& toolpath, double target
     return nullptr;
 }
 
+// Lowest cut Z at every XY visited by a cut move, keyed on a 1 um lattice.
+std::map<std::pair<long, long>, double> lowestCutZ(const tp::Toolpath& toolpath)
+{
+    std::map<std::pair<long, long>, double> lowest;
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        if (poly.motion != tp::MotionType::Cut)
+        {
+            continue;
+        }
+        for (const tp::Vertex& vertex : poly.pts)
+        {
+            const std::pair<long, long> key{std::lround(vertex.p.x * 1000.0f), std::lround(vertex.p.y * 1000.0f)};
+            const double z = static_cast<double>(vertex.p.z);
+            const auto [it, inserted] = lowest.emplace(key, z);
+            if (!inserted)
+            {
+                it->second = std::min(it->second, z);
+            }
+        }
+    }
+    return lowest;
+}
+
+std::size_t countCutPoints(const tp::Toolpath& toolpath)
+{
+    std::size_t points = 0;
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        if (poly.motion == tp::MotionType::Cut)
+        {
+            points += poly.pts.size();
+        }
+    }
+    return points;
+}
+
+// Z of the thinned polyline above the XY of a dense sample, or NaN when no segment passes over it.
+double chordZAt(const tp::Polyline& poly, const glm::dvec3& sample)
+{
+    for (std::size_t i = 0; i + 1 < poly.pts.size(); ++i)
+    {
+        const glm::dvec3 a = toDVec3(poly.pts[i].p);
+        const glm::dvec3 b = toDVec3(poly.pts[i + 1].p);
+        const glm::dvec2 ab{b.x - a.x, b.y - a.y};
+        const double length2 = glm::dot(ab, ab);
+        if (length2 < 1e-12)
+        {
+            if (horizontalDistance(a, sample) < 1e-3)
+            {
+                return std::max(a.z, b.z);
+            }
+            continue;
+        }
+        const glm::dvec2 as{sample.x - a.x, sample.y - a.y};
+        const double t = glm::dot(as, ab) / length2;
+        const double off = std::abs(as.x * ab.y - as.y * ab.x) / std::sqrt(length2);
+        if (t >= -1e-6 && t <= 1.0 + 1e-6 && off < 1e-3)
+        {
+            return a.z + std::clamp(t, 0.0, 1.0) * (b.z - a.z);
+        }
+    }
+    return std::nan("");
+}
+
 } // namespace
 
 int main()
@@ -252,5 +318,85 @@ int main()
     const double dot = (climbVec.x * convVec.x + climbVec.y * convVec.y) / (climbLen * convLen);
     assert(dot < -0.95);
 
+    // Rows are generated in parallel but stitched in row order, so a repeated run matches exactly; progress
+    // never goes backwards.
+    std::vector<int> progress;
+    tp::Toolpath repeatPath =
+        generator.generate(model, climbParams, ai, cancel, [&](int percent) { progress.push_back(percent); });
+    assert(repeatPath.passes.size() == climbPath.passes.size());
+    for (std::size_t i = 0; i < climbPath.passes.size(); ++i)
+    {
+        const auto& a = climbPath.passes[i].pts;
+        const auto& b = repeatPath.passes[i].pts;
+        assert(a.size() == b.size());
+        for (std::size_t j = 0; j < a.size(); ++j)
+        {
+            assert(a[j].p == b[j].p);
+        }
+    }
+    assert(!progress.empty() && progress.back() == 100);
+    assert(std::is_sorted(progress.begin(), progress.end()));
+
+    // Thinning collapses the colinear rows of the plane to a few points, and the thinned chords stay within
+    // the tolerance above every sample they replace.
+    tp::UserParams denseParams = climbParams;
+    denseParams.rasterChordTolerance_mm = 0.0;
+    tp::Toolpath densePath = generator.generate(model, denseParams, ai, cancel);
+    assert(densePath.passes.size() == climbPath.passes.size());
+    for (std::size_t i = 0; i < densePath.passes.size(); ++i)
+    {
+        if (densePath.passes[i].motion != tp::MotionType::Cut)
+        {
+            continue;
+        }
+        for (const tp::Vertex& vertex : densePath.passes[i].pts)
+        {
+            const glm::dvec3 sample = toDVec3(vertex.p);
+            const double chordZ = chordZAt(climbPath.passes[i], sample);
+            assert(!std::isnan(chordZ));
+            assert(chordZ >= sample.z - 1e-4);
+            assert(chordZ <= sample.z + climbParams.rasterChordTolerance_mm + 1e-4);
+        }
+    }
+    assert(countCutPoints(climbPath) * 5 < countCutPoints(densePath));
+
+    // Dropping the full tool footprint can only lift the raster relative to the centre-point sample.
+    tp::UserParams footprintParams = denseParams;
+    footprintParams.cutterAwareRaster = true;
+    tp::Toolpath footprintPath = generator.generate(model, footprintParams, ai, cancel);
+    assert(!footprintPath.empty());
+    const std::map<std::pair<long, long>, double> plainFloor = lowestCutZ(densePath);
+    const std::map<std::pair<long, long>, double> footprintFloor = lowestCutZ(footprintPath);
+    std::size_t compared = 0;
+    for (const auto& [key, z] : footprintFloor)
+    {
+        const auto it = plainFloor.find(key);
+        if (it != plainFloor.end())
+        {
+            assert(z >= it->second - 1e-4);
+            ++compared;
+        }
+    }
+    assert(compared > 0);
+
+    // The adaptive height field follows the dense one to within a few tolerances.
+    tp::UserParams adaptiveParams = denseParams;
+    adaptiveParams.adaptiveHeightField = true;
+    adaptiveParams.adaptiveHeightFieldTolerance_mm = 0.01;
+    tp::Toolpath adaptivePath = generator.generate(model, adaptiveParams, ai, cancel);
+    assert(!adaptivePath.empty());
+    const std::map<std::pair<long, long>, double> adaptiveFloor = lowestCutZ(adaptivePath);
+    compared = 0;
+    for (const auto& [key, z] : adaptiveFloor)
+    {
+        const auto it = plainFloor.find(key);
+        if (it != plainFloor.end())
+        {
+            assert(std::abs(z - it->second) <= 0.05);
+            ++compared;
+        }
+    }
+    assert(compared > 0);
+
     return 0;
 }
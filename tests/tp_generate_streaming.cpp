@@ -0,0 +1,212 @@
+#include "ai/IPathAI.h"
+#include "render/Model.h"
+#include "tp/ToolpathGenerator.h"
+
+#include <QtGui/QVector3D>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+render::Model buildWaveModel(double size, int divisions)
+{
+    std::vector<render::Vertex> vertices;
+    vertices.reserve(static_cast<std::size_t>((divisions + 1) * (divisions + 1)));
+    for (int row = 0; row <= divisions; ++row)
+    {
+        for (int col = 0; col <= divisions; ++col)
+        {
+            const double x = size * static_cast<double>(col) / static_cast<double>(divisions);
+            const double y = size * static_cast<double>(row) / static_cast<double>(divisions);
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x),
+                                        static_cast<float>(y),
+                                        static_cast<float>(3.0 * std::sin(x * 0.2) * std::cos(y * 0.15)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices.push_back(vertex);
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * (divisions + 1) + col);
+            const auto stride = static_cast<render::Model::Index>(divisions + 1);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+class FixedAI : public ai::IPathAI
+{
+public:
+    explicit FixedAI(ai::StrategyDecision decision)
+        : m_decision(std::move(decision))
+    {
+    }
+
+    ai::StrategyDecision predict(const render::Model&, const tp::UserParams&) override
+    {
+        return m_decision;
+    }
+
+private:
+    ai::StrategyDecision m_decision{};
+};
+
+bool samePasses(const std::vector<tp::Polyline>& a, const std::vector<tp::Polyline>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].motion != b[i].motion || a[i].pts.size() != b[i].pts.size())
+        {
+            return false;
+        }
+        for (std::size_t j = 0; j < a[i].pts.size(); ++j)
+        {
+            if (a[i].pts[j].p != b[i].pts[j].p)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    // Each comparison below generates the same passes twice; with the pass geometry cache on, the second
+    // run would be served from the first instead of being generated again.
+    tp::ToolpathGenerator::setPassGeometryCacheCapacity(0);
+
+    const render::Model model = buildWaveModel(40.0, 40);
+    assert(model.isValid());
+
+    tp::UserParams params;
+    params.enableRoughPass = true;
+    params.stockAllowance_mm = 0.5;
+    params.leaveStock_mm = 0.2;
+    params.toolDiameter = 3.0;
+    params.stepOver = 1.0;
+    params.maxDepthPerPass = 2.0;
+    params.machine = tp::makeDefaultMachine();
+    params.stock = tp::makeDefaultStock();
+    params.stock.topZ_mm = 5.0;
+
+    ai::StrategyDecision decision;
+    ai::StrategyStep raster;
+    raster.type = ai::StrategyStep::Type::Raster;
+    raster.stepover = 1.0;
+    raster.stepdown = 2.0;
+    raster.angle_deg = 30.0;
+    raster.finish_pass = true;
+    decision.steps.push_back(raster);
+    ai::StrategyStep waterline = raster;
+    waterline.type = ai::StrategyStep::Type::Waterline;
+    decision.steps.push_back(waterline);
+
+    FixedAI ai(decision);
+    tp::ToolpathGenerator generator;
+    std::atomic<bool> cancel{false};
+
+    const tp::Toolpath batch = generator.generate(model, params, ai, cancel);
+    assert(!batch.empty());
+
+    // The chunks arrive pass by pass while generation is still running, and together they are exactly the
+    // batch toolpath.
+    std::vector<tp::Polyline> streamed;
+    std::vector<std::size_t> passIndices;
+    int lastProgress = 0;
+    int progressAtFirstChunk = -1;
+    const tp::Toolpath result = generator.generateStreaming(
+        model,
+        params,
+        ai,
+        cancel,
+        [&](const tp::ToolpathChunk& chunk) {
+            assert(chunk.settings != nullptr);
+            assert(chunk.settings->passes.empty());
+            assert(chunk.settings->feed == batch.feed);
+            assert(chunk.settings->machine.safeZ_mm == batch.machine.safeZ_mm);
+            assert(!chunk.polylines.empty());
+            assert(chunk.passIndex < chunk.passCount);
+            if (progressAtFirstChunk < 0)
+            {
+                progressAtFirstChunk = lastProgress;
+            }
+            passIndices.push_back(chunk.passIndex);
+            streamed.insert(streamed.end(), chunk.polylines.begin(), chunk.polylines.end());
+        },
+        [&](int percent) { lastProgress = percent; });
+
+    assert(samePasses(result.passes, batch.passes));
+    assert(samePasses(streamed, batch.passes));
+    assert(passIndices.size() >= 2);
+    for (std::size_t i = 1; i < passIndices.size(); ++i)
+    {
+        assert(passIndices[i] > passIndices[i - 1]);
+    }
+    assert(progressAtFirstChunk >= 0 && progressAtFirstChunk < 100);
+
+    // Cancelling from the sink stops generation; the caller gets an empty toolpath.
+    std::atomic<bool> cancelFromSink{false};
+    std::size_t chunks = 0;
+    const tp::Toolpath cancelled = generator.generateStreaming(model,
+                                                               params,
+                                                               ai,
+                                                               cancelFromSink,
+                                                               [&](const tp::ToolpathChunk&) {
+                                                                   ++chunks;
+                                                                   cancelFromSink.store(true);
+                                                               });
+    assert(cancelled.empty());
+    assert(chunks == 1);
+
+    // Rough and finish rasters plus a waterline run concurrently. The merged toolpath matches a sequential
+    // run, progress never goes backwards, and the two rasters on the same lattice build one height field.
+    ai::StrategyDecision threePasses = decision;
+    ai::StrategyStep rough = raster;
+    rough.finish_pass = false;
+    threePasses.steps.insert(threePasses.steps.begin(), rough);
+    FixedAI threePassAI(threePasses);
+
+    const render::Model freshModel = buildWaveModel(40.0, 40);
+    tp::UserParams concurrentParams = params;
+    concurrentParams.concurrentPasses = 3;
+    const std::uint64_t buildsBefore = tp::ToolpathGenerator::heightFieldCacheStats().builds;
+    std::vector<int> progress;
+    const tp::Toolpath concurrent = generator.generate(freshModel, concurrentParams, threePassAI, cancel, [&](int percent) {
+        progress.push_back(percent);
+    });
+    assert(tp::ToolpathGenerator::heightFieldCacheStats().builds == buildsBefore + 1);
+    assert(!progress.empty() && progress.back() == 100);
+    assert(std::is_sorted(progress.begin(), progress.end()));
+
+    tp::UserParams sequentialParams = params;
+    sequentialParams.concurrentPasses = 1;
+    const tp::Toolpath sequential = generator.generate(freshModel, sequentialParams, threePassAI, cancel);
+    assert(!sequential.empty());
+    assert(samePasses(concurrent.passes, sequential.passes));
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "render/Model.h"
+#include "tp/GougeChecker.h"
+#include "tp/ModelGeometryContext.h"
+#include "tp/heightfield/UniformGrid.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <QtGui/QVector3D>
+
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+render::Model buildPyramid(float height)
+{
+    std::vector<render::Vertex> vertices(5);
+    const QVector3D positions[] = {QVector3D(0.0f, 0.0f, 0.0f),
+                                   QVector3D(20.0f, 0.0f, 0.0f),
+                                   QVector3D(20.0f, 20.0f, 0.0f),
+                                   QVector3D(0.0f, 20.0f, 0.0f),
+                                   QVector3D(10.0f, 10.0f, height)};
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        vertices[i].position = positions[i];
+        vertices[i].normal = QVector3D(0.0f, 0.0f, 1.0f);
+    }
+    std::vector<render::Model::Index> indices = {0, 1, 4, 1, 2, 4, 2, 3, 4, 3, 0, 4};
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+} // namespace
+
+int main()
+{
+    std::weak_ptr<tp::ModelGeometryContext> released;
+    {
+        render::Model model = buildPyramid(8.0f);
+        assert(model.isValid());
+
+        // Copies share the mesh and therefore the context; every structure is built once.
+        const auto context = tp::ModelGeometryContext::forModel(model);
+        const render::Model copy = model;
+        assert(tp::ModelGeometryContext::forModel(copy) == context);
+        assert(&context->slicer(model) == &context->slicer(copy));
+        assert(&context->gougeChecker(model) == &context->gougeChecker(copy));
+
+        const auto grid = context->uniformGrid(model, 2.0);
+        assert(context->uniformGrid(copy, 2.0) == grid);
+
+        // The shared structures answer like freshly built ones.
+        const auto loops = context->slicer(model).slice(4.0, 0.0, false);
+        assert(loops.size() == 1);
+        const std::optional<double> surfaceZ =
+            context->gougeChecker(model).surfaceHeightAt(tp::GougeChecker::Vec3(10.0f, 10.0f, 20.0f));
+        assert(surfaceZ && std::abs(*surfaceZ - 8.0) < 1e-3);
+        double sampledZ = 0.0;
+        assert(grid->sampleMaxZAtXY(10.0, 10.0, sampledZ) && std::abs(sampledZ - 8.0) < 1e-3);
+
+        // Only the most recently used cell sizes are kept.
+        for (std::size_t i = 0; i < tp::ModelGeometryContext::kMaxUniformGrids; ++i)
+        {
+            (void)context->uniformGrid(model, 3.0 + static_cast<double>(i));
+        }
+        assert(context->uniformGrid(model, 2.0) != grid);
+
+        // New mesh data gets a new context.
+        model.setMeshData(buildPyramid(5.0f).vertices(), buildPyramid(5.0f).indices());
+        const auto rebuilt = tp::ModelGeometryContext::forModel(model);
+        assert(rebuilt != context);
+        const std::optional<double> lowerZ =
+            rebuilt->gougeChecker(model).surfaceHeightAt(tp::GougeChecker::Vec3(10.0f, 10.0f, 20.0f));
+        assert(lowerZ && std::abs(*lowerZ - 5.0) < 1e-3);
+
+        released = rebuilt;
+    }
+
+    // Once the mesh is gone the registry lets go of its context on the next lookup.
+    const render::Model other = buildPyramid(3.0f);
+    (void)tp::ModelGeometryContext::forModel(other);
+    assert(released.expired());
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "ai/IPathAI.h"
+#include "render/Model.h"
+#include "tp/ToolpathGenerator.h"
+
+#include <QtGui/QVector3D>
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::unique_ptr<render::Model> buildWaveModel(double size, int divisions)
+{
+    auto model = std::make_unique<render::Model>();
+
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(samples * samples);
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x),
+                                        static_cast<float>(y),
+                                        static_cast<float>(2.0 * std::sin(x * 0.2) * std::cos(y * 0.15)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices[row * samples + col] = vertex;
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    indices.reserve(divisions * divisions * 6);
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const int base = row * samples + col;
+            indices.push_back(static_cast<render::Model::Index>(base));
+            indices.push_back(static_cast<render::Model::Index>(base + 1));
+            indices.push_back(static_cast<render::Model::Index>(base + samples));
+            indices.push_back(static_cast<render::Model::Index>(base + 1));
+            indices.push_back(static_cast<render::Model::Index>(base + samples + 1));
+            indices.push_back(static_cast<render::Model::Index>(base + samples));
+        }
+    }
+
+    model->setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+class FixedRasterAI : public ai::IPathAI
+{
+public:
+    explicit FixedRasterAI(double stepover)
+    {
+        ai::StrategyStep step;
+        step.type = ai::StrategyStep::Type::Raster;
+        step.stepover = stepover;
+        step.stepdown = 2.0;
+        step.finish_pass = true;
+        m_decision.steps.push_back(step);
+    }
+
+    ai::StrategyDecision predict(const render::Model&, const tp::UserParams&) override
+    {
+        return m_decision;
+    }
+
+private:
+    ai::StrategyDecision m_decision{};
+};
+
+tp::UserParams makeParams(double stepover)
+{
+    tp::UserParams params;
+    params.enableRoughPass = false;
+    params.stockAllowance_mm = 0.0;
+    params.leaveStock_mm = 0.0;
+    params.stepOver = stepover;
+    params.maxDepthPerPass = 2.0;
+    params.machine = tp::makeDefaultMachine();
+    params.stock = tp::makeDefaultStock();
+    params.stock.topZ_mm = 5.0;
+    return params;
+}
+
+tp::Toolpath generate(const render::Model& model, double stepover, bool prefetchTiles = true)
+{
+    tp::ToolpathGenerator generator;
+    FixedRasterAI ai(stepover);
+    std::atomic<bool> cancel{false};
+    tp::UserParams params = makeParams(stepover);
+    params.prefetchHeightFieldTiles = prefetchTiles;
+    tp::Toolpath toolpath = generator.generate(model, params, ai, cancel);
+    assert(!toolpath.empty());
+    return toolpath;
+}
+
+bool samePasses(const tp::Toolpath& lhs, const tp::Toolpath& rhs)
+{
+    if (lhs.passes.size() != rhs.passes.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < lhs.passes.size(); ++i)
+    {
+        const auto& a = lhs.passes[i].pts;
+        const auto& b = rhs.passes[i].pts;
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (std::size_t j = 0; j < a.size(); ++j)
+        {
+            if (a[j].p != b[j].p)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    // Regenerations with unchanged parameters would otherwise reuse whole passes without touching the cache.
+    tp::ToolpathGenerator::setPassGeometryCacheCapacity(0);
+
+    // Stepovers 0.4 and 0.8 mm map to 0.2 and 0.4 mm height field resolutions.
+    {
+        const auto model = buildWaveModel(40.0, 20);
+        const tp::HeightFieldCacheStats start = tp::ToolpathGenerator::heightFieldCacheStats();
+
+        generate(*model, 0.4);
+        tp::HeightFieldCacheStats stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.builds == start.builds + 1);
+        assert(stats.misses == start.misses + 1);
+        assert(stats.entries == start.entries + 1);
+        assert(stats.bytes > start.bytes);
+
+        generate(*model, 0.4);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.hits == start.hits + 1);
+        assert(stats.builds == start.builds + 1);
+
+        // 0.4 mm is twice 0.2 mm, so the coarser field is derived from the cached one.
+        generate(*model, 0.8);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.downsampled == start.downsampled + 1);
+        assert(stats.builds == start.builds + 1);
+        assert(stats.entries == start.entries + 2);
+
+        // New mesh data invalidates the model's entries even though the object is the same.
+        const auto replacement = buildWaveModel(40.0, 20);
+        model->setMeshData(replacement->vertices(), replacement->indices());
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.invalidations == start.invalidations + 2);
+        assert(stats.entries == start.entries);
+
+        generate(*model, 0.4);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.builds == start.builds + 2);
+    }
+
+    // Destroying the model releases its entries.
+    tp::HeightFieldCacheStats stats = tp::ToolpathGenerator::heightFieldCacheStats();
+    assert(stats.entries == 0);
+
+    // The byte budget evicts least recently used fields first.
+    std::size_t oneField = 0;
+    {
+        const auto first = buildWaveModel(40.0, 20);
+        const auto second = buildWaveModel(40.0, 24);
+        generate(*first, 0.4);
+        oneField = tp::ToolpathGenerator::heightFieldCacheStats().bytes;
+        tp::ToolpathGenerator::setHeightFieldCacheCapacity(oneField + oneField / 2);
+
+        const std::uint64_t evictionsBefore = tp::ToolpathGenerator::heightFieldCacheStats().evictions;
+        generate(*second, 0.4);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.evictions == evictionsBefore + 1);
+        assert(stats.entries == 1);
+        assert(stats.bytes <= stats.capacityBytes);
+
+        const std::uint64_t buildsBefore = stats.builds;
+        generate(*second, 0.4);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.builds == buildsBefore);
+
+        tp::ToolpathGenerator::setHeightFieldCacheCapacity(0);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.entries == 0 && stats.bytes == 0);
+    }
+
+    // Quantized fields take 2 bytes per sample and still feed the downsampling path.
+    {
+        tp::ToolpathGenerator::setHeightFieldCacheCapacity(std::size_t{1} << 30);
+        tp::ToolpathGenerator::setHeightFieldQuantum(0.001);
+        const auto model = buildWaveModel(40.0, 20);
+        generate(*model, 0.4);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.entries == 1);
+        assert(stats.bytes * 4 < oneField);
+
+        const std::uint64_t downsampledBefore = stats.downsampled;
+        generate(*model, 0.8);
+        stats = tp::ToolpathGenerator::heightFieldCacheStats();
+        assert(stats.downsampled == downsampledBefore + 1);
+        tp::ToolpathGenerator::setHeightFieldQuantum(0.0);
+    }
+
+    // Lazily built fields yield the same passes as eager ones, with and without the prefetch thread.
+    {
+        const auto model = buildWaveModel(40.0, 20);
+        tp::ToolpathGenerator::setHeightFieldCacheCapacity(0);
+        tp::ToolpathGenerator::setHeightFieldCacheCapacity(std::size_t{1} << 30);
+        const tp::Toolpath eager = generate(*model, 0.4);
+
+        for (const bool prefetchTiles : {true, false})
+        {
+            tp::ToolpathGenerator::setHeightFieldCacheCapacity(0);
+            tp::ToolpathGenerator::setHeightFieldCacheCapacity(std::size_t{1} << 30);
+            tp::ToolpathGenerator::setHeightFieldLazyBuild(true);
+            const std::uint64_t buildsBefore = tp::ToolpathGenerator::heightFieldCacheStats().builds;
+            const tp::Toolpath lazy = generate(*model, 0.4, prefetchTiles);
+            assert(tp::ToolpathGenerator::heightFieldCacheStats().builds == buildsBefore + 1);
+            assert(samePasses(eager, lazy));
+
+            // The coarser pass downsamples the lazy field once its remaining tiles are built.
+            const std::uint64_t downsampledBefore = tp::ToolpathGenerator::heightFieldCacheStats().downsampled;
+            generate(*model, 0.8, prefetchTiles);
+            assert(tp::ToolpathGenerator::heightFieldCacheStats().downsampled == downsampledBefore + 1);
+            tp::ToolpathGenerator::setHeightFieldLazyBuild(false);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,319 @@
+#include "ai/IPathAI.h"
+#include "render/Model.h"
+#include "tp/GougeChecker.h"
+#include "tp/ToolpathGenerator.h"
+
+#include <QtGui/QVector3D>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+render::Model buildHeightModel(double size, int divisions, const std::function<double(double, double)>& height)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(static_cast<std::size_t>(samples * samples));
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(height(x, y)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices[static_cast<std::size_t>(row * samples + col)] = vertex;
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * samples + col);
+            const auto stride = static_cast<render::Model::Index>(samples);
+            indices.insert(indices.end(), {base, base + 1, base + stride, base + 1, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+// A 6 mm step along X with a 2 mm wide slope; vertices every millimetre reproduce it exactly.
+double stepHeight(double x, double /*y*/)
+{
+    return std::clamp((x - 29.0) * 3.0, 0.0, 6.0);
+}
+
+double pillarHeight(double x, double y)
+{
+    return (x >= 25.0 && x <= 35.0 && y >= 25.0 && y <= 35.0) ? 20.0 : 0.0;
+}
+
+class FixedAI : public ai::IPathAI
+{
+public:
+    explicit FixedAI(ai::StrategyDecision decision)
+        : m_decision(std::move(decision))
+    {
+    }
+
+    ai::StrategyDecision predict(const render::Model&, const tp::UserParams&) override
+    {
+        return m_decision;
+    }
+
+private:
+    ai::StrategyDecision m_decision{};
+};
+
+struct LinkReport
+{
+    int stayDown{-1};
+    int clearancePlane{-1};
+    int safePlane{-1};
+    double saved_s{0.0};
+};
+
+LinkReport parseLinks(const std::string& banner)
+{
+    LinkReport report;
+    const std::size_t at = banner.find("Links: ");
+    if (at != std::string::npos)
+    {
+        const int fields = std::sscanf(banner.c_str() + at,
+                                       "Links: %d stay-down, %d clearance plane, %d safe plane; about %lf s saved",
+                                       &report.stayDown,
+                                       &report.clearancePlane,
+                                       &report.safePlane,
+                                       &report.saved_s);
+        assert(fields == 4);
+    }
+    return report;
+}
+
+std::size_t countMotion(const tp::Toolpath& toolpath, tp::MotionType motion)
+{
+    return static_cast<std::size_t>(std::count_if(toolpath.passes.begin(), toolpath.passes.end(), [motion](const auto& poly) {
+        return poly.motion == motion;
+    }));
+}
+
+std::size_t countSafePlaneRapids(const tp::Toolpath& toolpath)
+{
+    std::size_t count = 0;
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        if (poly.motion == tp::MotionType::Rapid
+            && std::any_of(poly.pts.begin(), poly.pts.end(), [&](const tp::Vertex& v) {
+                   return std::abs(static_cast<double>(v.p.z) - toolpath.machine.safeZ_mm) < 1e-3;
+               }))
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Cuts below the clearance plane, which leaves out the entry and exit ramps.
+std::vector<tp::Polyline> surfaceCuts(const tp::Toolpath& toolpath)
+{
+    std::vector<tp::Polyline> cuts;
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        if (poly.motion == tp::MotionType::Cut
+            && std::all_of(poly.pts.begin(), poly.pts.end(), [&](const tp::Vertex& v) {
+                   return static_cast<double>(v.p.z) < toolpath.machine.clearanceZ_mm - 1e-3;
+               }))
+        {
+            cuts.push_back(poly);
+        }
+    }
+    return cuts;
+}
+
+// Every link and every horizontal rapid keeps the flat end mill's tip above floor(x, y).
+void checkLinksClear(const tp::Toolpath& toolpath, const std::function<double(double, double)>& floor, double rampAngleDeg)
+{
+    const double rampSlope = std::tan(rampAngleDeg * 3.14159265358979 / 180.0);
+    for (const tp::Polyline& poly : toolpath.passes)
+    {
+        if (poly.motion == tp::MotionType::Cut)
+        {
+            continue;
+        }
+        for (std::size_t i = 0; i + 1 < poly.pts.size(); ++i)
+        {
+            const glm::vec3 a = poly.pts[i].p;
+            const glm::vec3 b = poly.pts[i + 1].p;
+            const double run = std::hypot(static_cast<double>(b.x - a.x), static_cast<double>(b.y - a.y));
+            if (poly.motion == tp::MotionType::Link)
+            {
+                assert(static_cast<double>(std::max(a.z, b.z)) <= toolpath.machine.clearanceZ_mm + 1e-4);
+                assert(static_cast<double>(a.z - b.z) <= run * rampSlope + 1e-3);
+            }
+            else if (run < 1e-3)
+            {
+                continue;
+            }
+            for (int s = 0; s <= 16; ++s)
+            {
+                const glm::vec3 p = a + (b - a) * (static_cast<float>(s) / 16.0f);
+                assert(static_cast<double>(p.z) >= floor(p.x, p.y) - 1e-3);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    tp::UserParams params;
+    params.enableRoughPass = false;
+    params.stockAllowance_mm = 0.0;
+    params.leaveStock_mm = 0.0;
+    params.toolDiameter = 6.0;
+    params.stepOver = 2.0;
+    params.maxDepthPerPass = 2.0;
+    params.rampAngleDeg = 3.0;
+    params.machine = tp::makeDefaultMachine();
+    params.machine.safeZ_mm = 30.0;
+    params.machine.clearanceZ_mm = 12.0;
+    params.stock = tp::makeDefaultStock();
+    params.stock.topZ_mm = 8.0;
+    const double toolRadius = params.toolDiameter * 0.5;
+
+    ai::StrategyDecision raster;
+    ai::StrategyStep rows;
+    rows.type = ai::StrategyStep::Type::Raster;
+    rows.stepover = params.stepOver;
+    rows.stepdown = params.maxDepthPerPass;
+    rows.finish_pass = true;
+    raster.steps.push_back(rows);
+    FixedAI rasterAI(raster);
+    tp::ToolpathGenerator generator;
+    std::atomic<bool> cancel{false};
+
+    // The tip of a flat end mill has to clear the highest point of the step under it.
+    const render::Model step = buildHeightModel(60.0, 60, stepHeight);
+    const auto stepFloor = [toolRadius](double x, double y) { return stepHeight(x + toolRadius, y); };
+
+    // Under a disc reaching partway up the slope, the highest point is where the rim meets the slope rather
+    // than the top of the step; a rim just touching the foot of the slope stays on the floor. Past the end of
+    // the slope, a disc catching only its corner counts the slope with its height at the rim.
+    const tp::GougeChecker stepChecker(step);
+    tp::GougeChecker::QueryContext query;
+    const auto discHeight = [&](double x, double y) {
+        const std::optional<double> height = stepChecker.maxHeightUnderDisc(x, y, toolRadius, query);
+        assert(height);
+        return *height;
+    };
+    assert(std::abs(discHeight(27.0, 30.0) - 3.0) < 1e-4);
+    assert(std::abs(discHeight(27.5, 30.0) - 4.5) < 1e-4);
+    assert(std::abs(discHeight(26.0, 30.0)) < 1e-4);
+    assert(std::abs(discHeight(20.0, 30.0)) < 1e-4);
+    assert(std::abs(discHeight(35.0, 30.0) - 6.0) < 1e-4);
+    const double cornerReach = 28.0 + std::sqrt(toolRadius * toolRadius - 2.8 * 2.8) - 29.0;
+    assert(std::abs(discHeight(28.0, 62.8) - 3.0 * cornerReach) < 1e-3);
+    assert(!stepChecker.maxHeightUnderDisc(-10.0, 30.0, toolRadius, query));
+
+    tp::UserParams safe = params;
+    safe.linking = tp::UserParams::Linking::SafePlane;
+    std::string safeBanner;
+    const tp::Toolpath retracting = generator.generate(step, safe, rasterAI, cancel, {}, nullptr, &safeBanner);
+    assert(!retracting.empty());
+    assert(countMotion(retracting, tp::MotionType::Link) == 0);
+    assert(parseLinks(safeBanner).stayDown < 0);
+    const std::size_t cutCount = surfaceCuts(retracting).size();
+    assert(cutCount > 10);
+    assert(countSafePlaneRapids(retracting) > cutCount);
+    checkLinksClear(retracting, stepFloor, params.rampAngleDeg);
+
+    // Crossing at the clearance plane only climbs to the safe plane before the first cut and after the last.
+    tp::UserParams clearance = params;
+    clearance.linking = tp::UserParams::Linking::ClearancePlane;
+    std::string clearanceBanner;
+    const tp::Toolpath crossing = generator.generate(step, clearance, rasterAI, cancel, {}, nullptr, &clearanceBanner);
+    const LinkReport crossingLinks = parseLinks(clearanceBanner);
+    assert(crossingLinks.stayDown == 0 && crossingLinks.safePlane == 0);
+    assert(crossingLinks.clearancePlane == static_cast<int>(cutCount) - 1);
+    assert(crossingLinks.saved_s > 0.0);
+    assert(countMotion(crossing, tp::MotionType::Link) == 0);
+    assert(countSafePlaneRapids(crossing) == 2);
+    checkLinksClear(crossing, stepFloor, params.rampAngleDeg);
+
+    // Neighbouring rows are joined without leaving the material, and the rows themselves do not change.
+    std::string stayBanner;
+    const tp::Toolpath staying = generator.generate(step, params, rasterAI, cancel, {}, nullptr, &stayBanner);
+    const LinkReport stayLinks = parseLinks(stayBanner);
+    assert(stayLinks.stayDown > 0);
+    assert(stayLinks.stayDown + stayLinks.clearancePlane + stayLinks.safePlane == static_cast<int>(cutCount) - 1);
+    assert(countMotion(staying, tp::MotionType::Link) == static_cast<std::size_t>(stayLinks.stayDown));
+    assert(stayLinks.saved_s > crossingLinks.saved_s);
+    checkLinksClear(staying, stepFloor, params.rampAngleDeg);
+    const std::vector<tp::Polyline> stayCuts = surfaceCuts(staying);
+    const std::vector<tp::Polyline> safeCuts = surfaceCuts(retracting);
+    assert(stayCuts.size() == safeCuts.size());
+    for (std::size_t i = 0; i < stayCuts.size(); ++i)
+    {
+        assert(stayCuts[i].pts.size() == safeCuts[i].pts.size());
+        for (std::size_t j = 0; j < stayCuts[i].pts.size(); ++j)
+        {
+            assert(stayCuts[i].pts[j].p == safeCuts[i].pts[j].p);
+        }
+    }
+
+    // A pillar reaching through the clearance plane sends the moves next to it up to the safe plane.
+    const render::Model pillar = buildHeightModel(60.0, 60, pillarHeight);
+    const auto pillarFloor = [toolRadius](double x, double y) {
+        double highest = 0.0;
+        for (double vx = std::floor(x - toolRadius); vx <= x + toolRadius; vx += 1.0)
+        {
+            for (double vy = std::floor(y - toolRadius); vy <= y + toolRadius; vy += 1.0)
+            {
+                if (std::hypot(vx - x, vy - y) < toolRadius - 1e-3)
+                {
+                    highest = std::max(highest, pillarHeight(vx, vy));
+                }
+            }
+        }
+        return highest;
+    };
+    tp::UserParams low = params;
+    low.stock.topZ_mm = 5.0;
+    low.machine.clearanceZ_mm = 5.5;
+    low.machine.safeZ_mm = 40.0;
+    ai::StrategyDecision waterline;
+    ai::StrategyStep levels;
+    levels.type = ai::StrategyStep::Type::Waterline;
+    levels.stepdown = 1.5;
+    levels.finish_pass = true;
+    waterline.steps.push_back(levels);
+    FixedAI waterlineAI(waterline);
+    std::string pillarBanner;
+    const tp::Toolpath around = generator.generate(pillar, low, waterlineAI, cancel, {}, nullptr, &pillarBanner);
+    assert(!around.empty());
+    const LinkReport pillarLinks = parseLinks(pillarBanner);
+    assert(pillarLinks.safePlane > 0);
+    // Loops touching the pillar's walls still link by staying down and over the clearance plane.
+    assert(pillarLinks.stayDown > 0 && pillarLinks.clearancePlane > 0);
+    checkLinksClear(around, pillarFloor, low.rampAngleDeg);
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "ai/IPathAI.h"
+#include "render/Model.h"
+#include "tp/ToolpathGenerator.h"
+
+#include <QtGui/QVector3D>
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::unique_ptr<render::Model> buildWaveModel(double size, int divisions)
+{
+    std::vector<render::Vertex> vertices;
+    vertices.reserve(static_cast<std::size_t>((divisions + 1) * (divisions + 1)));
+    for (int row = 0; row <= divisions; ++row)
+    {
+        for (int col = 0; col <= divisions; ++col)
+        {
+            const double x = size * static_cast<double>(col) / static_cast<double>(divisions);
+            const double y = size * static_cast<double>(row) / static_cast<double>(divisions);
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x),
+                                        static_cast<float>(y),
+                                        static_cast<float>(3.0 * std::sin(x * 0.2) * std::cos(y * 0.15)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices.push_back(vertex);
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * (divisions + 1) + col);
+            const auto stride = static_cast<render::Model::Index>(divisions + 1);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    auto model = std::make_unique<render::Model>();
+    model->setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+class FixedAI : public ai::IPathAI
+{
+public:
+    explicit FixedAI(ai::StrategyDecision decision)
+        : m_decision(std::move(decision))
+    {
+    }
+
+    ai::StrategyDecision predict(const render::Model&, const tp::UserParams&) override
+    {
+        return m_decision;
+    }
+
+private:
+    ai::StrategyDecision m_decision{};
+};
+
+bool sameToolpath(const tp::Toolpath& a, const tp::Toolpath& b)
+{
+    if (a.feed != b.feed || a.spindle != b.spindle || a.machine.safeZ_mm != b.machine.safeZ_mm
+        || a.passes.size() != b.passes.size())
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.passes.size(); ++i)
+    {
+        if (a.passes[i].motion != b.passes[i].motion || a.passes[i].strategyStep != b.passes[i].strategyStep
+            || a.passes[i].pts.size() != b.passes[i].pts.size())
+        {
+            return false;
+        }
+        for (std::size_t j = 0; j < a.passes[i].pts.size(); ++j)
+        {
+            if (a.passes[i].pts[j].p != b.passes[i].pts[j].p)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    tp::UserParams params;
+    params.stockAllowance_mm = 0.5;
+    params.leaveStock_mm = 0.2;
+    params.toolDiameter = 3.0;
+    params.stepOver = 1.0;
+    params.maxDepthPerPass = 2.0;
+    params.machine = tp::makeDefaultMachine();
+    params.stock = tp::makeDefaultStock();
+    params.stock.topZ_mm = 5.0;
+
+    ai::StrategyDecision decision;
+    ai::StrategyStep rough;
+    rough.type = ai::StrategyStep::Type::Raster;
+    rough.stepover = 1.0;
+    rough.stepdown = 2.0;
+    rough.angle_deg = 30.0;
+    decision.steps.push_back(rough);
+    ai::StrategyStep finish = rough;
+    finish.finish_pass = true;
+    decision.steps.push_back(finish);
+    ai::StrategyStep waterline = finish;
+    waterline.type = ai::StrategyStep::Type::Waterline;
+    decision.steps.push_back(waterline);
+
+    FixedAI ai(decision);
+    tp::ToolpathGenerator generator;
+    std::atomic<bool> cancel{false};
+
+    // Identical meshes in separate models never share cache entries, so the second model always yields a
+    // freshly generated reference.
+    auto model = buildWaveModel(40.0, 40);
+    const auto reference = buildWaveModel(40.0, 40);
+    const std::size_t startEntries = tp::ToolpathGenerator::passGeometryCacheStats().entries;
+
+    ai::StrategyDecision applied;
+    const tp::Toolpath first = generator.generate(*model, params, ai, cancel, {}, &applied);
+    assert(!first.empty());
+    const std::size_t passCount = applied.steps.size();
+    assert(passCount == 3);
+    tp::PassGeometryCacheStats stats = tp::ToolpathGenerator::passGeometryCacheStats();
+    assert(stats.entries == startEntries + passCount);
+    assert(stats.bytes > 0 && stats.bytes <= stats.capacityBytes);
+
+    // Feeds and linking changes reuse every pass without going back to the height field, and the toolpath
+    // matches a fresh generation with the new settings.
+    tp::UserParams linking = params;
+    linking.feed = 1200.0;
+    linking.spindle = 9000.0;
+    linking.enableRamp = false;
+    linking.leadInLength = 1.5;
+    linking.machine.safeZ_mm = 25.0;
+    const tp::HeightFieldCacheStats fieldsBefore = tp::ToolpathGenerator::heightFieldCacheStats();
+    const tp::PassGeometryCacheStats before = tp::ToolpathGenerator::passGeometryCacheStats();
+    std::string banner;
+    const tp::Toolpath relinked = generator.generate(*model, linking, ai, cancel, {}, nullptr, &banner);
+    stats = tp::ToolpathGenerator::passGeometryCacheStats();
+    assert(stats.hits == before.hits + passCount);
+    assert(stats.misses == before.misses);
+    assert(tp::ToolpathGenerator::heightFieldCacheStats().hits == fieldsBefore.hits);
+    assert(tp::ToolpathGenerator::heightFieldCacheStats().builds == fieldsBefore.builds);
+    assert(banner.find("cut geometry reused") != std::string::npos);
+    assert(sameToolpath(relinked, generator.generate(*reference, linking, ai, cancel)));
+    assert(!sameToolpath(relinked, first));
+
+    // A safe plane low enough to cap the leave-stock fixup changes the cut, so the passes are regenerated.
+    tp::UserParams lowSafe = params;
+    lowSafe.machine.safeZ_mm = 1.0;
+    const tp::PassGeometryCacheStats beforeLow = tp::ToolpathGenerator::passGeometryCacheStats();
+    const tp::Toolpath capped = generator.generate(*model, lowSafe, ai, cancel);
+    assert(tp::ToolpathGenerator::passGeometryCacheStats().hits == beforeLow.hits);
+    assert(sameToolpath(capped, generator.generate(*reference, lowSafe, ai, cancel)));
+
+    // Cut parameters are part of the key.
+    tp::UserParams moreStock = params;
+    moreStock.leaveStock_mm = 0.4;
+    const tp::PassGeometryCacheStats beforeStock = tp::ToolpathGenerator::passGeometryCacheStats();
+    const tp::Toolpath thicker = generator.generate(*model, moreStock, ai, cancel);
+    assert(tp::ToolpathGenerator::passGeometryCacheStats().hits == beforeStock.hits);
+    assert(sameToolpath(thicker, generator.generate(*reference, moreStock, ai, cancel)));
+
+    // Entries go with their mesh, and a zero budget turns the cache off.
+    const std::size_t entriesWithModel = tp::ToolpathGenerator::passGeometryCacheStats().entries;
+    model.reset();
+    assert(tp::ToolpathGenerator::passGeometryCacheStats().entries < entriesWithModel);
+    tp::ToolpathGenerator::setPassGeometryCacheCapacity(0);
+    assert(tp::ToolpathGenerator::passGeometryCacheStats().entries == 0);
+    (void)generator.generate(*reference, params, ai, cancel);
+    assert(tp::ToolpathGenerator::passGeometryCacheStats().entries == 0);
+
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include "tp/PassOrdering.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+double horizontalDistance(const glm::dvec3& a, const glm::dvec3& b)
+{
+    const double dx = a.x - b.x;
+    const double dy = a.y - b.y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// The quadratic greedy ordering the grid-backed one replaced.
+std::vector<std::size_t> referenceOrder(const std::vector<tp::Polyline>& polylines, const glm::dvec3* seed)
+{
+    const std::size_t count = polylines.size();
+    std::vector<bool> used(count, false);
+    const auto startPoint = [&](std::size_t i) { return glm::dvec3(polylines[i].pts.front().p); };
+    const auto chooseClosest = [&](const glm::dvec3& from) {
+        double bestDist = std::numeric_limits<double>::max();
+        std::size_t bestIndex = count;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double dist = horizontalDistance(from, startPoint(i));
+            if (!used[i] && dist < bestDist)
+            {
+                bestDist = dist;
+                bestIndex = i;
+            }
+        }
+        return bestIndex;
+    };
+
+    std::size_t current = 0;
+    if (seed)
+    {
+        current = chooseClosest(*seed);
+    }
+    else
+    {
+        double bestMetric = std::numeric_limits<double>::max();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double metric = std::abs(startPoint(i).x) + std::abs(startPoint(i).y);
+            if (metric < bestMetric)
+            {
+                bestMetric = metric;
+                current = i;
+            }
+        }
+    }
+
+    std::vector<std::size_t> order;
+    while (true)
+    {
+        used[current] = true;
+        order.push_back(current);
+        if (order.size() == count)
+        {
+            return order;
+        }
+        current = chooseClosest(glm::dvec3(polylines[current].pts.back().p));
+    }
+}
+
+tp::Polyline makeSegment(float x0, float y0, float x1, float y1, float z, int tag)
+{
+    tp::Polyline poly;
+    poly.pts.push_back({glm::vec3(x0, y0, z)});
+    poly.pts.push_back({glm::vec3(x1, y1, z)});
+    poly.strategyStep = tag;
+    return poly;
+}
+
+tp::Polyline makeLoop(float cx, float cy, float radius, float z, int tag)
+{
+    tp::Polyline poly;
+    for (int k = 0; k < 16; ++k)
+    {
+        const float angle = static_cast<float>(k) * 6.2831853f / 16.0f;
+        poly.pts.push_back({glm::vec3(cx + radius * std::cos(angle), cy + radius * std::sin(angle), z)});
+    }
+    poly.pts.push_back(poly.pts.front());
+    poly.strategyStep = tag;
+    return poly;
+}
+
+double rapidLength(const std::vector<tp::Polyline>& polylines, const glm::dvec3* seed)
+{
+    double total = 0.0;
+    for (std::size_t i = 0; i < polylines.size(); ++i)
+    {
+        const glm::dvec3 head(polylines[i].pts.front().p);
+        if (i > 0)
+        {
+            total += horizontalDistance(glm::dvec3(polylines[i - 1].pts.back().p), head);
+        }
+        else if (seed)
+        {
+            total += horizontalDistance(*seed, head);
+        }
+    }
+    return total;
+}
+
+// Every input polyline appears once in the output, reversed only where that is allowed.
+void checkSamePolylines(const std::vector<tp::Polyline>& input,
+                        const std::vector<tp::Polyline>& output,
+                        bool allowReverse,
+                        std::size_t* reversedCount = nullptr)
+{
+    assert(input.size() == output.size());
+    std::vector<bool> seen(input.size(), false);
+    std::size_t reversed = 0;
+    for (const tp::Polyline& poly : output)
+    {
+        const auto tag = static_cast<std::size_t>(poly.strategyStep);
+        assert(tag < input.size() && !seen[tag]);
+        seen[tag] = true;
+        const auto& original = input[tag].pts;
+        assert(original.size() == poly.pts.size());
+        const bool same = std::equal(original.begin(), original.end(), poly.pts.begin(), [](const auto& a, const auto& b) {
+            return a.p == b.p;
+        });
+        if (!same)
+        {
+            assert(allowReverse);
+            assert(original.front().p != original.back().p);
+            assert(std::equal(original.rbegin(), original.rend(), poly.pts.begin(), [](const auto& a, const auto& b) {
+                return a.p == b.p;
+            }));
+            ++reversed;
+        }
+    }
+    if (reversedCount)
+    {
+        *reversedCount = reversed;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(-40.0f, 80.0f);
+
+    // Without improvement the grid gives exactly the order of the quadratic scan, ties included.
+    {
+        std::vector<tp::Polyline> input;
+        for (int i = 0; i < 1500; ++i)
+        {
+            const float x = std::round(coord(rng));
+            const float y = std::round(coord(rng));
+            input.push_back(makeSegment(x, y, x + std::round(coord(rng) * 0.1f), y + 2.0f, 0.0f, i));
+        }
+        const glm::dvec3 seed(200.0, -30.0, 5.0);
+        for (const glm::dvec3* seedPtr : {static_cast<const glm::dvec3*>(nullptr), &seed})
+        {
+            std::vector<tp::Polyline> ordered = input;
+            tp::PassOrderingStats stats;
+            const glm::dvec3 end = tp::orderPassRange(ordered, 0, ordered.size(), seedPtr, {}, &stats);
+            const std::vector<std::size_t> expected = referenceOrder(input, seedPtr);
+            for (std::size_t i = 0; i < ordered.size(); ++i)
+            {
+                assert(static_cast<std::size_t>(ordered[i].strategyStep) == expected[i]);
+            }
+            assert(end == glm::dvec3(ordered.back().pts.back().p));
+            assert(std::abs(stats.rapidBefore_mm - rapidLength(input, seedPtr)) < 1e-6);
+            assert(std::abs(stats.rapidNearestNeighbour_mm - rapidLength(ordered, seedPtr)) < 1e-6);
+            assert(stats.rapidAfter_mm == stats.rapidNearestNeighbour_mm && stats.improvements == 0);
+        }
+    }
+
+    // Improvement moves shorten the air moves of scattered loops and keep every loop as it was.
+    {
+        std::vector<tp::Polyline> input;
+        for (int i = 0; i < 3000; ++i)
+        {
+            input.push_back(makeLoop(coord(rng), coord(rng), 0.5f, 0.0f, i));
+        }
+        std::vector<tp::Polyline> ordered = input;
+        tp::PassOrderingOptions options;
+        options.clearance_mm = 3.0;
+        options.improveSteps = 10'000'000;
+        tp::PassOrderingStats stats;
+        const glm::dvec3 end = tp::orderPassRange(ordered, 0, ordered.size(), nullptr, options, &stats);
+        assert(stats.improvements > 0 && !stats.budgetExhausted);
+        assert(stats.rapidAfter_mm < 0.95 * stats.rapidNearestNeighbour_mm);
+        assert(std::abs(stats.rapidAfter_mm - rapidLength(ordered, nullptr)) < 1e-6 * stats.rapidAfter_mm);
+        assert(end == glm::dvec3(ordered.back().pts.back().p));
+        checkSamePolylines(input, ordered, false);
+
+        // A step limit that runs out stops part way, at the same order every time; a time cap only adds a
+        // way to stop earlier.
+        options.improveSteps = 2000;
+        std::vector<tp::Polyline> first = input;
+        tp::PassOrderingStats firstStats;
+        (void)tp::orderPassRange(first, 0, first.size(), nullptr, options, &firstStats);
+        std::vector<tp::Polyline> second = input;
+        options.improveBudget_ms = 60'000.0;
+        (void)tp::orderPassRange(second, 0, second.size(), nullptr, options);
+        assert(firstStats.budgetExhausted && firstStats.improvements > 0);
+        assert(firstStats.rapidAfter_mm > stats.rapidAfter_mm);
+        for (std::size_t i = 0; i < first.size(); ++i)
+        {
+            assert(first[i].strategyStep == second[i].strategyStep);
+        }
+    }
+
+    // Open polylines are only cut backwards when allowed, and doing so never lengthens the air moves.
+    {
+        std::vector<tp::Polyline> input;
+        for (int i = 0; i < 800; ++i)
+        {
+            const float x = coord(rng);
+            const float y = coord(rng);
+            input.push_back(makeSegment(x, y, x + 3.0f, y + 1.0f, 0.0f, i));
+        }
+        tp::PassOrderingOptions options;
+        options.improveSteps = 10'000'000;
+
+        std::vector<tp::Polyline> forwardOnly = input;
+        tp::PassOrderingStats forwardStats;
+        (void)tp::orderPassRange(forwardOnly, 0, forwardOnly.size(), nullptr, options, &forwardStats);
+        checkSamePolylines(input, forwardOnly, false);
+        assert(forwardStats.rapidAfter_mm <= forwardStats.rapidNearestNeighbour_mm);
+
+        options.allowReverse = true;
+        std::vector<tp::Polyline> either = input;
+        tp::PassOrderingStats eitherStats;
+        (void)tp::orderPassRange(either, 0, either.size(), nullptr, options, &eitherStats);
+        std::size_t reversed = 0;
+        checkSamePolylines(input, either, true, &reversed);
+        assert(reversed > 0);
+        assert(eitherStats.rapidAfter_mm < eitherStats.rapidNearestNeighbour_mm);
+        assert(std::abs(eitherStats.rapidAfter_mm - rapidLength(either, nullptr)) < 1e-6 * eitherStats.rapidAfter_mm);
+    }
+
+    // Stacked loops at different depths keep the relative order the greedy stage gave them however the
+    // stacks get rearranged.
+    {
+        std::vector<tp::Polyline> input;
+        int tag = 0;
+        for (int stack = 0; stack < 300; ++stack)
+        {
+            const float x = coord(rng);
+            const float y = coord(rng);
+            const int levels = stack % 3 == 0 ? 1 : 2;
+            for (int level = 0; level < levels; ++level)
+            {
+                input.push_back(makeLoop(x, y, 1.0f + 0.3f * static_cast<float>(level), -static_cast<float>(level), tag++));
+            }
+            if (levels == 1)
+            {
+                input.push_back(makeLoop(x + 20.0f, y, 1.0f, 0.0f, tag++));
+            }
+        }
+        const glm::dvec3 seed(0.0, 0.0, 10.0);
+        std::vector<tp::Polyline> greedy = input;
+        (void)tp::orderPassRange(greedy, 0, greedy.size(), &seed);
+
+        std::vector<tp::Polyline> ordered = input;
+        tp::PassOrderingOptions options;
+        options.clearance_mm = 2.0;
+        options.improveSteps = 10'000'000;
+        tp::PassOrderingStats stats;
+        (void)tp::orderPassRange(ordered, 0, ordered.size(), &seed, options, &stats);
+        checkSamePolylines(input, ordered, false);
+        assert(stats.improvements > 0 && stats.rapidAfter_mm < stats.rapidNearestNeighbour_mm);
+
+        const auto positions = [&](const std::vector<tp::Polyline>& polylines) {
+            std::vector<std::size_t> position(polylines.size());
+            for (std::size_t i = 0; i < polylines.size(); ++i)
+            {
+                position[static_cast<std::size_t>(polylines[i].strategyStep)] = i;
+            }
+            return position;
+        };
+        const std::vector<std::size_t> greedyPosition = positions(greedy);
+        const std::vector<std::size_t> position = positions(ordered);
+        for (std::size_t a = 0; a + 1 < input.size(); ++a)
+        {
+            const std::size_t b = a + 1;
+            if (input[a].pts.front().p.z != input[b].pts.front().p.z)
+            {
+                assert((greedyPosition[a] < greedyPosition[b]) == (position[a] < position[b]));
+            }
+        }
+    }
+
+    return 0;
+}
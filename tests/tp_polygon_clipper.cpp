@@ -0,0 +1,285 @@
+#include "tp/PolygonClipper.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+constexpr double kPi = 3.14159265358979323846;
+
+double signedArea(const tp::Path2& path)
+{
+    double area = 0.0;
+    for (std::size_t i = 0; i < path.size(); ++i)
+    {
+        const glm::dvec2& a = path[i];
+        const glm::dvec2& b = path[(i + 1) % path.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return 0.5 * area;
+}
+
+double totalArea(const std::vector<tp::Path2>& paths)
+{
+    double area = 0.0;
+    for (const tp::Path2& path : paths)
+    {
+        area += signedArea(path);
+    }
+    return area;
+}
+
+tp::Path2 rectangle(double x0, double y0, double x1, double y1)
+{
+    return {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+}
+
+tp::Path2 circle(const glm::dvec2& centre, double radius, int points)
+{
+    tp::Path2 path;
+    for (int i = 0; i < points; ++i)
+    {
+        const double angle = 2.0 * kPi * static_cast<double>(i) / static_cast<double>(points);
+        path.push_back(centre + radius * glm::dvec2(std::cos(angle), std::sin(angle)));
+    }
+    return path;
+}
+
+tp::Path2 reversed(tp::Path2 path)
+{
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+double distanceToSegment(const glm::dvec2& p, const glm::dvec2& a, const glm::dvec2& b)
+{
+    const glm::dvec2 ab = b - a;
+    const double t = std::clamp(glm::dot(p - a, ab) / glm::dot(ab, ab), 0.0, 1.0);
+    return glm::length(p - (a + t * ab));
+}
+
+double distanceToPaths(const glm::dvec2& p, const std::vector<tp::Path2>& paths)
+{
+    double distance = std::numeric_limits<double>::infinity();
+    for (const tp::Path2& path : paths)
+    {
+        for (std::size_t i = 0; i < path.size(); ++i)
+        {
+            distance = std::min(distance, distanceToSegment(p, path[i], path[(i + 1) % path.size()]));
+        }
+    }
+    return distance;
+}
+
+bool near(double a, double b, double tolerance)
+{
+    return std::abs(a - b) <= tolerance;
+}
+
+} // namespace
+
+int main()
+{
+    tp::PolygonClipper clipper;
+
+    // Two overlapping squares, the second given clockwise: every operation sees them as filled.
+    {
+        const tp::Path2 a = rectangle(0.0, 0.0, 2.0, 2.0);
+        const tp::Path2 b = reversed(rectangle(1.0, 1.0, 3.0, 3.0));
+        const auto run = [&](tp::ClipOperation operation) {
+            clipper.addPath(a, tp::PolygonClipper::Role::Subject);
+            clipper.addPath(b, tp::PolygonClipper::Role::Clip);
+            return clipper.execute(operation, tp::FillRule::NonZero);
+        };
+        const auto unionLoops = run(tp::ClipOperation::Union);
+        assert(unionLoops.size() == 1 && unionLoops.front().size() == 8);
+        assert(near(signedArea(unionLoops.front()), 7.0, 1e-9));
+        assert(near(totalArea(run(tp::ClipOperation::Intersection)), 1.0, 1e-9));
+        assert(near(totalArea(run(tp::ClipOperation::Difference)), 3.0, 1e-9));
+        const auto xorLoops = run(tp::ClipOperation::Xor);
+        assert(xorLoops.size() == 2 && near(totalArea(xorLoops), 6.0, 1e-9));
+    }
+
+    // A bow tie resolves into its two triangles; squares sharing an edge merge, and squares touching at
+    // a corner stay two loops.
+    {
+        clipper.addPath(tp::Path2{{0.0, 0.0}, {2.0, 2.0}, {2.0, 0.0}, {0.0, 2.0}});
+        const auto bowTie = clipper.execute(tp::ClipOperation::Union, tp::FillRule::NonZero);
+        assert(bowTie.size() == 2 && near(totalArea(bowTie), 2.0, 1e-9));
+
+        clipper.addPaths(std::vector<tp::Path2>{rectangle(0.0, 0.0, 1.0, 1.0), rectangle(1.0, 0.0, 2.0, 1.0)});
+        const auto shared = clipper.execute(tp::ClipOperation::Union, tp::FillRule::NonZero);
+        assert(shared.size() == 1 && shared.front().size() == 4 && near(signedArea(shared.front()), 2.0, 1e-9));
+
+        clipper.addPaths(std::vector<tp::Path2>{rectangle(0.0, 0.0, 1.0, 1.0), rectangle(1.0, 1.0, 2.0, 2.0)});
+        const auto corner = clipper.execute(tp::ClipOperation::Union, tp::FillRule::NonZero);
+        assert(corner.size() == 2 && near(signedArea(corner[0]), 1.0, 1e-9) && near(signedArea(corner[1]), 1.0, 1e-9));
+    }
+
+    // Nested loops under the even-odd rule: an outer square with a hole, whatever the loops' directions.
+    // Growing shrinks the hole until it closes; shrinking widens it until only the corners, furthest from
+    // both boundaries, are left.
+    {
+        const std::vector<tp::Path2> ring{rectangle(0.0, 0.0, 10.0, 10.0), rectangle(3.0, 3.0, 7.0, 7.0)};
+        clipper.addPaths(ring);
+        const auto resolved = clipper.execute(tp::ClipOperation::Union, tp::FillRule::EvenOdd);
+        assert(resolved.size() == 2 && near(totalArea(resolved), 84.0, 1e-9));
+        assert(signedArea(resolved[0]) * signedArea(resolved[1]) < 0.0);
+
+        clipper.addPaths(ring);
+        const auto grown = clipper.offset(1.0, tp::FillRule::EvenOdd, 1e-3);
+        assert(grown.size() == 2);
+        const double outer = 144.0 - (4.0 - kPi);
+        const double hole = 4.0;
+        assert(near(totalArea(grown), outer - hole, 1e-2));
+
+        clipper.addPaths(ring);
+        const auto closed = clipper.offset(2.5, tp::FillRule::EvenOdd, 1e-3);
+        assert(closed.size() == 1 && signedArea(closed.front()) > 0.0);
+
+        clipper.addPaths(ring);
+        const auto thinned = clipper.offset(-1.0, tp::FillRule::EvenOdd, 1e-3);
+        assert(thinned.size() == 2 && near(totalArea(thinned), 64.0 - (36.0 - (4.0 - kPi)), 1e-2));
+
+        clipper.addPaths(ring);
+        const auto corners = clipper.offset(-1.6, tp::FillRule::EvenOdd, 1e-3);
+        assert(corners.size() == 4);
+        for (const tp::Path2& corner : corners)
+        {
+            assert(signedArea(corner) > 0.1 && signedArea(corner) < 0.2);
+        }
+
+        clipper.addPaths(ring);
+        assert(clipper.offset(-2.2, tp::FillRule::EvenOdd, 1e-3).empty());
+    }
+
+    // Circles grow and shrink to circles, within the arc tolerance.
+    {
+        for (const double delta : {2.0, -2.0, 0.25})
+        {
+            clipper.addPath(circle({5.0, -3.0}, 4.0, 720));
+            const auto loops = clipper.offset(delta, tp::FillRule::NonZero, 1e-3);
+            assert(loops.size() == 1);
+            for (const glm::dvec2& p : loops.front())
+            {
+                assert(near(glm::length(p - glm::dvec2(5.0, -3.0)), 4.0 + delta, 2e-3));
+            }
+        }
+        clipper.addPath(circle({0.0, 0.0}, 1.0, 90));
+        assert(clipper.offset(-1.5, tp::FillRule::NonZero, 1e-3).empty());
+    }
+
+    // Sharp spikes stay within the offset distance of the input and come back rounded, with no points
+    // thrown out along the bisector.
+    {
+        const tp::Path2 spike{{0.0, 0.0}, {40.0, 0.5}, {0.0, 1.0}, {-1.0, 0.5}};
+        for (const double delta : {1.0, 0.3})
+        {
+            clipper.addPath(spike);
+            const auto loops = clipper.offset(delta, tp::FillRule::NonZero, 1e-3);
+            assert(loops.size() == 1);
+            for (const glm::dvec2& p : loops.front())
+            {
+                assert(near(distanceToPaths(p, {spike}), delta, 2e-3));
+            }
+        }
+    }
+
+    // Loops that grow into each other merge, and nothing is left of a wall thinner than the cutter.
+    {
+        clipper.addPaths(std::vector<tp::Path2>{circle({0.0, 0.0}, 5.0, 360), circle({11.5, 0.0}, 5.0, 360)});
+        assert(clipper.offset(0.5, tp::FillRule::NonZero, 1e-3).size() == 2);
+        clipper.addPaths(std::vector<tp::Path2>{circle({0.0, 0.0}, 5.0, 360), circle({11.5, 0.0}, 5.0, 360)});
+        assert(clipper.offset(1.0, tp::FillRule::NonZero, 1e-3).size() == 1);
+
+        clipper.addPath(rectangle(0.0, 0.0, 20.0, 0.5));
+        assert(clipper.offset(-0.3, tp::FillRule::NonZero, 1e-3).empty());
+    }
+
+    // Edges that run back over each other cancel however far the input is scaled, including when the grid
+    // has to coarsen to fit it.
+    {
+        const tp::Path2 overlapping{{3, 7}, {1, 1}, {7, 5}, {3, 0}, {7, 3}, {3, 3}, {0, 7}, {5, 1}, {2, 4}};
+        double unitArea = 0.0;
+        for (const double scale : {1.0, 1000.0, 1e5})
+        {
+            tp::Path2 path = overlapping;
+            for (glm::dvec2& point : path)
+            {
+                point *= scale;
+            }
+            clipper.addPath(path);
+            const auto grown = clipper.offset(1.4 * scale, tp::FillRule::EvenOdd, 1e-4 * scale);
+            const double area = totalArea(grown) / (scale * scale);
+            unitArea = (scale == 1.0) ? area : unitArea;
+            assert(std::abs(area - unitArea) < 1e-3 * unitArea);
+        }
+    }
+
+    // Steep edges of the grown loops crowd around a few points, where rounding each crossing to the grid
+    // used to keep making new ones; the pieces must still settle into a region larger than the input.
+    {
+        const std::vector<tp::Path2> tangle{
+            tp::Path2{
+                {7164.3, 5001.2}, {6477.9, 7559.5}, {4005.7, 7231.6}, {9240.9, 7617.6}, {3266.1, 9676.1},
+                {9594.1, 6059.6}, {110.8, 5220.0}, {8328.4, 3476.2}},
+            tp::Path2{
+                {6854.1, 4911.8}, {9702.0, 7016.4}, {1147.3, 641.5}, {9243.4, 1745.9}, {2432.4, 5260.9},
+                {4490.9, 1024.1}, {2890.6, 4846.2}, {736.3, 9373.8}, {7123.6, 262.8}, {2479.4, 3038.7}},
+            tp::Path2{
+                {5205.3, 9788.1}, {2820.3, 4166.6}, {4081.9, 9951.9}, {1806.6, 7646.8}, {806.5, 7103.8},
+                {7466.6, 6992.8}, {7408.5, 9955.9}, {7192.7, 6682.6}, {6300.9, 8266.8}, {9889.0, 278.5}}};
+        clipper.addPaths(tangle);
+        const auto resolved = clipper.execute(tp::ClipOperation::Union, tp::FillRule::Positive);
+        clipper.addPaths(tangle);
+        const auto grown = clipper.offset(626.0, tp::FillRule::Positive, 1.0);
+        assert(totalArea(grown) > totalArea(resolved));
+        for (const tp::Path2& loop : grown)
+        {
+            for (const glm::dvec2& p : loop)
+            {
+                assert(near(distanceToPaths(p, resolved), 626.0, 1.0));
+            }
+        }
+    }
+
+    // Thousands of loops in one level: a 50 x 50 field of 96-point islands that grow into a single
+    // region with 49 x 49 holes between them.
+    {
+        std::vector<tp::Path2> islands;
+        for (int row = 0; row < 50; ++row)
+        {
+            for (int col = 0; col < 50; ++col)
+            {
+                islands.push_back(circle({4.0 * col, 4.0 * row}, 1.8, 96));
+            }
+        }
+        for (int repeat = 0; repeat < 2; ++repeat)
+        {
+            clipper.addPaths(islands);
+            const auto start = std::chrono::steady_clock::now();
+            const auto loops = clipper.offset(0.5, tp::FillRule::EvenOdd, 1e-3);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "offset of " << islands.size() << " loops (" << islands.size() * 96 << " points) into "
+                      << loops.size() << " loops in " << ms << " ms\n";
+            assert(loops.size() == 1 + 49 * 49);
+            std::size_t outer = 0;
+            for (const tp::Path2& loop : loops)
+            {
+                outer += signedArea(loop) > 0.0 ? 1 : 0;
+            }
+            assert(outer == 1);
+        }
+    }
+
+    return 0;
+}
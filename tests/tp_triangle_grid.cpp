@@ -5,9 +5,12 @@
 
 #include <QtGui/QVector3D>
 
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <optional>
+#include <thread>
 #include <vector>
 
 namespace
@@ -37,6 +40,112 @@ render::Model makeFlatPlate(double size)
     return model;
 }
 
+render::Model makeSlopedSurface(int divisions, double size)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(static_cast<std::size_t>(samples * samples));
+    for (int y = 0; y < samples; ++y)
+    {
+        for (int x = 0; x < samples; ++x)
+        {
+            const double px = (static_cast<double>(x) / divisions) * size;
+            const double py = (static_cast<double>(y) / divisions) * size;
+            const double pz = 0.2 * px + 0.05 * py + std::sin(px * 0.3);
+            render::Vertex& vertex = vertices[static_cast<std::size_t>(y * samples + x)];
+            vertex.position = QVector3D(static_cast<float>(px), static_cast<float>(py), static_cast<float>(pz));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int y = 0; y < divisions; ++y)
+    {
+        for (int x = 0; x < divisions; ++x)
+        {
+            const auto base = static_cast<render::Model::Index>(y * samples + x);
+            const auto next = static_cast<render::Model::Index>(base + samples);
+            indices.insert(indices.end(), {base, base + 1, next + 1, base, next + 1, next});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+// Hammers one shared UniformGrid/GougeChecker from several threads and compares every answer with a
+// single-threaded reference. Run under -fsanitize=thread to check the query path for data races.
+void stressConcurrentQueries()
+{
+    constexpr double kSize = 40.0;
+    constexpr int kThreads = 8;
+    constexpr int kRounds = 20;
+
+    const render::Model model = makeSlopedSurface(48, kSize);
+    const tp::heightfield::UniformGrid uniform(model, 0.5);
+    const tp::GougeChecker checker(model);
+
+    struct Probe
+    {
+        double x{0.0};
+        double y{0.0};
+        bool hit{false};
+        double z{0.0};
+        std::optional<double> surface;
+    };
+
+    std::vector<Probe> probes;
+    for (int i = 0; i < 400; ++i)
+    {
+        Probe probe;
+        probe.x = std::fmod(static_cast<double>(i) * 1.618033988, kSize);
+        probe.y = std::fmod(static_cast<double>(i) * 0.754877666, kSize);
+        probe.hit = uniform.sampleMaxZAtXY(probe.x, probe.y, probe.z);
+        probe.surface = checker.surfaceHeightAt(
+            {static_cast<float>(probe.x), static_cast<float>(probe.y), 100.0f});
+        probes.push_back(probe);
+    }
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        workers.emplace_back([&, t]() {
+            tp::TriangleGrid::QueryContext context;
+            for (int round = 0; round < kRounds; ++round)
+            {
+                for (std::size_t i = 0; i < probes.size(); ++i)
+                {
+                    const Probe& probe = probes[(i + static_cast<std::size_t>(t) * 37) % probes.size()];
+                    double z = 0.0;
+                    const bool useContext = ((round + t) % 2) == 0;
+                    const bool hit = useContext ? uniform.sampleMaxZAtXY(probe.x, probe.y, z, context)
+                                                : uniform.sampleMaxZAtXY(probe.x, probe.y, z);
+                    if (hit != probe.hit || (hit && z != probe.z))
+                    {
+                        mismatches.fetch_add(1, std::memory_order_relaxed);
+                    }
+
+                    const tp::GougeChecker::Vec3 sample{
+                        static_cast<float>(probe.x), static_cast<float>(probe.y), 100.0f};
+                    const auto surface = useContext ? checker.surfaceHeightAt(sample, context)
+                                                    : checker.surfaceHeightAt(sample);
+                    if (surface != probe.surface)
+                    {
+                        mismatches.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    assert(mismatches.load() == 0);
+}
+
 } // namespace
 
 int main()
@@ -76,6 +185,12 @@ int main()
     const double clearance = checker.minClearanceAlong(path, params);
     assert(std::abs(clearance - 5.0) < 1e-6);
 
+    tp::TriangleGrid::QueryContext context;
+    grid.gatherCandidatesAABB(0.0, 0.0, kSize, kSize, context);
+    assert(context.candidates.size() == 2);
+
+    stressConcurrentQueries();
+
     return 0;
 }
 
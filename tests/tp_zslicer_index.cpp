@@ -0,0 +1,192 @@
+#include "render/Model.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <QtGui/QVector3D>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTolerance = 1e-4;
+
+render::Model buildHeightModel(double size, int divisions, const std::function<double(double, double)>& height)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(static_cast<std::size_t>(samples * samples));
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(height(x, y)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices[static_cast<std::size_t>(row * samples + col)] = vertex;
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * samples + col);
+            const auto stride = static_cast<render::Model::Index>(samples);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+// Closed prism whose side walls are single triangles spanning the full height, next to a field of small
+// triangles near the floor.
+render::Model buildPrism(int sides, double radius, double height)
+{
+    std::vector<render::Vertex> vertices;
+    const auto addVertex = [&](double x, double y, double z) {
+        render::Vertex vertex;
+        vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+        vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+        vertices.push_back(vertex);
+        return static_cast<render::Model::Index>(vertices.size() - 1);
+    };
+
+    std::vector<render::Model::Index> indices;
+    const render::Model::Index bottomCentre = addVertex(0.0, 0.0, 0.0);
+    const render::Model::Index topCentre = addVertex(0.0, 0.0, height);
+    std::vector<render::Model::Index> bottom;
+    std::vector<render::Model::Index> top;
+    for (int i = 0; i < sides; ++i)
+    {
+        const double angle = 2.0 * kPi * static_cast<double>(i) / static_cast<double>(sides);
+        bottom.push_back(addVertex(radius * std::cos(angle), radius * std::sin(angle), 0.0));
+        top.push_back(addVertex(radius * std::cos(angle), radius * std::sin(angle), height));
+    }
+    for (int i = 0; i < sides; ++i)
+    {
+        const auto a = static_cast<std::size_t>(i);
+        const auto b = static_cast<std::size_t>((i + 1) % sides);
+        indices.insert(indices.end(), {bottom[a], bottom[b], top[b], bottom[a], top[b], top[a]});
+        indices.insert(indices.end(), {bottomCentre, bottom[b], bottom[a], topCentre, top[a], top[b]});
+    }
+
+    // Small triangles away from the prism, all within a millimetre of the floor.
+    for (int i = 0; i < 2000; ++i)
+    {
+        const double x = 3.0 * radius + static_cast<double>(i % 50);
+        const double y = static_cast<double>(i / 50);
+        const double z = 0.5 + 0.4 * std::sin(static_cast<double>(i));
+        indices.push_back(addVertex(x, y, z));
+        indices.push_back(addVertex(x + 0.8, y, z));
+        indices.push_back(addVertex(x, y + 0.8, z + 0.1));
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+// Triangles whose Z range, widened by the slicing tolerance, contains planeZ.
+std::size_t crossingCount(const render::Model& model, double planeZ)
+{
+    const auto& vertices = model.vertices();
+    const auto& indices = model.indices();
+    std::size_t count = 0;
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const double z0 = vertices[indices[i]].position.z();
+        const double z1 = vertices[indices[i + 1]].position.z();
+        const double z2 = vertices[indices[i + 2]].position.z();
+        if (planeZ >= std::min({z0, z1, z2}) - kTolerance && planeZ <= std::max({z0, z1, z2}) + kTolerance)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+double loopArea(const std::vector<glm::dvec3>& loop)
+{
+    double area = 0.0;
+    for (std::size_t i = 0; i + 1 < loop.size(); ++i)
+    {
+        area += loop[i].x * loop[i + 1].y - loop[i + 1].x * loop[i].y;
+    }
+    return 0.5 * std::abs(area);
+}
+
+} // namespace
+
+int main()
+{
+    // A cone on a plate: each level cuts a thin band of the mesh, and the index only hands out that band
+    // plus its bucket neighbours.
+    {
+        const render::Model cone = buildHeightModel(60.0, 120, [](double x, double y) {
+            return std::max(0.0, 20.0 - std::hypot(x - 30.0, y - 30.0));
+        });
+        const tp::waterline::ZSlicer slicer(cone, kTolerance);
+        const std::size_t triangles = cone.indices().size() / 3;
+        assert(slicer.bucketCount() > 1);
+        for (int level = 1; level < 34; ++level)
+        {
+            const double planeZ = 0.5 * static_cast<double>(level) + 0.013;
+            const std::size_t candidates = slicer.candidateCount(planeZ);
+            assert(candidates >= crossingCount(cone, planeZ));
+            assert(candidates * 20 < triangles);
+
+            const auto loops = slicer.slice(planeZ, 0.0, false, tp::waterline::ZSlicer::SliceMode::Sequential);
+            assert(loops.size() == 1);
+            const double radius = 20.0 - planeZ;
+            assert(std::abs(loopArea(loops.front()) - kPi * radius * radius) < 0.03 * kPi * radius * radius);
+        }
+    }
+
+    // Planes level with flat regions, and just inside the tolerance of them, keep every triangle on them.
+    {
+        const render::Model pocket = buildHeightModel(60.0, 60, [](double x, double y) {
+            return (x > 12.0 && x < 48.0 && y > 12.0 && y < 48.0) ? -6.0 : 0.0;
+        });
+        const tp::waterline::ZSlicer slicer(pocket, kTolerance);
+        for (const double planeZ : {-6.0, -6.0 + 0.9 * kTolerance, -6.0 - 0.9 * kTolerance, -3.0, 0.0,
+                                    -0.9 * kTolerance, 0.9 * kTolerance})
+        {
+            assert(slicer.candidateCount(planeZ) >= crossingCount(pocket, planeZ));
+        }
+        assert(slicer.candidateCount(-6.0 - 2.0 * kTolerance) == 0);
+        assert(slicer.candidateCount(2.0 * kTolerance) == 0);
+        assert(slicer.slice(1.0, 0.0, false).empty());
+        assert(slicer.slice(-7.0, 0.0, false).empty());
+        assert(slicer.slice(-3.0, 0.0, false).size() == 1);
+    }
+
+    // Walls spanning every bucket are listed in each of them, and slicing sees them at every level.
+    {
+        const render::Model prism = buildPrism(64, 10.0, 30.0);
+        const tp::waterline::ZSlicer slicer(prism, kTolerance);
+        const double section = 0.5 * 64.0 * 100.0 * std::sin(2.0 * kPi / 64.0);
+        for (int level = 1; level < 30; ++level)
+        {
+            const double planeZ = static_cast<double>(level) + 0.25;
+            assert(slicer.candidateCount(planeZ) >= crossingCount(prism, planeZ));
+            const auto loops = slicer.slice(planeZ, 0.0, false, tp::waterline::ZSlicer::SliceMode::Parallel);
+            assert(loops.size() == 1);
+            assert(std::abs(loopArea(loops.front()) - section) < 1e-3 * section);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "render/Model.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <QtGui/QVector3D>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+render::Model buildHeightModel(double size, int divisions, const std::function<double(double, double)>& height)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(static_cast<std::size_t>(samples * samples));
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(height(x, y)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices[static_cast<std::size_t>(row * samples + col)] = vertex;
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * samples + col);
+            const auto stride = static_cast<render::Model::Index>(samples);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+} // namespace
+
+int main()
+{
+    // Bumps and a pocket: several loops per level, some levels empty, some on flats.
+    const render::Model part = buildHeightModel(80.0, 160, [](double x, double y) {
+        const double bumps = 4.0 * std::sin(x * 0.15) * std::cos(y * 0.12);
+        return (x > 30.0 && x < 50.0 && y > 30.0 && y < 50.0) ? -8.0 : bumps;
+    });
+    const tp::waterline::ZSlicer slicer(part, 1e-4);
+
+    // Descending levels as the waterline pass emits them, plus levels outside the part and repeats.
+    std::vector<double> levels;
+    for (double planeZ = slicer.maxZ() + 0.5; planeZ >= slicer.minZ() - 0.5; planeZ -= 0.25)
+    {
+        levels.push_back(planeZ);
+    }
+    levels.push_back(-8.0);
+    levels.push_back(0.0);
+    levels.push_back(0.0);
+
+    for (const bool applyOffset : {false, true})
+    {
+        const double toolRadius = applyOffset ? 1.5 : 0.0;
+        const auto parallel = slicer.sliceLevels(levels, toolRadius, applyOffset);
+        const auto sequential = slicer.sliceLevels(levels,
+                                                   toolRadius,
+                                                   applyOffset,
+                                                   tp::waterline::ZSlicer::SliceMode::Sequential);
+        assert(parallel.size() == levels.size() && sequential.size() == levels.size());
+        std::size_t loops = 0;
+        for (std::size_t i = 0; i < levels.size(); ++i)
+        {
+            const auto single = slicer.slice(levels[i], toolRadius, applyOffset);
+            assert(parallel[i] == single);
+            assert(sequential[i] == single);
+            loops += single.size();
+        }
+        assert(loops > levels.size());
+        assert(parallel.front().empty() && parallel[levels.size() - 4].empty());
+    }
+
+    assert(slicer.sliceLevels({}, 0.0, false).empty());
+
+    // A raised cancel flag leaves every level unsliced.
+    std::atomic<bool> cancel{true};
+    const auto cancelled = slicer.sliceLevels(levels, 0.0, false, tp::waterline::ZSlicer::SliceMode::Parallel, &cancel);
+    assert(cancelled.size() == levels.size());
+    assert(std::all_of(cancelled.begin(), cancelled.end(), [](const auto& loops) { return loops.empty(); }));
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "render/Model.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <QtGui/QVector3D>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+render::Model buildHeightModel(double size, int divisions, const std::function<double(double, double)>& height)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices(static_cast<std::size_t>(samples * samples));
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            render::Vertex vertex;
+            vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(height(x, y)));
+            vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+            vertices[static_cast<std::size_t>(row * samples + col)] = vertex;
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * samples + col);
+            const auto stride = static_cast<render::Model::Index>(samples);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+double distanceToLoop(const glm::dvec3& p, const std::vector<glm::dvec3>& loop)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 1; i < loop.size(); ++i)
+    {
+        const glm::dvec2 a(loop[i - 1]);
+        const glm::dvec2 edge = glm::dvec2(loop[i]) - a;
+        const double t = std::clamp(glm::dot(glm::dvec2(p) - a, edge) / glm::dot(edge, edge), 0.0, 1.0);
+        best = std::min(best, glm::length(glm::dvec2(p) - (a + t * edge)));
+    }
+    return best;
+}
+
+// Signed area of a closed loop in XY, and its length.
+double loopArea(const std::vector<glm::dvec3>& loop)
+{
+    double area = 0.0;
+    for (std::size_t i = 1; i < loop.size(); ++i)
+    {
+        area += loop[i - 1].x * loop[i].y - loop[i].x * loop[i - 1].y;
+    }
+    return 0.5 * area;
+}
+
+double loopLength(const std::vector<glm::dvec3>& loop)
+{
+    double length = 0.0;
+    for (std::size_t i = 1; i < loop.size(); ++i)
+    {
+        length += glm::length(glm::dvec2(loop[i]) - glm::dvec2(loop[i - 1]));
+    }
+    return length;
+}
+
+} // namespace
+
+int main()
+{
+    // Terraces one millimetre apart with vertices on every terrace: planes through them meet triangles
+    // lying in the plane, edges in the plane and single vertices on it, the cases that yield more than
+    // one crossing point per edge. Planes between terraces only meet crossing edges.
+    const render::Model terraces = buildHeightModel(80.0, 80, [](double x, double y) {
+        return std::floor(std::max(0.0, 8.0 - std::max(std::abs(x - 40.0), std::abs(y - 40.0)) / 4.0));
+    });
+    const tp::waterline::ZSlicer slicer(terraces, 1e-4);
+
+    std::vector<double> levels;
+    for (int step = -2; step <= 36; ++step)
+    {
+        levels.push_back(0.25 * static_cast<double>(step));
+    }
+
+    std::size_t loopsBetween = 0;
+    for (const double planeZ : levels)
+    {
+        for (const bool applyOffset : {false, true})
+        {
+            const double toolRadius = applyOffset ? 1.0 : 0.0;
+            using Mode = tp::waterline::ZSlicer::SliceMode;
+            const auto sequential = slicer.slice(planeZ, toolRadius, applyOffset, Mode::Sequential);
+            const auto parallel = slicer.slice(planeZ, toolRadius, applyOffset, Mode::Parallel);
+            assert(sequential == parallel);
+            for (const auto& loop : parallel)
+            {
+                assert(loop.size() >= 4);
+                assert(loop.front() == loop.back());
+                assert(std::all_of(loop.begin(), loop.end(), [planeZ](const glm::dvec3& p) { return p.z == planeZ; }));
+            }
+
+            // Between terraces every level is a single square ring around the top.
+            const double terrace = std::floor(planeZ);
+            if (!applyOffset && planeZ > 0.0 && planeZ < 8.0 && planeZ - terrace > 0.1)
+            {
+                assert(parallel.size() == 1);
+                ++loopsBetween;
+            }
+        }
+    }
+    assert(loopsBetween == 24);
+
+    // Grown loops keep the radius from the traced ring and round its corners at most the arc tolerance
+    // outside the true arcs; a looser tolerance takes fewer points.
+    {
+        using Mode = tp::waterline::ZSlicer::SliceMode;
+        const auto ring = slicer.slice(2.5, 0.0, false, Mode::Sequential);
+        assert(ring.size() == 1);
+        std::size_t finePoints = 0;
+        for (const double arcTolerance : {1e-3, 0.05})
+        {
+            const auto grown = slicer.slice(2.5, 1.0, true, Mode::Sequential, arcTolerance);
+            assert(grown.size() == 1);
+            for (const glm::dvec3& p : grown.front())
+            {
+                const double distance = distanceToLoop(p, ring.front());
+                assert(distance >= 1.0 - 1e-6 && distance <= 1.0 + arcTolerance + 1e-6);
+            }
+            if (finePoints == 0)
+            {
+                finePoints = grown.front().size();
+            }
+            else
+            {
+                assert(grown.front().size() < finePoints);
+            }
+        }
+    }
+
+    // Blocks 2 mm tall: two a millimetre apart at mid-height, one holding a narrow and a wide pit, and one
+    // alone. Grown by 1 mm the close pair merges and the narrow pit closes, while the wide pit shrinks and the
+    // lone block grows by exactly its perimeter strip and a disc. No grown point comes within the radius of
+    // a traced loop.
+    {
+        using Mode = tp::waterline::ZSlicer::SliceMode;
+        const auto inside = [](double x, double y, double x0, double x1, double y0, double y1) {
+            return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+        };
+        const render::Model blocks = buildHeightModel(60.0, 60, [&](double x, double y) {
+            if (inside(x, y, 44.0, 45.0, 10.0, 11.0) || inside(x, y, 48.0, 52.0, 14.0, 20.0))
+            {
+                return 0.0;
+            }
+            return (inside(x, y, 5.0, 15.0, 5.0, 15.0) || inside(x, y, 17.0, 27.0, 5.0, 15.0)
+                    || inside(x, y, 40.0, 55.0, 5.0, 25.0) || inside(x, y, 5.0, 10.0, 22.0, 27.0))
+                       ? 2.0
+                       : 0.0;
+        });
+        const tp::waterline::ZSlicer blockSlicer(blocks, 1e-4);
+        const auto traced = blockSlicer.slice(1.0, 0.0, false, Mode::Sequential);
+        assert(traced.size() == 6);
+
+        const double arcTolerance = 1e-3;
+        const auto grown = blockSlicer.slice(1.0, 1.0, true, Mode::Sequential, arcTolerance);
+        assert(grown.size() == 4);
+        for (const auto& loop : grown)
+        {
+            for (const glm::dvec3& p : loop)
+            {
+                for (const auto& tracedLoop : traced)
+                {
+                    assert(distanceToLoop(p, tracedLoop) >= 1.0 - 1e-6);
+                }
+            }
+        }
+
+        const auto lone = std::find_if(traced.begin(), traced.end(), [](const auto& loop) {
+            return loop.front().y > 20.0 && loop.front().x < 20.0;
+        });
+        const auto grownLone = std::find_if(grown.begin(), grown.end(), [](const auto& loop) {
+            return loop.front().y > 20.0 && loop.front().x < 20.0;
+        });
+        assert(lone != traced.end() && grownLone != grown.end());
+        const double expected = std::abs(loopArea(*lone)) + loopLength(*lone) + std::acos(-1.0);
+        const double area = std::abs(loopArea(*grownLone));
+        assert(area >= expected - 1e-6 && area <= expected + 2.0 * std::acos(-1.0) * arcTolerance);
+
+        // The wide pit is the only hole left, running the opposite way round to the outer loops.
+        const auto holes = std::count_if(grown.begin(), grown.end(), [&](const auto& loop) {
+            return (loopArea(loop) > 0.0) != (loopArea(*grownLone) > 0.0);
+        });
+        assert(holes == 1);
+    }
+
+    // Above and below the part nothing is left to slice.
+    assert(slicer.slice(8.5, 0.0, false, tp::waterline::ZSlicer::SliceMode::Parallel).empty());
+    assert(slicer.slice(-0.5, 0.0, false, tp::waterline::ZSlicer::SliceMode::Parallel).empty());
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "render/Model.h"
+#include "tp/waterline/ZSlicer.h"
+
+#include <QtGui/QVector3D>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+void addVertex(std::vector<render::Vertex>& vertices, double x, double y, double z)
+{
+    render::Vertex vertex;
+    vertex.position = QVector3D(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+    vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
+    vertices.push_back(vertex);
+}
+
+render::Model buildHeightModel(double size, int divisions, const std::function<double(double, double)>& height)
+{
+    const int samples = divisions + 1;
+    std::vector<render::Vertex> vertices;
+    const double step = size / static_cast<double>(divisions);
+    for (int row = 0; row < samples; ++row)
+    {
+        for (int col = 0; col < samples; ++col)
+        {
+            const double x = static_cast<double>(col) * step;
+            const double y = static_cast<double>(row) * step;
+            addVertex(vertices, x, y, height(x, y));
+        }
+    }
+
+    std::vector<render::Model::Index> indices;
+    for (int row = 0; row < divisions; ++row)
+    {
+        for (int col = 0; col < divisions; ++col)
+        {
+            const auto base = static_cast<render::Model::Index>(row * samples + col);
+            const auto stride = static_cast<render::Model::Index>(samples);
+            indices.insert(indices.end(), {base, base + 1, base + stride + 1, base, base + stride + 1, base + stride});
+        }
+    }
+
+    render::Model model;
+    model.setMeshData(std::move(vertices), std::move(indices));
+    return model;
+}
+
+// The same triangles with three vertices of their own each, as tessellated CAD imports arrive.
+render::Model unweld(const render::Model& model)
+{
+    std::vector<render::Vertex> vertices;
+    std::vector<render::Model::Index> indices;
+    for (const render::Model::Index index : model.indices())
+    {
+        indices.push_back(static_cast<render::Model::Index>(vertices.size()));
+        vertices.push_back(model.vertices()[index]);
+    }
+    render::Model copy;
+    copy.setMeshData(std::move(vertices), std::move(indices));
+    return copy;
+}
+
+// Closed axis-aligned box, two triangles per face.
+void addBox(std::vector<render::Vertex>& vertices,
+            std::vector<render::Model::Index>& indices,
+            double x0,
+            double x1,
+            double size)
+{
+    const auto base = static_cast<render::Model::Index>(vertices.size());
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        addVertex(vertices, (corner & 1) ? x1 : x0, (corner & 2) ? size : 0.0, (corner & 4) ? size : 0.0);
+    }
+    const auto quad = [&](int a, int b, int c, int d) {
+        indices.insert(indices.end(),
+                       {base + static_cast<render::Model::Index>(a),
+                        base + static_cast<render::Model::Index>(b),
+                        base + static_cast<render::Model::Index>(c),
+                        base + static_cast<render::Model::Index>(a),
+                        base + static_cast<render::Model::Index>(c),
+                        base + static_cast<render::Model::Index>(d)});
+    };
+    quad(0, 2, 3, 1);
+    quad(4, 5, 7, 6);
+    quad(0, 1, 5, 4);
+    quad(1, 3, 7, 5);
+    quad(3, 2, 6, 7);
+    quad(2, 0, 4, 6);
+}
+
+double loopArea(const std::vector<glm::dvec3>& loop)
+{
+    double area = 0.0;
+    for (std::size_t i = 0; i + 1 < loop.size(); ++i)
+    {
+        area += loop[i].x * loop[i + 1].y - loop[i + 1].x * loop[i].y;
+    }
+    return 0.5 * std::abs(area);
+}
+
+} // namespace
+
+int main()
+{
+    // Every edge of a closed box is shared by two triangles.
+    {
+        std::vector<render::Vertex> vertices;
+        std::vector<render::Model::Index> indices;
+        addBox(vertices, indices, 0.0, 10.0, 10.0);
+        render::Model box;
+        box.setMeshData(std::move(vertices), std::move(indices));
+        const tp::waterline::ZSlicer slicer(box, 1e-4);
+        assert(slicer.manifoldEdgeCount() == 18);
+        assert(tp::waterline::ZSlicer(unweld(box), 1e-4).manifoldEdgeCount() == 18);
+    }
+
+    // Storing each triangle with its own vertices changes neither the topology nor the slices.
+    {
+        const render::Model cone = buildHeightModel(60.0, 90, [](double x, double y) {
+            return std::max(0.0, 20.0 - std::hypot(x - 30.0, y - 30.0));
+        });
+        const render::Model separate = unweld(cone);
+        const tp::waterline::ZSlicer welded(cone, 1e-4);
+        const tp::waterline::ZSlicer unwelded(separate, 1e-4);
+        // A height field's border edges belong to one triangle only.
+        assert(welded.manifoldEdgeCount() == 3 * 90 * 90 - 2 * 90);
+        assert(unwelded.manifoldEdgeCount() == welded.manifoldEdgeCount());
+        for (int level = 1; level < 36; ++level)
+        {
+            const double planeZ = 0.5 * static_cast<double>(level) + 0.013;
+            const auto loops = welded.slice(planeZ, 0.0, false);
+            assert(loops.size() == 1);
+            assert(unwelded.slice(planeZ, 0.0, false) == loops);
+        }
+    }
+
+    // Two boxes closer together than the slicing tolerance, with their walls interleaved in the index
+    // list. Matching end points by position can jump from one box to the other at the touching corners;
+    // walking the shared edges keeps each box's section apart.
+    {
+        std::vector<render::Vertex> vertices;
+        std::vector<render::Model::Index> indices;
+        addBox(vertices, indices, 0.0, 10.0, 10.0);
+        addBox(vertices, indices, 10.00002, 20.0, 10.0);
+        std::vector<render::Model::Index> interleaved(indices.begin(), indices.begin() + 18);
+        interleaved.insert(interleaved.end(), indices.begin() + 36, indices.end());
+        interleaved.insert(interleaved.end(), indices.begin() + 18, indices.begin() + 36);
+        render::Model boxes;
+        boxes.setMeshData(std::move(vertices), std::move(interleaved));
+        const tp::waterline::ZSlicer slicer(boxes, 1e-4);
+        assert(slicer.manifoldEdgeCount() == 36);
+        for (const double planeZ : {2.5, 5.0, 7.5})
+        {
+            const auto loops = slicer.slice(planeZ, 0.0, false);
+            assert(loops.size() == 2);
+            for (const auto& loop : loops)
+            {
+                assert(std::abs(loopArea(loop) - 100.0) < 1e-2);
+            }
+        }
+    }
+
+    return 0;
+}
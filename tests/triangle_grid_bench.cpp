@@ -1,6 +1,7 @@
 
 #include "render/Model.h"
 #include "tp/TriangleGrid.h"
+#include "tp/heightfield/UniformGrid.h"
 
 #include "common/log.h"
 
@@ -13,9 +14,9 @@
 #include <sstream>
 #include <vector>
 
-// Micro-benchmark: TriangleGrid candidate gathering.
+// Micro-benchmark: TriangleGrid candidate gathering and UniformGrid height queries.
 // Build: cmake --build <build-dir> --target triangle_grid_bench
-// Run:   triangle_grid_bench [iterations]
+// Run:   triangle_grid_bench [iterations] [plate divisions]
 
 namespace
 {
@@ -34,7 +35,8 @@ render::Model makeTestPlate(int gridResolution, double size)
             const double px = (static_cast<double>(x) / gridResolution) * size;
             const double py = (static_cast<double>(y) / gridResolution) * size;
             render::Vertex vertex;
-            vertex.position = QVector3D(static_cast<float>(px), static_cast<float>(py), 0.0f);
+            const double pz = 2.0 * std::sin(px * 0.15) * std::cos(py * 0.1);
+            vertex.position = QVector3D(static_cast<float>(px), static_cast<float>(py), static_cast<float>(pz));
             vertex.normal = QVector3D(0.0f, 0.0f, 1.0f);
             vertices[static_cast<std::size_t>(y * samples + x)] = vertex;
         }
@@ -65,8 +67,9 @@ render::Model makeTestPlate(int gridResolution, double size)
 int main(int argc, char** argv)
 {
     const int iterations = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 200000;
+    const int divisions = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 64;
 
-    render::Model model = makeTestPlate(64, 128.0);
+    render::Model model = makeTestPlate(divisions, 128.0);
     if (!model.isValid())
     {
         LOG_ERR(Render,
@@ -104,10 +107,65 @@ int main(int argc, char** argv)
     const double ms = std::chrono::duration<double, std::milli>(elapsed).count();
     const double avgCandidates = accumCandidates / static_cast<double>(iterations);
 
+    tp::heightfield::UniformGrid uniform(model, 1.0);
+    std::size_t hits = 0;
+    const auto sampleStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        const double x = std::fmod(static_cast<double>(i) * 0.37, 128.0);
+        const double y = std::fmod(static_cast<double>(i) * 0.61803398875, 128.0);
+        double z = 0.0;
+        if (uniform.sampleMaxZAtXY(x, y, z))
+        {
+            ++hits;
+        }
+    }
+    const double sampleMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sampleStart).count();
+
+    // Raster-style rows at 0.05 mm spacing: the same samples queried point by point and as one batch.
+    constexpr double kRowSpacing = 0.05;
+    const std::size_t rowSamples = static_cast<std::size_t>(128.0 / kRowSpacing) + 1;
+    const std::size_t rowCount = std::max<std::size_t>(1, static_cast<std::size_t>(iterations) / rowSamples);
+    std::vector<double> rowZ(rowSamples);
+    std::size_t rowPointHits = 0;
+    const auto rowPointStart = std::chrono::steady_clock::now();
+    for (std::size_t row = 0; row < rowCount; ++row)
+    {
+        const double y = std::fmod(static_cast<double>(row) * 7.77, 128.0);
+        for (std::size_t i = 0; i < rowSamples; ++i)
+        {
+            double z = 0.0;
+            if (uniform.sampleMaxZAtXY(static_cast<double>(i) * kRowSpacing, y, z))
+            {
+                ++rowPointHits;
+            }
+        }
+    }
+    const double rowPointMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rowPointStart).count();
+
+    std::size_t rowHits = 0;
+    const auto rowStart = std::chrono::steady_clock::now();
+    for (std::size_t row = 0; row < rowCount; ++row)
+    {
+        const double y = std::fmod(static_cast<double>(row) * 7.77, 128.0);
+        rowHits += uniform.sampleMaxZRow(y, 0.0, kRowSpacing, rowSamples, rowZ.data());
+    }
+    const double rowMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rowStart).count();
+
     std::ostringstream summary;
-    summary << "Triangle grid benchmark completed: iterations=" << iterations
+    summary << "Triangle grid benchmark completed: triangles=" << grid.triangleCount()
+            << ", iterations=" << iterations
             << ", elapsed_ms=" << ms
             << ", avg_candidates=" << avgCandidates
+            << ", sample_ms=" << sampleMs
+            << ", sample_hits=" << hits
+            << ", row_samples=" << rowCount * rowSamples
+            << ", row_point_ms=" << rowPointMs
+            << ", row_batch_ms=" << rowMs
+            << ", row_hits=" << rowHits << "/" << rowPointHits
+            << ", row_kernel=" << tp::heightfield::simdLevelName(uniform.simdLevel())
             << ". Use the report to tune gather parameters.";
     LOG_INFO(Render, summary.str());
 